@@ -0,0 +1,879 @@
+// ==============================================================================
+// Benchmark Corpus Implementation
+// ==============================================================================
+
+#include "corpus.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace n2t {
+
+// ==============================================================================
+// CPU
+// ==============================================================================
+
+std::string corpus_cpu_mult() {
+    // 20000 x (123 * 45)
+    return R"(
+    @20000
+    D=A
+    @R10
+    M=D
+(OUTER)
+    @R2
+    M=0
+    @123
+    D=A
+    @R0
+    M=D
+    @45
+    D=A
+    @R1
+    M=D
+(LOOP)
+    @R1
+    D=M
+    @NEXT
+    D;JEQ
+    @R0
+    D=M
+    @R2
+    M=D+M
+    @R1
+    M=M-1
+    @LOOP
+    0;JMP
+(NEXT)
+    @R10
+    MD=M-1
+    @OUTER
+    D;JGT
+)";
+}
+
+std::string corpus_cpu_fill() {
+    // 40 passes over the 8192 screen words; odd passes black, even white
+    return R"(
+    @40
+    D=A
+    @R10
+    M=D
+(PASS)
+    @R10
+    D=M
+    @1
+    D=D&A
+    @R11
+    M=-D
+    @SCREEN
+    D=A
+    @R12
+    M=D
+(FILL)
+    @R11
+    D=M
+    @R12
+    A=M
+    M=D
+    @R12
+    MD=M+1
+    @KBD
+    D=D-A
+    @FILL
+    D;JLT
+    @R10
+    MD=M-1
+    @PASS
+    D;JGT
+)";
+}
+
+std::string corpus_cpu_pong() {
+    // 100000 frames; the ball moves one word column and one row per frame
+    return R"(
+    @5
+    D=A
+    @x
+    M=D
+    @9
+    D=A
+    @y
+    M=D
+    @dx
+    M=1
+    @dy
+    M=1
+    @paddle
+    M=0
+    @SCREEN
+    D=A
+    @addr
+    M=D
+    @paddleaddr
+    M=D
+    @10000
+    D=A
+    @frames
+    M=D
+    @10
+    D=A
+    @framescale
+    M=D
+(FRAME)
+    @addr
+    A=M
+    M=0
+    @paddleaddr
+    A=M
+    M=0
+    @dx
+    D=M
+    @x
+    MD=D+M
+    @XLOW
+    D;JLE
+    @31
+    D=D-A
+    @XHIGH
+    D;JGE
+    @YMOVE
+    0;JMP
+(XLOW)
+    @dx
+    M=1
+    @YMOVE
+    0;JMP
+(XHIGH)
+    @dx
+    M=-1
+(YMOVE)
+    @dy
+    D=M
+    @y
+    MD=D+M
+    @YLOW
+    D;JLE
+    @255
+    D=D-A
+    @YHIGH
+    D;JGE
+    @DRAW
+    0;JMP
+(YLOW)
+    @dy
+    M=1
+    @DRAW
+    0;JMP
+(YHIGH)
+    @dy
+    M=-1
+(DRAW)
+    @y
+    D=M
+    @tmp
+    M=D
+    D=D+M
+    M=D
+    D=D+M
+    M=D
+    D=D+M
+    M=D
+    D=D+M
+    M=D
+    D=D+M
+    @x
+    D=D+M
+    @SCREEN
+    D=D+A
+    @addr
+    M=D
+    A=D
+    M=-1
+    @y
+    D=M
+    @paddle
+    D=D-M
+    @PDOWN
+    D;JGT
+    @PUP
+    D;JLT
+    @PDRAW
+    0;JMP
+(PDOWN)
+    @paddle
+    M=M+1
+    @PDRAW
+    0;JMP
+(PUP)
+    @paddle
+    M=M-1
+(PDRAW)
+    @paddle
+    D=M
+    @tmp
+    M=D
+    D=D+M
+    M=D
+    D=D+M
+    M=D
+    D=D+M
+    M=D
+    D=D+M
+    M=D
+    D=D+M
+    @SCREEN
+    D=D+A
+    @paddleaddr
+    M=D
+    A=D
+    M=1
+    @frames
+    MD=M-1
+    @FRAME
+    D;JGT
+    @10000
+    D=A
+    @frames
+    M=D
+    @framescale
+    MD=M-1
+    @FRAME
+    D;JGT
+)";
+}
+
+std::string corpus_cpu_large_asm() {
+    // 4000 blocks of labels, variables, A- and C-instructions
+    std::string source;
+    for (int i = 0; i < 4000; i++) {
+        std::string n = std::to_string(i);
+        source += "(L" + n + ")\n"
+                  "    @var" + std::to_string(i % 200) + "   // a variable\n"
+                  "    D=M\n"
+                  "    @" + n + "\n"
+                  "    D=D+A\n"
+                  "    @R" + std::to_string(i % 16) + "\n"
+                  "    AM=D-1\n"
+                  "    @L" + std::to_string((i * 7) % 4000) + "\n"
+                  "    D;JGT\n";
+    }
+    return source;
+}
+
+// ==============================================================================
+// VM
+// ==============================================================================
+
+std::string corpus_vm_fib() {
+    return R"(
+function Sys.init 0
+push constant 24
+call Main.fib 1
+pop temp 0
+push constant 0
+return
+
+function Main.fib 0
+push argument 0
+push constant 2
+lt
+if-goto BASE
+push argument 0
+push constant 1
+sub
+call Main.fib 1
+push argument 0
+push constant 2
+sub
+call Main.fib 1
+add
+return
+label BASE
+push argument 0
+return
+)";
+}
+
+/**
+ * @brief Memory.init/alloc/deAlloc: a free list of segments [length, next]
+ *        in the heap (2048-16383). alloc(n) takes the first segment of
+ *        exactly n + 1 words if there is one, and otherwise splits n + 1
+ *        words off the end of the first larger segment; the block's first
+ *        word keeps its length.
+ */
+static const char* VM_MEMORY = R"(
+function Memory.init 0
+push constant 2048
+pop static 0
+push constant 2048
+pop pointer 1
+push constant 14334
+pop that 0
+push constant 0
+pop that 1
+push constant 0
+return
+
+function Memory.alloc 3
+push constant 0
+pop local 1
+push static 0
+pop local 0
+label EXACT_SEARCH
+push local 0
+if-goto EXACT_TEST
+goto SPLIT_START
+label EXACT_TEST
+push local 0
+pop pointer 1
+push that 0
+push argument 0
+push constant 1
+add
+eq
+if-goto EXACT
+push local 0
+pop local 1
+push that 1
+pop local 0
+goto EXACT_SEARCH
+label EXACT
+push that 1
+push local 1
+if-goto LINK
+pop static 0
+goto TAKE
+label LINK
+push local 1
+pop pointer 1
+pop that 1
+label TAKE
+push local 0
+push constant 1
+add
+return
+label SPLIT_START
+push static 0
+pop local 0
+label SPLIT_SEARCH
+push local 0
+pop pointer 1
+push that 0
+push argument 0
+push constant 2
+add
+gt
+if-goto SPLIT
+push that 1
+pop local 0
+goto SPLIT_SEARCH
+label SPLIT
+push that 0
+push argument 0
+sub
+push constant 1
+sub
+pop that 0
+push local 0
+push that 0
+add
+pop local 2
+push local 2
+pop pointer 1
+push argument 0
+push constant 1
+add
+pop that 0
+push local 2
+push constant 1
+add
+return
+
+function Memory.deAlloc 1
+push argument 0
+push constant 1
+sub
+pop local 0
+push local 0
+pop pointer 1
+push static 0
+pop that 1
+push local 0
+pop static 0
+push constant 0
+return
+)";
+
+std::string corpus_vm_alloc() {
+    // 3000 rounds: allocate 8 blocks of sizes 2-9, free the odd then the
+    // even ones
+    std::string source = VM_MEMORY;
+    source += R"(
+function Sys.init 0
+call Memory.init 0
+pop temp 0
+call Main.churn 0
+pop temp 0
+push constant 0
+return
+
+function Main.churn 3
+push constant 8
+call Memory.alloc 1
+pop local 2
+push constant 0
+pop local 0
+label OUTER
+push local 0
+push constant 3000
+lt
+not
+if-goto DONE
+push constant 0
+pop local 1
+label ALLOC
+push local 1
+push constant 8
+lt
+not
+if-goto FREE_ODD_START
+push local 1
+push local 0
+add
+push constant 7
+and
+push constant 2
+add
+call Memory.alloc 1
+push local 2
+push local 1
+add
+pop pointer 1
+pop that 0
+push local 1
+push constant 1
+add
+pop local 1
+goto ALLOC
+label FREE_ODD_START
+push constant 1
+pop local 1
+label FREE_ODD
+push local 1
+push constant 8
+lt
+not
+if-goto FREE_EVEN_START
+push local 2
+push local 1
+add
+pop pointer 1
+push that 0
+call Memory.deAlloc 1
+pop temp 0
+push local 1
+push constant 2
+add
+pop local 1
+goto FREE_ODD
+label FREE_EVEN_START
+push constant 0
+pop local 1
+label FREE_EVEN
+push local 1
+push constant 8
+lt
+not
+if-goto NEXT
+push local 2
+push local 1
+add
+pop pointer 1
+push that 0
+call Memory.deAlloc 1
+pop temp 0
+push local 1
+push constant 2
+add
+pop local 1
+goto FREE_EVEN
+label NEXT
+push local 0
+push constant 1
+add
+pop local 0
+goto OUTER
+label DONE
+push constant 0
+return
+)";
+    return source;
+}
+
+std::string corpus_vm_strings() {
+    std::string source = VM_MEMORY;
+    source += R"(
+function String.new 0
+push constant 3
+call Memory.alloc 1
+pop pointer 0
+push constant 0
+pop this 0
+push argument 0
+pop this 1
+push argument 0
+call Memory.alloc 1
+pop this 2
+push pointer 0
+return
+
+function String.dispose 0
+push argument 0
+pop pointer 0
+push this 2
+call Memory.deAlloc 1
+pop temp 0
+push pointer 0
+call Memory.deAlloc 1
+pop temp 0
+push constant 0
+return
+
+function String.appendChar 0
+push argument 0
+pop pointer 0
+push this 0
+push this 1
+lt
+not
+if-goto FULL
+push this 2
+push this 0
+add
+pop pointer 1
+push argument 1
+pop that 0
+push this 0
+push constant 1
+add
+pop this 0
+label FULL
+push pointer 0
+return
+)";
+
+    // String.appendInt: five decimal digits by repeated subtraction
+    source += "\nfunction String.appendInt 2\npush argument 1\npop local 0\n";
+    for (const char* power : {"10000", "1000", "100", "10", "1"}) {
+        std::string p = power;
+        source += "push constant 0\npop local 1\n"
+                  "label DIGIT" + p + "\n"
+                  "push local 0\npush constant " + p + "\nlt\nif-goto END" + p + "\n"
+                  "push local 0\npush constant " + p + "\nsub\npop local 0\n"
+                  "push local 1\npush constant 1\nadd\npop local 1\n"
+                  "goto DIGIT" + p + "\n"
+                  "label END" + p + "\n"
+                  "push argument 0\npush local 1\npush constant 48\nadd\n"
+                  "call String.appendChar 2\npop temp 0\n";
+    }
+    source += "push argument 0\nreturn\n";
+
+    // 1500 strings of four characters and a number
+    source += R"(
+function Sys.init 0
+call Memory.init 0
+pop temp 0
+call Main.strings 0
+pop temp 0
+push constant 0
+return
+
+function Main.strings 2
+push constant 0
+pop local 0
+label LOOP
+push local 0
+push constant 1500
+lt
+not
+if-goto DONE
+push constant 16
+call String.new 1
+push constant 72
+call String.appendChar 2
+push constant 97
+call String.appendChar 2
+push constant 99
+call String.appendChar 2
+push constant 107
+call String.appendChar 2
+push local 0
+push local 0
+add
+push local 0
+add
+push local 0
+add
+push local 0
+add
+push local 0
+add
+push local 0
+add
+call String.appendInt 2
+pop local 1
+push local 1
+call String.dispose 1
+pop temp 0
+push local 0
+push constant 1
+add
+pop local 0
+goto LOOP
+label DONE
+push constant 0
+return
+)";
+    return source;
+}
+
+std::string corpus_vm_large() {
+    // 500 functions of 40 commands each
+    std::string source;
+    for (int f = 0; f < 500; f++) {
+        std::string name = "Gen.f" + std::to_string(f);
+        source += "function " + name + " 2\n";
+        for (int i = 0; i < 4; i++) {
+            source += "label L" + std::to_string(i) + "\n"
+                      "push argument 0\n"
+                      "push constant " + std::to_string(f + i) + "\n"
+                      "add\n"
+                      "pop local " + std::to_string(i % 2) + "   // comment\n"
+                      "push static " + std::to_string(i) + "\n"
+                      "push local 0\n"
+                      "lt\n"
+                      "if-goto L" + std::to_string(i) + "\n";
+        }
+        source += "push constant 0\nreturn\n\n";
+    }
+    return source;
+}
+
+// ==============================================================================
+// HDL
+// ==============================================================================
+
+std::string corpus_hdl_gate_alu() {
+    return R"(
+CHIP GateALU {
+    IN x[16], y[16], zx, nx, zy, ny, f, no;
+    OUT out[16], zr, ng;
+
+    PARTS:
+    Mux16(a=x, b=false, sel=zx, out=x1);
+    Not16(in=x1, out=notx1);
+    Mux16(a=x1, b=notx1, sel=nx, out=x2);
+    Mux16(a=y, b=false, sel=zy, out=y1);
+    Not16(in=y1, out=noty1);
+    Mux16(a=y1, b=noty1, sel=ny, out=y2);
+    Add16(a=x2, b=y2, out=sum);
+    And16(a=x2, b=y2, out=xandy);
+    Mux16(a=xandy, b=sum, sel=f, out=o1);
+    Not16(in=o1, out=noto1);
+    Mux16(a=o1, b=noto1, sel=no, out=out, out[15]=ng, out[0..7]=lo, out[8..15]=hi);
+    Or8Way(in=lo, out=orlo);
+    Or8Way(in=hi, out=orhi);
+    Or(a=orlo, b=orhi, out=nonzero);
+    Not(in=nonzero, out=zr);
+}
+)";
+}
+
+std::string corpus_hdl_cpu() {
+    return R"(
+CHIP HackCPU {
+    IN inM[16], instruction[16], reset;
+    OUT outM[16], writeM, addressM[15], pc[15];
+
+    PARTS:
+    Not(in=instruction[15], out=isA);
+    And(a=instruction[15], b=instruction[5], out=destA);
+    Or(a=isA, b=destA, out=loadA);
+    Mux16(a=aluOut, b=instruction, sel=isA, out=aIn);
+    Register(in=aIn, load=loadA, out=aOut, out[0..14]=addressM);
+
+    And(a=instruction[15], b=instruction[4], out=loadD);
+    Register(in=aluOut, load=loadD, out=dOut);
+
+    Mux16(a=aOut, b=inM, sel=instruction[12], out=am);
+    ALU(x=dOut, y=am, zx=instruction[11], nx=instruction[10], zy=instruction[9],
+        ny=instruction[8], f=instruction[7], no=instruction[6],
+        out=aluOut, out=outM, zr=zr, ng=ng);
+    And(a=instruction[15], b=instruction[3], out=writeM);
+
+    Or(a=zr, b=ng, out=notPos);
+    Not(in=notPos, out=pos);
+    And(a=instruction[2], b=ng, out=jlt);
+    And(a=instruction[1], b=zr, out=jeq);
+    And(a=instruction[0], b=pos, out=jgt);
+    Or(a=jlt, b=jeq, out=jle);
+    Or(a=jle, b=jgt, out=jump);
+    And(a=instruction[15], b=jump, out=loadPC);
+    PC(in=aOut, load=loadPC, inc=true, reset=reset, out[0..14]=pc);
+}
+)";
+}
+
+/**
+ * @brief Deterministic operands (a 16-bit linear congruential generator).
+ */
+static uint16_t next_operand(uint32_t& seed) {
+    seed = seed * 1103515245u + 12345u;
+    return static_cast<uint16_t>(seed >> 16);
+}
+
+std::string corpus_tst_alu(const std::string& chip, int rows) {
+    // The 18 Hack ALU functions as zx nx zy ny f no
+    static const char* CONTROLS[18] = {
+        "101010", "111111", "111010", "001100", "110000", "001101", "110001",
+        "001111", "110011", "011111", "110111", "001110", "110010", "000010",
+        "010011", "000111", "000000", "010101",
+    };
+    std::string tst = "load " + chip + ".hdl;\n"
+                      "output-list x%B1.16.1 y%B1.16.1 zx%B1.1.1 nx%B1.1.1 zy%B1.1.1 "
+                      "ny%B1.1.1 f%B1.1.1 no%B1.1.1 out%B1.16.1 zr%B1.1.1 ng%B1.1.1;\n";
+    uint32_t seed = 1;
+    for (int row = 0; row < rows; row++) {
+        const char* c = CONTROLS[row % 18];
+        tst += "set x " + std::to_string(next_operand(seed)) +
+               ", set y " + std::to_string(next_operand(seed)) +
+               ", set zx " + c[0] + ", set nx " + c[1] + ", set zy " + c[2] +
+               ", set ny " + c[3] + ", set f " + c[4] + ", set no " + c[5] +
+               ", eval, output;\n";
+    }
+    return tst;
+}
+
+std::string corpus_tst_ram16k(int rows) {
+    std::string tst = "load RAM16K.hdl;\n"
+                      "output-list time%S1.4.1 in%D1.6.1 load%B2.1.2 address%D1.5.1 out%D1.6.1;\n";
+    uint32_t seed = 7;
+    std::vector<uint16_t> addresses;
+    for (int row = 0; row < rows / 2; row++) {
+        uint16_t address = next_operand(seed) & 0x3FFF;
+        addresses.push_back(address);
+        tst += "set address " + std::to_string(address) +
+               ", set in " + std::to_string(next_operand(seed) & 0x7FFF) +
+               ", set load 1, tick, output, tock, output;\n";
+    }
+    for (uint16_t address : addresses) {
+        tst += "set address " + std::to_string(address) + ", set load 0, eval, output;\n";
+    }
+    return tst;
+}
+
+std::string corpus_tst_cpu(int cycles) {
+    // Mult's loop body: @R0, D=M, @R2, M=D+M, @R1, MD=M-1, @4, D;JGT
+    static const uint16_t MIX[8] = {
+        0, 0b1111110000010000, 2, 0b1111000010001000,
+        1, 0b1111110010011000, 4, 0b1110001100000001,
+    };
+    std::string tst = "load HackCPU.hdl;\n"
+                      "output-list inM%D1.6.1 instruction%B0.16.0 reset%B2.1.2 outM%D1.6.1 "
+                      "writeM%B3.1.3 addressM%D0.5.0 pc%D0.5.0;\n"
+                      "set reset 1, tick, tock, set reset 0;\n";
+    uint32_t seed = 3;
+    for (int cycle = 0; cycle < cycles; cycle++) {
+        std::string bits;
+        for (int b = 15; b >= 0; b--) bits += (MIX[cycle % 8] >> b) & 1 ? '1' : '0';
+        tst += "set instruction %B" + bits +
+               ", set inM " + std::to_string(next_operand(seed) & 0x00FF) +
+               ", tick, output, tock, output;\n";
+    }
+    return tst;
+}
+
+// ==============================================================================
+// Jack
+// ==============================================================================
+
+/**
+ * @brief Main.jack, and the VM it compiles to with each command's line:
+ *
+ *    2  function int twice(int x) {
+ *    3      return x + x;
+ *    4  }
+ *    5  function void main() {
+ *    6      var int i, sum;
+ *    7      let i = 0;
+ *    8      let sum = 0;
+ *    9      while (i < 2000) {
+ *   10          let sum = sum + Main.twice(i);
+ *   11          let i = i + 1;
+ *   12      }
+ *   13      return;
+ *   14  }
+ */
+struct JackVMLine {
+    const char* command;
+    int jack_line;      // 0 = unmapped
+    const char* function;
+};
+
+static const JackVMLine JACK_PROGRAM[] = {
+    {"function Main.twice 0", 0, "Main.twice"},
+    {"push argument 0", 3, "Main.twice"},
+    {"push argument 0", 3, "Main.twice"},
+    {"add", 3, "Main.twice"},
+    {"return", 3, "Main.twice"},
+    {"function Main.main 2", 0, "Main.main"},
+    {"push constant 0", 7, "Main.main"},
+    {"pop local 0", 7, "Main.main"},
+    {"push constant 0", 8, "Main.main"},
+    {"pop local 1", 8, "Main.main"},
+    {"label WHILE_EXP0", 0, "Main.main"},
+    {"push local 0", 9, "Main.main"},
+    {"push constant 2000", 9, "Main.main"},
+    {"lt", 9, "Main.main"},
+    {"not", 9, "Main.main"},
+    {"if-goto WHILE_END0", 9, "Main.main"},
+    {"push local 1", 10, "Main.main"},
+    {"push local 0", 10, "Main.main"},
+    {"call Main.twice 1", 10, "Main.main"},
+    {"add", 10, "Main.main"},
+    {"pop local 1", 10, "Main.main"},
+    {"push local 0", 11, "Main.main"},
+    {"push constant 1", 11, "Main.main"},
+    {"add", 11, "Main.main"},
+    {"pop local 0", 11, "Main.main"},
+    {"goto WHILE_EXP0", 11, "Main.main"},
+    {"label WHILE_END0", 0, "Main.main"},
+    {"push constant 0", 13, "Main.main"},
+    {"return", 13, "Main.main"},
+};
+
+std::string corpus_jack_vm() {
+    std::string vm;
+    for (const JackVMLine& line : JACK_PROGRAM) vm += std::string(line.command) + "\n";
+    return vm;
+}
+
+std::string corpus_jack_smap() {
+    std::string smap;
+    size_t index = 0;
+    for (const JackVMLine& line : JACK_PROGRAM) {
+        if (line.jack_line) {
+            smap += "MAP Main:" + std::to_string(line.jack_line) + " -> " + std::to_string(index) +
+                    " [" + line.function + "]\n";
+        }
+        index++;
+    }
+    smap += "FUNC Main.twice\n"
+            "VAR argument int x 0\n"
+            "FUNC Main.main\n"
+            "VAR local int i 0\n"
+            "VAR local int sum 1\n";
+    return smap;
+}
+
+}  // namespace n2t
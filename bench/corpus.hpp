@@ -0,0 +1,117 @@
+// ==============================================================================
+// Benchmark Corpus
+// ==============================================================================
+// The programs n2t_bench runs. Everything is generated in process from
+// fixed parameters, so every build measures exactly the same work and no
+// file on disk can drift from the baseline it was compared against.
+//
+// Programs halt on their own (the CPU ones run off the end of the ROM, the
+// VM ones return from Sys.init), so "to halt" is a fixed amount of work.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_BENCH_CORPUS_HPP
+#define NAND2TETRIS_BENCH_CORPUS_HPP
+
+#include <string>
+
+namespace n2t {
+
+// =============================================================================
+// CPU (Hack assembly)
+// =============================================================================
+
+/**
+ * @brief Mult.asm (R2 = R0 * R1 by repeated addition) in an outer loop.
+ */
+std::string corpus_cpu_mult();
+
+/**
+ * @brief Fill.asm without the keyboard: the whole screen is blackened
+ *        and cleared, alternately, a fixed number of times.
+ */
+std::string corpus_cpu_fill();
+
+/**
+ * @brief A Pong-style frame loop: a ball bouncing off the screen edges
+ *        (erase, move, bounce, draw) and a paddle following it.
+ */
+std::string corpus_cpu_pong();
+
+/**
+ * @brief A long straight-line program for assembler throughput.
+ */
+std::string corpus_cpu_large_asm();
+
+// =============================================================================
+// VM
+// =============================================================================
+
+/**
+ * @brief Recursive Fibonacci, called from Sys.init.
+ */
+std::string corpus_vm_fib();
+
+/**
+ * @brief A first-fit free-list Memory.alloc/deAlloc in VM code (the Jack
+ *        OS pattern), churned by allocating and freeing mixed sizes.
+ */
+std::string corpus_vm_alloc();
+
+/**
+ * @brief A String class over the same allocator: strings created,
+ *        appended to (characters and integers), and disposed.
+ */
+std::string corpus_vm_strings();
+
+/**
+ * @brief A long VM program for parser throughput.
+ */
+std::string corpus_vm_large();
+
+// =============================================================================
+// HDL
+// =============================================================================
+
+/**
+ * @brief The ALU built from 16-bit gates (chip GateALU).
+ */
+std::string corpus_hdl_gate_alu();
+
+/**
+ * @brief The Hack CPU built from ALU, Register and PC (chip HackCPU).
+ */
+std::string corpus_hdl_cpu();
+
+/**
+ * @brief A test script driving an ALU-shaped chip through every control
+ *        combination with pseudo-random operands.
+ */
+std::string corpus_tst_alu(const std::string& chip, int rows);
+
+/**
+ * @brief A test script writing and reading back RAM16K addresses.
+ */
+std::string corpus_tst_ram16k(int rows);
+
+/**
+ * @brief A test script clocking HackCPU through a fixed instruction mix.
+ */
+std::string corpus_tst_cpu(int cycles);
+
+// =============================================================================
+// Jack
+// =============================================================================
+
+/**
+ * @brief A Main.jack loop calling a helper, compiled to VM by hand.
+ */
+std::string corpus_jack_vm();
+
+/**
+ * @brief The source map of corpus_jack_vm().
+ */
+std::string corpus_jack_smap();
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_BENCH_CORPUS_HPP
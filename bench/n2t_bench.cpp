@@ -0,0 +1,449 @@
+// ==============================================================================
+// n2t_bench — Benchmark Suite for the Simulation Engines
+// ==============================================================================
+// Run:      n2t_bench [-r 5] [--filter cpu/] [--out results.json]
+// Compare:  n2t_bench --baseline baseline.json [--threshold 10]
+// List:     n2t_bench --list
+//
+// Every benchmark runs its corpus program (see corpus.hpp) several times
+// and reports the min/median/mean wall time of the measured part, the
+// amount of work done, and the rate at the median time. Micro benchmarks
+// measure one engine operation (assembling, parsing); macro benchmarks
+// run a whole program, with loading outside the measurement.
+//
+// Output is one JSON object, one benchmark per line:
+//
+//   {
+//     "format": "n2t-bench-1",
+//     "repetitions": 5,
+//     "benchmarks": [
+//       {"name": "cpu/mult/switch", "kind": "macro", "unit": "instructions",
+//        "work": 9460000, "min_ms": ..., "median_ms": ..., "mean_ms": ...,
+//        "mops": ...},
+//       ...
+//     ]
+//   }
+//
+// "mops" is millions of work units per second at the median time. With
+// --baseline, the median of every benchmark is compared against a file
+// written by an earlier run; the exit status is 1 if any benchmark got
+// slower by more than the threshold (percent, default 10).
+// ==============================================================================
+
+#include "bench_report.hpp"
+#include "corpus.hpp"
+#include "assembler.hpp"
+#include "cpu.hpp"
+#include "error.hpp"
+#include "hdl_engine.hpp"
+#include "jack_debugger.hpp"
+#include "vm_engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace n2t;
+
+// ==============================================================================
+// Benchmarks
+// ==============================================================================
+
+/**
+ * @brief One benchmark. run() does the measured work once and returns the
+ *        work done; whatever it does before calling start() is not timed.
+ */
+struct Benchmark {
+    std::string name;
+    std::string kind;       // "micro" or "macro"
+    std::string unit;       // What "work" counts
+    std::function<uint64_t(const std::function<void()>& start)> run;
+};
+
+struct BenchResult {
+    const Benchmark* benchmark = nullptr;
+    uint64_t work = 0;
+    std::vector<double> times_ms;
+};
+
+static const char* dispatch_name(CPUDispatch dispatch) {
+    switch (dispatch) {
+        case CPUDispatch::SWITCH:   return "switch";
+        case CPUDispatch::THREADED: return "threaded";
+        case CPUDispatch::BLOCK:    return "block";
+        case CPUDispatch::JIT:      return "jit";
+    }
+    return "switch";
+}
+
+static void add_cpu(std::vector<Benchmark>& list, const std::string& program,
+                    std::string (*source)()) {
+    std::vector<CPUDispatch> dispatches = {CPUDispatch::SWITCH, CPUDispatch::THREADED,
+                                           CPUDispatch::BLOCK};
+    if (jit_supported()) dispatches.push_back(CPUDispatch::JIT);
+    for (CPUDispatch dispatch : dispatches) {
+        list.push_back({"cpu/" + program + "/" + dispatch_name(dispatch), "macro", "instructions",
+                        [source, dispatch](const std::function<void()>& start) {
+                            CPUEngine cpu;
+                            cpu.set_dispatch(dispatch);
+                            cpu.load_asm(source());
+                            start();
+                            if (cpu.run() != CPUState::HALTED) {
+                                throw RuntimeError("CPU benchmark did not halt: " +
+                                                   cpu.get_error_message());
+                            }
+                            return cpu.get_stats().instructions_executed;
+                        }});
+    }
+}
+
+static void add_vm(std::vector<Benchmark>& list, const std::string& program,
+                   std::string (*source)()) {
+    struct Variant {
+        const char* name;
+        VMDispatch dispatch;
+        bool superinstructions;
+    };
+    static const Variant variants[] = {
+        {"switch", VMDispatch::SWITCH, false},
+        {"threaded_unfused", VMDispatch::THREADED, false},
+        {"threaded", VMDispatch::THREADED, true},
+    };
+    for (const Variant& variant : variants) {
+        list.push_back({"vm/" + program + "/" + variant.name, "macro", "commands",
+                        [source, variant](const std::function<void()>& start) {
+                            VMEngine vm;
+                            vm.set_dispatch(variant.dispatch);
+                            vm.set_superinstructions(variant.superinstructions);
+                            vm.load_string(source(), "Bench.vm");
+                            start();
+                            if (vm.run() != VMState::HALTED) {
+                                throw RuntimeError("VM benchmark did not halt: " +
+                                                   vm.get_error_message());
+                            }
+                            return vm.get_stats().instructions_executed;
+                        }});
+    }
+}
+
+/**
+ * @brief A test script run through TstRunner; the work is output rows.
+ */
+static void add_hdl(std::vector<Benchmark>& list, const std::string& name, std::string (*hdl)(),
+                    std::function<std::string()> tst) {
+    list.push_back({"hdl/" + name, "macro", "rows",
+                    [hdl, tst](const std::function<void()>& start) {
+                        HDLEngine engine;
+                        if (hdl) engine.load_hdl_string(hdl());
+                        std::string script = tst();
+                        start();
+                        HDLState state = engine.run_test_string(script);
+                        if (state == HDLState::ERROR) {
+                            throw RuntimeError("HDL benchmark failed: " + engine.get_error_message());
+                        }
+                        // Every output line but the header is a row
+                        const std::string& table = engine.get_output_table();
+                        return static_cast<uint64_t>(std::count(table.begin(), table.end(), '\n') - 1);
+                    }});
+}
+
+static std::vector<Benchmark> all_benchmarks() {
+    std::vector<Benchmark> list;
+
+    // Micro: front ends
+    list.push_back({"asm/assemble", "micro", "lines", [](const std::function<void()>& start) {
+                        std::string source = corpus_cpu_large_asm();
+                        start();
+                        return static_cast<uint64_t>(assemble_hack(source).source_map.lines.size());
+                    }});
+    list.push_back({"vm/parse", "micro", "commands", [](const std::function<void()>& start) {
+                        std::string source = corpus_vm_large();
+                        VMEngine vm;
+                        start();
+                        vm.load_string(source, "Gen.vm");
+                        return static_cast<uint64_t>(vm.get_command_count());
+                    }});
+
+    // CPU
+    add_cpu(list, "mult", corpus_cpu_mult);
+    add_cpu(list, "fill", corpus_cpu_fill);
+    add_cpu(list, "pong", corpus_cpu_pong);
+
+    // VM
+    add_vm(list, "fib", corpus_vm_fib);
+    add_vm(list, "alloc", corpus_vm_alloc);
+    add_vm(list, "strings", corpus_vm_strings);
+
+    // HDL
+    add_hdl(list, "alu", nullptr, [] { return corpus_tst_alu("ALU", 2000); });
+    add_hdl(list, "gate_alu", corpus_hdl_gate_alu, [] { return corpus_tst_alu("GateALU", 2000); });
+    add_hdl(list, "ram16k", nullptr, [] { return corpus_tst_ram16k(2000); });
+    add_hdl(list, "cpu", corpus_hdl_cpu, [] { return corpus_tst_cpu(1000); });
+
+    // Jack debugger: the cost of one Jack-level step
+    auto jack = [](VMState (JackDebugger::*step)()) {
+        return [step](const std::function<void()>& start) {
+            JackDebugger dbg;
+            dbg.load(corpus_jack_vm(), corpus_jack_smap(), "Main");
+            dbg.set_entry_point("Main.main");
+            dbg.reset();
+            dbg.step();     // Onto the first Jack line
+            start();
+            uint64_t steps = 0;
+            VMState state;
+            do {
+                state = (dbg.*step)();
+                steps++;
+            } while (state != VMState::HALTED && state != VMState::ERROR);
+            if (state == VMState::ERROR) throw RuntimeError("Jack benchmark failed");
+            return steps;
+        };
+    };
+    list.push_back({"jack/step", "macro", "steps", jack(&JackDebugger::step)});
+    list.push_back({"jack/step_over", "macro", "steps", jack(&JackDebugger::step_over)});
+
+    return list;
+}
+
+// ==============================================================================
+// Running
+// ==============================================================================
+
+static BenchResult run_benchmark(const Benchmark& benchmark, unsigned repetitions) {
+    BenchResult result;
+    result.benchmark = &benchmark;
+    for (unsigned r = 0; r < repetitions; r++) {
+        BenchClock::time_point started;
+        auto start = [&started] { started = BenchClock::now(); };
+        started = BenchClock::now();
+        result.work = benchmark.run(start);
+        result.times_ms.push_back(elapsed_ms(started, BenchClock::now()));
+    }
+    return result;
+}
+
+static double median_of(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+static std::string results_json(const std::vector<BenchResult>& results, unsigned repetitions) {
+    std::ostringstream out;
+    out << "{\n"
+        << "  \"format\": \"n2t-bench-1\",\n"
+        << "  \"repetitions\": " << repetitions << ",\n"
+        << "  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        const std::vector<double>& t = result.times_ms;
+        double sum = 0;
+        for (double v : t) sum += v;
+        double median = median_of(t);
+        double mops = median > 0 ? static_cast<double>(result.work) / (median * 1000.0) : 0.0;
+        out << (i ? ",\n" : "\n")
+            << "    {\"name\": " << bench_json_string(result.benchmark->name)
+            << ", \"kind\": " << bench_json_string(result.benchmark->kind)
+            << ", \"unit\": " << bench_json_string(result.benchmark->unit)
+            << ", \"work\": " << result.work
+            << ", \"min_ms\": " << bench_json_number(*std::min_element(t.begin(), t.end()))
+            << ", \"median_ms\": " << bench_json_number(median)
+            << ", \"mean_ms\": " << bench_json_number(sum / static_cast<double>(t.size()))
+            << ", \"mops\": " << bench_json_number(mops) << "}";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+// ==============================================================================
+// Baseline Comparison
+// ==============================================================================
+
+/**
+ * @brief Median time per benchmark name from a file written by n2t_bench
+ *        (one benchmark object per line).
+ */
+static std::map<std::string, double> read_baseline(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) throw FileError(path, "cannot open baseline");
+    std::map<std::string, double> medians;
+    std::string line;
+    LineNumber line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        const std::string name_key = "\"name\": \"";
+        const std::string median_key = "\"median_ms\": ";
+        size_t name = line.find(name_key);
+        size_t median = line.find(median_key);
+        if (name == std::string::npos || median == std::string::npos) continue;
+        name += name_key.size();
+        size_t name_end = line.find('"', name);
+        if (name_end == std::string::npos) continue;
+        double value;
+        try {
+            value = std::stod(line.substr(median + median_key.size()));
+        } catch (const std::exception&) {
+            throw ParseError(path, line_number, "median_ms is not a number");
+        }
+        medians[line.substr(name, name_end - name)] = value;
+    }
+    return medians;
+}
+
+/**
+ * @brief Value of a numeric command-line option, which must be all number
+ */
+static double parse_number(const std::string& option, const std::string& text) {
+    size_t used = 0;
+    double value = 0;
+    try {
+        value = std::stod(text, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size() || !std::isfinite(value)) {
+        throw RuntimeError("invalid value for " + option + ": '" + text + "'");
+    }
+    return value;
+}
+
+/**
+ * @brief Width of a name column: the longest name plus a space.
+ */
+static int name_width(const std::vector<Benchmark>& benchmarks) {
+    size_t longest = 0;
+    for (const Benchmark& b : benchmarks) {
+        longest = std::max(longest, b.name.size());
+    }
+    return static_cast<int>(longest) + 1;
+}
+
+/**
+ * @brief Print a comparison table; returns the number of regressions.
+ */
+static int compare(const std::vector<BenchResult>& results,
+                   const std::map<std::string, double>& baseline, double threshold,
+                   int width) {
+    int regressions = 0;
+    std::cerr << std::left << std::setw(width) << "benchmark" << std::right << std::setw(13)
+              << "baseline ms" << std::setw(13) << "current ms" << std::setw(10) << "change" << "\n";
+    for (const BenchResult& result : results) {
+        const std::string& name = result.benchmark->name;
+        double current = median_of(result.times_ms);
+        std::cerr << std::left << std::setw(width) << name << std::right << std::fixed
+                  << std::setprecision(3);
+        auto it = baseline.find(name);
+        if (it == baseline.end() || it->second <= 0) {
+            std::cerr << std::setw(13) << "-" << std::setw(13) << current << std::setw(10) << "new"
+                      << "\n";
+            continue;
+        }
+        double change = (current - it->second) / it->second * 100.0;
+        std::cerr << std::setw(13) << it->second << std::setw(13) << current << std::setw(9)
+                  << std::showpos << std::setprecision(1) << change << std::noshowpos << "%";
+        if (change > threshold) {
+            std::cerr << "  REGRESSION";
+            regressions++;
+        }
+        std::cerr << "\n";
+    }
+    return regressions;
+}
+
+// ==============================================================================
+// Main
+// ==============================================================================
+
+static void print_usage() {
+    std::cout << "Usage:\n"
+              << "  n2t_bench [options]                  Run the benchmarks, print JSON\n"
+              << "    -r <reps>                          Repetitions per benchmark (default 5)\n"
+              << "    --filter <text>                    Only benchmarks whose name contains text\n"
+              << "    --out <file.json>                  Write the JSON to a file\n"
+              << "    --baseline <file.json>             Compare medians against an earlier run;\n"
+              << "                                       exit 1 on a regression\n"
+              << "    --threshold <percent>              Allowed slowdown (default 10)\n"
+              << "  n2t_bench --list                     List the benchmarks\n"
+              << "  n2t_bench --help                     Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    unsigned repetitions = 5;
+    std::string filter, out_path, baseline_path;
+    double threshold = 10.0;
+    bool list_only = false;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string opt = argv[i];
+            if (opt == "--help" || opt == "-h") {
+                print_usage();
+                return 0;
+            } else if (opt == "--list") {
+                list_only = true;
+            } else if (opt == "-r" && i + 1 < argc) {
+                double reps = parse_number(opt, argv[++i]);
+                if (reps < 1 || reps > 1e6 || reps != std::floor(reps)) {
+                    throw RuntimeError("-r takes a whole number from 1 to 1000000");
+                }
+                repetitions = static_cast<unsigned>(reps);
+            } else if (opt == "--filter" && i + 1 < argc) {
+                filter = argv[++i];
+            } else if (opt == "--out" && i + 1 < argc) {
+                out_path = argv[++i];
+            } else if (opt == "--baseline" && i + 1 < argc) {
+                baseline_path = argv[++i];
+            } else if (opt == "--threshold" && i + 1 < argc) {
+                threshold = parse_number(opt, argv[++i]);
+            } else {
+                throw RuntimeError("unknown option " + opt);
+            }
+        }
+    } catch (const N2TError& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        print_usage();
+        return 1;
+    }
+
+    std::vector<Benchmark> benchmarks = all_benchmarks();
+    const int width = name_width(benchmarks);
+    if (list_only) {
+        for (const Benchmark& b : benchmarks) {
+            std::cout << std::left << std::setw(width) << b.name << b.kind << ", " << b.unit << "\n";
+        }
+        return 0;
+    }
+
+    try {
+        std::map<std::string, double> baseline;
+        if (!baseline_path.empty()) baseline = read_baseline(baseline_path);
+
+        std::vector<BenchResult> results;
+        for (const Benchmark& b : benchmarks) {
+            if (!filter.empty() && b.name.find(filter) == std::string::npos) continue;
+            std::cerr << "  " << b.name << "...\n";
+            results.push_back(run_benchmark(b, repetitions));
+        }
+
+        std::string json = results_json(results, repetitions);
+        if (out_path.empty()) {
+            std::cout << json;
+        } else {
+            std::ofstream file(out_path);
+            if (!file) throw FileError(out_path, "cannot write results");
+            file << json;
+        }
+
+        if (!baseline_path.empty() && compare(results, baseline, threshold, width) > 0) return 1;
+    } catch (const N2TError& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+// ==============================================================================
+// Benchmark Report — shared by the CLIs' --bench modes
+// ==============================================================================
+// A benchmark loads a program and runs it several times, each time in a
+// fresh engine, timing the load (read + parse/assemble) and the run
+// separately. The report is one JSON object:
+//
+//   {
+//     "tool": "cpu_sim", "program": "Pong.hack", "budget": 10000000,
+//     "repetitions": 5, "config": {"dispatch": "jit"},
+//     "state": "budget",
+//     "runs": [{"load_ms": 1.2, "run_ms": 40.1, "instructions": 10000000,
+//               "mips": 249.4}, ...],
+//     "load_ms": {"min": ..., "median": ..., "mean": ...},
+//     "run_ms": {...}, "mips": {...},
+//     "counts": {"instructions_executed": ..., ...}
+//   }
+//
+// "counts" are the engine's statistics after the last run (every run
+// executes the same instructions). MIPS is millions of instructions per
+// second of run time.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CLI_BENCH_REPORT_HPP
+#define NAND2TETRIS_CLI_BENCH_REPORT_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace n2t {
+
+using BenchClock = std::chrono::steady_clock;
+
+inline double elapsed_ms(BenchClock::time_point start, BenchClock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * @brief One repetition of a benchmark.
+ */
+struct BenchRun {
+    double load_ms = 0;
+    double run_ms = 0;
+    uint64_t instructions = 0;
+
+    double mips() const {
+        return run_ms > 0 ? static_cast<double>(instructions) / (run_ms * 1000.0) : 0.0;
+    }
+};
+
+/**
+ * @brief Everything a --bench report contains besides the runs.
+ */
+struct BenchReport {
+    std::string tool;
+    std::string program;
+    uint64_t budget = 0;                                        // 0 = run to halt
+    std::vector<std::pair<std::string, std::string>> config;    // Engine settings
+    std::string state;                                          // How the last run ended
+    std::vector<BenchRun> runs;
+    std::vector<std::pair<std::string, uint64_t>> counts;       // Per-category statistics
+};
+
+inline std::string bench_json_string(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+inline std::string bench_json_number(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+}
+
+/**
+ * @brief {"min", "median", "mean"} of one measurement across the runs.
+ */
+inline std::string bench_json_summary(std::vector<double> values) {
+    if (values.empty()) return "null";
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    double median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+    double sum = 0;
+    for (double v : values) sum += v;
+    return "{\"min\": " + bench_json_number(values.front()) +
+           ", \"median\": " + bench_json_number(median) +
+           ", \"mean\": " + bench_json_number(sum / static_cast<double>(n)) + "}";
+}
+
+inline std::string bench_json(const BenchReport& report) {
+    std::ostringstream out;
+    out << "{\n"
+        << "  \"tool\": " << bench_json_string(report.tool) << ",\n"
+        << "  \"program\": " << bench_json_string(report.program) << ",\n"
+        << "  \"budget\": " << report.budget << ",\n"
+        << "  \"repetitions\": " << report.runs.size() << ",\n"
+        << "  \"config\": {";
+    for (size_t i = 0; i < report.config.size(); i++) {
+        out << (i ? ", " : "") << bench_json_string(report.config[i].first) << ": "
+            << bench_json_string(report.config[i].second);
+    }
+    out << "},\n"
+        << "  \"state\": " << bench_json_string(report.state) << ",\n"
+        << "  \"runs\": [";
+    std::vector<double> load_ms, run_ms, mips;
+    for (size_t i = 0; i < report.runs.size(); i++) {
+        const BenchRun& run = report.runs[i];
+        out << (i ? ",\n" : "\n") << "    {\"load_ms\": " << bench_json_number(run.load_ms)
+            << ", \"run_ms\": " << bench_json_number(run.run_ms)
+            << ", \"instructions\": " << run.instructions
+            << ", \"mips\": " << bench_json_number(run.mips()) << "}";
+        load_ms.push_back(run.load_ms);
+        run_ms.push_back(run.run_ms);
+        mips.push_back(run.mips());
+    }
+    out << "\n  ],\n"
+        << "  \"load_ms\": " << bench_json_summary(load_ms) << ",\n"
+        << "  \"run_ms\": " << bench_json_summary(run_ms) << ",\n"
+        << "  \"mips\": " << bench_json_summary(mips) << ",\n"
+        << "  \"counts\": {";
+    for (size_t i = 0; i < report.counts.size(); i++) {
+        out << (i ? ", " : "") << bench_json_string(report.counts[i].first) << ": "
+            << report.counts[i].second;
+    }
+    out << "}\n}\n";
+    return out.str();
+}
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CLI_BENCH_REPORT_HPP
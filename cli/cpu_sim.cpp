@@ -1,17 +1,30 @@
 // ==============================================================================
 // cpu_sim — Hack CPU Simulator CLI
 // ==============================================================================
-// Batch:       cpu_sim --run Prog.hack [-n 1000]
+// Batch:       cpu_sim --run Prog.hack [-n 1000] [--profile]
+// Profile:     cpu_sim --profile Prog.hack [-n 1000]
 // Interactive: cpu_sim Prog.hack
+// Convert:     cpu_sim --convert Prog.hack Prog.hackb
+// CFG:         cpu_sim --cfg Prog.hack [--json]
+// Benchmark:   cpu_sim --bench Prog.hack [-n 10000000] [-r 5] [--dispatch jit]
+//
+// Prog.asm can be passed wherever Prog.hack is; it is assembled in process
+// and the REPL then shows its labels and source lines.
 // ==============================================================================
 
 #include "cpu.hpp"
+#include "assembler.hpp"
+#include "bench_report.hpp"
+#include "cpu_cfg.hpp"
+#include "cpu_profile.hpp"
 #include "error.hpp"
 #include "line_editor.hpp"
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
 #include <iomanip>
 
@@ -20,7 +33,19 @@ using namespace n2t;
 static void print_usage() {
     std::cout << "Usage:\n"
               << "  cpu_sim --run Prog.hack [-n <max_instructions>]   Run in batch mode\n"
+              << "                                                     (stops early in an idle END/wait loop)\n"
+              << "          [--profile]                                Also print hot instructions, blocks,\n"
+              << "                                                     loops and an annotated disassembly\n"
+              << "  cpu_sim --profile Prog.hack [-n <max>]             Same as --run ... --profile\n"
               << "  cpu_sim Prog.hack                                  Interactive REPL\n"
+              << "  cpu_sim --convert Prog.hack Prog.hackb             Write a binary ROM image\n"
+              << "                                                     (.hackb loads anywhere .hack does)\n"
+              << "  cpu_sim --cfg Prog.hack [--json]                   Print the control-flow graph as\n"
+              << "                                                     Graphviz dot (or JSON)\n"
+              << "  cpu_sim --bench Prog.hack [-n <max>] [-r <reps>]   Time load and run, print JSON\n"
+              << "          [--dispatch switch|threaded|block|jit]     (runs to halt or an idle loop\n"
+              << "                                                     without -n; 5 repetitions)\n"
+              << "  Prog.asm is accepted wherever Prog.hack is (assembled on load)\n"
               << "  cpu_sim --help                                     Show this help\n";
 }
 
@@ -40,6 +65,21 @@ static void print_state(CPUState state, const CPUEngine& cpu) {
             std::cout << "[PAUSED]";
             if (cpu.get_pause_reason() == CPUPauseReason::BREAKPOINT)
                 std::cout << " breakpoint at PC=" << cpu.get_pc();
+            else if (cpu.get_pause_reason() == CPUPauseReason::IDLE_LOOP)
+                std::cout << " idle loop at PC=" << cpu.get_pc();
+            else if (cpu.get_pause_reason() == CPUPauseReason::HISTORY_START)
+                std::cout << " start of recorded history at PC=" << cpu.get_pc();
+            else if (cpu.get_pause_reason() == CPUPauseReason::WATCHPOINT) {
+                const WatchHit& hit = cpu.get_watch_hit();
+                if (hit.kind == WatchKind::WRITE) {
+                    std::cout << " write to RAM[" << hit.address << "] by ROM[" << hit.pc << "]: "
+                              << static_cast<int16_t>(hit.old_value) << " -> "
+                              << static_cast<int16_t>(hit.new_value);
+                } else {
+                    std::cout << " read of RAM[" << hit.address << "] by ROM[" << hit.pc << "]: "
+                              << static_cast<int16_t>(hit.old_value);
+                }
+            }
             std::cout << "\n";
             break;
         case CPUState::HALTED:  std::cout << "[HALTED] PC past end of ROM\n"; break;
@@ -65,7 +105,55 @@ static std::vector<std::string> split_args(const std::string& line) {
     return args;
 }
 
-static int batch_mode(const std::string& file, uint64_t max_instr) {
+/**
+ * @brief Parse a breakpoint location: a ROM address, a label of the loaded
+ *        .asm program, or :line for an .asm source line.
+ */
+static bool parse_location(const CPUEngine& cpu, const std::string& arg, Address& address) {
+    const AsmSourceMap* map = cpu.get_source_map();
+    if (!arg.empty() && arg[0] == ':') {
+        if (!map || arg.size() < 2 ||
+            !std::all_of(arg.begin() + 1, arg.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+            return false;
+        }
+        auto found = map->address_for_line(std::stoul(arg.substr(1)));
+        if (!found) return false;
+        address = *found;
+        return true;
+    }
+    if (!arg.empty() && std::isdigit(static_cast<unsigned char>(arg[0]))) {
+        address = static_cast<Address>(std::stoul(arg));
+        return true;
+    }
+    if (map) {
+        for (const auto& [label_address, name] : map->labels) {
+            if (name == arg) {
+                address = label_address;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Parse a RAM range "addr" or "first-last".
+ */
+static bool parse_ram_range(const std::string& arg, Address& first, Address& last) {
+    auto is_number = [](const std::string& text) {
+        return !text.empty() &&
+               std::all_of(text.begin(), text.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+    };
+    size_t dash = arg.find('-');
+    std::string low = arg.substr(0, dash);
+    std::string high = dash == std::string::npos ? low : arg.substr(dash + 1);
+    if (!is_number(low) || !is_number(high)) return false;
+    first = static_cast<Address>(std::stoul(low));
+    last = static_cast<Address>(std::stoul(high));
+    return first <= last;
+}
+
+static int batch_mode(const std::string& file, uint64_t max_instr, bool profile) {
     CPUEngine cpu;
     try {
         cpu.load_file(file);
@@ -74,6 +162,11 @@ static int batch_mode(const std::string& file, uint64_t max_instr) {
         return 1;
     }
 
+    if (profile) cpu.set_instrumentation(CPUInstrumentation::PROFILE);
+
+    // Nothing can press a key in batch mode, so an idle loop is the end
+    cpu.set_idle_detection(true);
+
     CPUState state = (max_instr > 0) ? cpu.run_for(max_instr) : cpu.run();
 
     print_state(state, cpu);
@@ -81,9 +174,138 @@ static int batch_mode(const std::string& file, uint64_t max_instr) {
     std::cout << "\n";
     print_stats(cpu);
 
+    if (profile) {
+        const CPUProgram& program = *cpu.memory().program();
+        auto cfg = cpu.get_cfg();
+        std::cout << "\n=== Profile ===\n" << cpu.get_profile()->report(program, *cfg)
+                  << "\n=== Annotated Disassembly ===\n"
+                  << cpu.get_profile()->annotate(program, *cfg);
+    }
+
     return (state == CPUState::ERROR) ? 1 : 0;
 }
 
+static bool parse_dispatch(const std::string& name, CPUDispatch& dispatch) {
+    if (name == "switch") dispatch = CPUDispatch::SWITCH;
+    else if (name == "threaded") dispatch = CPUDispatch::THREADED;
+    else if (name == "block") dispatch = CPUDispatch::BLOCK;
+    else if (name == "jit") dispatch = CPUDispatch::JIT;
+    else return false;
+    return true;
+}
+
+static const char* dispatch_name(CPUDispatch dispatch) {
+    switch (dispatch) {
+        case CPUDispatch::SWITCH:   return "switch";
+        case CPUDispatch::THREADED: return "threaded";
+        case CPUDispatch::BLOCK:    return "block";
+        case CPUDispatch::JIT:      return jit_supported() ? "jit" : "block";
+    }
+    return "switch";
+}
+
+/**
+ * @brief Run the program repetitions times, each in a fresh engine, and
+ *        print a JSON report (see bench_report.hpp).
+ *
+ * With a budget every run executes exactly that many instructions (unless
+ * the program halts first). Without one, idle loop detection ends the run
+ * at an END loop, as in batch mode.
+ */
+static int bench_mode(const std::string& file, uint64_t max_instr, unsigned repetitions,
+                      CPUDispatch dispatch) {
+    BenchReport report;
+    report.tool = "cpu_sim";
+    report.program = file;
+    report.budget = max_instr;
+    report.config = {{"dispatch", dispatch_name(dispatch)}};
+
+    for (unsigned r = 0; r < repetitions; r++) {
+        CPUEngine cpu;
+        cpu.set_dispatch(dispatch);
+        cpu.set_idle_detection(max_instr == 0);
+
+        BenchRun run;
+        auto start = BenchClock::now();
+        try {
+            cpu.load_file(file);
+        } catch (const N2TError& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        auto loaded = BenchClock::now();
+        CPUState state = (max_instr > 0) ? cpu.run_for(max_instr) : cpu.run();
+        auto finished = BenchClock::now();
+
+        run.load_ms = elapsed_ms(start, loaded);
+        run.run_ms = elapsed_ms(loaded, finished);
+        run.instructions = cpu.get_stats().instructions_executed;
+        report.runs.push_back(run);
+
+        if (r + 1 < repetitions) continue;
+        switch (state) {
+            case CPUState::HALTED: report.state = "halted"; break;
+            case CPUState::ERROR:  report.state = "error"; break;
+            default:
+                report.state = cpu.get_pause_reason() == CPUPauseReason::IDLE_LOOP ? "idle" : "budget";
+                break;
+        }
+        const CPUStats& s = cpu.get_stats();
+        report.counts = {{"instructions_executed", s.instructions_executed},
+                         {"a_instruction_count", s.a_instruction_count},
+                         {"c_instruction_count", s.c_instruction_count},
+                         {"jump_count", s.jump_count},
+                         {"memory_reads", s.memory_reads},
+                         {"memory_writes", s.memory_writes}};
+    }
+
+    std::cout << bench_json(report);
+    return report.state == "error" ? 1 : 0;
+}
+
+static int cfg_mode(const std::string& file, bool json) {
+    CPUEngine cpu;
+    try {
+        cpu.load_file(file);
+    } catch (const N2TError& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    auto cfg = cpu.get_cfg();
+    std::cout << (json ? cfg->to_json() : cfg->to_dot(*cpu.memory().program()));
+    return 0;
+}
+
+static void print_cfg_summary(const CPUEngine& cpu) {
+    auto cfg = cpu.get_cfg();
+    std::cout << "  Blocks:         " << cfg->blocks().size() << "\n"
+              << "  Loops:          " << cfg->loops().size() << "\n";
+    for (const auto& loop : cfg->loops()) {
+        const auto& header = cfg->blocks()[loop.header];
+        std::cout << "    header ROM[" << header.start << "], " << loop.blocks.size() << " block(s)\n";
+    }
+    std::cout << "  Computed jumps: " << cfg->computed_jumps().size() << "\n";
+    for (Address a : cfg->computed_jumps()) std::cout << "    ROM[" << a << "]\n";
+    auto unreachable = cfg->unreachable();
+    std::cout << "  Unreachable:    " << unreachable.size() << " range(s)\n";
+    for (const auto& [first, last] : unreachable) {
+        std::cout << "    ROM[" << first << ".." << last << "]\n";
+    }
+}
+
+static int convert_mode(const std::string& input, const std::string& output) {
+    try {
+        CPUEngine cpu;
+        cpu.load_file(input);
+        cpu.memory().save_rom_binary(output);
+        std::cout << "Wrote " << cpu.rom_size() << " instructions to " << output << "\n";
+    } catch (const N2TError& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
 static void interactive_mode(const std::string& file) {
     CPUEngine cpu;
     try {
@@ -93,6 +315,9 @@ static void interactive_mode(const std::string& file) {
         return;
     }
 
+    // Interactive sessions can step backwards (see 'back' and 'rback')
+    cpu.set_history_enabled(true);
+
     std::cout << "Hack CPU Simulator — " << file << "\n"
               << "ROM: " << cpu.rom_size() << " instructions loaded\n"
               << "Type 'help' for commands.\n\n";
@@ -116,13 +341,21 @@ static void interactive_mode(const std::string& file) {
                       << "  step [N], s [N]      Step N instructions (default 1)\n"
                       << "  run, r               Run until halt/breakpoint\n"
                       << "  run N                Run for N instructions\n"
+                      << "  back [N]             Step N instructions backwards (default 1)\n"
+                      << "  rback                Run backwards to the previous breakpoint\n"
+                      << "  history [on|off]     Show or toggle execution recording\n"
                       << "  regs                 Show A, D, PC registers\n"
                       << "  ram <addr> [count]   Show RAM contents\n"
                       << "  rom <addr> [count]   Show ROM with disassembly\n"
-                      << "  break <addr>, b      Set breakpoint\n"
-                      << "  clear <addr>         Clear breakpoint\n"
+                      << "  break <loc>, b       Set breakpoint at an address, a LABEL or\n"
+                      << "                       :line (the last two for .asm programs)\n"
+                      << "  clear <loc>          Clear breakpoint\n"
                       << "  breaks               List breakpoints\n"
+                      << "  watch <a>[-<b>] [r|w|rw]  Pause when RAM[a..b] is read/written (default w)\n"
+                      << "  unwatch <a>[-<b>]    Remove a watchpoint\n"
+                      << "  watches              List watchpoints\n"
                       << "  dasm [addr] [count]  Disassemble instructions\n"
+                      << "  cfg                  Summarize the control-flow graph\n"
                       << "  stats                Show execution statistics\n"
                       << "  reset                Reset CPU\n"
                       << "  quit, q              Exit\n";
@@ -152,6 +385,36 @@ static void interactive_mode(const std::string& file) {
             }
             print_state(state, cpu);
             print_regs(cpu);
+        } else if (cmd == "back") {
+            uint64_t n = 1;
+            if (args.size() > 1) n = std::stoull(args[1]);
+            if (!cpu.get_history_enabled()) {
+                std::cout << "History is off. Use 'history on' to record execution.\n";
+                continue;
+            }
+            CPUState state = cpu.step_back(n);
+            std::cout << "PC=" << cpu.get_pc();
+            if (cpu.get_pc() < cpu.rom_size()) {
+                std::cout << "  " << cpu.disassemble(cpu.get_pc());
+            }
+            std::cout << "\n";
+            if (cpu.get_pause_reason() == CPUPauseReason::HISTORY_START)
+                print_state(state, cpu);
+        } else if (cmd == "rback") {
+            if (!cpu.get_history_enabled()) {
+                std::cout << "History is off. Use 'history on' to record execution.\n";
+                continue;
+            }
+            print_state(cpu.run_back(), cpu);
+            print_regs(cpu);
+        } else if (cmd == "history") {
+            if (args.size() > 1) cpu.set_history_enabled(args[1] == "on");
+            if (cpu.get_history_enabled()) {
+                std::cout << "History on: " << cpu.history_depth()
+                          << " instructions can be stepped back.\n";
+            } else {
+                std::cout << "History off.\n";
+            }
         } else if (cmd == "regs") {
             print_regs(cpu);
         } else if (cmd == "ram") {
@@ -181,19 +444,19 @@ static void interactive_mode(const std::string& file) {
                 }
             }
         } else if (cmd == "break" || cmd == "b") {
-            if (args.size() < 2) {
-                std::cout << "Usage: break <addr>\n";
+            Address addr = 0;
+            if (args.size() < 2 || !parse_location(cpu, args[1], addr)) {
+                std::cout << "Usage: break <addr|LABEL|:line>\n";
                 continue;
             }
-            Address addr = static_cast<Address>(std::stoul(args[1]));
             cpu.add_breakpoint(addr);
             std::cout << "Breakpoint set at ROM[" << addr << "]\n";
         } else if (cmd == "clear") {
-            if (args.size() < 2) {
-                std::cout << "Usage: clear <addr>\n";
+            Address addr = 0;
+            if (args.size() < 2 || !parse_location(cpu, args[1], addr)) {
+                std::cout << "Usage: clear <addr|LABEL|:line>\n";
                 continue;
             }
-            Address addr = static_cast<Address>(std::stoul(args[1]));
             cpu.remove_breakpoint(addr);
             std::cout << "Breakpoint cleared at ROM[" << addr << "]\n";
         } else if (cmd == "breaks") {
@@ -205,6 +468,45 @@ static void interactive_mode(const std::string& file) {
                 for (auto a : bps)
                     std::cout << "  ROM[" << a << "]\n";
             }
+        } else if (cmd == "watch") {
+            Address first = 0;
+            Address last = 0;
+            std::string kind_name = args.size() > 2 ? args[2] : "w";
+            WatchKind kind = kind_name == "r" ? WatchKind::READ
+                           : kind_name == "rw" ? WatchKind::ACCESS : WatchKind::WRITE;
+            if (args.size() < 2 || !parse_ram_range(args[1], first, last) ||
+                (kind_name != "r" && kind_name != "w" && kind_name != "rw")) {
+                std::cout << "Usage: watch <addr>[-<last>] [r|w|rw]\n";
+                continue;
+            }
+            cpu.add_watchpoint(first, last, kind);
+            std::cout << "Watching RAM[" << first << (first == last ? "" : ".." + std::to_string(last))
+                      << "] (" << kind_name << ")\n";
+        } else if (cmd == "unwatch") {
+            Address first = 0;
+            Address last = 0;
+            if (args.size() < 2 || !parse_ram_range(args[1], first, last)) {
+                std::cout << "Usage: unwatch <addr>[-<last>]\n";
+                continue;
+            }
+            if (cpu.remove_watchpoint(first, last)) {
+                std::cout << "Watchpoint removed.\n";
+            } else {
+                std::cout << "No watchpoint on that range.\n";
+            }
+        } else if (cmd == "watches") {
+            const auto& watches = cpu.get_watchpoints();
+            if (watches.empty()) {
+                std::cout << "No watchpoints set.\n";
+            } else {
+                std::cout << "Watchpoints:\n";
+                for (const auto& w : watches) {
+                    std::cout << "  RAM[" << w.first;
+                    if (w.last != w.first) std::cout << ".." << w.last;
+                    std::cout << "] " << (w.kind == WatchKind::READ ? "r"
+                                          : w.kind == WatchKind::WRITE ? "w" : "rw") << "\n";
+                }
+            }
         } else if (cmd == "dasm") {
             Address addr = cpu.get_pc();
             unsigned count = 10;
@@ -212,13 +514,22 @@ static void interactive_mode(const std::string& file) {
             if (args.size() > 2) count = static_cast<unsigned>(std::stoul(args[2]));
             Address end = static_cast<Address>(std::min(static_cast<size_t>(addr + count), cpu.rom_size()));
             auto lines = cpu.disassemble_range(addr, end);
+            const AsmSourceMap* map = cpu.get_source_map();
             for (unsigned i = 0; i < lines.size(); ++i) {
                 Address a = static_cast<Address>(addr + i);
+                if (map) {
+                    for (const auto& label : map->labels_at(a)) {
+                        std::cout << "         (" << label << ")\n";
+                    }
+                }
                 std::cout << (cpu.has_breakpoint(a) ? "* " : "  ")
                           << std::setw(5) << a << ": " << lines[i];
+                if (map) std::cout << "  ; line " << *map->line_for(a);
                 if (a == cpu.get_pc()) std::cout << "  <-- PC";
                 std::cout << "\n";
             }
+        } else if (cmd == "cfg") {
+            print_cfg_summary(cpu);
         } else if (cmd == "stats") {
             print_stats(cpu);
         } else if (cmd == "reset") {
@@ -243,16 +554,78 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    if (arg1 == "--run") {
+    if (arg1 == "--run" || arg1 == "--profile") {
         if (argc < 3) {
-            std::cerr << "Error: --run requires a .hack file\n";
+            std::cerr << "Error: " << arg1 << " requires a .hack file\n";
             return 1;
         }
         uint64_t max_instr = 0;
-        if (argc >= 5 && std::string(argv[3]) == "-n") {
-            max_instr = std::stoull(argv[4]);
+        bool profile = arg1 == "--profile";
+        for (int i = 3; i < argc; i++) {
+            std::string opt = argv[i];
+            if (opt == "-n" && i + 1 < argc) {
+                max_instr = std::stoull(argv[++i]);
+            } else if (opt == "--profile") {
+                profile = true;
+            } else {
+                std::cerr << "Error: unknown option " << opt << "\n";
+                return 1;
+            }
+        }
+        return batch_mode(argv[2], max_instr, profile);
+    }
+
+    if (arg1 == "--bench") {
+        if (argc < 3) {
+            std::cerr << "Error: --bench requires a .hack file\n";
+            return 1;
+        }
+        uint64_t max_instr = 0;
+        unsigned repetitions = 5;
+        CPUDispatch dispatch = CPUDispatch::SWITCH;
+        for (int i = 3; i < argc; i++) {
+            std::string opt = argv[i];
+            if (opt == "-n" && i + 1 < argc) {
+                max_instr = std::stoull(argv[++i]);
+            } else if (opt == "-r" && i + 1 < argc) {
+                repetitions = static_cast<unsigned>(std::max(1ul, std::stoul(argv[++i])));
+            } else if (opt == "--dispatch" && i + 1 < argc) {
+                if (!parse_dispatch(argv[++i], dispatch)) {
+                    std::cerr << "Error: unknown dispatch " << argv[i] << "\n";
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: unknown option " << opt << "\n";
+                return 1;
+            }
+        }
+        return bench_mode(argv[2], max_instr, repetitions, dispatch);
+    }
+
+    if (arg1 == "--convert") {
+        if (argc < 4) {
+            std::cerr << "Error: --convert requires an input and an output file\n";
+            return 1;
+        }
+        return convert_mode(argv[2], argv[3]);
+    }
+
+    if (arg1 == "--cfg") {
+        if (argc < 3) {
+            std::cerr << "Error: --cfg requires a .hack file\n";
+            return 1;
+        }
+        bool json = false;
+        for (int i = 3; i < argc; i++) {
+            std::string opt = argv[i];
+            if (opt == "--json") {
+                json = true;
+            } else {
+                std::cerr << "Error: unknown option " << opt << "\n";
+                return 1;
+            }
         }
-        return batch_mode(argv[2], max_instr);
+        return cfg_mode(argv[2], json);
     }
 
     // Interactive mode
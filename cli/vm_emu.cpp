@@ -1,7 +1,8 @@
 // ==============================================================================
 // vm_emu — VM Emulator CLI
 // ==============================================================================
-// Batch:       vm_emu --run Prog.vm [-n 10000]
+// Batch:       vm_emu --run Prog.vm [-n 10000] [--no-natives]
+// Benchmark:   vm_emu --bench Prog.vm [-n 10000000] [-r 5] [--dispatch threaded]
 // Interactive: vm_emu Prog.vm  |  vm_emu dir/
 // ==============================================================================
 
@@ -9,18 +10,25 @@
 #include "vm_command.hpp"
 #include "error.hpp"
 #include "line_editor.hpp"
+#include "bench_report.hpp"
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <vector>
 #include <cstdlib>
 #include <iomanip>
+#include <algorithm>
 
 using namespace n2t;
 
 static void print_usage() {
     std::cout << "Usage:\n"
               << "  vm_emu --run <file.vm|dir> [-n <max>]   Run in batch mode\n"
+              << "         [--no-natives]                    (no built-in Jack OS functions)\n"
+              << "  vm_emu --bench <file.vm|dir> [-n <max>]  Time load and run, print JSON\n"
+              << "         [-r <reps>]                       (5 repetitions; runs to halt without -n)\n"
+              << "         [--dispatch switch|threaded]\n"
+              << "         [--no-superinstructions] [--no-natives]\n"
               << "  vm_emu <file.vm|dir>                     Interactive REPL\n"
               << "  vm_emu --help                            Show this help\n";
 }
@@ -45,7 +53,7 @@ static void print_state(VMState state, const VMEngine& vm) {
 }
 
 static void print_current_cmd(const VMEngine& vm) {
-    auto* cmd = vm.get_current_command();
+    auto cmd = vm.get_current_command();
     if (cmd) {
         std::cout << "  " << vm.get_pc() << ": " << command_to_string(*cmd);
         auto func = vm.get_current_function();
@@ -80,7 +88,8 @@ static void print_stats(const VMEngine& vm) {
               << "  Pop count:             " << s.pop_count << "\n"
               << "  Arithmetic count:      " << s.arithmetic_count << "\n"
               << "  Call count:            " << s.call_count << "\n"
-              << "  Return count:          " << s.return_count << "\n";
+              << "  Return count:          " << s.return_count << "\n"
+              << "  Native calls:          " << s.native_call_count << "\n";
 }
 
 static std::vector<std::string> split_args(const std::string& line) {
@@ -103,8 +112,9 @@ static void load_program(VMEngine& vm, const std::string& path) {
     }
 }
 
-static int batch_mode(const std::string& path, uint64_t max_instr) {
+static int batch_mode(const std::string& path, uint64_t max_instr, bool natives) {
     VMEngine vm;
+    vm.set_natives_enabled(natives);
     try {
         load_program(vm, path);
     } catch (const N2TError& e) {
@@ -124,6 +134,75 @@ static int batch_mode(const std::string& path, uint64_t max_instr) {
     return (state == VMState::ERROR) ? 1 : 0;
 }
 
+static bool parse_dispatch(const std::string& name, VMDispatch& dispatch) {
+    if (name == "switch") dispatch = VMDispatch::SWITCH;
+    else if (name == "threaded") dispatch = VMDispatch::THREADED;
+    else return false;
+    return true;
+}
+
+static const char* dispatch_name(VMDispatch dispatch) {
+    return dispatch == VMDispatch::THREADED ? "threaded" : "switch";
+}
+
+/**
+ * @brief Run the program repetitions times, each in a fresh engine, and
+ *        print a JSON report (see bench_report.hpp).
+ */
+static int bench_mode(const std::string& path, uint64_t max_instr, unsigned repetitions,
+                      VMDispatch dispatch, bool superinstructions, bool natives) {
+    BenchReport report;
+    report.tool = "vm_emu";
+    report.program = path;
+    report.budget = max_instr;
+    report.config = {{"dispatch", dispatch_name(dispatch)},
+                     {"superinstructions", superinstructions ? "on" : "off"},
+                     {"natives", natives ? "on" : "off"}};
+
+    for (unsigned r = 0; r < repetitions; r++) {
+        VMEngine vm;
+        vm.set_dispatch(dispatch);
+        vm.set_superinstructions(superinstructions);
+        vm.set_natives_enabled(natives);
+
+        BenchRun run;
+        auto start = BenchClock::now();
+        try {
+            load_program(vm, path);
+        } catch (const N2TError& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        auto loaded = BenchClock::now();
+        VMState state = (max_instr > 0) ? vm.run_for(max_instr) : vm.run();
+        auto finished = BenchClock::now();
+
+        run.load_ms = elapsed_ms(start, loaded);
+        run.run_ms = elapsed_ms(loaded, finished);
+        run.instructions = vm.get_stats().instructions_executed;
+        report.runs.push_back(run);
+
+        if (r + 1 < repetitions) continue;
+        switch (state) {
+            case VMState::HALTED: report.state = "halted"; break;
+            case VMState::ERROR:  report.state = "error"; break;
+            default:              report.state = "budget"; break;
+        }
+        const VMStats& s = vm.get_stats();
+        report.counts = {{"instructions_executed", s.instructions_executed},
+                         {"push_count", s.push_count},
+                         {"pop_count", s.pop_count},
+                         {"arithmetic_count", s.arithmetic_count},
+                         {"call_count", s.call_count},
+                         {"return_count", s.return_count},
+                         {"native_call_count", s.native_call_count},
+                         {"dispatch_count", s.dispatch_count}};
+    }
+
+    std::cout << bench_json(report);
+    return report.state == "error" ? 1 : 0;
+}
+
 static const char* segment_name(const std::string& name) {
     // Return nullptr if not a valid segment name
     static const char* valid[] = {
@@ -275,7 +354,7 @@ static void interactive_mode(const std::string& path) {
         } else if (cmd == "cmd") {
             if (args.size() > 1) {
                 size_t idx = std::stoull(args[1]);
-                auto* c = vm.get_command(idx);
+                auto c = vm.get_command(idx);
                 if (c) {
                     std::cout << "  " << idx << ": " << command_to_string(*c) << "\n";
                 } else {
@@ -330,7 +409,7 @@ static void interactive_mode(const std::string& path) {
                 std::cout << "Breakpoints:\n";
                 for (auto idx : bps) {
                     std::cout << "  cmd " << idx;
-                    auto* c = vm.get_command(idx);
+                    auto c = vm.get_command(idx);
                     if (c) std::cout << ": " << command_to_string(*c);
                     std::cout << "\n";
                 }
@@ -365,10 +444,52 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         uint64_t max_instr = 0;
-        if (argc >= 5 && std::string(argv[3]) == "-n") {
-            max_instr = std::stoull(argv[4]);
+        bool natives = true;
+        for (int i = 3; i < argc; i++) {
+            std::string opt = argv[i];
+            if (opt == "-n" && i + 1 < argc) {
+                max_instr = std::stoull(argv[++i]);
+            } else if (opt == "--no-natives") {
+                natives = false;
+            } else {
+                std::cerr << "Error: unknown option " << opt << "\n";
+                return 1;
+            }
+        }
+        return batch_mode(argv[2], max_instr, natives);
+    }
+
+    if (arg1 == "--bench") {
+        if (argc < 3) {
+            std::cerr << "Error: --bench requires a .vm file or directory\n";
+            return 1;
+        }
+        uint64_t max_instr = 0;
+        unsigned repetitions = 5;
+        VMDispatch dispatch = VMDispatch::SWITCH;
+        bool superinstructions = true;
+        bool natives = true;
+        for (int i = 3; i < argc; i++) {
+            std::string opt = argv[i];
+            if (opt == "-n" && i + 1 < argc) {
+                max_instr = std::stoull(argv[++i]);
+            } else if (opt == "-r" && i + 1 < argc) {
+                repetitions = static_cast<unsigned>(std::max(1ul, std::stoul(argv[++i])));
+            } else if (opt == "--dispatch" && i + 1 < argc) {
+                if (!parse_dispatch(argv[++i], dispatch)) {
+                    std::cerr << "Error: unknown dispatch " << argv[i] << "\n";
+                    return 1;
+                }
+            } else if (opt == "--no-superinstructions") {
+                superinstructions = false;
+            } else if (opt == "--no-natives") {
+                natives = false;
+            } else {
+                std::cerr << "Error: unknown option " << opt << "\n";
+                return 1;
+            }
         }
-        return batch_mode(argv[2], max_instr);
+        return bench_mode(argv[2], max_instr, repetitions, dispatch, superinstructions, natives);
     }
 
     interactive_mode(arg1);
@@ -65,7 +65,7 @@ using Byte = uint8_t;
  * - TEMP: Temporary variables (only 8 of them: temp 0-7)
  * - POINTER: Access to THIS/THAT pointers (pointer 0 = THIS, pointer 1 = THAT)
  */
-enum class SegmentType {
+enum class SegmentType : uint8_t {
     LOCAL,
     ARGUMENT,
     THIS,
@@ -0,0 +1,88 @@
+// ==============================================================================
+// Address Bitmap
+// ==============================================================================
+// A fixed-size set of addresses stored as one bit per address. Membership
+// tests are a shift and a mask, which is cheap enough for per-instruction
+// checks in the CPU hot loop (e.g. breakpoints over the 32K ROM fit in 4 KB).
+// ==============================================================================
+
+#ifndef NAND2TETRIS_ADDRESS_BITMAP_HPP
+#define NAND2TETRIS_ADDRESS_BITMAP_HPP
+
+#include "types.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace n2t {
+
+template <size_t N>
+class AddressBitmap {
+public:
+    static constexpr size_t SIZE = N;
+
+    /**
+     * @brief Add an address. Returns false if it was already present
+     *        (or is out of range).
+     */
+    bool insert(size_t address) {
+        if (address >= N || test(address)) return false;
+        words_[address >> 6] |= bit(address);
+        count_++;
+        return true;
+    }
+
+    /**
+     * @brief Remove an address. Returns false if it was not present.
+     */
+    bool erase(size_t address) {
+        if (!test(address)) return false;
+        words_[address >> 6] &= ~bit(address);
+        count_--;
+        return true;
+    }
+
+    /**
+     * @brief Membership test; out-of-range addresses are never present.
+     */
+    bool test(size_t address) const {
+        return address < N && (words_[address >> 6] & bit(address)) != 0;
+    }
+
+    void clear() {
+        words_.fill(0);
+        count_ = 0;
+    }
+
+    bool empty() const { return count_ == 0; }
+    size_t size() const { return count_; }
+
+    /**
+     * @brief All members in ascending order.
+     */
+    std::vector<Address> to_vector() const {
+        std::vector<Address> result;
+        result.reserve(count_);
+        for (size_t w = 0; w < WORD_COUNT; w++) {
+            if (words_[w] == 0) continue;
+            for (size_t offset = 0; offset < 64; offset++) {
+                if (words_[w] & (uint64_t{1} << offset)) {
+                    result.push_back(static_cast<Address>(w * 64 + offset));
+                }
+            }
+        }
+        return result;
+    }
+
+private:
+    static constexpr size_t WORD_COUNT = (N + 63) / 64;
+
+    static uint64_t bit(size_t address) { return uint64_t{1} << (address & 63); }
+
+    std::array<uint64_t, WORD_COUNT> words_{};
+    size_t count_ = 0;
+};
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_ADDRESS_BITMAP_HPP
@@ -0,0 +1,330 @@
+// ==============================================================================
+// Hack Assembler Implementation
+// ==============================================================================
+
+#include "assembler.hpp"
+#include "instruction.hpp"
+#include "memory.hpp"
+#include "error.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace n2t {
+
+namespace {
+
+constexpr Address VARIABLE_BASE = CPUAddress::STATIC_BASE;
+constexpr int32_t UNDEFINED = -1;
+
+// ==============================================================================
+// Field Tables
+// ==============================================================================
+
+/**
+ * @brief comp mnemonic -> 7-bit {a, c1-c6} field, including the commutative
+ *        spellings (A+D, 1+D, M&D, ...) that other assemblers accept.
+ */
+const std::unordered_map<std::string_view, uint8_t>& comp_table() {
+    static const std::unordered_map<std::string_view, uint8_t> table = [] {
+        auto code = [](Computation c) { return static_cast<uint8_t>(c); };
+        std::unordered_map<std::string_view, uint8_t> t = {
+            {"0", code(Computation::ZERO)},      {"1", code(Computation::ONE)},
+            {"-1", code(Computation::NEG_ONE)},  {"D", code(Computation::D)},
+            {"A", code(Computation::A)},         {"!D", code(Computation::NOT_D)},
+            {"!A", code(Computation::NOT_A)},    {"-D", code(Computation::NEG_D)},
+            {"-A", code(Computation::NEG_A)},    {"D+1", code(Computation::D_PLUS_1)},
+            {"A+1", code(Computation::A_PLUS_1)}, {"D-1", code(Computation::D_MINUS_1)},
+            {"A-1", code(Computation::A_MINUS_1)}, {"D+A", code(Computation::D_PLUS_A)},
+            {"D-A", code(Computation::D_MINUS_A)}, {"A-D", code(Computation::A_MINUS_D)},
+            {"D&A", code(Computation::D_AND_A)}, {"D|A", code(Computation::D_OR_A)},
+            {"M", code(Computation::M)},         {"!M", code(Computation::NOT_M)},
+            {"-M", code(Computation::NEG_M)},    {"M+1", code(Computation::M_PLUS_1)},
+            {"M-1", code(Computation::M_MINUS_1)}, {"D+M", code(Computation::D_PLUS_M)},
+            {"D-M", code(Computation::D_MINUS_M)}, {"M-D", code(Computation::M_MINUS_D)},
+            {"D&M", code(Computation::D_AND_M)}, {"D|M", code(Computation::D_OR_M)},
+        };
+        const std::pair<std::string_view, std::string_view> aliases[] = {
+            {"1+D", "D+1"}, {"1+A", "A+1"}, {"1+M", "M+1"},
+            {"A+D", "D+A"}, {"A&D", "D&A"}, {"A|D", "D|A"},
+            {"M+D", "D+M"}, {"M&D", "D&M"}, {"M|D", "D|M"},
+        };
+        for (const auto& [alias, canonical] : aliases) t[alias] = t.at(canonical);
+        return t;
+    }();
+    return table;
+}
+
+bool parse_dest(std::string_view dest, Word& bits) {
+    bits = 0;
+    if (dest.empty()) return false;
+    for (char c : dest) {
+        Word bit = c == 'A' ? 0b100 : c == 'D' ? 0b010 : c == 'M' ? 0b001 : 0;
+        if (bit == 0 || (bits & bit)) return false;
+        bits |= bit;
+    }
+    return true;
+}
+
+bool parse_jump(std::string_view jump, Word& bits) {
+    static constexpr std::string_view NAMES[] = {
+        "JGT", "JEQ", "JGE", "JLT", "JNE", "JLE", "JMP",
+    };
+    for (Word i = 0; i < 7; i++) {
+        if (jump == NAMES[i]) {
+            bits = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_symbol_start(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           c == '_' || c == '.' || c == '$' || c == ':';
+}
+
+bool is_symbol_char(char c) {
+    return is_symbol_start(c) || (c >= '0' && c <= '9');
+}
+
+bool is_symbol(std::string_view name) {
+    if (name.empty() || !is_symbol_start(name[0])) return false;
+    return std::all_of(name.begin() + 1, name.end(), is_symbol_char);
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// ==============================================================================
+// Symbol Table
+// ==============================================================================
+
+/**
+ * @brief Symbols of one assembly, keyed by views into the source text.
+ *
+ * Ids are handed out in order of first appearance, which is also the
+ * order unresolved symbols become variables.
+ */
+class SymbolTable {
+public:
+    struct Symbol {
+        std::string_view name;
+        int32_t address = UNDEFINED;
+        LineNumber label_line = 0;    // Non-zero once declared as (LABEL)
+    };
+
+    SymbolTable() {
+        static constexpr std::pair<std::string_view, Address> PREDEFINED[] = {
+            {"SP", 0}, {"LCL", 1}, {"ARG", 2}, {"THIS", 3}, {"THAT", 4},
+            {"R0", 0}, {"R1", 1}, {"R2", 2}, {"R3", 3}, {"R4", 4}, {"R5", 5},
+            {"R6", 6}, {"R7", 7}, {"R8", 8}, {"R9", 9}, {"R10", 10}, {"R11", 11},
+            {"R12", 12}, {"R13", 13}, {"R14", 14}, {"R15", 15},
+            {"SCREEN", CPUAddress::SCREEN_BASE}, {"KBD", CPUAddress::KEYBOARD},
+        };
+        ids_.reserve(256);
+        for (const auto& [name, address] : PREDEFINED) {
+            ids_.emplace(name, static_cast<uint32_t>(symbols_.size()));
+            symbols_.push_back({name, address, 0});
+        }
+        predefined_ = symbols_.size();
+    }
+
+    uint32_t intern(std::string_view name) {
+        auto [it, inserted] = ids_.try_emplace(name, static_cast<uint32_t>(symbols_.size()));
+        if (inserted) symbols_.push_back({name, UNDEFINED, 0});
+        return it->second;
+    }
+
+    bool is_predefined(uint32_t id) const { return id < predefined_; }
+    Symbol& operator[](uint32_t id) { return symbols_[id]; }
+    size_t size() const { return symbols_.size(); }
+
+private:
+    std::unordered_map<std::string_view, uint32_t> ids_;
+    std::vector<Symbol> symbols_;
+    size_t predefined_ = 0;
+};
+
+}  // namespace
+
+// ==============================================================================
+// Source Map
+// ==============================================================================
+
+std::optional<LineNumber> AsmSourceMap::line_for(Address address) const {
+    if (address >= lines.size()) return std::nullopt;
+    return lines[address];
+}
+
+std::optional<Address> AsmSourceMap::address_for_line(LineNumber line) const {
+    // Lines increase with the address, so the first one at or after line
+    // can be found by binary search
+    auto it = std::lower_bound(lines.begin(), lines.end(), line);
+    if (it == lines.end()) return std::nullopt;
+    return static_cast<Address>(it - lines.begin());
+}
+
+std::vector<std::string> AsmSourceMap::labels_at(Address address) const {
+    std::vector<std::string> result;
+    auto it = std::lower_bound(labels.begin(), labels.end(), address,
+                               [](const auto& label, Address a) { return label.first < a; });
+    for (; it != labels.end() && it->first == address; ++it) result.push_back(it->second);
+    return result;
+}
+
+// ==============================================================================
+// Assembler
+// ==============================================================================
+
+AssembledProgram assemble_hack(std::string_view source, const std::string& file_name) {
+    AssembledProgram result;
+    std::vector<Word>& rom = result.rom;
+    AsmSourceMap& map = result.source_map;
+    map.file = file_name;
+
+    SymbolTable symbols;
+    std::vector<std::pair<size_t, uint32_t>> fixups;   // ROM index, symbol id
+    std::string squeezed;                              // C-instruction without spaces
+    const auto& comps = comp_table();
+
+    size_t pos = 0;
+    LineNumber line_number = 0;
+    while (pos < source.size()) {
+        line_number++;
+        size_t eol = source.find('\n', pos);
+        if (eol == std::string_view::npos) eol = source.size();
+        std::string_view line = source.substr(pos, eol - pos);
+        pos = eol + 1;
+
+        // Strip the comment and surrounding whitespace
+        size_t comment = line.find("//");
+        if (comment != std::string_view::npos) line = line.substr(0, comment);
+        while (!line.empty() && is_space(line.front())) line.remove_prefix(1);
+        while (!line.empty() && is_space(line.back())) line.remove_suffix(1);
+        if (line.empty()) continue;
+
+        auto fail = [&](const std::string& message) -> ParseError {
+            return ParseError(file_name, line_number, message);
+        };
+
+        // (LABEL)
+        if (line.front() == '(') {
+            if (line.back() != ')') throw fail("Expected ')' to close label: " + std::string(line));
+            std::string_view name = line.substr(1, line.size() - 2);
+            if (!is_symbol(name)) throw fail("Invalid label name: '" + std::string(name) + "'");
+
+            uint32_t id = symbols.intern(name);
+            auto& symbol = symbols[id];
+            if (symbols.is_predefined(id)) {
+                throw fail("Label '" + std::string(name) + "' redefines a predefined symbol");
+            }
+            if (symbol.label_line) {
+                throw fail("Label '" + std::string(name) + "' already defined on line " +
+                           std::to_string(symbol.label_line));
+            }
+            symbol.address = static_cast<int32_t>(rom.size());
+            symbol.label_line = line_number;
+            map.labels.emplace_back(static_cast<Address>(rom.size()), std::string(name));
+            continue;
+        }
+
+        if (rom.size() >= CPUAddress::ROM_SIZE) {
+            throw fail("Program too large! ROM can hold at most " +
+                       std::to_string(CPUAddress::ROM_SIZE) + " instructions.");
+        }
+
+        Word word = 0;
+        if (line.front() == '@') {
+            // @value or @symbol
+            std::string_view operand = line.substr(1);
+            if (operand.empty()) throw fail("Missing value after '@'");
+            if (operand[0] >= '0' && operand[0] <= '9') {
+                uint32_t value = 0;
+                for (char c : operand) {
+                    if (c < '0' || c > '9') {
+                        throw fail("Invalid constant: '" + std::string(operand) + "'");
+                    }
+                    value = value * 10 + static_cast<uint32_t>(c - '0');
+                    if (value > 32767) {
+                        throw fail("Constant " + std::string(operand) +
+                                   " does not fit in 15 bits (max 32767)");
+                    }
+                }
+                word = static_cast<Word>(value);
+            } else {
+                if (!is_symbol(operand)) {
+                    throw fail("Invalid symbol: '" + std::string(operand) + "'");
+                }
+                uint32_t id = symbols.intern(operand);
+                if (symbols[id].address != UNDEFINED) {
+                    word = static_cast<Word>(symbols[id].address);
+                } else {
+                    fixups.emplace_back(rom.size(), id);
+                }
+            }
+        } else {
+            // dest=comp;jump, with whitespace allowed between the parts
+            squeezed.clear();
+            for (char c : line) {
+                if (!is_space(c)) squeezed.push_back(c);
+            }
+            std::string_view text = squeezed;
+            Word dest = 0;
+            Word jump = 0;
+
+            size_t eq = text.find('=');
+            if (eq != std::string_view::npos) {
+                if (!parse_dest(text.substr(0, eq), dest)) {
+                    throw fail("Invalid destination: '" + std::string(text.substr(0, eq)) + "'");
+                }
+                text.remove_prefix(eq + 1);
+            }
+            size_t semi = text.find(';');
+            if (semi != std::string_view::npos) {
+                if (!parse_jump(text.substr(semi + 1), jump)) {
+                    throw fail("Invalid jump: '" + std::string(text.substr(semi + 1)) + "'");
+                }
+                text = text.substr(0, semi);
+            }
+            auto comp = comps.find(text);
+            if (comp == comps.end()) {
+                throw fail("Invalid computation: '" + std::string(text) + "'");
+            }
+            word = static_cast<Word>(0xE000 | (comp->second << 6) | (dest << 3) | jump);
+        }
+
+        rom.push_back(word);
+        map.lines.push_back(line_number);
+        map.text.emplace_back(line);
+    }
+
+    // Symbols never declared as labels become variables from RAM[16], in
+    // order of first use
+    Address next_variable = VARIABLE_BASE;
+    for (uint32_t id = 0; id < symbols.size(); id++) {
+        auto& symbol = symbols[id];
+        if (symbol.address == UNDEFINED) symbol.address = next_variable++;
+        if (!symbols.is_predefined(id)) {
+            map.symbols.emplace(std::string(symbol.name), static_cast<Address>(symbol.address));
+        }
+    }
+    for (const auto& [index, id] : fixups) {
+        rom[index] = static_cast<Word>(symbols[id].address);
+    }
+
+    return result;
+}
+
+AssembledProgram assemble_hack_file(const std::string& file_path) {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        throw FileError(file_path, "Could not open .asm file for reading");
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return assemble_hack(contents.str(), file_path);
+}
+
+}  // namespace n2t
@@ -0,0 +1,93 @@
+// ==============================================================================
+// Hack Assembler
+// ==============================================================================
+// Translates Hack assembly (.asm) into ROM words in process, so a CPUEngine
+// can load .asm directly.
+//
+// The source is read in a single pass. Symbol names are string_views into
+// the source text (the text itself is the arena; nothing is copied while
+// assembling) and are interned in one hash table. An @symbol that is not
+// yet defined gets a fixup that is patched at the end: to its label's
+// address, or else to the next free variable address from 16, in order of
+// first use — the same allocation the two-pass reference assembler makes.
+//
+// Besides the ROM, the result maps every ROM address back to its .asm line
+// and source text, so the debugger can show and break on source lines.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CPU_ASSEMBLER_HPP
+#define NAND2TETRIS_CPU_ASSEMBLER_HPP
+
+#include "types.hpp"
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace n2t {
+
+// ==============================================================================
+// Source Map
+// ==============================================================================
+
+/**
+ * @brief Where each ROM word of an assembled program came from.
+ */
+struct AsmSourceMap {
+    std::string file;                                  // Name used in errors
+    std::vector<LineNumber> lines;                     // Per ROM address, 1-based
+    std::vector<std::string> text;                     // Per ROM address, e.g. "@LOOP"
+    std::vector<std::pair<Address, std::string>> labels;   // By address
+    std::unordered_map<std::string, Address> symbols;  // Labels and variables
+
+    /**
+     * @brief Source line of a ROM address.
+     */
+    std::optional<LineNumber> line_for(Address address) const;
+
+    /**
+     * @brief First ROM address assembled from line or a later line (so a
+     *        label or comment line maps to the next instruction).
+     */
+    std::optional<Address> address_for_line(LineNumber line) const;
+
+    /**
+     * @brief Labels declared at a ROM address, in source order.
+     */
+    std::vector<std::string> labels_at(Address address) const;
+};
+
+/**
+ * @brief ROM words and source map produced by the assembler.
+ */
+struct AssembledProgram {
+    std::vector<Word> rom;
+    AsmSourceMap source_map;
+};
+
+// ==============================================================================
+// Assembler
+// ==============================================================================
+
+/**
+ * @brief Assemble .asm source text.
+ *
+ * @param file_name Reported in errors and kept in the source map
+ * @throws ParseError on a syntax error, a duplicate label, a constant
+ *         above 32767, or more than ROM_SIZE instructions
+ */
+AssembledProgram assemble_hack(std::string_view source, const std::string& file_name = "<asm>");
+
+/**
+ * @brief Read and assemble an .asm file.
+ *
+ * @throws FileError if the file cannot be read
+ * @throws ParseError as for assemble_hack()
+ */
+AssembledProgram assemble_hack_file(const std::string& file_path);
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CPU_ASSEMBLER_HPP
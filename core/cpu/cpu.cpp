@@ -3,6 +3,11 @@
 // ==============================================================================
 
 #include "cpu.hpp"
+#include "assembler.hpp"
+#include "cpu_cfg.hpp"
+#include "disassembly.hpp"
+#include "cpu_history.hpp"
+#include "cpu_profile.hpp"
 #include <algorithm>
 
 namespace n2t {
@@ -11,52 +16,86 @@ namespace n2t {
 // Constructor
 // ==============================================================================
 
-CPUEngine::CPUEngine() = default;
+CPUEngine::CPUEngine()
+    : history_limit_(CPUHistory::DEFAULT_LIMIT)
+    , checkpoint_interval_(CPUHistory::DEFAULT_CHECKPOINT_INTERVAL)
+{}
+
+CPUEngine::~CPUEngine() = default;
 
 // ==============================================================================
 // Program Loading
 // ==============================================================================
 
 void CPUEngine::load_file(const std::string& file_path) {
+    const std::string extension = ".asm";
+    if (file_path.size() >= extension.size() &&
+        file_path.compare(file_path.size() - extension.size(), extension.size(), extension) == 0) {
+        auto assembled = assemble_hack_file(file_path);
+        load(assembled.rom);
+        source_map_ = std::make_shared<const AsmSourceMap>(std::move(assembled.source_map));
+        return;
+    }
+
     memory_.load_rom_file(file_path);
-    state_ = CPUState::READY;
-    pc_ = 0;
-    a_register_ = 0;
-    d_register_ = 0;
-    stats_.reset();
+    on_program_loaded();
 }
 
 void CPUEngine::load_string(const std::string& hack_text) {
     memory_.load_rom_string(hack_text);
-    state_ = CPUState::READY;
-    pc_ = 0;
-    a_register_ = 0;
-    d_register_ = 0;
-    stats_.reset();
+    on_program_loaded();
+}
+
+void CPUEngine::load_asm(const std::string& asm_text) {
+    auto assembled = assemble_hack(asm_text);
+    load(assembled.rom);
+    source_map_ = std::make_shared<const AsmSourceMap>(std::move(assembled.source_map));
 }
 
 void CPUEngine::load(const std::vector<Word>& instructions) {
     memory_.load_rom(instructions);
-    state_ = CPUState::READY;
-    pc_ = 0;
-    a_register_ = 0;
-    d_register_ = 0;
-    stats_.reset();
+    on_program_loaded();
+}
+
+void CPUEngine::load_program(std::shared_ptr<const CPUProgram> program) {
+    memory_.load_program(std::move(program));
+    on_program_loaded();
 }
 
 void CPUEngine::reset() {
     memory_.reset();
-    a_register_ = 0;
-    d_register_ = 0;
-    pc_ = 0;
-    state_ = CPUState::READY;
+    on_program_loaded();
     pause_reason_ = CPUPauseReason::NONE;
     pause_requested_ = false;
-    stats_.reset();
     error_message_.clear();
+    error_code_ = CPUErrorCode::NONE;
     error_location_ = 0;
 }
 
+void CPUEngine::on_program_loaded() {
+    state_ = CPUState::READY;
+    pc_ = 0;
+    a_register_ = 0;
+    d_register_ = 0;
+    stats_.reset();
+    if (history_) history_->clear();
+    if (profile_) profile_->clear();
+
+    // Everything derived from the previous ROM
+    source_map_.reset();
+    cfg_.reset();
+    disassembly_.reset();
+}
+
+// ==============================================================================
+// Static Analysis
+// ==============================================================================
+
+std::shared_ptr<const ControlFlowGraph> CPUEngine::get_cfg() const {
+    if (!cfg_) cfg_ = std::make_shared<const ControlFlowGraph>(*memory_.program());
+    return cfg_;
+}
+
 // ==============================================================================
 // Execution Control
 // ==============================================================================
@@ -67,10 +106,18 @@ CPUState CPUEngine::run() {
         pause_reason_ = CPUPauseReason::NONE;
         pause_requested_ = false;
 
-        while (state_ == CPUState::RUNNING) {
-            if (!execute_instruction()) {
-                break;
-            }
+        if (history_) {
+            run_recorded(UINT64_MAX);
+        } else if (!watchpoints_.empty()) {
+            run_switch(UINT64_MAX);
+        } else if (dispatch_ == CPUDispatch::JIT && !needs_per_instruction()) {
+            run_jit(UINT64_MAX);
+        } else if (dispatch_ == CPUDispatch::BLOCK && !needs_per_instruction()) {
+            run_blocks(UINT64_MAX);
+        } else if (dispatch_ != CPUDispatch::SWITCH) {
+            run_threaded(UINT64_MAX);
+        } else {
+            run_switch(UINT64_MAX);
         }
     }
 
@@ -83,12 +130,18 @@ CPUState CPUEngine::run_for(uint64_t max_instructions) {
         pause_reason_ = CPUPauseReason::NONE;
         pause_requested_ = false;
 
-        uint64_t count = 0;
-        while (state_ == CPUState::RUNNING && count < max_instructions) {
-            if (!execute_instruction()) {
-                break;
-            }
-            count++;
+        if (history_) {
+            run_recorded(max_instructions);
+        } else if (!watchpoints_.empty()) {
+            run_switch(max_instructions);
+        } else if (dispatch_ == CPUDispatch::JIT && !needs_per_instruction()) {
+            run_jit(max_instructions);
+        } else if (dispatch_ == CPUDispatch::BLOCK && !needs_per_instruction()) {
+            run_blocks(max_instructions);
+        } else if (dispatch_ != CPUDispatch::SWITCH) {
+            run_threaded(max_instructions);
+        } else {
+            run_switch(max_instructions);
         }
 
         if (state_ == CPUState::RUNNING) {
@@ -105,6 +158,7 @@ CPUState CPUEngine::step() {
         state_ = CPUState::RUNNING;
         pause_reason_ = CPUPauseReason::NONE;
 
+        if (history_) record_instruction();
         execute_instruction();
 
         if (state_ == CPUState::RUNNING) {
@@ -120,28 +174,126 @@ void CPUEngine::pause() {
     pause_requested_ = true;
 }
 
+// ==============================================================================
+// Instrumentation
+// ==============================================================================
+
+void CPUEngine::set_instrumentation(CPUInstrumentation mode) {
+    instrumentation_ = mode;
+    if (mode == CPUInstrumentation::PROFILE && !profile_) {
+        profile_ = std::make_unique<CPUProfile>();
+    }
+}
+
+void CPUEngine::clear_profile() {
+    if (profile_) profile_->clear();
+}
+
+// ==============================================================================
+// Idle Loop Detection
+// ==============================================================================
+
+bool CPUEngine::is_idle_loop(Word a, Word d, Address pc) const {
+    const MicroOp* ops = memory_.decoded_ptr();
+    const Word* ram = memory_.ram_ptr();
+    const size_t program_size = memory_.rom_size();
+
+    const Word start_a = a;
+    const Word start_d = d;
+    const Address start_pc = pc;
+
+    for (size_t i = 0; i < IDLE_PROBE_LENGTH; i++) {
+        if (pc >= program_size || breakpoints_.test(pc)) return false;
+
+        const MicroOp& op = ops[pc];
+        if (op.op == AluOp::LOAD_A) {
+            a = op.value;
+            pc++;
+        } else {
+            // Any RAM write (or error) means the next pass may differ
+            if (op.op == AluOp::INVALID || (op.dest & 0x1)) return false;
+
+            Word x = a;
+            if (op.reads_m) {
+                // A watched read would pause the loop on its first pass
+                if (a >= CPUAddress::RAM_SIZE || watchpoints_.watches_read(a)) return false;
+                x = ram[a];
+            }
+
+            Word out = evaluate_alu(op.op, d, x);
+            if (op.dest & 0x4) a = out;
+            if (op.dest & 0x2) d = out;
+            if (op.jump && jump_taken(op.jump, out)) {
+                pc = a;
+            } else {
+                pc++;
+            }
+        }
+
+        if (pc == start_pc && a == start_a && d == start_d) return true;
+    }
+
+    return false;
+}
+
+bool CPUEngine::stop_if_idle(Word a, Word d, Address pc) {
+    if (!idle_detection_ || !is_idle_loop(a, d, pc)) {
+        return false;
+    }
+    state_ = CPUState::PAUSED;
+    pause_reason_ = CPUPauseReason::IDLE_LOOP;
+    return true;
+}
+
 // ==============================================================================
 // Breakpoints
 // ==============================================================================
 
 void CPUEngine::add_breakpoint(Address rom_address) {
+    // Addresses past the end of ROM can never be reached; ignore them
     breakpoints_.insert(rom_address);
+    breakpoint_version_++;
 }
 
 void CPUEngine::remove_breakpoint(Address rom_address) {
     breakpoints_.erase(rom_address);
+    breakpoint_version_++;
 }
 
 void CPUEngine::clear_breakpoints() {
     breakpoints_.clear();
+    breakpoint_version_++;
 }
 
 bool CPUEngine::has_breakpoint(Address rom_address) const {
-    return breakpoints_.count(rom_address) > 0;
+    return breakpoints_.test(rom_address);
 }
 
 std::vector<Address> CPUEngine::get_breakpoints() const {
-    return std::vector<Address>(breakpoints_.begin(), breakpoints_.end());
+    return breakpoints_.to_vector();
+}
+
+std::optional<Address> CPUEngine::add_breakpoint_at_line(LineNumber line) {
+    if (!source_map_) return std::nullopt;
+    auto address = source_map_->address_for_line(line);
+    if (address) add_breakpoint(*address);
+    return address;
+}
+
+// ==============================================================================
+// Watchpoints
+// ==============================================================================
+
+void CPUEngine::add_watchpoint(Address first, Address last, WatchKind kind) {
+    watchpoints_.add(first, last, kind);
+}
+
+bool CPUEngine::remove_watchpoint(Address first, Address last) {
+    return watchpoints_.remove(first, last);
+}
+
+void CPUEngine::clear_watchpoints() {
+    watchpoints_.clear();
 }
 
 // ==============================================================================
@@ -158,22 +310,119 @@ DecodedInstruction CPUEngine::get_current_instruction() const {
     return decode_instruction(memory_.read_rom(pc_));
 }
 
+const DisassemblyTable& CPUEngine::disassembly() const {
+    if (!disassembly_) {
+        disassembly_ = std::make_shared<const DisassemblyTable>(*memory_.program(), source_map_.get());
+    }
+    return *disassembly_;
+}
+
 std::string CPUEngine::disassemble(Address rom_address) const {
+    if (rom_address < memory_.rom_size()) {
+        return std::string(disassembly().line(rom_address));
+    }
     return instruction_to_string(memory_.read_rom(rom_address));
 }
 
 std::vector<std::string> CPUEngine::disassemble_range(Address start, Address end) const {
     std::vector<std::string> result;
-    for (Address addr = start; addr < end && addr < memory_.rom_size(); addr++) {
-        result.push_back(instruction_to_string(memory_.read_rom(addr)));
+    const DisassemblyTable& table = disassembly();
+    for (Address addr = start; addr < end && addr < table.size(); addr++) {
+        result.emplace_back(table.line(addr));
     }
     return result;
 }
 
+std::string_view CPUEngine::disassemble_view(Address rom_address) const {
+    return disassembly().line(rom_address);
+}
+
+std::string_view CPUEngine::disassemble_window(Address start, Address end) const {
+    return disassembly().window(start, end);
+}
+
 // ==============================================================================
 // Execution Core
 // ==============================================================================
 
+void CPUEngine::run_switch(uint64_t max_instructions) {
+    if (watchpoints_.empty()) {
+        run_switch_with<false>(max_instructions);
+    } else {
+        run_switch_with<true>(max_instructions);
+    }
+}
+
+template <bool Watched>
+void CPUEngine::run_switch_with(uint64_t max_instructions) {
+    constexpr auto CHECKED = CPUCheckMode::CHECKED;
+    constexpr auto UNCHECKED = CPUCheckMode::UNCHECKED;
+    const bool checked = check_mode_ == CHECKED;
+
+    switch (active_instrumentation()) {
+        case CPUInstrumentation::FULL:
+            checked ? run_switch_as<CHECKED, CPUInstrumentation::FULL, Watched>(max_instructions)
+                    : run_switch_as<UNCHECKED, CPUInstrumentation::FULL, Watched>(max_instructions);
+            break;
+        case CPUInstrumentation::BARE:
+            checked ? run_switch_as<CHECKED, CPUInstrumentation::BARE, Watched>(max_instructions)
+                    : run_switch_as<UNCHECKED, CPUInstrumentation::BARE, Watched>(max_instructions);
+            break;
+        case CPUInstrumentation::TRACE:
+            checked ? run_switch_as<CHECKED, CPUInstrumentation::TRACE, Watched>(max_instructions)
+                    : run_switch_as<UNCHECKED, CPUInstrumentation::TRACE, Watched>(max_instructions);
+            break;
+        case CPUInstrumentation::PROFILE:
+            checked ? run_switch_as<CHECKED, CPUInstrumentation::PROFILE, Watched>(max_instructions)
+                    : run_switch_as<UNCHECKED, CPUInstrumentation::PROFILE, Watched>(max_instructions);
+            break;
+    }
+}
+
+template <CPUCheckMode Mode, CPUInstrumentation Inst, bool Watched>
+void CPUEngine::run_switch_as(uint64_t max_instructions) {
+    uint64_t count = 0;
+
+    if (!breakpoints_.empty()) {
+        while (state_ == CPUState::RUNNING && count < max_instructions) {
+            if (count % PAUSE_POLL_INTERVAL == 0 &&
+                stop_if_idle(a_register_, d_register_, pc_)) {
+                return;
+            }
+            if (!execute_instruction()) {
+                break;
+            }
+            count++;
+        }
+        return;
+    }
+
+    while (state_ == CPUState::RUNNING && count < max_instructions) {
+        if (pc_ >= memory_.rom_size()) {
+            state_ = CPUState::HALTED;
+            return;
+        }
+        if (pause_requested_.load(std::memory_order_relaxed)) {
+            pause_requested_ = false;
+            state_ = CPUState::PAUSED;
+            pause_reason_ = CPUPauseReason::USER_REQUEST;
+            return;
+        }
+        if (stop_if_idle(a_register_, d_register_, pc_)) {
+            return;
+        }
+
+        // execute_current_as() leaves PC in range whenever it returns true
+        uint64_t slice = std::min(max_instructions - count, PAUSE_POLL_INTERVAL);
+        for (uint64_t i = 0; i < slice; i++) {
+            if (!execute_current_as<Mode, Inst, Watched>()) {
+                return;
+            }
+        }
+        count += slice;
+    }
+}
+
 bool CPUEngine::execute_instruction() {
     // Check halt: PC past loaded program
     if (pc_ >= memory_.rom_size()) {
@@ -191,158 +440,177 @@ bool CPUEngine::execute_instruction() {
 
     // Check breakpoints (skip on first instruction after run to avoid
     // re-triggering on the same breakpoint)
-    if (stats_.instructions_executed > 0 && breakpoints_.count(pc_)) {
+    if (stats_.instructions_executed > 0 && breakpoints_.test(pc_)) {
         state_ = CPUState::PAUSED;
         pause_reason_ = CPUPauseReason::BREAKPOINT;
         return false;
     }
 
-    try {
-        // Fetch
-        Word raw = memory_.rom_ptr()[pc_];
+    return watchpoints_.empty() ? execute_current_with<false>() : execute_current_with<true>();
+}
 
-        if (!(raw & 0x8000)) {
-            // ---- A-instruction ----
-            a_register_ = raw & 0x7FFF;
-            pc_++;
-            stats_.a_instruction_count++;
+bool CPUEngine::execute_current() {
+    return check_mode_ == CPUCheckMode::CHECKED
+        ? execute_current_as<CPUCheckMode::CHECKED, CPUInstrumentation::FULL>()
+        : execute_current_as<CPUCheckMode::UNCHECKED, CPUInstrumentation::FULL>();
+}
 
-        } else {
-            // ---- C-instruction: 111accccccdddjjj ----
-            uint8_t comp_bits = static_cast<uint8_t>((raw >> 6) & 0x7F);
-            uint8_t dest_bits = static_cast<uint8_t>((raw >> 3) & 0x7);
-            uint8_t jump_bits = static_cast<uint8_t>(raw & 0x7);
-
-            // Determine ALU input: A register or M (RAM[A])
-            Word am_val;
-            if (comp_bits & 0x40) {
-                // a-bit set: use M = RAM[A]
-                am_val = memory_.read_ram(a_register_);
-                stats_.memory_reads++;
-            } else {
-                am_val = a_register_;
-            }
+template <bool Watched>
+bool CPUEngine::execute_current_with() {
+    constexpr auto CHECKED = CPUCheckMode::CHECKED;
+    constexpr auto UNCHECKED = CPUCheckMode::UNCHECKED;
+    const bool checked = check_mode_ == CHECKED;
+
+    switch (active_instrumentation()) {
+        case CPUInstrumentation::BARE:
+            return checked ? execute_current_as<CHECKED, CPUInstrumentation::BARE, Watched>()
+                           : execute_current_as<UNCHECKED, CPUInstrumentation::BARE, Watched>();
+        case CPUInstrumentation::TRACE:
+            return checked ? execute_current_as<CHECKED, CPUInstrumentation::TRACE, Watched>()
+                           : execute_current_as<UNCHECKED, CPUInstrumentation::TRACE, Watched>();
+        case CPUInstrumentation::PROFILE:
+            return checked ? execute_current_as<CHECKED, CPUInstrumentation::PROFILE, Watched>()
+                           : execute_current_as<UNCHECKED, CPUInstrumentation::PROFILE, Watched>();
+        case CPUInstrumentation::FULL:
+            break;
+    }
+    return checked ? execute_current_as<CHECKED, CPUInstrumentation::FULL, Watched>()
+                   : execute_current_as<UNCHECKED, CPUInstrumentation::FULL, Watched>();
+}
 
-            // Compute ALU result
-            Word alu_output = compute_alu(
-                static_cast<Computation>(comp_bits), d_register_, am_val);
+template <CPUCheckMode Mode, CPUInstrumentation Inst, bool Watched>
+bool CPUEngine::execute_current_as() {
+    constexpr bool checked = Mode == CPUCheckMode::CHECKED;
+    constexpr bool counted = Inst != CPUInstrumentation::BARE;
+    constexpr bool profiled = Inst == CPUInstrumentation::PROFILE;
+    const Address at = pc_;
+    bool watch_hit = false;
 
-            // Store results — save original A for M write
-            Word original_a = a_register_;
+    if (Inst == CPUInstrumentation::TRACE) {
+        trace_hook_(pc_, a_register_, d_register_);
+    }
 
-            if (dest_bits & 0x4) {  // d1: A register
-                a_register_ = alu_output;
-            }
-            if (dest_bits & 0x2) {  // d2: D register
-                d_register_ = alu_output;
+    // Fetch the predecoded micro-op (decoded once at load time)
+    const MicroOp& op = memory_.decoded_ptr()[pc_];
+
+    if (op.op == AluOp::LOAD_A) {
+        // ---- A-instruction ----
+        a_register_ = op.value;
+        pc_++;
+        if (counted) stats_.a_instruction_count++;
+
+    } else {
+        // ---- C-instruction ----
+        if (op.op == AluOp::INVALID) {
+            raise_error(CPUErrorCode::INVALID_INSTRUCTION, pc_);
+            return false;
+        }
+
+        // Determine ALU input: A register or M (RAM[A])
+        Word x_val;
+        if (op.reads_m) {
+            if (checked && a_register_ >= CPUAddress::RAM_SIZE) {
+                raise_error(CPUErrorCode::RAM_READ_OUT_OF_RANGE, a_register_);
+                return false;
             }
-            if (dest_bits & 0x1) {  // d3: M (RAM[A])
-                memory_.write_ram(original_a, alu_output);
-                stats_.memory_writes++;
+            const Address address = ram_address<Mode>(a_register_);
+            x_val = memory_.read_ram_unchecked(address);
+            if (counted) stats_.memory_reads++;
+            if (Watched && watchpoints_.watches_read(address)) {
+                watch_hit_ = {address, at, WatchKind::READ, x_val, x_val};
+                watch_hit = true;
             }
+        } else {
+            x_val = a_register_;
+        }
 
-            // Jump evaluation
-            if (should_jump(static_cast<JumpCondition>(jump_bits), alu_output)) {
-                pc_ = a_register_;
-                stats_.jump_count++;
-            } else {
-                pc_++;
-            }
+        Word alu_output = evaluate_alu(op.op, d_register_, x_val);
 
-            stats_.c_instruction_count++;
-        }
+        // Store results — save original A for M write
+        Word original_a = a_register_;
 
-        stats_.instructions_executed++;
+        if (op.dest & 0x4) {  // d1: A register
+            a_register_ = alu_output;
+        }
+        if (op.dest & 0x2) {  // d2: D register
+            d_register_ = alu_output;
+        }
+        if (op.dest & 0x1) {  // d3: M (RAM[A])
+            if (checked && original_a >= CPUAddress::RAM_SIZE) {
+                raise_error(CPUErrorCode::RAM_WRITE_OUT_OF_RANGE, original_a);
+                return false;
+            }
+            const Address address = ram_address<Mode>(original_a);
+            if (Watched && watchpoints_.watches_write(address)) {
+                watch_hit_ = {address, at, WatchKind::WRITE,
+                              memory_.read_ram_unchecked(address), alu_output};
+                watch_hit = true;
+            }
+            memory_.write_ram_unchecked(address, alu_output);
+            if (counted) stats_.memory_writes++;
+        }
 
-        // Check if PC has reached end of program after execution
-        if (pc_ >= memory_.rom_size()) {
-            state_ = CPUState::HALTED;
-            return false;
+        // Jump evaluation
+        if (op.jump && jump_taken(op.jump, alu_output)) {
+            pc_ = a_register_;
+            if (counted) stats_.jump_count++;
+            if (profiled) profile_->jumps_data()[at]++;
+        } else {
+            pc_++;
         }
 
-    } catch (const N2TError& e) {
-        error_message_ = e.what();
-        error_location_ = pc_;
-        state_ = CPUState::ERROR;
-        return false;
-    } catch (const std::exception& e) {
-        error_message_ = std::string("Unexpected error: ") + e.what();
-        error_location_ = pc_;
-        state_ = CPUState::ERROR;
-        return false;
+        if (counted) stats_.c_instruction_count++;
     }
 
-    return true;
-}
+    stats_.instructions_executed++;
+    if (profiled) profile_->executed_data()[at]++;
 
-// ==============================================================================
-// ALU
-// ==============================================================================
+    // Pause once the watched access has completed
+    if (Watched && watch_hit) {
+        state_ = CPUState::PAUSED;
+        pause_reason_ = CPUPauseReason::WATCHPOINT;
+        return false;
+    }
 
-Word CPUEngine::compute_alu(Computation comp, Word d_val, Word am_val) const {
-    int16_t d = static_cast<int16_t>(d_val);
-    int16_t am = static_cast<int16_t>(am_val);
-    int16_t result;
-
-    switch (comp) {
-        case Computation::ZERO:      result = 0; break;
-        case Computation::ONE:       result = 1; break;
-        case Computation::NEG_ONE:   result = -1; break;
-        case Computation::D:         result = d; break;
-        case Computation::A:
-        case Computation::M:         result = am; break;
-        case Computation::NOT_D:     result = static_cast<int16_t>(~d); break;
-        case Computation::NOT_A:
-        case Computation::NOT_M:     result = static_cast<int16_t>(~am); break;
-        case Computation::NEG_D:     result = static_cast<int16_t>(-d); break;
-        case Computation::NEG_A:
-        case Computation::NEG_M:     result = static_cast<int16_t>(-am); break;
-        case Computation::D_PLUS_1:  result = static_cast<int16_t>(d + 1); break;
-        case Computation::A_PLUS_1:
-        case Computation::M_PLUS_1:  result = static_cast<int16_t>(am + 1); break;
-        case Computation::D_MINUS_1: result = static_cast<int16_t>(d - 1); break;
-        case Computation::A_MINUS_1:
-        case Computation::M_MINUS_1: result = static_cast<int16_t>(am - 1); break;
-        case Computation::D_PLUS_A:
-        case Computation::D_PLUS_M:  result = static_cast<int16_t>(d + am); break;
-        case Computation::D_MINUS_A:
-        case Computation::D_MINUS_M: result = static_cast<int16_t>(d - am); break;
-        case Computation::A_MINUS_D:
-        case Computation::M_MINUS_D: result = static_cast<int16_t>(am - d); break;
-        case Computation::D_AND_A:
-        case Computation::D_AND_M:   result = d & am; break;
-        case Computation::D_OR_A:
-        case Computation::D_OR_M:    result = d | am; break;
-        default:
-            throw RuntimeError(
-                "Invalid ALU computation code at ROM[" + std::to_string(pc_) +
-                "]. The instruction may be corrupted.");
+    // Check if PC has reached end of program after execution
+    if (pc_ >= memory_.rom_size()) {
+        state_ = CPUState::HALTED;
+        return false;
     }
 
-    return static_cast<Word>(result);
+    return true;
 }
 
 // ==============================================================================
-// Jump Evaluation
+// Error Handling
 // ==============================================================================
 
-bool CPUEngine::should_jump(JumpCondition jump, Word alu_output) const {
-    if (jump == JumpCondition::NO_JUMP) return false;
-    if (jump == JumpCondition::JMP) return true;
-
-    int16_t val = static_cast<int16_t>(alu_output);
-    uint8_t j = static_cast<uint8_t>(jump);
-
-    // j1 (bit 2) = lt, j2 (bit 1) = eq, j3 (bit 0) = gt
-    return (val < 0  && (j & 0x4)) ||
-           (val == 0 && (j & 0x2)) ||
-           (val > 0  && (j & 0x1));
-}
-
 void CPUEngine::set_error(const std::string& message) {
     error_message_ = message;
     error_location_ = pc_;
     state_ = CPUState::ERROR;
 }
 
+void CPUEngine::raise_error(CPUErrorCode code, Address address) {
+    // Formatted exactly as the RuntimeError the memory accessors throw
+    std::string message;
+    switch (code) {
+        case CPUErrorCode::RAM_READ_OUT_OF_RANGE:
+            message = CPUMemory::read_error_message(address);
+            break;
+        case CPUErrorCode::RAM_WRITE_OUT_OF_RANGE:
+            message = CPUMemory::write_error_message(address);
+            break;
+        case CPUErrorCode::INVALID_INSTRUCTION:
+            message = "Invalid ALU computation code at ROM[" + std::to_string(address) +
+                      "]. The instruction may be corrupted.";
+            break;
+        case CPUErrorCode::NONE:
+            break;
+    }
+
+    set_error(RuntimeError(message).what());
+    error_code_ = code;
+}
+
 }  // namespace n2t
@@ -11,8 +11,15 @@
 // - Disassembly of instructions
 // - Execution statistics
 //
-// The fetch-decode-execute cycle is optimized for speed: inline bit
-// extraction in the hot loop, no heap allocation per instruction.
+// The fetch-decode-execute cycle is optimized for speed: instructions are
+// predecoded into MicroOps when the ROM is loaded, so the hot loop only
+// dispatches on the micro-op table, with no heap allocation per instruction.
+// CPUDispatch::BLOCK translates basic blocks into fused operations
+// (see cpu_block.hpp); on x86-64 hosts, CPUDispatch::JIT translates them
+// into native code instead (see cpu_jit.hpp).
+//
+// With history enabled, execution is recorded so that step_back() and
+// run_back() can move backwards (see cpu_history.hpp).
 // ==============================================================================
 
 #ifndef NAND2TETRIS_CPU_HPP
@@ -20,9 +27,16 @@
 
 #include "instruction.hpp"
 #include "memory.hpp"
-#include <unordered_set>
+#include "cpu_block.hpp"
+#include "cpu_watch.hpp"
+#include "cpu_jit.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <vector>
 #include <string>
+#include <string_view>
 
 namespace n2t {
 
@@ -42,7 +56,88 @@ enum class CPUPauseReason {
     NONE,
     STEP_COMPLETE,
     BREAKPOINT,
-    USER_REQUEST
+    USER_REQUEST,
+    IDLE_LOOP,      // Spinning in a loop that can never change state (opt-in)
+    HISTORY_START,  // Reverse execution reached the oldest recorded state
+    WATCHPOINT      // An instruction accessed a watched RAM word (see get_watch_hit())
+};
+
+/**
+ * @brief Which execution core run() and run_for() use.
+ *
+ * All cores give bit-identical results (registers, RAM, stats, errors).
+ *   SWITCH:   one loop iteration per instruction, one dispatch point.
+ *   THREADED: one handler per instruction shape, each ending in its own
+ *             indirect jump to the next handler (GCC/Clang labels-as-values,
+ *             with a portable switch fallback on other compilers).
+ *   BLOCK:    basic blocks translated on first use into fused operations
+ *             ("@X; D=M" becomes one load), one dispatch per fused op.
+ *   JIT:      basic blocks translated to x86-64 code on first use; falls
+ *             back to BLOCK where jit_supported() is false.
+ * step() always uses the SWITCH core.
+ */
+enum class CPUDispatch {
+    SWITCH,
+    THREADED,
+    BLOCK,
+    JIT
+};
+
+/**
+ * @brief How much the execution cores validate RAM accesses.
+ *
+ *   CHECKED:   an M access with A outside 0-32767 stops execution with
+ *              CPUState::ERROR and the usual error message (default).
+ *   UNCHECKED: for trusted, pre-validated ROMs. M addresses are masked to
+ *              15 bits and never checked, so such a program silently wraps
+ *              around instead of stopping. Invalid instructions are still
+ *              reported, since detecting them costs nothing extra.
+ *
+ * Neither mode throws from the hot loop: errors are recorded as a
+ * CPUErrorCode, and the message is built only when execution stops.
+ */
+enum class CPUCheckMode {
+    CHECKED,
+    UNCHECKED
+};
+
+/**
+ * @brief What the execution cores record besides the machine state.
+ *
+ *   FULL:  every CPUStats counter (default).
+ *   BARE:  only instructions_executed, which budgets, breakpoints and
+ *          history depend on; the other counters keep their old values.
+ *          For production runs that only need the final RAM.
+ *   TRACE: FULL, plus a call to the trace hook before every instruction
+ *          (see set_trace_hook). Without a hook it behaves like FULL.
+ *   PROFILE: FULL, plus per-ROM-address execution and taken-jump counts
+ *          (see get_profile and cpu_profile.hpp).
+ *
+ * Each policy is a separate compile-time instantiation of the SWITCH and
+ * THREADED cores, so BARE carries no counter code at all. BLOCK and JIT
+ * keep counters per block and run on the THREADED core under TRACE and
+ * PROFILE.
+ */
+enum class CPUInstrumentation {
+    FULL,
+    BARE,
+    TRACE,
+    PROFILE
+};
+
+/**
+ * @brief Called with (pc, a, d) before each instruction under TRACE.
+ */
+using CPUTraceHook = std::function<void(Address pc, Word a, Word d)>;
+
+/**
+ * @brief Why execution stopped with CPUState::ERROR.
+ */
+enum class CPUErrorCode {
+    NONE,
+    RAM_READ_OUT_OF_RANGE,    // M read with A >= 32768
+    RAM_WRITE_OUT_OF_RANGE,   // M write with A >= 32768
+    INVALID_INSTRUCTION       // C-instruction with unknown comp bits
 };
 
 // ==============================================================================
@@ -67,6 +162,12 @@ struct CPUStats {
     }
 };
 
+class CPUHistory;
+class CPUProfile;
+class ControlFlowGraph;
+class DisassemblyTable;
+struct AsmSourceMap;
+
 // ==============================================================================
 // CPU Engine Class
 // ==============================================================================
@@ -90,13 +191,17 @@ struct CPUStats {
 class CPUEngine {
 public:
     CPUEngine();
+    ~CPUEngine();
 
     // =========================================================================
     // Program Loading
     // =========================================================================
 
     /**
-     * @brief Load a .hack file into ROM.
+     * @brief Load a .hack, .hackb or .asm file into ROM.
+     *
+     * .asm files are assembled in process (see assembler.hpp) and keep
+     * their source map.
      */
     void load_file(const std::string& file_path);
 
@@ -105,11 +210,23 @@ public:
      */
     void load_string(const std::string& hack_text);
 
+    /**
+     * @brief Assemble Hack assembly source and load it.
+     *
+     * @throws ParseError if the source does not assemble
+     */
+    void load_asm(const std::string& asm_text);
+
     /**
      * @brief Load from pre-parsed instruction words.
      */
     void load(const std::vector<Word>& instructions);
 
+    /**
+     * @brief Load a prebuilt program, shared with any other engine using it.
+     */
+    void load_program(std::shared_ptr<const CPUProgram> program);
+
     /**
      * @brief Reset CPU to initial state (registers zeroed, RAM cleared).
      */
@@ -139,6 +256,107 @@ public:
      */
     void pause();
 
+    /**
+     * @brief Select the execution core used by run() and run_for().
+     */
+    void set_dispatch(CPUDispatch mode) { dispatch_ = mode; }
+    CPUDispatch get_dispatch() const { return dispatch_; }
+
+    /**
+     * @brief Select how RAM accesses are validated (see CPUCheckMode).
+     */
+    void set_check_mode(CPUCheckMode mode) { check_mode_ = mode; }
+    CPUCheckMode get_check_mode() const { return check_mode_; }
+
+    /**
+     * @brief Pause run()/run_for() with CPUPauseReason::IDLE_LOOP once the
+     *        program is stuck in a loop that can never change state.
+     *
+     * Catches the usual "(END) @END; 0;JMP" ending as well as busy-waits
+     * like "@KBD; D=M; @LOOP; D;JEQ": any loop that writes no RAM and
+     * comes back to the same A, D and PC. The check runs every
+     * PAUSE_POLL_INTERVAL instructions, so a run stops within that many
+     * instructions of entering the loop. Resuming after the keyboard (or
+     * any RAM) changes continues normally. Off by default.
+     */
+    void set_idle_detection(bool enabled) { idle_detection_ = enabled; }
+    bool get_idle_detection() const { return idle_detection_; }
+
+    /**
+     * @brief Select which statistics the cores keep (see CPUInstrumentation).
+     *
+     * Selecting PROFILE allocates the profile counters on first use; they
+     * are kept (and keep accumulating) until clear_profile() or a load.
+     */
+    void set_instrumentation(CPUInstrumentation mode);
+    CPUInstrumentation get_instrumentation() const { return instrumentation_; }
+
+    /**
+     * @brief Counters collected under PROFILE, or nullptr if it was never
+     *        selected.
+     */
+    const CPUProfile* get_profile() const { return profile_.get(); }
+    void clear_profile();
+
+    /**
+     * @brief Hook called before every instruction under
+     *        CPUInstrumentation::TRACE (pass nullptr to remove it).
+     */
+    void set_trace_hook(CPUTraceHook hook) { trace_hook_ = std::move(hook); }
+
+    // =========================================================================
+    // Reverse Execution
+    // =========================================================================
+
+    /**
+     * @brief Record execution so that it can be stepped backwards.
+     *
+     * While enabled, run() and run_for() use the SWITCH core whatever the
+     * dispatch setting, and every instruction logs the RAM word it
+     * overwrites. Turning history off (or reset/load) discards it.
+     */
+    void set_history_enabled(bool enabled);
+    bool get_history_enabled() const { return history_ != nullptr; }
+
+    /**
+     * @brief Memory cap for the recorded history, in bytes (default 64 MB).
+     *
+     * Each checkpoint takes 64 KB; once the cap is reached the oldest
+     * history is discarded.
+     */
+    void set_history_limit(size_t bytes);
+    size_t get_history_limit() const { return history_limit_; }
+
+    /**
+     * @brief Instructions between periodic checkpoints (default 1M).
+     *
+     * Stepping back re-executes at most this many instructions.
+     */
+    void set_checkpoint_interval(uint64_t instructions);
+    uint64_t get_checkpoint_interval() const { return checkpoint_interval_; }
+
+    /**
+     * @brief How many instructions step_back() can currently undo.
+     */
+    uint64_t history_depth() const;
+
+    /**
+     * @brief Undo the last count instructions.
+     *
+     * Stepping back from ERROR first returns to the state just before the
+     * failing instruction (that counts as one step). Ends PAUSED with
+     * STEP_COMPLETE, or HISTORY_START if the history ran out first.
+     * Does nothing without history.
+     */
+    CPUState step_back(uint64_t count = 1);
+
+    /**
+     * @brief Go back to the most recent earlier point where PC was at a
+     *        breakpoint (pause reason BREAKPOINT), or to the oldest
+     *        recorded state (HISTORY_START) if there is none.
+     */
+    CPUState run_back();
+
     bool is_running() const { return state_ == CPUState::RUNNING; }
     CPUState get_state() const { return state_; }
     CPUPauseReason get_pause_reason() const { return pause_reason_; }
@@ -156,7 +374,10 @@ public:
     // =========================================================================
 
     Word read_ram(Address address) const { return memory_.read_ram(address); }
-    void write_ram(Address address, Word value) { memory_.write_ram(address, value); }
+    void write_ram(Address address, Word value) {
+        if (history_) note_external_write(address, value);
+        memory_.write_ram(address, value);
+    }
     Word read_rom(Address address) const { return memory_.read_rom(address); }
     size_t rom_size() const { return memory_.rom_size(); }
 
@@ -168,8 +389,12 @@ public:
     // =========================================================================
 
     const Word* get_screen_buffer() const { return memory_.screen_buffer(); }
+    ScreenDelta take_screen_delta() { return memory_.take_screen_delta(); }
     Word get_keyboard() const { return memory_.get_keyboard(); }
-    void set_keyboard(Word key_code) { memory_.set_keyboard(key_code); }
+    void set_keyboard(Word key_code) {
+        if (history_) note_external_write(CPUAddress::KEYBOARD, key_code);
+        memory_.set_keyboard(key_code);
+    }
 
     // =========================================================================
     // Breakpoints
@@ -181,6 +406,37 @@ public:
     bool has_breakpoint(Address rom_address) const;
     std::vector<Address> get_breakpoints() const;
 
+    /**
+     * @brief Break on the first instruction assembled from an .asm line
+     *        (or the next line that produced one).
+     *
+     * @return The breakpoint's ROM address, or nullopt if no .asm source
+     *         is loaded or nothing was assembled at or after the line
+     */
+    std::optional<Address> add_breakpoint_at_line(LineNumber line);
+
+    // =========================================================================
+    // Watchpoints
+    // =========================================================================
+
+    /**
+     * @brief Pause after any instruction that reads or writes (per kind) a
+     *        RAM word in [first, last], with CPUPauseReason::WATCHPOINT.
+     *
+     * While a watchpoint is set, run() and run_for() use the SWITCH core
+     * whatever the dispatch setting. Writes through write_ram() and
+     * set_keyboard() are not reported.
+     */
+    void add_watchpoint(Address first, Address last, WatchKind kind = WatchKind::WRITE);
+    bool remove_watchpoint(Address first, Address last);
+    void clear_watchpoints();
+    const std::vector<Watchpoint>& get_watchpoints() const { return watchpoints_.list(); }
+
+    /**
+     * @brief The access that caused the last WATCHPOINT pause.
+     */
+    const WatchHit& get_watch_hit() const { return watch_hit_; }
+
     // =========================================================================
     // Disassembly
     // =========================================================================
@@ -192,6 +448,9 @@ public:
 
     /**
      * @brief Disassemble the instruction at a ROM address.
+     *
+     * Programs loaded from .asm show their source text (with labels)
+     * instead of the decoded form.
      */
     std::string disassemble(Address rom_address) const;
 
@@ -200,12 +459,46 @@ public:
      */
     std::vector<std::string> disassemble_range(Address start, Address end) const;
 
+    /**
+     * @brief Disassembly of a ROM address as a view into the cached table
+     *        (see disassembly.hpp); empty past the end of the program.
+     *
+     * The table is formatted once, on the first call after a load, and
+     * views stay valid until the next load or reset.
+     */
+    std::string_view disassemble_view(Address rom_address) const;
+
+    /**
+     * @brief Disassembly of [start, end), clipped to the program, as one
+     *        view with lines joined by '\n'. Valid like disassemble_view().
+     */
+    std::string_view disassemble_window(Address start, Address end) const;
+
+    /**
+     * @brief Source map of the loaded .asm program, or nullptr if the
+     *        program was not loaded from assembly.
+     */
+    const AsmSourceMap* get_source_map() const { return source_map_.get(); }
+
+    // =========================================================================
+    // Static Analysis
+    // =========================================================================
+
+    /**
+     * @brief Control-flow graph of the loaded program (see cpu_cfg.hpp).
+     *
+     * Built on the first call after a load and kept until the next load
+     * or reset.
+     */
+    std::shared_ptr<const ControlFlowGraph> get_cfg() const;
+
     // =========================================================================
     // Statistics and Error
     // =========================================================================
 
     const CPUStats& get_stats() const { return stats_; }
     const std::string& get_error_message() const { return error_message_; }
+    CPUErrorCode get_error_code() const { return error_code_; }
     Address get_error_location() const { return error_location_; }
 
 private:
@@ -220,38 +513,235 @@ private:
     // State
     CPUState state_ = CPUState::READY;
     CPUPauseReason pause_reason_ = CPUPauseReason::NONE;
-    bool pause_requested_ = false;
+    std::atomic<bool> pause_requested_{false};  // Set by pause() from any thread
+    CPUDispatch dispatch_ = CPUDispatch::SWITCH;
+    CPUCheckMode check_mode_ = CPUCheckMode::CHECKED;
+    bool idle_detection_ = false;
+    CPUInstrumentation instrumentation_ = CPUInstrumentation::FULL;
+    CPUTraceHook trace_hook_;
+    std::unique_ptr<CPUProfile> profile_;
 
     // Statistics
     CPUStats stats_;
 
+    // Source of a program loaded from .asm (null otherwise)
+    std::shared_ptr<const AsmSourceMap> source_map_;
+
+    // Control-flow graph of the loaded program (built on demand)
+    mutable std::shared_ptr<const ControlFlowGraph> cfg_;
+
+    // Disassembly of the loaded program (built on demand)
+    mutable std::shared_ptr<const DisassemblyTable> disassembly_;
+
     // Breakpoints
-    std::unordered_set<Address> breakpoints_;
+    RomBitmap breakpoints_;
+    uint64_t breakpoint_version_ = 0;  // Bumped on every breakpoint change
+
+    // Watchpoints
+    RamWatchpoints watchpoints_;
+    WatchHit watch_hit_;
+
+    // Translated block caches (the JIT's is created on first use)
+    BlockTranslator block_cache_;
+    std::unique_ptr<CPUJit> jit_;
+
+    // Reverse execution (null while history is disabled)
+    std::unique_ptr<CPUHistory> history_;
+    size_t history_limit_;
+    uint64_t checkpoint_interval_;
 
     // Error
     std::string error_message_;
+    CPUErrorCode error_code_ = CPUErrorCode::NONE;
     Address error_location_ = 0;
 
     // =========================================================================
     // Internal
     // =========================================================================
 
+    /**
+     * @brief How often (in instructions) run loops poll the pause flag.
+     *
+     * pause() is only meaningful from another thread while a run is in
+     * progress, so checking it every instruction buys nothing.
+     */
+    static constexpr uint64_t PAUSE_POLL_INTERVAL = 4096;
+
+    /**
+     * @brief The disassembly table of the loaded program, built on first use.
+     */
+    const DisassemblyTable& disassembly() const;
+
     /**
      * @brief Execute one instruction. Returns true to continue.
      */
     bool execute_instruction();
 
     /**
-     * @brief Evaluate the ALU for a computation code.
+     * @brief Execute the instruction at PC without the halt, pause and
+     *        breakpoint checks. Requires PC < rom_size().
+     *
+     * Watchpoints are not checked either, so reverse execution can replay
+     * instructions with it; execute_instruction() checks them. Always runs
+     * with FULL instrumentation: a replayed instruction already reached
+     * the profile and the trace hook when it first ran.
+     */
+    bool execute_current();
+
+    template <bool Watched>
+    bool execute_current_with();
+
+    template <CPUCheckMode Mode, CPUInstrumentation Inst, bool Watched = false>
+    bool execute_current_as();
+
+    /**
+     * @brief The instrumentation the cores actually apply: TRACE without
+     *        a hook is FULL.
+     */
+    CPUInstrumentation active_instrumentation() const {
+        if (instrumentation_ == CPUInstrumentation::TRACE && !trace_hook_) {
+            return CPUInstrumentation::FULL;
+        }
+        return instrumentation_;
+    }
+
+    /**
+     * @brief Whether the active instrumentation works per instruction, so
+     *        BLOCK and JIT must hand over to the THREADED core.
+     */
+    bool needs_per_instruction() const {
+        CPUInstrumentation active = active_instrumentation();
+        return active == CPUInstrumentation::TRACE || active == CPUInstrumentation::PROFILE;
+    }
+
+    /**
+     * @brief Switch execution core for run() and run_for().
+     *
+     * Without breakpoints only the halt check runs per instruction, and the
+     * pause flag is polled every PAUSE_POLL_INTERVAL instructions.
+     */
+    void run_switch(uint64_t max_instructions);
+
+    template <bool Watched>
+    void run_switch_with(uint64_t max_instructions);
+
+    template <CPUCheckMode Mode, CPUInstrumentation Inst, bool Watched>
+    void run_switch_as(uint64_t max_instructions);
+
+    /**
+     * @brief RAM index for the address in A under a check mode.
+     *
+     * CHECKED callers have already rejected out-of-range addresses.
      */
-    Word compute_alu(Computation comp, Word d_val, Word am_val) const;
+    template <CPUCheckMode Mode>
+    static Address ram_address(Address address) {
+        if (Mode == CPUCheckMode::CHECKED) return address;
+        return static_cast<Address>(address & (CPUAddress::RAM_SIZE - 1));
+    }
 
     /**
-     * @brief Evaluate whether a jump should be taken.
+     * @brief Threaded execution core (see cpu_threaded.cpp).
+     *
+     * Executes up to max_instructions, leaving state_ RUNNING if the
+     * budget runs out, exactly as a loop over execute_instruction() would.
      */
-    bool should_jump(JumpCondition jump, Word alu_output) const;
+    void run_threaded(uint64_t max_instructions);
+
+    template <CPUCheckMode Mode, CPUInstrumentation Inst>
+    void run_threaded_with(uint64_t max_instructions);
+
+    template <CPUCheckMode Mode, CPUInstrumentation Inst, bool Breakpoints>
+    void run_threaded_as(uint64_t max_instructions);
+
+    /**
+     * @brief Basic-block execution core (see cpu_block.cpp).
+     *
+     * Same contract as run_threaded(); instructions that cannot run inside
+     * a block go through execute_instruction().
+     */
+    void run_blocks(uint64_t max_instructions);
+
+    /**
+     * @brief JIT execution core (see cpu_jit.cpp).
+     *
+     * Same contract as run_threaded(); instructions that cannot run natively
+     * (screen/keyboard/out-of-range M, invalid code, partial blocks at the
+     * end of a budget) go through execute_instruction().
+     */
+    void run_jit(uint64_t max_instructions);
 
     void set_error(const std::string& message);
+
+    /**
+     * @brief Start over on a newly loaded ROM: clear registers, state,
+     *        stats, history and profile, and drop every cache of the old ROM.
+     *
+     * Called by every loader and by reset(); a new per-program cache is
+     * cleared here.
+     */
+    void on_program_loaded();
+
+    // =========================================================================
+    // Reverse Execution (see cpu_history.cpp)
+    // =========================================================================
+
+    /**
+     * @brief Recording execution core, used instead of the others while
+     *        history is enabled.
+     */
+    void run_recorded(uint64_t max_instructions);
+
+    /**
+     * @brief Checkpoint if one is due, and log the RAM word the instruction
+     *        at PC is about to overwrite.
+     */
+    void record_instruction();
+
+    /**
+     * @brief Log a write_ram()/set_keyboard() from outside the program.
+     */
+    void note_external_write(Address address, Word value);
+
+    /**
+     * @brief Restore the recorded state at an instruction count.
+     *
+     * @param live true if the machine is still in its newest recorded state
+     */
+    void travel_to(uint64_t instruction, bool live);
+
+    /**
+     * @brief Load a checkpoint's registers and statistics.
+     */
+    void load_checkpoint(size_t index);
+
+    /**
+     * @brief Longest loop (in instructions) recognized as idle.
+     */
+    static constexpr size_t IDLE_PROBE_LENGTH = 256;
+
+    /**
+     * @brief Whether execution from (a, d, pc) is stuck in an idle loop.
+     *
+     * Simulates up to IDLE_PROBE_LENGTH instructions without side effects.
+     * The loop is idle if it returns to the same A, D and PC without writing
+     * RAM (so the next pass would be identical) and without crossing a
+     * breakpoint.
+     */
+    bool is_idle_loop(Word a, Word d, Address pc) const;
+
+    /**
+     * @brief If idle detection is on and (a, d, pc) is idle, pause with
+     *        IDLE_LOOP and return true.
+     */
+    bool stop_if_idle(Word a, Word d, Address pc);
+
+    /**
+     * @brief Stop with an error code and its user-facing message.
+     *
+     * @param address The offending RAM address, or the ROM address for
+     *                INVALID_INSTRUCTION
+     */
+    void raise_error(CPUErrorCode code, Address address);
 };
 
 }  // namespace n2t
@@ -0,0 +1,291 @@
+// ==============================================================================
+// Hack CPU Basic-Block Translator Implementation
+// ==============================================================================
+
+#include "cpu.hpp"
+#include "cpu_block.hpp"
+
+namespace n2t {
+
+namespace {
+
+inline bool touches_m(const MicroOp& op) {
+    return op.reads_m || (op.dest & 0x1);
+}
+
+/**
+ * @brief Choose the fused form of "@imm; c".
+ */
+FusedOpKind fuse_pair(const MicroOp& c) {
+    const bool no_jump = c.jump == 0;
+
+    if (c.op == AluOp::X && !c.reads_m && c.dest == 0x2 && no_jump) return FusedOpKind::LOAD_D_IMM;
+    if (c.op == AluOp::X && c.reads_m && c.dest == 0x2 && no_jump)  return FusedOpKind::LOAD_D_MEM;
+    if (c.op == AluOp::D && c.dest == 0x1 && no_jump)               return FusedOpKind::STORE_D_MEM;
+    if (c.op == AluOp::X_PLUS_1 && c.reads_m && c.dest == 0x1 && no_jump)  return FusedOpKind::INC_MEM;
+    if (c.op == AluOp::X_MINUS_1 && c.reads_m && c.dest == 0x1 && no_jump) return FusedOpKind::DEC_MEM;
+    if (c.op == AluOp::D_PLUS_X && c.reads_m && c.dest == 0x2 && no_jump)  return FusedOpKind::ADD_D_MEM;
+    if (c.op == AluOp::D_MINUS_X && c.reads_m && c.dest == 0x2 && no_jump) return FusedOpKind::SUB_D_MEM;
+    if (c.op == AluOp::ZERO && c.dest == 0 && c.jump == 0x7)        return FusedOpKind::JUMP;
+    if (c.op == AluOp::D && c.dest == 0 && !no_jump)                return FusedOpKind::BRANCH_D;
+    return FusedOpKind::SET_A_ALU;
+}
+
+}  // namespace
+
+// ==============================================================================
+// Block Cache
+// ==============================================================================
+
+void BlockTranslator::clear() {
+    blocks_.clear();
+    block_index_.assign(CPUAddress::ROM_SIZE, NOT_TRANSLATED);
+    valid_ = false;
+}
+
+const TranslatedBlock* BlockTranslator::block_at(
+        Address pc, const CPUMemory& memory,
+        const RomBitmap& breakpoints,
+        uint64_t breakpoint_version) {
+    if (!valid_ || rom_generation_ != memory.rom_generation() ||
+        breakpoint_version_ != breakpoint_version) {
+        clear();
+        rom_generation_ = memory.rom_generation();
+        breakpoint_version_ = breakpoint_version;
+        valid_ = true;
+    }
+
+    int32_t index = block_index_[pc];
+    if (index >= 0) return blocks_[static_cast<size_t>(index)].get();
+    if (index == UNTRANSLATABLE) return nullptr;
+
+    return translate(pc, memory, breakpoints);
+}
+
+// ==============================================================================
+// Translation
+// ==============================================================================
+
+const TranslatedBlock* BlockTranslator::translate(
+        Address start, const CPUMemory& memory,
+        const RomBitmap& breakpoints) {
+    const MicroOp* ops = memory.decoded_ptr();
+    const size_t program_size = memory.rom_size();
+
+    // Find the block extent
+    size_t length = 0;
+    for (size_t addr = start; addr < program_size && length < MAX_BLOCK_LENGTH; addr++) {
+        const MicroOp& op = ops[addr];
+        if (op.op == AluOp::INVALID) break;
+        if (length > 0 && breakpoints.test(addr)) break;
+        length++;
+        if (op.op != AluOp::LOAD_A && op.jump) break;
+    }
+
+    if (length == 0) {
+        block_index_[start] = UNTRANSLATABLE;
+        return nullptr;
+    }
+
+    auto block = std::make_unique<TranslatedBlock>();
+    block->length = static_cast<uint16_t>(length);
+    block->a_instructions.assign(length + 1, 0);
+    block->c_instructions.assign(length + 1, 0);
+    block->memory_reads.assign(length + 1, 0);
+    block->memory_writes.assign(length + 1, 0);
+
+    for (size_t i = 0; i < length; i++) {
+        const MicroOp& op = ops[start + i];
+        block->a_instructions[i + 1] = block->a_instructions[i];
+        block->c_instructions[i + 1] = block->c_instructions[i];
+        block->memory_reads[i + 1] = block->memory_reads[i];
+        block->memory_writes[i + 1] = block->memory_writes[i];
+        if (op.op == AluOp::LOAD_A) {
+            block->a_instructions[i + 1]++;
+        } else {
+            block->c_instructions[i + 1]++;
+            if (op.reads_m) block->memory_reads[i + 1]++;
+            if (op.dest & 0x1) block->memory_writes[i + 1]++;
+        }
+    }
+
+    for (size_t i = 0; i < length; ) {
+        const MicroOp& op = ops[start + i];
+        FusedOp fused;
+
+        if (op.op == AluOp::LOAD_A) {
+            fused.imm = op.value;
+            fused.kind = FusedOpKind::SET_A;
+
+            // Fuse only when any M access is known to hit plain RAM
+            if (i + 1 < length) {
+                const MicroOp& next = ops[start + i + 1];
+                if (next.op != AluOp::LOAD_A &&
+                    (!touches_m(next) || op.value < CPUAddress::SCREEN_BASE)) {
+                    fused.kind = fuse_pair(next);
+                    fused.length = 2;
+                    fused.c = next;
+                }
+            }
+        } else {
+            fused.kind = FusedOpKind::ALU;
+            fused.c = op;
+        }
+
+        block->ops.push_back(fused);
+        i += fused.length;
+    }
+
+    block_index_[start] = static_cast<int32_t>(blocks_.size());
+    blocks_.push_back(std::move(block));
+    return blocks_.back().get();
+}
+
+// ==============================================================================
+// Engine Integration
+// ==============================================================================
+
+void CPUEngine::run_blocks(uint64_t max_instructions) {
+    Word* ram = memory_.ram_ptr();
+    const size_t program_size = memory_.rom_size();
+    const bool counted = instrumentation_ != CPUInstrumentation::BARE;
+
+    uint64_t count = 0;
+    uint64_t next_idle_probe = 0;
+    while (state_ == CPUState::RUNNING && count < max_instructions) {
+        if (count >= next_idle_probe) {
+            next_idle_probe = count + PAUSE_POLL_INTERVAL;
+            if (stop_if_idle(a_register_, d_register_, pc_)) break;
+        }
+
+        // Enter a block only where the interpreter would execute the next
+        // instruction without stopping first
+        bool stop_here = pc_ >= program_size ||
+            pause_requested_.load(std::memory_order_relaxed) ||
+            (stats_.instructions_executed > 0 && breakpoints_.test(pc_));
+
+        const TranslatedBlock* block = nullptr;
+        if (!stop_here) {
+            block = block_cache_.block_at(pc_, memory_, breakpoints_, breakpoint_version_);
+        }
+
+        if (block && max_instructions - count >= block->length) {
+            Word a = a_register_;
+            Word d = d_register_;
+            Address next_pc = static_cast<Address>(pc_ + block->length);
+            bool jumped = false;
+            size_t done = 0;
+
+            for (const FusedOp& op : block->ops) {
+                switch (op.kind) {
+                    case FusedOpKind::SET_A:
+                        a = op.imm;
+                        break;
+
+                    case FusedOpKind::LOAD_D_IMM:
+                        a = op.imm;
+                        d = op.imm;
+                        break;
+
+                    case FusedOpKind::LOAD_D_MEM:
+                        a = op.imm;
+                        d = ram[a];
+                        break;
+
+                    case FusedOpKind::STORE_D_MEM:
+                        a = op.imm;
+                        ram[a] = d;
+                        break;
+
+                    case FusedOpKind::INC_MEM:
+                        a = op.imm;
+                        ram[a] = static_cast<Word>(ram[a] + 1);
+                        break;
+
+                    case FusedOpKind::DEC_MEM:
+                        a = op.imm;
+                        ram[a] = static_cast<Word>(ram[a] - 1);
+                        break;
+
+                    case FusedOpKind::ADD_D_MEM:
+                        a = op.imm;
+                        d = static_cast<Word>(d + ram[a]);
+                        break;
+
+                    case FusedOpKind::SUB_D_MEM:
+                        a = op.imm;
+                        d = static_cast<Word>(d - ram[a]);
+                        break;
+
+                    case FusedOpKind::JUMP:
+                        a = op.imm;
+                        next_pc = a;
+                        jumped = true;
+                        break;
+
+                    case FusedOpKind::BRANCH_D:
+                        a = op.imm;
+                        if (jump_taken(op.c.jump, d)) {
+                            next_pc = a;
+                            jumped = true;
+                        }
+                        break;
+
+                    case FusedOpKind::ALU:
+                        // A is only known now; screen, keyboard and
+                        // out-of-range M go through the interpreter
+                        if (touches_m(op.c) && a >= CPUAddress::SCREEN_BASE) {
+                            goto side_exit;
+                        }
+                        [[fallthrough]];
+
+                    case FusedOpKind::SET_A_ALU: {
+                        if (op.kind == FusedOpKind::SET_A_ALU) a = op.imm;
+                        Word x = op.c.reads_m ? ram[a] : a;
+                        Word out = evaluate_alu(op.c.op, d, x);
+                        Word original_a = a;
+                        if (op.c.dest & 0x4) a = out;
+                        if (op.c.dest & 0x2) d = out;
+                        if (op.c.dest & 0x1) ram[original_a] = out;
+                        if (op.c.jump && jump_taken(op.c.jump, out)) {
+                            next_pc = a;
+                            jumped = true;
+                        }
+                        break;
+                    }
+                }
+                done += op.length;
+            }
+
+        side_exit:
+            if (done > 0) {
+                a_register_ = a;
+                d_register_ = d;
+                pc_ = done == block->length ? next_pc : static_cast<Address>(pc_ + done);
+
+                stats_.instructions_executed += done;
+                if (counted) {
+                    stats_.a_instruction_count += block->a_instructions[done];
+                    stats_.c_instruction_count += block->c_instructions[done];
+                    stats_.memory_reads += block->memory_reads[done];
+                    stats_.memory_writes += block->memory_writes[done];
+                    if (jumped) stats_.jump_count++;
+                }
+                count += done;
+
+                if (pc_ >= program_size) {
+                    state_ = CPUState::HALTED;
+                }
+                continue;
+            }
+            // Side exit before the first instruction: interpret it
+        }
+
+        if (!execute_instruction()) {
+            break;
+        }
+        count++;
+    }
+}
+
+}  // namespace n2t
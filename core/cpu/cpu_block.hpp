@@ -0,0 +1,121 @@
+// ==============================================================================
+// Hack CPU Basic-Block Translator
+// ==============================================================================
+// A portable middle tier between the interpreters and the JIT: basic blocks
+// are translated once into a short sequence of fused operations, which the
+// engine then executes with one dispatch per fused op instead of one per
+// instruction.
+//
+// Block boundaries are the same as the JIT's: a block runs until (inclusive)
+// the first jumping C-instruction, or until (exclusive) an invalid
+// instruction, a breakpoint, the end of the program, or MAX_BLOCK_LENGTH
+// instructions.
+//
+// Inside a block, an A-instruction followed by a C-instruction becomes one
+// fused op whose address is known at translate time, e.g.
+//   @X; D=M    ->  LOAD_D_MEM X
+//   @X; M=D    ->  STORE_D_MEM X
+//   @X; D;JGT  ->  BRANCH_D X (JGT)
+// Pairs that touch M at a screen/keyboard address are not fused, and a
+// lone C-instruction touching M checks A < SCREEN_BASE at run time; both
+// side-exit to the interpreter, which handles dirty tracking and errors.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CPU_BLOCK_HPP
+#define NAND2TETRIS_CPU_BLOCK_HPP
+
+#include "instruction.hpp"
+#include "memory.hpp"
+#include <memory>
+#include <vector>
+
+namespace n2t {
+
+/**
+ * @brief Shape of a fused operation.
+ */
+enum class FusedOpKind : uint8_t {
+    SET_A,          // @X
+    ALU,            // lone C-instruction (A known only at run time)
+    SET_A_ALU,      // @X; any C-instruction
+    LOAD_D_IMM,     // @X; D=A
+    LOAD_D_MEM,     // @X; D=M
+    STORE_D_MEM,    // @X; M=D
+    INC_MEM,        // @X; M=M+1
+    DEC_MEM,        // @X; M=M-1
+    ADD_D_MEM,      // @X; D=D+M
+    SUB_D_MEM,      // @X; D=D-M
+    JUMP,           // @X; 0;JMP
+    BRANCH_D        // @X; D;Jcc
+};
+
+/**
+ * @brief One fused operation covering one or two instructions.
+ */
+struct FusedOp {
+    FusedOpKind kind = FusedOpKind::SET_A;
+    uint8_t length = 1;     // Instructions covered (1 or 2)
+    Word imm = 0;           // A value for SET_A* and fused forms
+    MicroOp c;              // C-instruction for ALU / SET_A_ALU / BRANCH_D
+};
+
+/**
+ * @brief One translated basic block.
+ */
+struct TranslatedBlock {
+    std::vector<FusedOp> ops;
+    uint16_t length = 0;    // Instructions covered by the whole block
+
+    // Prefix counts: element k covers the block's first k instructions
+    std::vector<uint16_t> a_instructions;
+    std::vector<uint16_t> c_instructions;
+    std::vector<uint16_t> memory_reads;
+    std::vector<uint16_t> memory_writes;
+};
+
+/**
+ * @brief Block translator and cache for one CPUEngine.
+ */
+class BlockTranslator {
+public:
+    static constexpr size_t MAX_BLOCK_LENGTH = 64;
+
+    /**
+     * @brief Get (translating on first use) the block starting at pc.
+     *
+     * Returns nullptr if no block can start there (e.g. the instruction is
+     * invalid), in which case the interpreter should execute it. The cache
+     * is rebuilt whenever the ROM generation or breakpoint version changes.
+     */
+    const TranslatedBlock* block_at(Address pc, const CPUMemory& memory,
+                                    const RomBitmap& breakpoints,
+                                    uint64_t breakpoint_version);
+
+    /**
+     * @brief Drop all translated blocks.
+     */
+    void clear();
+
+    /**
+     * @brief Number of blocks currently translated.
+     */
+    size_t block_count() const { return blocks_.size(); }
+
+private:
+    std::vector<std::unique_ptr<TranslatedBlock>> blocks_;
+    std::vector<int32_t> block_index_;           // ROM address -> blocks_ index
+
+    uint64_t rom_generation_ = 0;
+    uint64_t breakpoint_version_ = 0;
+    bool valid_ = false;
+
+    static constexpr int32_t NOT_TRANSLATED = -1;
+    static constexpr int32_t UNTRANSLATABLE = -2;
+
+    const TranslatedBlock* translate(Address start, const CPUMemory& memory,
+                                     const RomBitmap& breakpoints);
+};
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CPU_BLOCK_HPP
@@ -0,0 +1,493 @@
+// ==============================================================================
+// Hack CPU Control-Flow Graph Implementation
+// ==============================================================================
+
+#include "cpu_cfg.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace n2t {
+
+namespace {
+
+// ==============================================================================
+// Constant Tracking
+// ==============================================================================
+
+bool uses_d(AluOp op) {
+    switch (op) {
+        case AluOp::D:
+        case AluOp::NOT_D:
+        case AluOp::NEG_D:
+        case AluOp::D_PLUS_1:
+        case AluOp::D_MINUS_1:
+        case AluOp::D_PLUS_X:
+        case AluOp::D_MINUS_X:
+        case AluOp::X_MINUS_D:
+        case AluOp::D_AND_X:
+        case AluOp::D_OR_X:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool uses_x(AluOp op) {
+    switch (op) {
+        case AluOp::X:
+        case AluOp::NOT_X:
+        case AluOp::NEG_X:
+        case AluOp::X_PLUS_1:
+        case AluOp::X_MINUS_1:
+        case AluOp::D_PLUS_X:
+        case AluOp::D_MINUS_X:
+        case AluOp::X_MINUS_D:
+        case AluOp::D_AND_X:
+        case AluOp::D_OR_X:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief A and D where they are known constants.
+ */
+struct KnownRegisters {
+    bool a_known = false;
+    bool d_known = false;
+    Word a = 0;
+    Word d = 0;
+};
+
+enum class JumpKind : uint8_t { NONE, NEVER, ALWAYS, CONDITIONAL };
+
+/**
+ * @brief How an instruction leaves: whether it jumps and where to, if known.
+ */
+struct JumpInfo {
+    JumpKind kind = JumpKind::NONE;
+    std::optional<Address> target;
+};
+
+/**
+ * @brief Apply one instruction to the known registers.
+ */
+JumpInfo simulate(const MicroOp& op, KnownRegisters& known) {
+    JumpInfo info;
+    if (op.op == AluOp::LOAD_A) {
+        known.a_known = true;
+        known.a = op.value;
+        return info;
+    }
+    if (op.op == AluOp::INVALID) return info;
+
+    const bool x_known = known.a_known && !op.reads_m;
+    const bool out_known = (known.d_known || !uses_d(op.op)) && (x_known || !uses_x(op.op));
+    const Word out = out_known ? evaluate_alu(op.op, known.d, known.a) : 0;
+    if (op.dest & 0x4) {
+        known.a_known = out_known;
+        known.a = out;
+    }
+    if (op.dest & 0x2) {
+        known.d_known = out_known;
+        known.d = out;
+    }
+
+    if (op.jump) {
+        if (out_known) {
+            info.kind = jump_taken(op.jump, out) ? JumpKind::ALWAYS : JumpKind::NEVER;
+        } else {
+            info.kind = op.jump == 0x7 ? JumpKind::ALWAYS : JumpKind::CONDITIONAL;
+        }
+        if (info.kind != JumpKind::NEVER && known.a_known) info.target = known.a;
+    }
+    return info;
+}
+
+}  // namespace
+
+// ==============================================================================
+// Construction
+// ==============================================================================
+
+ControlFlowGraph::ControlFlowGraph(const CPUProgram& program) {
+    if (program.size == 0) return;
+    find_blocks(program);
+    link_blocks(program);
+    mark_reachable();
+    find_loops();
+}
+
+void ControlFlowGraph::find_blocks(const CPUProgram& program) {
+    const size_t size = program.size;
+    const MicroOp* ops = program.decoded.data();
+
+    std::vector<bool> leader(size + 1, false);
+    leader[0] = true;
+    for (size_t a = 0; a < size; a++) {
+        if (ops[a].jump || ops[a].op == AluOp::INVALID) leader[a + 1] = true;
+    }
+
+    // New leaders reset what is known at them, which can change targets
+    // found earlier, so scan until the leader set stops growing
+    bool address_taken_added = false;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        bool computed = false;
+        KnownRegisters known;
+        for (size_t a = 0; a < size; a++) {
+            if (leader[a]) known = KnownRegisters{};
+            JumpInfo info = simulate(ops[a], known);
+            if (info.kind == JumpKind::ALWAYS || info.kind == JumpKind::CONDITIONAL) {
+                if (!info.target) {
+                    computed = true;
+                } else if (*info.target < size && !leader[*info.target]) {
+                    leader[*info.target] = true;
+                    changed = true;
+                }
+            }
+        }
+
+        // A computed jump may land on any address the program loads
+        if (computed && !address_taken_added) {
+            address_taken_added = true;
+            for (size_t a = 0; a < size; a++) {
+                if (ops[a].op == AluOp::LOAD_A && ops[a].value < size && !leader[ops[a].value]) {
+                    leader[ops[a].value] = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    block_of_.assign(size, 0);
+    for (size_t a = 0; a < size; a++) {
+        if (leader[a]) {
+            CFGBlock block;
+            block.start = static_cast<Address>(a);
+            blocks_.push_back(block);
+        }
+        blocks_.back().end = static_cast<Address>(a);
+        block_of_[a] = static_cast<uint32_t>(blocks_.size() - 1);
+    }
+
+    if (address_taken_added) {
+        for (size_t a = 0; a < size; a++) {
+            if (ops[a].op == AluOp::LOAD_A && ops[a].value < size) {
+                blocks_[block_of_[ops[a].value]].address_taken = true;
+            }
+        }
+    }
+}
+
+void ControlFlowGraph::link_blocks(const CPUProgram& program) {
+    const size_t size = program.size;
+    const MicroOp* ops = program.decoded.data();
+    targets_.assign(blocks_.size(), std::nullopt);
+
+    for (uint32_t b = 0; b < blocks_.size(); b++) {
+        CFGBlock& block = blocks_[b];
+        KnownRegisters known;
+        JumpInfo info;
+        for (size_t a = block.start; a <= block.end; a++) info = simulate(ops[a], known);
+
+        auto add_successor = [&](size_t address) {
+            if (address >= size) {
+                block.halts = true;
+                return;
+            }
+            uint32_t successor = block_of_[address];
+            if (std::find(block.successors.begin(), block.successors.end(), successor) ==
+                block.successors.end()) {
+                block.successors.push_back(successor);
+            }
+        };
+
+        if (ops[block.end].op == AluOp::INVALID) {
+            block.invalid = true;
+            continue;
+        }
+        if (info.kind == JumpKind::ALWAYS || info.kind == JumpKind::CONDITIONAL) {
+            if (info.target) {
+                targets_[b] = info.target;
+                add_successor(*info.target);
+            } else {
+                block.computed_jump = true;
+                computed_jumps_.push_back(block.end);
+            }
+        }
+        if (info.kind != JumpKind::ALWAYS) add_successor(block.end + 1);
+    }
+
+    for (uint32_t b = 0; b < blocks_.size(); b++) {
+        for (uint32_t successor : blocks_[b].successors) {
+            blocks_[successor].predecessors.push_back(b);
+        }
+    }
+}
+
+void ControlFlowGraph::mark_reachable() {
+    std::vector<uint32_t> work = {0};
+    blocks_[0].reachable = true;
+    bool roots_added = false;
+
+    while (!work.empty()) {
+        uint32_t b = work.back();
+        work.pop_back();
+        auto visit = [&](uint32_t next) {
+            if (!blocks_[next].reachable) {
+                blocks_[next].reachable = true;
+                work.push_back(next);
+            }
+        };
+        for (uint32_t successor : blocks_[b].successors) visit(successor);
+        if (blocks_[b].computed_jump && !roots_added) {
+            roots_added = true;
+            for (uint32_t t = 0; t < blocks_.size(); t++) {
+                if (blocks_[t].address_taken) visit(t);
+            }
+        }
+    }
+}
+
+void ControlFlowGraph::find_loops() {
+    // Dominators over the reachable blocks, from a virtual root that enters
+    // at block 0 and (through computed jumps) at every address-taken block
+    const uint32_t n = static_cast<uint32_t>(blocks_.size());
+    const uint32_t root = n;
+    const bool computed_reachable = std::any_of(blocks_.begin(), blocks_.end(),
+        [](const CFGBlock& b) { return b.reachable && b.computed_jump; });
+
+    std::vector<uint32_t> entries = {0};
+    if (computed_reachable) {
+        for (uint32_t b = 1; b < n; b++) {
+            if (blocks_[b].address_taken) entries.push_back(b);
+        }
+    }
+    auto successors_of = [&](uint32_t node) -> const std::vector<uint32_t>& {
+        return node == root ? entries : blocks_[node].successors;
+    };
+
+    // Reverse postorder by iterative DFS
+    std::vector<uint32_t> postorder;
+    std::vector<uint32_t> order(n + 1, UINT32_MAX);    // Postorder number
+    std::vector<bool> seen(n + 1, false);
+    std::vector<std::pair<uint32_t, size_t>> stack = {{root, 0}};
+    seen[root] = true;
+    while (!stack.empty()) {
+        auto& [node, next] = stack.back();
+        const auto& successors = successors_of(node);
+        if (next < successors.size()) {
+            uint32_t s = successors[next++];
+            if (!seen[s]) {
+                seen[s] = true;
+                stack.push_back({s, 0});
+            }
+        } else {
+            order[node] = static_cast<uint32_t>(postorder.size());
+            postorder.push_back(node);
+            stack.pop_back();
+        }
+    }
+
+    std::vector<bool> is_entry(n, false);
+    for (uint32_t e : entries) is_entry[e] = true;
+
+    std::vector<uint32_t> idom(n + 1, UINT32_MAX);
+    idom[root] = root;
+    auto intersect = [&](uint32_t x, uint32_t y) {
+        while (x != y) {
+            while (order[x] < order[y]) x = idom[x];
+            while (order[y] < order[x]) y = idom[y];
+        }
+        return x;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = postorder.size() - 1; i-- > 0;) {    // Skips the root (last)
+            uint32_t b = postorder[i];
+            uint32_t new_idom = is_entry[b] ? root : UINT32_MAX;
+            for (uint32_t p : blocks_[b].predecessors) {
+                if (idom[p] == UINT32_MAX) continue;
+                new_idom = new_idom == UINT32_MAX ? p : intersect(p, new_idom);
+            }
+            if (idom[b] != new_idom) {
+                idom[b] = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    auto dominates = [&](uint32_t h, uint32_t b) {
+        while (true) {
+            if (b == h) return true;
+            if (b == root) return false;
+            b = idom[b];
+        }
+    };
+
+    // Back edges, grouped by header
+    std::vector<uint32_t> loop_of(n, UINT32_MAX);
+    for (uint32_t b = 0; b < n; b++) {
+        if (!seen[b]) continue;
+        for (uint32_t h : blocks_[b].successors) {
+            if (!dominates(h, b)) continue;
+            if (loop_of[h] == UINT32_MAX) {
+                loop_of[h] = static_cast<uint32_t>(loops_.size());
+                loops_.push_back(CFGLoop{h, {}, {}});
+            }
+            loops_[loop_of[h]].latches.push_back(b);
+        }
+    }
+
+    // Body: everything that reaches a latch without passing the header
+    std::vector<uint32_t> stamp(n, UINT32_MAX);     // Loop index that last visited a block
+    for (uint32_t l = 0; l < loops_.size(); l++) {
+        CFGLoop& loop = loops_[l];
+        stamp[loop.header] = l;
+        loop.blocks.push_back(loop.header);
+        std::vector<uint32_t> work;
+        for (uint32_t latch : loop.latches) {
+            if (stamp[latch] != l) {
+                stamp[latch] = l;
+                loop.blocks.push_back(latch);
+                work.push_back(latch);
+            }
+        }
+        while (!work.empty()) {
+            uint32_t b = work.back();
+            work.pop_back();
+            for (uint32_t p : blocks_[b].predecessors) {
+                if (seen[p] && stamp[p] != l) {
+                    stamp[p] = l;
+                    loop.blocks.push_back(p);
+                    work.push_back(p);
+                }
+            }
+        }
+        std::sort(loop.blocks.begin(), loop.blocks.end());
+    }
+
+    std::sort(loops_.begin(), loops_.end(), [](const CFGLoop& x, const CFGLoop& y) {
+        return x.blocks.size() != y.blocks.size() ? x.blocks.size() > y.blocks.size()
+                                                  : x.header < y.header;
+    });
+}
+
+// ==============================================================================
+// Queries
+// ==============================================================================
+
+std::optional<uint32_t> ControlFlowGraph::block_at(Address address) const {
+    if (address >= block_of_.size()) return std::nullopt;
+    return block_of_[address];
+}
+
+std::optional<Address> ControlFlowGraph::jump_target(uint32_t block) const {
+    if (block >= targets_.size()) return std::nullopt;
+    return targets_[block];
+}
+
+std::vector<std::pair<Address, Address>> ControlFlowGraph::unreachable() const {
+    std::vector<std::pair<Address, Address>> ranges;
+    for (const CFGBlock& block : blocks_) {
+        if (block.reachable) continue;
+        if (!ranges.empty() && ranges.back().second + 1 == block.start) {
+            ranges.back().second = block.end;
+        } else {
+            ranges.emplace_back(block.start, block.end);
+        }
+    }
+    return ranges;
+}
+
+// ==============================================================================
+// Output
+// ==============================================================================
+
+std::string ControlFlowGraph::to_dot(const CPUProgram& program) const {
+    std::vector<bool> header(blocks_.size(), false);
+    for (const CFGLoop& loop : loops_) header[loop.header] = true;
+
+    std::ostringstream oss;
+    oss << "digraph cfg {\n"
+        << "  node [shape=box, fontname=\"monospace\"];\n";
+    bool any_halt = false;
+    for (uint32_t b = 0; b < blocks_.size(); b++) {
+        const CFGBlock& block = blocks_[b];
+        oss << "  b" << b << " [label=\"" << block.start << "-" << block.end << "\\l";
+        for (size_t a = block.start; a <= block.end; a++) {
+            oss << instruction_to_string(program.rom[a]) << "\\l";
+        }
+        if (block.computed_jump) oss << "(computed jump)\\l";
+        oss << "\"";
+        if (!block.reachable) oss << ", style=filled, fillcolor=lightgrey";
+        if (header[b]) oss << ", penwidth=2";
+        if (block.computed_jump) oss << ", color=red";
+        oss << "];\n";
+
+        for (uint32_t successor : block.successors) {
+            oss << "  b" << b << " -> b" << successor;
+            if (targets_[b] && *targets_[b] == blocks_[successor].start) oss << " [label=\"jump\"]";
+            oss << ";\n";
+        }
+        if (block.halts) {
+            any_halt = true;
+            oss << "  b" << b << " -> halt;\n";
+        }
+    }
+    if (any_halt) oss << "  halt [shape=oval];\n";
+    oss << "}\n";
+    return oss.str();
+}
+
+std::string ControlFlowGraph::to_json() const {
+    auto list = [](std::ostringstream& oss, const auto& values) {
+        oss << "[";
+        for (size_t i = 0; i < values.size(); i++) oss << (i ? ", " : "") << values[i];
+        oss << "]";
+    };
+    auto flag = [](bool value) { return value ? "true" : "false"; };
+
+    std::ostringstream oss;
+    oss << "{\n  \"blocks\": [";
+    for (uint32_t b = 0; b < blocks_.size(); b++) {
+        const CFGBlock& block = blocks_[b];
+        oss << (b ? "," : "") << "\n    {\"start\": " << block.start << ", \"end\": " << block.end
+            << ", \"successors\": ";
+        list(oss, block.successors);
+        oss << ", \"target\": ";
+        if (targets_[b]) {
+            oss << *targets_[b];
+        } else {
+            oss << "null";
+        }
+        oss << ", \"reachable\": " << flag(block.reachable)
+            << ", \"computed_jump\": " << flag(block.computed_jump)
+            << ", \"halts\": " << flag(block.halts)
+            << ", \"invalid\": " << flag(block.invalid)
+            << ", \"address_taken\": " << flag(block.address_taken) << "}";
+    }
+    oss << "\n  ],\n  \"loops\": [";
+    for (size_t i = 0; i < loops_.size(); i++) {
+        oss << (i ? "," : "") << "\n    {\"header\": " << loops_[i].header << ", \"latches\": ";
+        list(oss, loops_[i].latches);
+        oss << ", \"blocks\": ";
+        list(oss, loops_[i].blocks);
+        oss << "}";
+    }
+    oss << "\n  ],\n  \"unreachable\": [";
+    auto ranges = unreachable();
+    for (size_t i = 0; i < ranges.size(); i++) {
+        oss << (i ? ", " : "") << "[" << ranges[i].first << ", " << ranges[i].second << "]";
+    }
+    oss << "],\n  \"computed_jumps\": ";
+    list(oss, computed_jumps_);
+    oss << "\n}\n";
+    return oss.str();
+}
+
+}  // namespace n2t
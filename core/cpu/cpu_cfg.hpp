@@ -0,0 +1,128 @@
+// ==============================================================================
+// Hack CPU Control-Flow Graph
+// ==============================================================================
+// Static analysis of a loaded ROM: basic blocks, the edges between them,
+// natural loops, unreachable code and computed jumps.
+//
+// Jump targets are resolved by tracking A and D through each block as
+// known constants: "@X; 0;JMP", "@X; D;JGT" and "@X; D=A; @Y; A=D; 0;JMP"
+// all have a static target. Knowledge is reset at every block start, so a
+// jump whose A depends on how the block was entered (or on RAM) is a
+// computed jump. A jump on a constant ALU result ("0;JEQ") is resolved to
+// always or never taken.
+//
+// Computed jumps have no edges. Instead, in a program that contains any,
+// every ROM address loaded by an @X (e.g. a pushed return address) starts
+// a block marked address_taken; those blocks count as reachable once a
+// reachable computed jump exists. The analysis is therefore conservative
+// about unreachable code, never optimistic.
+//
+// Loops are natural loops: a back edge to a block that dominates its
+// source, and every block that reaches the source without passing the
+// header. Dominators are computed with the Cooper-Harvey-Kennedy algorithm.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CPU_CFG_HPP
+#define NAND2TETRIS_CPU_CFG_HPP
+
+#include "memory.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace n2t {
+
+/**
+ * @brief Consecutive instructions entered only at the first and left only
+ *        after the last.
+ */
+struct CFGBlock {
+    Address start = 0;
+    Address end = 0;                        // Inclusive
+    std::vector<uint32_t> successors;       // Block indices: jump target, then fall-through
+    std::vector<uint32_t> predecessors;     // Block indices, ascending
+    bool reachable = false;
+    bool computed_jump = false;     // Ends in a jump whose target is not a known constant
+    bool halts = false;             // Can run past the end of the program
+    bool invalid = false;           // Ends in an invalid instruction
+    bool address_taken = false;     // Loaded by an @X in a program with computed jumps
+};
+
+/**
+ * @brief A natural loop.
+ */
+struct CFGLoop {
+    uint32_t header = 0;            // Block every iteration enters through
+    std::vector<uint32_t> latches;  // Blocks with a back edge to the header
+    std::vector<uint32_t> blocks;   // Header and body, ascending
+};
+
+/**
+ * @brief Control-flow graph of a program's first size instructions.
+ */
+class ControlFlowGraph {
+public:
+    explicit ControlFlowGraph(const CPUProgram& program);
+
+    const std::vector<CFGBlock>& blocks() const { return blocks_; }
+
+    /**
+     * @brief Loops, outermost (largest) first.
+     */
+    const std::vector<CFGLoop>& loops() const { return loops_; }
+
+    /**
+     * @brief Addresses of jumps with a computed target, ascending.
+     */
+    const std::vector<Address>& computed_jumps() const { return computed_jumps_; }
+
+    /**
+     * @brief Index of the block containing a ROM address.
+     */
+    std::optional<uint32_t> block_at(Address address) const;
+
+    /**
+     * @brief Static jump target of the block's last instruction, if it
+     *        jumps to a known constant (possibly past the program).
+     */
+    std::optional<Address> jump_target(uint32_t block) const;
+
+    /**
+     * @brief Unreachable code as [first, last] address ranges.
+     */
+    std::vector<std::pair<Address, Address>> unreachable() const;
+
+    // =========================================================================
+    // Output
+    // =========================================================================
+
+    /**
+     * @brief Graphviz dot: one node per block listing its instructions.
+     *        Unreachable blocks are grey, loop headers bold, computed
+     *        jumps red.
+     */
+    std::string to_dot(const CPUProgram& program) const;
+
+    /**
+     * @brief Blocks, loops, unreachable ranges and computed jumps as JSON.
+     */
+    std::string to_json() const;
+
+private:
+    void find_blocks(const CPUProgram& program);
+    void link_blocks(const CPUProgram& program);
+    void mark_reachable();
+    void find_loops();
+
+    std::vector<CFGBlock> blocks_;
+    std::vector<uint32_t> block_of_;                // Per address
+    std::vector<std::optional<Address>> targets_;   // Per block
+    std::vector<CFGLoop> loops_;
+    std::vector<Address> computed_jumps_;
+};
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CPU_CFG_HPP
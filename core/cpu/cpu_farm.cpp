@@ -0,0 +1,207 @@
+// ==============================================================================
+// Hack CPU Farm Implementation
+// ==============================================================================
+
+#include "cpu_farm.hpp"
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace n2t {
+
+// ==============================================================================
+// Construction
+// ==============================================================================
+
+CPUFarm::CPUFarm(std::shared_ptr<const CPUProgram> program)
+    : CPUFarm(std::move(program), Options{})
+{}
+
+CPUFarm::CPUFarm(std::shared_ptr<const CPUProgram> program, Options options)
+    : program_(std::move(program))
+    , options_(options)
+{
+    if (!program_) {
+        throw RuntimeError("CPUFarm needs a program to run");
+    }
+}
+
+// ==============================================================================
+// Work-Stealing Pool
+// ==============================================================================
+
+namespace {
+
+/**
+ * @brief One worker's share of the scenario indices.
+ *
+ * The owner takes from the back; thieves take from the front, so they
+ * grab the work the owner would reach last.
+ */
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> items;
+
+    bool pop_back(size_t& item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) return false;
+        item = items.back();
+        items.pop_back();
+        return true;
+    }
+
+    bool steal_front(size_t& item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) return false;
+        item = items.front();
+        items.pop_front();
+        return true;
+    }
+};
+
+}  // namespace
+
+std::vector<CPURunResult> CPUFarm::run(const std::vector<CPUScenario>& scenarios,
+                                       const std::vector<RamRegion>& regions) const {
+    // Validate up front so that workers never throw on user input
+    for (const auto& region : regions) {
+        // Written so that a huge length cannot wrap the sum
+        if (region.start >= CPUAddress::RAM_SIZE ||
+            region.length > CPUAddress::RAM_SIZE - region.start) {
+            throw RuntimeError(
+                "RAM region " + std::to_string(region.start) + "+" +
+                std::to_string(region.length) + " extends past the end of RAM.");
+        }
+    }
+    for (size_t i = 0; i < scenarios.size(); i++) {
+        for (const auto& [address, value] : scenarios[i].ram) {
+            (void)value;
+            if (address >= CPUAddress::RAM_SIZE) {
+                throw RuntimeError(
+                    "Scenario " + std::to_string(i) + " sets RAM[" +
+                    std::to_string(address) + "], outside RAM (0-32767).");
+            }
+        }
+    }
+
+    std::vector<CPURunResult> results(scenarios.size());
+
+    size_t thread_count = options_.threads;
+    if (thread_count == 0) {
+        thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    thread_count = 1;
+#endif
+    thread_count = std::min(thread_count, scenarios.size());
+
+    if (thread_count <= 1) {
+        for (size_t i = 0; i < scenarios.size(); i++) {
+            results[i] = run_one(scenarios[i], regions);
+        }
+        return results;
+    }
+
+    std::vector<WorkQueue> queues(thread_count);
+    for (size_t i = 0; i < scenarios.size(); i++) {
+        queues[i % thread_count].items.push_back(i);
+    }
+
+    std::vector<std::exception_ptr> failures(thread_count);
+    auto worker = [&](size_t self) {
+        try {
+            size_t index = 0;
+            while (true) {
+                bool found = queues[self].pop_back(index);
+                for (size_t k = 1; !found && k < thread_count; k++) {
+                    found = queues[(self + k) % thread_count].steal_front(index);
+                }
+                // No work is ever added, so empty everywhere means done
+                if (!found) break;
+                results[index] = run_one(scenarios[index], regions);
+            }
+        } catch (...) {
+            failures[self] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t t = 1; t < thread_count; t++) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& failure : failures) {
+        if (failure) std::rethrow_exception(failure);
+    }
+    return results;
+}
+
+// ==============================================================================
+// Single Scenario
+// ==============================================================================
+
+CPURunResult CPUFarm::run_one(const CPUScenario& scenario,
+                              const std::vector<RamRegion>& regions) const {
+    auto cpu = std::make_unique<CPUEngine>();
+    cpu->load_program(program_);
+    cpu->set_dispatch(options_.dispatch);
+    cpu->set_check_mode(options_.check_mode);
+    cpu->set_instrumentation(options_.instrumentation);
+    cpu->set_idle_detection(options_.stop_on_idle);
+
+    for (const auto& [address, value] : scenario.ram) {
+        cpu->write_ram(address, value);
+    }
+
+    std::vector<KeyEvent> events = scenario.keyboard;
+    std::stable_sort(events.begin(), events.end(),
+        [](const KeyEvent& x, const KeyEvent& y) { return x.at_instruction < y.at_instruction; });
+
+    size_t next_event = 0;
+    while (true) {
+        uint64_t executed = cpu->get_stats().instructions_executed;
+        while (next_event < events.size() && events[next_event].at_instruction <= executed) {
+            cpu->set_keyboard(events[next_event++].key_code);
+        }
+        if (executed >= scenario.max_instructions) break;
+
+        // Run up to the next key change (or the end of the budget)
+        uint64_t until = scenario.max_instructions;
+        if (next_event < events.size()) {
+            until = std::min(until, events[next_event].at_instruction);
+        }
+        if (cpu->run_for(until - executed) != CPUState::PAUSED) break;
+
+        if (cpu->get_pause_reason() == CPUPauseReason::IDLE_LOOP) {
+            // Waiting on input: deliver the next key now, or stop for good
+            if (next_event == events.size()) break;
+            cpu->set_keyboard(events[next_event++].key_code);
+        } else if (cpu->get_stats().instructions_executed == executed) {
+            break;
+        }
+    }
+
+    CPURunResult result;
+    result.state = cpu->get_state();
+    result.pause_reason = cpu->get_pause_reason();
+    result.stats = cpu->get_stats();
+    result.a = cpu->get_a();
+    result.d = cpu->get_d();
+    result.pc = cpu->get_pc();
+    result.error_message = cpu->get_error_message();
+
+    const Word* ram = cpu->memory().ram_ptr();
+    for (const auto& region : regions) {
+        result.regions.emplace_back(ram + region.start, ram + region.start + region.length);
+    }
+    return result;
+}
+
+}  // namespace n2t
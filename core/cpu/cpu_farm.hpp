@@ -0,0 +1,119 @@
+// ==============================================================================
+// Hack CPU Farm
+// ==============================================================================
+// Runs one ROM against many input scenarios in parallel, in-process.
+//
+// Each scenario gets its own CPUEngine (registers + 64 KB of RAM); the ROM
+// and its predecoded micro-ops are built once and shared read-only by all
+// of them. Scenarios are spread over a pool of worker threads, each with
+// its own deque of work; a worker that runs out steals from the others, so
+// a few long-running scenarios do not leave the other cores idle.
+//
+// Example (a grader running Mult.hack against three test cases):
+//
+//   CPUFarm farm(CPUMemory::parse_program(hack_text));
+//   std::vector<CPUScenario> cases(3);
+//   cases[0].ram = {{0, 2}, {1, 3}};
+//   ...
+//   auto results = farm.run(cases, {{2, 1}});   // capture RAM[2]
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CPU_FARM_HPP
+#define NAND2TETRIS_CPU_FARM_HPP
+
+#include "cpu.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace n2t {
+
+/**
+ * @brief A key change applied once a scenario has executed a number of
+ *        instructions (key_code 0 releases the key).
+ */
+struct KeyEvent {
+    uint64_t at_instruction = 0;
+    Word key_code = 0;
+};
+
+/**
+ * @brief One input scenario for a CPUFarm run.
+ */
+struct CPUScenario {
+    std::vector<std::pair<Address, Word>> ram;  // Initial RAM values
+    std::vector<KeyEvent> keyboard;             // Applied in at_instruction order
+    uint64_t max_instructions = 1000000;        // Instruction budget
+};
+
+/**
+ * @brief A RAM range copied out of every instance after its run.
+ */
+struct RamRegion {
+    Address start = 0;
+    size_t length = 0;
+};
+
+/**
+ * @brief Final state of one scenario.
+ */
+struct CPURunResult {
+    CPUState state = CPUState::READY;
+    CPUPauseReason pause_reason = CPUPauseReason::NONE;
+    CPUStats stats;
+    Word a = 0;
+    Word d = 0;
+    Address pc = 0;
+    std::string error_message;
+    std::vector<std::vector<Word>> regions;     // One per requested RamRegion
+};
+
+/**
+ * @brief Runs a shared ROM against many scenarios on a thread pool.
+ */
+class CPUFarm {
+public:
+    /**
+     * @brief Execution settings applied to every instance.
+     */
+    struct Options {
+        size_t threads = 0;                          // 0 = hardware concurrency
+        CPUDispatch dispatch = CPUDispatch::THREADED;
+        CPUCheckMode check_mode = CPUCheckMode::CHECKED;
+        CPUInstrumentation instrumentation = CPUInstrumentation::FULL;   // BARE for result-only sweeps
+
+        // Stop a scenario in an idle loop (see CPUEngine::set_idle_detection).
+        // If keyboard events are still pending, the next one is applied
+        // right away instead of spinning until its instruction count.
+        bool stop_on_idle = true;
+    };
+
+    explicit CPUFarm(std::shared_ptr<const CPUProgram> program);
+    CPUFarm(std::shared_ptr<const CPUProgram> program, Options options);
+
+    /**
+     * @brief Run every scenario; results are in scenario order.
+     *
+     * @throws RuntimeError if a scenario or region names an address outside
+     *         RAM (checked before anything runs)
+     */
+    std::vector<CPURunResult> run(const std::vector<CPUScenario>& scenarios,
+                                  const std::vector<RamRegion>& regions) const;
+
+    const std::shared_ptr<const CPUProgram>& program() const { return program_; }
+    const Options& options() const { return options_; }
+
+private:
+    std::shared_ptr<const CPUProgram> program_;
+    Options options_;
+
+    /**
+     * @brief Run one scenario on a fresh engine.
+     */
+    CPURunResult run_one(const CPUScenario& scenario,
+                         const std::vector<RamRegion>& regions) const;
+};
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CPU_FARM_HPP
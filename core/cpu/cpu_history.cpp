@@ -0,0 +1,282 @@
+// ==============================================================================
+// Hack CPU Execution History Implementation
+// ==============================================================================
+
+#include "cpu_history.hpp"
+#include <algorithm>
+
+namespace n2t {
+
+// ==============================================================================
+// Configuration
+// ==============================================================================
+
+void CPUHistory::clear() {
+    segments_.clear();
+    bytes_ = 0;
+    barrier_ = false;
+}
+
+void CPUHistory::set_limit(size_t bytes) {
+    limit_ = bytes;
+    trim();
+}
+
+void CPUHistory::set_checkpoint_interval(uint64_t instructions) {
+    interval_ = std::max<uint64_t>(1, instructions);
+}
+
+// ==============================================================================
+// Recording
+// ==============================================================================
+
+void CPUHistory::checkpoint(uint64_t instruction, Word a, Word d, Address pc,
+                            const CPUStats& stats, const Word* ram) {
+    CPUCheckpoint checkpoint;
+    checkpoint.instruction = instruction;
+    checkpoint.a = a;
+    checkpoint.d = d;
+    checkpoint.pc = pc;
+    checkpoint.stats = stats;
+    checkpoint.ram.assign(ram, ram + CPUAddress::RAM_SIZE);
+
+    bytes_ += segment_bytes(checkpoint);
+    segments_.push_back(std::move(checkpoint));
+    barrier_ = false;
+    trim();
+}
+
+size_t CPUHistory::segment_bytes(const CPUCheckpoint& checkpoint) {
+    return sizeof(CPUCheckpoint) + checkpoint.ram.size() * sizeof(Word) +
+           checkpoint.undo.size() * sizeof(RamUndo);
+}
+
+void CPUHistory::trim() {
+    while (bytes_ > limit_ && segments_.size() > 1) {
+        bytes_ -= segment_bytes(segments_.front());
+        segments_.pop_front();
+    }
+}
+
+// ==============================================================================
+// Navigation
+// ==============================================================================
+
+uint64_t CPUHistory::oldest_instruction() const {
+    return segments_.empty() ? 0 : segments_.front().instruction;
+}
+
+size_t CPUHistory::segment_for(uint64_t instruction) const {
+    // Segments are in increasing instruction order; barrier segments may
+    // share a start with their predecessor, and the later one wins
+    auto it = std::upper_bound(segments_.begin(), segments_.end(), instruction,
+        [](uint64_t value, const CPUCheckpoint& c) { return value < c.instruction; });
+    return static_cast<size_t>(it - segments_.begin()) - 1;
+}
+
+void CPUHistory::restore_ram(size_t index, CPUMemory& memory, bool live) const {
+    size_t pending = 0;
+    for (size_t i = index; i < segments_.size(); i++) {
+        pending += segments_[i].undo.size();
+    }
+
+    // Undoing a handful of writes beats copying 32K words
+    if (live && pending < CPUAddress::RAM_SIZE / 4) {
+        for (size_t i = segments_.size(); i-- > index;) {
+            const auto& undo = segments_[i].undo;
+            for (auto it = undo.rbegin(); it != undo.rend(); ++it) {
+                memory.write_ram_unchecked(it->address, it->old_value);
+            }
+        }
+        return;
+    }
+
+    memory.load_ram(segments_[index].ram.data());
+}
+
+void CPUHistory::truncate_after(size_t index) {
+    while (segments_.size() > index + 1) {
+        bytes_ -= segment_bytes(segments_.back());
+        segments_.pop_back();
+    }
+    CPUCheckpoint& last = segments_.back();
+    bytes_ -= last.undo.size() * sizeof(RamUndo);
+    last.undo.clear();
+    barrier_ = false;
+}
+
+// ==============================================================================
+// CPUEngine: Recording
+// ==============================================================================
+
+void CPUEngine::set_history_enabled(bool enabled) {
+    if (!enabled) {
+        history_.reset();
+        return;
+    }
+    if (!history_) {
+        history_ = std::make_unique<CPUHistory>();
+        history_->set_limit(history_limit_);
+        history_->set_checkpoint_interval(checkpoint_interval_);
+    }
+}
+
+void CPUEngine::set_history_limit(size_t bytes) {
+    history_limit_ = bytes;
+    if (history_) history_->set_limit(bytes);
+}
+
+void CPUEngine::set_checkpoint_interval(uint64_t instructions) {
+    checkpoint_interval_ = std::max<uint64_t>(1, instructions);
+    if (history_) history_->set_checkpoint_interval(checkpoint_interval_);
+}
+
+uint64_t CPUEngine::history_depth() const {
+    if (!history_ || history_->empty()) return 0;
+    uint64_t depth = stats_.instructions_executed - history_->oldest_instruction();
+    // The clean state before a failed instruction is one more step back
+    return state_ == CPUState::ERROR ? depth + 1 : depth;
+}
+
+void CPUEngine::run_recorded(uint64_t max_instructions) {
+    uint64_t count = 0;
+    while (state_ == CPUState::RUNNING && count < max_instructions) {
+        if (count % PAUSE_POLL_INTERVAL == 0 &&
+            stop_if_idle(a_register_, d_register_, pc_)) {
+            return;
+        }
+        record_instruction();
+        if (!execute_instruction()) {
+            break;
+        }
+        count++;
+    }
+}
+
+void CPUEngine::record_instruction() {
+    if (history_->checkpoint_due(stats_.instructions_executed)) {
+        history_->checkpoint(stats_.instructions_executed, a_register_, d_register_,
+                             pc_, stats_, memory_.ram_ptr());
+    }
+    if (pc_ >= memory_.rom_size()) return;
+
+    const MicroOp& op = memory_.decoded_ptr()[pc_];
+    if (op.op == AluOp::LOAD_A || op.op == AluOp::INVALID || !(op.dest & 0x1)) return;
+
+    Address address = a_register_;
+    if (check_mode_ == CPUCheckMode::UNCHECKED) {
+        address = ram_address<CPUCheckMode::UNCHECKED>(address);
+    }
+    if (address < CPUAddress::RAM_SIZE) {
+        history_->log_write(address, memory_.read_ram_unchecked(address));
+    }
+}
+
+void CPUEngine::note_external_write(Address address, Word value) {
+    // Out-of-range writes throw in CPUMemory; unchanged words need no record
+    if (address >= CPUAddress::RAM_SIZE) return;
+    Word old_value = memory_.read_ram_unchecked(address);
+    if (old_value == value) return;
+
+    history_->log_write(address, old_value);
+    history_->mark_barrier();
+}
+
+// ==============================================================================
+// CPUEngine: Reverse Execution
+// ==============================================================================
+
+void CPUEngine::load_checkpoint(size_t index) {
+    const CPUCheckpoint& checkpoint = history_->segment(index);
+    a_register_ = checkpoint.a;
+    d_register_ = checkpoint.d;
+    pc_ = checkpoint.pc;
+    stats_ = checkpoint.stats;
+}
+
+void CPUEngine::travel_to(uint64_t instruction, bool live) {
+    size_t index = history_->segment_for(instruction);
+    history_->restore_ram(index, memory_, live);
+    history_->truncate_after(index);
+    load_checkpoint(index);
+
+    // Re-execute (and re-record) up to the target; these instructions all
+    // completed before, so none of them can fail or halt early
+    while (stats_.instructions_executed < instruction) {
+        record_instruction();
+        if (!execute_current()) break;
+    }
+
+    error_message_.clear();
+    error_code_ = CPUErrorCode::NONE;
+    error_location_ = 0;
+    state_ = (pc_ >= memory_.rom_size()) ? CPUState::HALTED : CPUState::PAUSED;
+}
+
+CPUState CPUEngine::step_back(uint64_t count) {
+    if (!history_ || history_->empty() || count == 0 || state_ == CPUState::RUNNING) {
+        return state_;
+    }
+
+    uint64_t now = stats_.instructions_executed;
+    if (state_ == CPUState::ERROR) {
+        count--;    // Leaving the error state is the first step
+    }
+    uint64_t oldest = history_->oldest_instruction();
+    uint64_t target = (now - oldest > count) ? now - count : oldest;
+    bool reached_start = now - oldest < count;
+
+    travel_to(target, true);
+    if (state_ == CPUState::PAUSED) {
+        pause_reason_ = reached_start ? CPUPauseReason::HISTORY_START
+                                      : CPUPauseReason::STEP_COMPLETE;
+    }
+    return state_;
+}
+
+CPUState CPUEngine::run_back() {
+    if (!history_ || history_->empty() || state_ == CPUState::RUNNING) {
+        return state_;
+    }
+
+    // Candidate states are those strictly before the current one; from
+    // ERROR, the clean state before the failed instruction counts too
+    const uint64_t now = stats_.instructions_executed;
+    const uint64_t limit = (state_ == CPUState::ERROR) ? now + 1 : now;
+    const uint64_t oldest = history_->oldest_instruction();
+
+    // Re-execute each segment, newest first, and keep the last breakpoint
+    // hit; stop at the first segment that has one
+    bool found = false;
+    bool scanned = false;
+    uint64_t hit = oldest;
+    if (!breakpoints_.empty() && limit > oldest) {
+        scanned = true;
+        for (size_t index = history_->segment_for(limit - 1); !found; index--) {
+            uint64_t end = limit;
+            if (index + 1 < history_->segment_count()) {
+                end = std::min(end, history_->segment(index + 1).instruction);
+            }
+
+            history_->restore_ram(index, memory_, false);
+            load_checkpoint(index);
+            for (uint64_t at = stats_.instructions_executed; at < end; at++) {
+                if (breakpoints_.test(pc_)) {
+                    hit = at;
+                    found = true;
+                }
+                if (at + 1 < end && !execute_current()) break;
+            }
+
+            if (index == 0) break;
+        }
+    }
+
+    travel_to(hit, !scanned);
+    if (state_ == CPUState::PAUSED) {
+        pause_reason_ = found ? CPUPauseReason::BREAKPOINT : CPUPauseReason::HISTORY_START;
+    }
+    return state_;
+}
+
+}  // namespace n2t
@@ -0,0 +1,167 @@
+// ==============================================================================
+// Hack CPU Execution History
+// ==============================================================================
+// Recording for reverse execution (CPUEngine::step_back / run_back).
+//
+// History is a list of segments. Each segment starts with a full checkpoint
+// (registers, statistics and a 64 KB copy of RAM) and is followed by an
+// undo log of the RAM writes made since, as (address, old value) pairs of
+// 4 bytes each. A new segment starts every checkpoint interval, and after
+// RAM was changed from outside the program (write_ram, set_keyboard), so
+// that execution inside a segment is a pure function of its checkpoint.
+//
+// Going back to instruction N therefore means: restore RAM to the latest
+// checkpoint at or before N — by undoing the logged writes when there are
+// only a few, or by copying the checkpoint's RAM otherwise — restore its
+// registers, and re-execute forward to N.
+//
+// When the history outgrows its memory limit, the oldest segments are
+// dropped, which limits how far back execution can go.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CPU_HISTORY_HPP
+#define NAND2TETRIS_CPU_HISTORY_HPP
+
+#include "cpu.hpp"
+#include <deque>
+#include <vector>
+
+namespace n2t {
+
+/**
+ * @brief One undone RAM write: the value before the write.
+ */
+struct RamUndo {
+    Address address = 0;
+    Word old_value = 0;
+};
+
+/**
+ * @brief A full machine snapshot plus the RAM writes made after it.
+ */
+struct CPUCheckpoint {
+    uint64_t instruction = 0;       // stats.instructions_executed when taken
+    Word a = 0;
+    Word d = 0;
+    Address pc = 0;
+    CPUStats stats;
+    std::vector<Word> ram;          // RAM_SIZE words
+    std::vector<RamUndo> undo;      // Writes since the checkpoint, oldest first
+};
+
+/**
+ * @brief Checkpoints and undo logs for one CPUEngine.
+ */
+class CPUHistory {
+public:
+    static constexpr size_t DEFAULT_LIMIT = 64 * 1024 * 1024;       // bytes
+    static constexpr uint64_t DEFAULT_CHECKPOINT_INTERVAL = 1 << 20; // instructions
+
+    CPUHistory() = default;
+
+    void clear();
+    bool empty() const { return segments_.empty(); }
+
+    // =========================================================================
+    // Configuration
+    // =========================================================================
+
+    /**
+     * @brief Memory cap in bytes; older segments are dropped to stay under
+     *        it (the newest segment is always kept).
+     */
+    void set_limit(size_t bytes);
+    size_t limit() const { return limit_; }
+
+    /**
+     * @brief Instructions between periodic checkpoints (at least 1).
+     *
+     * Shorter intervals make stepping back cheaper (less re-execution)
+     * at the cost of more 64 KB checkpoints.
+     */
+    void set_checkpoint_interval(uint64_t instructions);
+    uint64_t checkpoint_interval() const { return interval_; }
+
+    size_t memory_used() const { return bytes_; }
+
+    // =========================================================================
+    // Recording
+    // =========================================================================
+
+    /**
+     * @brief Whether the next instruction must start a new segment.
+     */
+    bool checkpoint_due(uint64_t instruction) const {
+        return barrier_ || segments_.empty() ||
+               instruction - segments_.back().instruction >= interval_;
+    }
+
+    /**
+     * @brief Start a new segment from the current machine state.
+     */
+    void checkpoint(uint64_t instruction, Word a, Word d, Address pc,
+                    const CPUStats& stats, const Word* ram);
+
+    /**
+     * @brief Log the old value of a RAM word about to be written.
+     */
+    void log_write(Address address, Word old_value) {
+        if (segments_.empty()) return;
+        segments_.back().undo.push_back({address, old_value});
+        bytes_ += sizeof(RamUndo);
+        if (bytes_ > limit_) trim();
+    }
+
+    /**
+     * @brief Force a new segment before the next recorded instruction
+     *        (RAM was changed from outside the program).
+     */
+    void mark_barrier() { barrier_ = true; }
+
+    // =========================================================================
+    // Navigation
+    // =========================================================================
+
+    /**
+     * @brief Earliest instruction count that can be restored.
+     */
+    uint64_t oldest_instruction() const;
+
+    size_t segment_count() const { return segments_.size(); }
+    const CPUCheckpoint& segment(size_t index) const { return segments_[index]; }
+
+    /**
+     * @brief Index of the latest segment starting at or before instruction.
+     *
+     * Requires instruction >= oldest_instruction().
+     */
+    size_t segment_for(uint64_t instruction) const;
+
+    /**
+     * @brief Set RAM to its state at the start of a segment.
+     *
+     * If live is true, memory holds the newest recorded state, so the
+     * undo logs can be replayed backwards instead of copying all of RAM.
+     */
+    void restore_ram(size_t index, CPUMemory& memory, bool live) const;
+
+    /**
+     * @brief Drop every segment after index, and the undo log of index.
+     */
+    void truncate_after(size_t index);
+
+private:
+    std::deque<CPUCheckpoint> segments_;
+    size_t limit_ = DEFAULT_LIMIT;
+    uint64_t interval_ = DEFAULT_CHECKPOINT_INTERVAL;
+    size_t bytes_ = 0;
+    bool barrier_ = false;
+
+    static size_t segment_bytes(const CPUCheckpoint& checkpoint);
+
+    void trim();
+};
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CPU_HISTORY_HPP
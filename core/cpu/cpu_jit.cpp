@@ -0,0 +1,439 @@
+// ==============================================================================
+// Hack CPU x86-64 JIT Implementation
+// ==============================================================================
+// Register assignment inside generated code (System V, all caller-saved):
+//   rdi = JitContext*        ecx = A (zero-extended 16-bit)
+//   rsi = RAM base           edx = D (zero-extended 16-bit)
+//   eax = ALU output         r8d = ALU X operand (A or M)
+// ==============================================================================
+
+#include "cpu.hpp"
+#include "cpu_jit.hpp"
+#include <cstring>
+
+#if N2T_CPU_JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace n2t {
+
+// ==============================================================================
+// Executable Memory
+// ==============================================================================
+
+struct CPUJit::CodeChunk {
+    static constexpr size_t SIZE = 256 * 1024;
+
+    uint8_t* base = nullptr;
+    size_t used = 0;
+
+    CodeChunk() {
+#if N2T_CPU_JIT_SUPPORTED
+        void* mem = mmap(nullptr, SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            throw InternalError("JIT could not allocate executable memory");
+        }
+        base = static_cast<uint8_t*>(mem);
+#endif
+    }
+
+    ~CodeChunk() {
+#if N2T_CPU_JIT_SUPPORTED
+        if (base) munmap(base, SIZE);
+#endif
+    }
+
+    CodeChunk(const CodeChunk&) = delete;
+    CodeChunk& operator=(const CodeChunk&) = delete;
+};
+
+// ==============================================================================
+// Construction
+// ==============================================================================
+
+CPUJit::CPUJit() = default;
+CPUJit::~CPUJit() = default;
+
+void CPUJit::clear() {
+    blocks_.clear();
+    block_index_.assign(CPUAddress::ROM_SIZE, NOT_TRANSLATED);
+    chunks_.clear();
+    valid_ = false;
+}
+
+void* CPUJit::install(const std::vector<uint8_t>& code) {
+#if N2T_CPU_JIT_SUPPORTED
+    if (code.size() > CodeChunk::SIZE) {
+        throw InternalError("JIT block too large for a code chunk");
+    }
+    if (chunks_.empty() || chunks_.back()->used + code.size() > CodeChunk::SIZE) {
+        chunks_.push_back(std::make_unique<CodeChunk>());
+    }
+
+    // W^X: the chunk is writable only while new code is copied in
+    CodeChunk& chunk = *chunks_.back();
+    if (mprotect(chunk.base, CodeChunk::SIZE, PROT_READ | PROT_WRITE) != 0) {
+        throw InternalError("JIT could not make code memory writable");
+    }
+    uint8_t* dest = chunk.base + chunk.used;
+    std::memcpy(dest, code.data(), code.size());
+    chunk.used += (code.size() + 15) & ~static_cast<size_t>(15);
+    if (mprotect(chunk.base, CodeChunk::SIZE, PROT_READ | PROT_EXEC) != 0) {
+        throw InternalError("JIT could not make code memory executable");
+    }
+    return dest;
+#else
+    (void)code;
+    return nullptr;
+#endif
+}
+
+// ==============================================================================
+// Block Cache
+// ==============================================================================
+
+const JitBlock* CPUJit::block_at(Address pc, const CPUMemory& memory,
+                                 const RomBitmap& breakpoints,
+                                 uint64_t breakpoint_version) {
+    if (!valid_ || rom_generation_ != memory.rom_generation() ||
+        breakpoint_version_ != breakpoint_version) {
+        clear();
+        rom_generation_ = memory.rom_generation();
+        breakpoint_version_ = breakpoint_version;
+        valid_ = true;
+    }
+
+    int32_t index = block_index_[pc];
+    if (index >= 0) return blocks_[static_cast<size_t>(index)].get();
+    if (index == UNTRANSLATABLE) return nullptr;
+
+    return translate(pc, memory, breakpoints);
+}
+
+// ==============================================================================
+// Code Generation
+// ==============================================================================
+
+namespace {
+
+// JitContext field offsets (see cpu_jit.hpp)
+constexpr uint8_t CTX_A = 0;
+constexpr uint8_t CTX_D = 2;
+constexpr uint8_t CTX_PC = 4;
+constexpr uint8_t CTX_RAM = 8;
+
+// Length of emit_exit_at(), used as a fixed rel8 skip distance
+constexpr uint8_t EXIT_LENGTH = 20;
+
+class Emitter {
+public:
+    std::vector<uint8_t> code;
+
+    void bytes(std::initializer_list<uint8_t> b) {
+        code.insert(code.end(), b);
+    }
+
+    void imm16(uint16_t v) {
+        code.push_back(static_cast<uint8_t>(v & 0xFF));
+        code.push_back(static_cast<uint8_t>(v >> 8));
+    }
+
+    void imm32(uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            code.push_back(static_cast<uint8_t>((v >> (8 * i)) & 0xFF));
+        }
+    }
+
+    // mov rsi, [rdi+RAM]; movzx ecx, word [rdi+A]; movzx edx, word [rdi+D]
+    void prologue() {
+        bytes({0x48, 0x8B, 0x77, CTX_RAM});
+        bytes({0x0F, 0xB7, 0x4F, CTX_A});
+        bytes({0x0F, 0xB7, 0x57, CTX_D});
+    }
+
+    // mov [rdi+A], cx; mov [rdi+D], dx
+    void store_registers() {
+        bytes({0x66, 0x89, 0x4F, CTX_A});
+        bytes({0x66, 0x89, 0x57, CTX_D});
+    }
+
+    // Exit with PC = pc; returns result. Exactly EXIT_LENGTH bytes.
+    void exit_at(Address pc, uint32_t result) {
+        store_registers();
+        bytes({0x66, 0xC7, 0x47, CTX_PC});
+        imm16(pc);
+        bytes({0xB8});
+        imm32(result);
+        bytes({0xC3});
+    }
+
+    // Exit with PC = A (a taken jump)
+    void exit_at_a(uint32_t result) {
+        store_registers();
+        bytes({0x66, 0x89, 0x4F, CTX_PC});
+        bytes({0xB8});
+        imm32(result);
+        bytes({0xC3});
+    }
+
+    // Side exit unless A < SCREEN_BASE: cmp ecx, imm32; jb +EXIT_LENGTH
+    void guard_ram_access(Address pc, uint32_t completed) {
+        bytes({0x81, 0xF9});
+        imm32(CPUAddress::SCREEN_BASE);
+        bytes({0x72, EXIT_LENGTH});
+        exit_at(pc, completed);
+    }
+};
+
+bool uses_x_operand(AluOp op) {
+    switch (op) {
+        case AluOp::X:
+        case AluOp::NOT_X:
+        case AluOp::NEG_X:
+        case AluOp::X_PLUS_1:
+        case AluOp::X_MINUS_1:
+        case AluOp::D_PLUS_X:
+        case AluOp::D_MINUS_X:
+        case AluOp::X_MINUS_D:
+        case AluOp::D_AND_X:
+        case AluOp::D_OR_X:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// eax = ALU(op, edx, r8d), masked to 16 bits
+void emit_alu(Emitter& e, AluOp op) {
+    constexpr uint8_t MOV_EAX_EDX[] = {0x89, 0xD0};
+    constexpr uint8_t MOV_EAX_R8D[] = {0x44, 0x89, 0xC0};
+
+    auto from_d = [&]() { e.bytes({MOV_EAX_EDX[0], MOV_EAX_EDX[1]}); };
+    auto from_x = [&]() { e.bytes({MOV_EAX_R8D[0], MOV_EAX_R8D[1], MOV_EAX_R8D[2]}); };
+
+    switch (op) {
+        case AluOp::ZERO:      e.bytes({0x31, 0xC0}); break;                    // xor eax, eax
+        case AluOp::ONE:       e.bytes({0xB8}); e.imm32(1); break;              // mov eax, 1
+        case AluOp::NEG_ONE:   e.bytes({0xB8}); e.imm32(0xFFFF); break;         // mov eax, 0xFFFF
+        case AluOp::D:         from_d(); break;
+        case AluOp::X:         from_x(); break;
+        case AluOp::NOT_D:     from_d(); e.bytes({0xF7, 0xD0}); break;          // not eax
+        case AluOp::NOT_X:     from_x(); e.bytes({0xF7, 0xD0}); break;
+        case AluOp::NEG_D:     from_d(); e.bytes({0xF7, 0xD8}); break;          // neg eax
+        case AluOp::NEG_X:     from_x(); e.bytes({0xF7, 0xD8}); break;
+        case AluOp::D_PLUS_1:  from_d(); e.bytes({0xFF, 0xC0}); break;          // inc eax
+        case AluOp::X_PLUS_1:  from_x(); e.bytes({0xFF, 0xC0}); break;
+        case AluOp::D_MINUS_1: from_d(); e.bytes({0xFF, 0xC8}); break;          // dec eax
+        case AluOp::X_MINUS_1: from_x(); e.bytes({0xFF, 0xC8}); break;
+        case AluOp::D_PLUS_X:  from_d(); e.bytes({0x44, 0x01, 0xC0}); break;    // add eax, r8d
+        case AluOp::D_MINUS_X: from_d(); e.bytes({0x44, 0x29, 0xC0}); break;    // sub eax, r8d
+        case AluOp::X_MINUS_D: from_x(); e.bytes({0x29, 0xD0}); break;          // sub eax, edx
+        case AluOp::D_AND_X:   from_d(); e.bytes({0x44, 0x21, 0xC0}); break;    // and eax, r8d
+        case AluOp::D_OR_X:    from_d(); e.bytes({0x44, 0x09, 0xC0}); break;    // or eax, r8d
+        default:
+            throw InternalError("JIT asked to translate a non-ALU micro-op");
+    }
+    e.bytes({0x0F, 0xB7, 0xC0});  // movzx eax, ax
+}
+
+// Jcc rel8 opcode for a jjj mask (JMP handled by the caller)
+uint8_t jcc_opcode(uint8_t jump) {
+    switch (jump) {
+        case 0b001: return 0x7F;  // JGT -> jg
+        case 0b010: return 0x74;  // JEQ -> je
+        case 0b011: return 0x7D;  // JGE -> jge
+        case 0b100: return 0x7C;  // JLT -> jl
+        case 0b101: return 0x75;  // JNE -> jne
+        case 0b110: return 0x7E;  // JLE -> jle
+        default:
+            throw InternalError("JIT asked for a condition code of an unconditional jump");
+    }
+}
+
+}  // namespace
+
+const JitBlock* CPUJit::translate(Address start, const CPUMemory& memory,
+                                  const RomBitmap& breakpoints) {
+#if N2T_CPU_JIT_SUPPORTED
+    const MicroOp* ops = memory.decoded_ptr();
+    const size_t program_size = memory.rom_size();
+
+    // Find the block extent
+    size_t length = 0;
+    for (size_t addr = start; addr < program_size && length < MAX_BLOCK_LENGTH; addr++) {
+        const MicroOp& op = ops[addr];
+        if (op.op == AluOp::INVALID) break;
+        if (length > 0 && breakpoints.test(addr)) break;
+        length++;
+        if (op.op != AluOp::LOAD_A && op.jump) break;
+    }
+
+    if (length == 0) {
+        block_index_[start] = UNTRANSLATABLE;
+        return nullptr;
+    }
+
+    auto block = std::make_unique<JitBlock>();
+    block->length = static_cast<uint16_t>(length);
+    block->a_instructions.assign(length + 1, 0);
+    block->c_instructions.assign(length + 1, 0);
+    block->memory_reads.assign(length + 1, 0);
+    block->memory_writes.assign(length + 1, 0);
+
+    Emitter e;
+    e.prologue();
+
+    for (size_t i = 0; i < length; i++) {
+        const MicroOp& op = ops[start + i];
+        const Address pc = static_cast<Address>(start + i);
+        const uint32_t completed = static_cast<uint32_t>(i);
+
+        block->a_instructions[i + 1] = block->a_instructions[i];
+        block->c_instructions[i + 1] = block->c_instructions[i];
+        block->memory_reads[i + 1] = block->memory_reads[i];
+        block->memory_writes[i + 1] = block->memory_writes[i];
+
+        if (op.op == AluOp::LOAD_A) {
+            e.bytes({0xB9});  // mov ecx, imm32
+            e.imm32(op.value);
+            block->a_instructions[i + 1]++;
+            continue;
+        }
+
+        block->c_instructions[i + 1]++;
+
+        // Any M access must leave the block before this instruction changes
+        // anything if A is outside plain RAM
+        if (op.reads_m || (op.dest & 0x1)) {
+            e.guard_ram_access(pc, completed);
+        }
+
+        if (uses_x_operand(op.op)) {
+            if (op.reads_m) {
+                e.bytes({0x44, 0x0F, 0xB7, 0x04, 0x4E});  // movzx r8d, word [rsi+rcx*2]
+                block->memory_reads[i + 1]++;
+            } else {
+                e.bytes({0x41, 0x89, 0xC8});              // mov r8d, ecx
+            }
+        }
+
+        emit_alu(e, op.op);
+
+        // M is written through the original A, so store it first
+        if (op.dest & 0x1) {
+            e.bytes({0x66, 0x89, 0x04, 0x4E});  // mov [rsi+rcx*2], ax
+            block->memory_writes[i + 1]++;
+        }
+        if (op.dest & 0x4) e.bytes({0x89, 0xC1});  // mov ecx, eax
+        if (op.dest & 0x2) e.bytes({0x89, 0xC2});  // mov edx, eax
+
+        if (op.jump) {
+            const uint32_t done = static_cast<uint32_t>(length);
+            const Address fallthrough = static_cast<Address>(start + length);
+            if (op.jump == 0b111) {
+                e.exit_at_a(done | JitBlock::JUMP_TAKEN_FLAG);
+            } else {
+                e.bytes({0x98});              // cwde: sign-extend the output
+                e.bytes({0x85, 0xC0});        // test eax, eax
+                e.bytes({jcc_opcode(op.jump), EXIT_LENGTH});
+                e.exit_at(fallthrough, done);
+                e.exit_at_a(done | JitBlock::JUMP_TAKEN_FLAG);
+            }
+        }
+    }
+
+    // Blocks that do not end in a jump fall through to the next address
+    const MicroOp& last = ops[start + length - 1];
+    if (last.op == AluOp::LOAD_A || !last.jump) {
+        e.exit_at(static_cast<Address>(start + length), static_cast<uint32_t>(length));
+    }
+
+    void* code = install(e.code);
+    block->entry = reinterpret_cast<JitBlock::Entry>(code);
+
+    block_index_[start] = static_cast<int32_t>(blocks_.size());
+    blocks_.push_back(std::move(block));
+    return blocks_.back().get();
+#else
+    (void)memory;
+    (void)breakpoints;
+    block_index_[start] = UNTRANSLATABLE;
+    return nullptr;
+#endif
+}
+
+// ==============================================================================
+// Engine Integration
+// ==============================================================================
+
+void CPUEngine::run_jit(uint64_t max_instructions) {
+    if (!jit_supported()) {
+        run_blocks(max_instructions);
+        return;
+    }
+
+    if (!jit_) jit_ = std::make_unique<CPUJit>();
+
+    JitContext ctx;
+    ctx.ram = memory_.ram_ptr();
+    const size_t program_size = memory_.rom_size();
+    const bool counted = instrumentation_ != CPUInstrumentation::BARE;
+
+    uint64_t count = 0;
+    uint64_t next_idle_probe = 0;
+    while (state_ == CPUState::RUNNING && count < max_instructions) {
+        if (count >= next_idle_probe) {
+            next_idle_probe = count + PAUSE_POLL_INTERVAL;
+            if (stop_if_idle(a_register_, d_register_, pc_)) break;
+        }
+
+        // Enter native code only where the interpreter would execute the
+        // next instruction without stopping first
+        bool stop_here = pc_ >= program_size ||
+            pause_requested_.load(std::memory_order_relaxed) ||
+            (stats_.instructions_executed > 0 && breakpoints_.test(pc_));
+
+        if (!stop_here) {
+            const JitBlock* block = jit_->block_at(
+                pc_, memory_, breakpoints_, breakpoint_version_);
+
+            if (block && max_instructions - count >= block->length) {
+                ctx.a = a_register_;
+                ctx.d = d_register_;
+                uint32_t result = block->entry(&ctx);
+                uint32_t done = result & 0xFFFF;
+
+                if (done > 0) {
+                    a_register_ = ctx.a;
+                    d_register_ = ctx.d;
+                    pc_ = ctx.pc;
+
+                    stats_.instructions_executed += done;
+                    if (counted) {
+                        stats_.a_instruction_count += block->a_instructions[done];
+                        stats_.c_instruction_count += block->c_instructions[done];
+                        stats_.memory_reads += block->memory_reads[done];
+                        stats_.memory_writes += block->memory_writes[done];
+                        if (result & JitBlock::JUMP_TAKEN_FLAG) stats_.jump_count++;
+                    }
+                    count += done;
+
+                    if (pc_ >= program_size) {
+                        state_ = CPUState::HALTED;
+                    }
+                    continue;
+                }
+                // Side exit before the first instruction: interpret it
+            }
+        }
+
+        if (!execute_instruction()) {
+            break;
+        }
+        count++;
+    }
+}
+
+}  // namespace n2t
@@ -0,0 +1,140 @@
+// ==============================================================================
+// Hack CPU x86-64 JIT
+// ==============================================================================
+// Translates Hack basic blocks into native x86-64 code for long headless runs.
+//
+// A block starts at any ROM address and extends until (inclusive) the first
+// jumping C-instruction, or until (exclusive) an invalid instruction, a
+// breakpoint, the end of the program, or MAX_BLOCK_LENGTH instructions.
+// Inside a block:
+//   - A lives in ecx, D in edx, and RAM is addressed off a base pointer
+//   - every M access first checks A < SCREEN_BASE; screen, keyboard and
+//     out-of-range addresses side-exit *before* the instruction, so the
+//     interpreter re-executes it with full checks, dirty tracking and the
+//     usual error messages
+//   - only the final instruction can jump, so stats for a partially executed
+//     block come from per-block prefix counts
+//
+// The engine enters a block only when the remaining run_for budget covers
+// the whole block and after its usual pause/breakpoint checks, so results
+// are identical to the interpreter's. Blocks are cached per ROM address and
+// dropped whenever the ROM or the breakpoint set changes.
+//
+// Only built for x86-64 System V targets (Linux, macOS) with mmap; elsewhere
+// jit_supported() is false and CPUDispatch::JIT falls back to BLOCK.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CPU_JIT_HPP
+#define NAND2TETRIS_CPU_JIT_HPP
+
+#include "instruction.hpp"
+#include "memory.hpp"
+#include <memory>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__)) && \
+    !defined(__EMSCRIPTEN__) && !defined(N2T_DISABLE_JIT)
+#define N2T_CPU_JIT_SUPPORTED 1
+#else
+#define N2T_CPU_JIT_SUPPORTED 0
+#endif
+
+namespace n2t {
+
+/**
+ * @brief Whether this build can generate native code.
+ */
+constexpr bool jit_supported() { return N2T_CPU_JIT_SUPPORTED != 0; }
+
+/**
+ * @brief Registers shared between the engine and generated code.
+ *
+ * Field offsets are baked into the generated code; keep the layout fixed.
+ */
+struct JitContext {
+    Word a = 0;          // offset 0
+    Word d = 0;          // offset 2
+    Word pc = 0;         // offset 4
+    Word reserved = 0;   // offset 6
+    Word* ram = nullptr; // offset 8
+};
+
+/**
+ * @brief One translated basic block.
+ */
+struct JitBlock {
+    // Generated entry point: runs the block on ctx, returns the number of
+    // instructions completed, plus JUMP_TAKEN_FLAG if the final jump was taken.
+    using Entry = uint32_t (*)(JitContext* ctx);
+    static constexpr uint32_t JUMP_TAKEN_FLAG = 0x10000;
+
+    Entry entry = nullptr;
+    uint16_t length = 0;
+
+    // Prefix counts: element k covers the block's first k instructions
+    std::vector<uint16_t> a_instructions;
+    std::vector<uint16_t> c_instructions;
+    std::vector<uint16_t> memory_reads;
+    std::vector<uint16_t> memory_writes;
+};
+
+/**
+ * @brief Block translator and code cache for one CPUEngine.
+ */
+class CPUJit {
+public:
+    static constexpr size_t MAX_BLOCK_LENGTH = 64;
+
+    CPUJit();
+    ~CPUJit();
+
+    CPUJit(const CPUJit&) = delete;
+    CPUJit& operator=(const CPUJit&) = delete;
+
+    /**
+     * @brief Get (translating on first use) the block starting at pc.
+     *
+     * Returns nullptr if no block can start there (e.g. the instruction is
+     * invalid), in which case the interpreter should execute it.
+     *
+     * @param memory Source of the ROM and micro-op table
+     * @param breakpoints Blocks never extend across these addresses
+     * @param breakpoint_version Changes whenever the breakpoint set changes
+     */
+    const JitBlock* block_at(Address pc, const CPUMemory& memory,
+                             const RomBitmap& breakpoints,
+                             uint64_t breakpoint_version);
+
+    /**
+     * @brief Drop all translated code.
+     */
+    void clear();
+
+    /**
+     * @brief Number of blocks currently translated.
+     */
+    size_t block_count() const { return blocks_.size(); }
+
+private:
+    struct CodeChunk;
+
+    std::vector<std::unique_ptr<JitBlock>> blocks_;
+    std::vector<int32_t> block_index_;           // ROM address -> blocks_ index
+    std::vector<std::unique_ptr<CodeChunk>> chunks_;
+
+    uint64_t rom_generation_ = 0;
+    uint64_t breakpoint_version_ = 0;
+    bool valid_ = false;
+
+    static constexpr int32_t NOT_TRANSLATED = -1;
+    static constexpr int32_t UNTRANSLATABLE = -2;
+
+    const JitBlock* translate(Address start, const CPUMemory& memory,
+                              const RomBitmap& breakpoints);
+
+    void* install(const std::vector<uint8_t>& code);
+};
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CPU_JIT_HPP
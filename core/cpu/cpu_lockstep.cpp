@@ -0,0 +1,349 @@
+// ==============================================================================
+// Hack CPU Lockstep Engine Implementation
+// ==============================================================================
+// Every per-lane loop below runs over the full LANES width with a 0x0000 /
+// 0xFFFF lane mask and bitwise blends, so it has a fixed trip count and no
+// data-dependent branches; the compiler turns these into SIMD loads, ALU ops
+// and blends. Only leader selection, error handling and divergent M
+// accesses are scalar.
+// ==============================================================================
+
+#include "cpu_lockstep.hpp"
+#include <algorithm>
+
+namespace n2t {
+
+namespace {
+
+constexpr size_t LANES = CPULockstep::LANES;
+using LaneWords = std::array<Word, LANES>;
+
+inline Word blend(Word mask, Word if_set, Word if_clear) {
+    return static_cast<Word>((if_set & mask) | (if_clear & static_cast<Word>(~mask)));
+}
+
+/**
+ * @brief True if any active lane holds an address outside RAM.
+ */
+inline bool any_out_of_range(const LaneWords& mask, const LaneWords& addresses) {
+    Word bad = 0;
+    for (size_t l = 0; l < LANES; l++) {
+        bad |= static_cast<Word>(mask[l] & (addresses[l] >= CPUAddress::RAM_SIZE ? 0xFFFF : 0));
+    }
+    return bad != 0;
+}
+
+/**
+ * @brief True if every active lane holds the same address; first is set
+ *        to it (0 if no lane is active).
+ */
+inline bool same_address(const LaneWords& mask, const LaneWords& addresses, Word& first) {
+    first = 0;
+    for (size_t l = 0; l < LANES; l++) {
+        if (mask[l]) {
+            first = addresses[l];
+            break;
+        }
+    }
+    Word differs = 0;
+    for (size_t l = 0; l < LANES; l++) {
+        differs |= static_cast<Word>(mask[l] & (addresses[l] ^ first));
+    }
+    return differs == 0;
+}
+
+/**
+ * @brief out[l] = f(d[l], x[l]) for every lane.
+ */
+template <typename F>
+inline void map_lanes(LaneWords& out, const LaneWords& d, const LaneWords& x, F f) {
+    for (size_t l = 0; l < LANES; l++) {
+        out[l] = static_cast<Word>(f(d[l], x[l]));
+    }
+}
+
+/**
+ * @brief Lane-wise evaluate_alu: one switch per step, not per lane.
+ */
+void evaluate_alu_lanes(AluOp op, const LaneWords& d, const LaneWords& x, LaneWords& out) {
+    switch (op) {
+        case AluOp::ZERO:      out.fill(0); break;
+        case AluOp::ONE:       out.fill(1); break;
+        case AluOp::NEG_ONE:   out.fill(0xFFFF); break;
+        case AluOp::D:         out = d; break;
+        case AluOp::X:         out = x; break;
+        case AluOp::NOT_D:     map_lanes(out, d, x, [](Word dv, Word) { return ~dv; }); break;
+        case AluOp::NOT_X:     map_lanes(out, d, x, [](Word, Word xv) { return ~xv; }); break;
+        case AluOp::NEG_D:     map_lanes(out, d, x, [](Word dv, Word) { return 0u - dv; }); break;
+        case AluOp::NEG_X:     map_lanes(out, d, x, [](Word, Word xv) { return 0u - xv; }); break;
+        case AluOp::D_PLUS_1:  map_lanes(out, d, x, [](Word dv, Word) { return dv + 1u; }); break;
+        case AluOp::X_PLUS_1:  map_lanes(out, d, x, [](Word, Word xv) { return xv + 1u; }); break;
+        case AluOp::D_MINUS_1: map_lanes(out, d, x, [](Word dv, Word) { return dv - 1u; }); break;
+        case AluOp::X_MINUS_1: map_lanes(out, d, x, [](Word, Word xv) { return xv - 1u; }); break;
+        case AluOp::D_PLUS_X:  map_lanes(out, d, x, [](Word dv, Word xv) { return dv + xv; }); break;
+        case AluOp::D_MINUS_X: map_lanes(out, d, x, [](Word dv, Word xv) { return dv - xv; }); break;
+        case AluOp::X_MINUS_D: map_lanes(out, d, x, [](Word dv, Word xv) { return xv - dv; }); break;
+        case AluOp::D_AND_X:   map_lanes(out, d, x, [](Word dv, Word xv) { return dv & xv; }); break;
+        case AluOp::D_OR_X:    map_lanes(out, d, x, [](Word dv, Word xv) { return dv | xv; }); break;
+        default:               out.fill(0); break;
+    }
+}
+
+}  // namespace
+
+// ==============================================================================
+// Construction and Reset
+// ==============================================================================
+
+CPULockstep::CPULockstep(std::shared_ptr<const CPUProgram> program)
+    : program_(std::move(program))
+    , ram_(CPUAddress::RAM_SIZE * LANES, 0)
+{
+    if (!program_) {
+        throw RuntimeError("CPULockstep needs a program to run");
+    }
+}
+
+void CPULockstep::reset() {
+    a_.fill(0);
+    d_.fill(0);
+    pc_.fill(0);
+    state_.fill(CPUState::READY);
+    executed_.fill(0);
+    for (auto& message : error_message_) {
+        message.clear();
+    }
+    std::fill(ram_.begin(), ram_.end(), 0);
+    full_steps_ = 0;
+    masked_steps_ = 0;
+}
+
+// ==============================================================================
+// Per-Lane Memory
+// ==============================================================================
+
+Word CPULockstep::read_ram(size_t lane, Address address) const {
+    if (lane >= LANES) {
+        throw RuntimeError("Lane " + std::to_string(lane) + " does not exist.");
+    }
+    if (address >= CPUAddress::RAM_SIZE) {
+        throw RuntimeError(CPUMemory::read_error_message(address));
+    }
+    return ram_[static_cast<size_t>(address) * LANES + lane];
+}
+
+void CPULockstep::write_ram(size_t lane, Address address, Word value) {
+    if (lane >= LANES) {
+        throw RuntimeError("Lane " + std::to_string(lane) + " does not exist.");
+    }
+    if (address >= CPUAddress::RAM_SIZE) {
+        throw RuntimeError(CPUMemory::write_error_message(address));
+    }
+    ram_[static_cast<size_t>(address) * LANES + lane] = value;
+}
+
+// ==============================================================================
+// Execution
+// ==============================================================================
+
+void CPULockstep::run_for(uint64_t max_instructions) {
+    const MicroOp* ops = program_->decoded.data();
+    const size_t rom_size = program_->size;
+
+    std::array<uint64_t, LANES> ran{};
+    for (size_t l = 0; l < LANES; l++) {
+        bool runnable = (state_[l] == CPUState::READY || state_[l] == CPUState::PAUSED) &&
+                        max_instructions > 0;
+        if (runnable && pc_[l] >= rom_size) {
+            state_[l] = CPUState::HALTED;
+            runnable = false;
+        }
+        if (runnable) state_[l] = CPUState::RUNNING;
+        live_[l] = runnable ? 0xFFFF : 0;
+    }
+
+    LaneWords mask{};
+    Word leader = 0;
+    bool regroup = true;
+    for (uint64_t steps = 0;; steps++) {
+        // A lane executes at most one instruction per step, so budgets can
+        // only run out once the step count reaches max_instructions
+        if (steps >= max_instructions) {
+            for (size_t l = 0; l < LANES; l++) {
+                if (ran[l] >= max_instructions && live_[l]) {
+                    live_[l] = 0;
+                    regroup = true;
+                }
+            }
+        }
+
+        if (regroup) {
+            // The lowest PC leads: lanes running the same loop stay
+            // together, and a lane that jumped ahead waits for the others
+            for (size_t l = 0; l < LANES; l++) {
+                live_[l] = static_cast<Word>(live_[l] & (pc_[l] < rom_size ? 0xFFFF : 0));
+            }
+            leader = 0xFFFF;
+            Word eligible = 0;
+            for (size_t l = 0; l < LANES; l++) {
+                leader = std::min(leader, blend(live_[l], pc_[l], 0xFFFF));
+                eligible = static_cast<Word>(eligible + (live_[l] & 1));
+            }
+            if (eligible == 0) break;
+
+            Word active = 0;
+            for (size_t l = 0; l < LANES; l++) {
+                mask[l] = static_cast<Word>(live_[l] & (pc_[l] == leader ? 0xFFFF : 0));
+                active = static_cast<Word>(active + (mask[l] & 1));
+            }
+            regroup = active != eligible;
+        } else {
+            // Still converged after a non-jumping instruction
+            leader++;
+        }
+
+        if (regroup) {
+            masked_steps_++;
+        } else {
+            full_steps_++;
+        }
+
+        const MicroOp& op = ops[leader];
+        bool completed = step_masked(op, leader, mask);
+
+        for (size_t l = 0; l < LANES; l++) {
+            ran[l] += mask[l] & 1;
+        }
+
+        // Lanes can only split up (or halt) on a jump, a failure or at the
+        // end of the ROM; otherwise they all sit at leader + 1 now
+        regroup = regroup || !completed || op.jump != 0 ||
+                  static_cast<size_t>(leader) + 1 >= rom_size;
+    }
+
+    for (size_t l = 0; l < LANES; l++) {
+        executed_[l] += ran[l];
+        if (state_[l] == CPUState::RUNNING) {
+            state_[l] = pc_[l] >= rom_size ? CPUState::HALTED : CPUState::PAUSED;
+        }
+    }
+}
+
+bool CPULockstep::step_masked(const MicroOp& op, Address op_pc, LaneWords& mask) {
+    if (op.op == AluOp::LOAD_A) {
+        for (size_t l = 0; l < LANES; l++) {
+            a_[l] = blend(mask[l], op.value, a_[l]);
+            pc_[l] = static_cast<Address>(pc_[l] + (mask[l] & 1));
+        }
+        return true;
+    }
+
+    if (op.op == AluOp::INVALID) {
+        for (size_t l = 0; l < LANES; l++) {
+            if (mask[l]) {
+                fail_lane(l, "Invalid ALU computation code at ROM[" + std::to_string(op_pc) +
+                             "]. The instruction may be corrupted.");
+                mask[l] = 0;
+            }
+        }
+        return false;
+    }
+
+    bool completed = true;
+    const bool touches_m = op.reads_m || (op.dest & 0x1);
+
+    // Out-of-range A fails the lane before (read) or after (write) the
+    // register updates, as in CPUEngine; either way it leaves the mask
+    if (op.reads_m && any_out_of_range(mask, a_)) {
+        for (size_t l = 0; l < LANES; l++) {
+            if (mask[l] && a_[l] >= CPUAddress::RAM_SIZE) {
+                fail_lane(l, CPUMemory::read_error_message(a_[l]));
+                mask[l] = 0;
+                completed = false;
+            }
+        }
+    }
+
+    Word first_a = 0;
+    bool uniform_a = touches_m && same_address(mask, a_, first_a);
+
+    LaneWords x;
+    if (!op.reads_m) {
+        x = a_;
+    } else if (uniform_a) {
+        // All active lanes read the same address: one contiguous row
+        const Word* row = &ram_[static_cast<size_t>(first_a) * LANES];
+        for (size_t l = 0; l < LANES; l++) {
+            x[l] = row[l];
+        }
+    } else {
+        // Inactive lanes gather from RAM[0] and are discarded by the blends
+        for (size_t l = 0; l < LANES; l++) {
+            x[l] = ram_[static_cast<size_t>(a_[l] & mask[l]) * LANES + l];
+        }
+    }
+
+    LaneWords out;
+    evaluate_alu_lanes(op.op, d_, x, out);
+
+    const LaneWords original_a = a_;
+    if (op.dest & 0x4) {
+        for (size_t l = 0; l < LANES; l++) {
+            a_[l] = blend(mask[l], out[l], a_[l]);
+        }
+    }
+    if (op.dest & 0x2) {
+        for (size_t l = 0; l < LANES; l++) {
+            d_[l] = blend(mask[l], out[l], d_[l]);
+        }
+    }
+    if (op.dest & 0x1) {
+        if (any_out_of_range(mask, original_a)) {
+            for (size_t l = 0; l < LANES; l++) {
+                if (mask[l] && original_a[l] >= CPUAddress::RAM_SIZE) {
+                    fail_lane(l, CPUMemory::write_error_message(original_a[l]));
+                    mask[l] = 0;
+                    completed = false;
+                }
+            }
+            // The failed lanes no longer count towards the row address
+            uniform_a = same_address(mask, original_a, first_a);
+        }
+        if (uniform_a) {
+            Word* row = &ram_[static_cast<size_t>(first_a) * LANES];
+            for (size_t l = 0; l < LANES; l++) {
+                row[l] = blend(mask[l], out[l], row[l]);
+            }
+        } else {
+            for (size_t l = 0; l < LANES; l++) {
+                if (mask[l]) {
+                    ram_[static_cast<size_t>(original_a[l]) * LANES + l] = out[l];
+                }
+            }
+        }
+    }
+
+    // Jump: per-lane lt/eq/gt masks against the op's jjj bits
+    const Word jump_lt = (op.jump & 0x4) ? 0xFFFF : 0;
+    const Word jump_eq = (op.jump & 0x2) ? 0xFFFF : 0;
+    const Word jump_gt = (op.jump & 0x1) ? 0xFFFF : 0;
+    for (size_t l = 0; l < LANES; l++) {
+        int16_t value = static_cast<int16_t>(out[l]);
+        Word lt = value < 0 ? 0xFFFF : 0;
+        Word eq = value == 0 ? 0xFFFF : 0;
+        Word gt = value > 0 ? 0xFFFF : 0;
+        Word taken = static_cast<Word>((lt & jump_lt) | (eq & jump_eq) | (gt & jump_gt));
+        Word next = blend(taken, a_[l], static_cast<Word>(pc_[l] + 1));
+        pc_[l] = blend(mask[l], next, pc_[l]);
+    }
+    return completed;
+}
+
+void CPULockstep::fail_lane(size_t lane, const std::string& message) {
+    // Formatted exactly as CPUEngine's error messages
+    error_message_[lane] = RuntimeError(message).what();
+    state_[lane] = CPUState::ERROR;
+    live_[lane] = 0;
+}
+
+}  // namespace n2t
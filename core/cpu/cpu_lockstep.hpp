@@ -0,0 +1,121 @@
+// ==============================================================================
+// Hack CPU Lockstep Engine
+// ==============================================================================
+// Runs LANES Hack machines over the same ROM in lockstep, for exhaustive
+// input sweeps (e.g. Mult over a whole R0 x R1 grid).
+//
+// State is kept as structure-of-arrays: A, D and PC are arrays indexed by
+// lane, and RAM is interleaved so that RAM[address] of all lanes is one
+// contiguous row. Every step executes one instruction for all lanes whose
+// PC equals the lowest PC among the running lanes; the other lanes are
+// masked out. Lanes that share a PC (the common case for sweeps, since
+// they run the same loops) therefore execute together, and diverged lanes
+// naturally fall back to masked execution until they meet again. Lanes
+// can only split up on a jump, so a converged group skips regrouping until
+// its next jumping instruction.
+//
+// The per-lane loops are plain fixed-length loops over small arrays with
+// blends instead of branches, written so the compiler can auto-vectorize
+// them for whatever SIMD width the target has (SSE, AVX2, AVX-512, NEON
+// or WASM SIMD). M accesses use one contiguous row when all active lanes
+// agree on A, and a per-lane gather/scatter otherwise.
+//
+// Semantics per lane match CPUEngine in CHECKED mode (same registers, RAM,
+// instruction counts and error messages). Lanes are headless: there is no
+// screen dirty tracking or keyboard input.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CPU_LOCKSTEP_HPP
+#define NAND2TETRIS_CPU_LOCKSTEP_HPP
+
+#include "cpu.hpp"
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace n2t {
+
+class CPULockstep {
+public:
+    static constexpr size_t LANES = 16;
+
+    explicit CPULockstep(std::shared_ptr<const CPUProgram> program);
+
+    /**
+     * @brief Zero registers and RAM of every lane; all lanes become READY.
+     */
+    void reset();
+
+    // =========================================================================
+    // Per-Lane Memory
+    // =========================================================================
+
+    /**
+     * @throws RuntimeError if lane or address is out of range
+     */
+    Word read_ram(size_t lane, Address address) const;
+    void write_ram(size_t lane, Address address, Word value);
+
+    // =========================================================================
+    // Execution
+    // =========================================================================
+
+    /**
+     * @brief Run every READY/PAUSED lane for up to max_instructions each.
+     *
+     * Lanes stop individually when they halt, fail, or use up the budget
+     * (PAUSED); a halted or failed lane stays that way until reset().
+     */
+    void run_for(uint64_t max_instructions);
+
+    // =========================================================================
+    // Per-Lane Inspection
+    // =========================================================================
+
+    CPUState state(size_t lane) const { return state_.at(lane); }
+    Word a(size_t lane) const { return a_.at(lane); }
+    Word d(size_t lane) const { return d_.at(lane); }
+    Address pc(size_t lane) const { return pc_.at(lane); }
+    uint64_t instructions_executed(size_t lane) const { return executed_.at(lane); }
+    const std::string& error_message(size_t lane) const { return error_message_.at(lane); }
+
+    /**
+     * @brief Steps executed with every running lane active, and steps
+     *        executed with some lanes masked out (for tuning sweeps).
+     */
+    uint64_t full_steps() const { return full_steps_; }
+    uint64_t masked_steps() const { return masked_steps_; }
+
+private:
+    using LaneWords = std::array<Word, LANES>;
+
+    std::shared_ptr<const CPUProgram> program_;
+
+    LaneWords a_{};
+    LaneWords d_{};
+    std::array<Address, LANES> pc_{};
+    std::array<CPUState, LANES> state_{};
+    std::array<uint64_t, LANES> executed_{};
+    std::array<std::string, LANES> error_message_;
+    LaneWords live_{};   // 0xFFFF for lanes still running in run_for
+
+    // RAM[address] for lane l lives at ram_[address * LANES + l]
+    std::vector<Word> ram_;
+
+    uint64_t full_steps_ = 0;
+    uint64_t masked_steps_ = 0;
+
+    /**
+     * @brief Execute op for the lanes whose mask is 0xFFFF.
+     *
+     * Lanes that fail are cleared from the mask; returns false if any did.
+     */
+    bool step_masked(const MicroOp& op, Address op_pc, LaneWords& mask);
+
+    void fail_lane(size_t lane, const std::string& message);
+};
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CPU_LOCKSTEP_HPP
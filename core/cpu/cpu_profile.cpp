@@ -0,0 +1,190 @@
+// ==============================================================================
+// Hack CPU Execution Profile Implementation
+// ==============================================================================
+
+#include "cpu_profile.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace n2t {
+
+namespace {
+
+std::string percent(uint64_t part, uint64_t total) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1)
+        << (total ? 100.0 * static_cast<double>(part) / static_cast<double>(total) : 0.0) << "%";
+    return oss.str();
+}
+
+}  // namespace
+
+// ==============================================================================
+// Counters
+// ==============================================================================
+
+CPUProfile::CPUProfile()
+    : executed_(CPUAddress::ROM_SIZE, 0), jumps_(CPUAddress::ROM_SIZE, 0) {}
+
+void CPUProfile::clear() {
+    std::fill(executed_.begin(), executed_.end(), 0);
+    std::fill(jumps_.begin(), jumps_.end(), 0);
+}
+
+uint64_t CPUProfile::total() const {
+    uint64_t sum = 0;
+    for (uint64_t count : executed_) sum += count;
+    return sum;
+}
+
+// ==============================================================================
+// Analysis
+// ==============================================================================
+
+std::vector<Address> CPUProfile::hottest(size_t limit) const {
+    std::vector<Address> addresses;
+    for (size_t a = 0; a < executed_.size(); a++) {
+        if (executed_[a]) addresses.push_back(static_cast<Address>(a));
+    }
+    auto hotter = [this](Address x, Address y) {
+        return executed_[x] != executed_[y] ? executed_[x] > executed_[y] : x < y;
+    };
+    if (addresses.size() > limit) {
+        std::partial_sort(addresses.begin(), addresses.begin() + limit, addresses.end(), hotter);
+        addresses.resize(limit);
+    } else {
+        std::sort(addresses.begin(), addresses.end(), hotter);
+    }
+    return addresses;
+}
+
+std::vector<ProfileBlock> CPUProfile::blocks(const ControlFlowGraph& cfg) const {
+    std::vector<ProfileBlock> result;
+    result.reserve(cfg.blocks().size());
+    for (const CFGBlock& b : cfg.blocks()) {
+        ProfileBlock block;
+        block.start = b.start;
+        block.end = b.end;
+        block.executions = executed_[b.start];
+        for (size_t a = b.start; a <= b.end; a++) block.instructions += executed_[a];
+        result.push_back(block);
+    }
+    return result;
+}
+
+std::vector<ProfileLoop> CPUProfile::loops(const ControlFlowGraph& cfg) const {
+    const auto& blocks = cfg.blocks();
+    std::vector<ProfileLoop> result;
+    for (const CFGLoop& l : cfg.loops()) {
+        const CFGBlock& header = blocks[l.header];
+        ProfileLoop loop;
+        loop.head = header.start;
+        for (uint32_t latch : l.latches) {
+            const Address end = blocks[latch].end;
+            loop.back_edge = std::max(loop.back_edge, end);
+            // A latch reaches the header by its jump or by falling through
+            if (cfg.jump_target(latch) == header.start) {
+                loop.iterations += jumps_[end];
+            } else if (end + 1u == header.start) {
+                loop.iterations += executed_[end] - jumps_[end];
+            }
+        }
+        if (loop.iterations == 0) continue;
+        for (uint32_t block : l.blocks) {
+            for (size_t a = blocks[block].start; a <= blocks[block].end; a++) {
+                loop.instructions += executed_[a];
+            }
+        }
+        result.push_back(loop);
+    }
+    std::sort(result.begin(), result.end(), [](const ProfileLoop& x, const ProfileLoop& y) {
+        return x.instructions != y.instructions ? x.instructions > y.instructions
+                                                : x.head < y.head;
+    });
+    return result;
+}
+
+// ==============================================================================
+// Reports
+// ==============================================================================
+
+std::string CPUProfile::report(const CPUProgram& program, const ControlFlowGraph& cfg,
+                               size_t limit) const {
+    const uint64_t sum = total();
+    std::ostringstream oss;
+    oss << "Instructions executed: " << sum << "\n";
+
+    oss << "\nHot instructions:\n"
+        << "  " << std::setw(12) << "count" << std::setw(8) << "share"
+        << std::setw(8) << "addr" << "  instruction\n";
+    for (Address a : hottest(limit)) {
+        oss << "  " << std::setw(12) << executed_[a] << std::setw(8) << percent(executed_[a], sum)
+            << std::setw(8) << a << "  " << instruction_to_string(program.rom[a]) << "\n";
+    }
+
+    auto blocks_by_cost = blocks(cfg);
+    std::sort(blocks_by_cost.begin(), blocks_by_cost.end(),
+              [](const ProfileBlock& x, const ProfileBlock& y) {
+                  return x.instructions != y.instructions ? x.instructions > y.instructions
+                                                          : x.start < y.start;
+              });
+    oss << "\nHot blocks:\n"
+        << "  " << std::setw(12) << "instrs" << std::setw(8) << "share"
+        << std::setw(12) << "runs" << "  range\n";
+    for (size_t i = 0; i < blocks_by_cost.size() && i < limit; i++) {
+        const ProfileBlock& b = blocks_by_cost[i];
+        if (b.instructions == 0) break;
+        oss << "  " << std::setw(12) << b.instructions << std::setw(8) << percent(b.instructions, sum)
+            << std::setw(12) << b.executions << "  " << b.start << "-" << b.end << "\n";
+    }
+
+    auto all_loops = loops(cfg);
+    oss << "\nLoops:\n"
+        << "  " << std::setw(12) << "instrs" << std::setw(8) << "share"
+        << std::setw(12) << "iterations" << "  range\n";
+    if (all_loops.empty()) oss << "  (none taken)\n";
+    for (size_t i = 0; i < all_loops.size() && i < limit; i++) {
+        const ProfileLoop& l = all_loops[i];
+        oss << "  " << std::setw(12) << l.instructions << std::setw(8) << percent(l.instructions, sum)
+            << std::setw(12) << l.iterations << "  " << l.head << "-" << l.back_edge << "\n";
+    }
+    return oss.str();
+}
+
+std::string CPUProfile::annotate(const CPUProgram& program, const ControlFlowGraph& cfg) const {
+    const uint64_t sum = total();
+    std::ostringstream oss;
+    oss << std::setw(12) << "count" << std::setw(8) << "share" << std::setw(10) << "taken"
+        << std::setw(8) << "addr" << "  instruction\n";
+
+    auto all_blocks = blocks(cfg);
+    for (size_t i = 0; i < all_blocks.size(); i++) {
+        const ProfileBlock& b = all_blocks[i];
+        if (b.executions == 0) {
+            // Collapse a run of blocks that never ran
+            Address end = b.end;
+            while (i + 1 < all_blocks.size() && all_blocks[i + 1].executions == 0) {
+                end = all_blocks[++i].end;
+            }
+            oss << std::setw(38) << b.start << "  ; " << (end - b.start + 1)
+                << " instruction(s) never executed\n";
+            continue;
+        }
+        oss << "  ; block " << b.start << "-" << b.end << ", ran " << b.executions << " times\n";
+        for (size_t a = b.start; a <= b.end; a++) {
+            oss << std::setw(12) << executed_[a] << std::setw(8) << percent(executed_[a], sum);
+            DecodedInstruction decoded = decode_instruction(program.rom[a]);
+            if (decoded.type == InstructionType::C_INSTRUCTION &&
+                decoded.jump != JumpCondition::NO_JUMP) {
+                oss << std::setw(10) << jumps_[a];
+            } else {
+                oss << std::setw(10) << "";
+            }
+            oss << std::setw(8) << a << "  " << instruction_to_string(program.rom[a]) << "\n";
+        }
+    }
+    return oss.str();
+}
+
+}  // namespace n2t
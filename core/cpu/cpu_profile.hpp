@@ -0,0 +1,113 @@
+// ==============================================================================
+// Hack CPU Execution Profile
+// ==============================================================================
+// Per-ROM-address counters collected under CPUInstrumentation::PROFILE:
+// how many times each instruction completed, and how many times each
+// jumping instruction took its jump.
+//
+// The reports group instructions into the basic blocks and natural loops
+// of the program's ControlFlowGraph, so a profile and the CFG of the same
+// ROM agree on both:
+//
+//   - A block's executions are the count of its first instruction; a run
+//     stopped inside a block leaves the rest of it with fewer.
+//   - A loop's iterations are the times its back edges were taken, and its
+//     cost is the instructions executed in all of its blocks.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CPU_PROFILE_HPP
+#define NAND2TETRIS_CPU_PROFILE_HPP
+
+#include "cpu_cfg.hpp"
+#include "memory.hpp"
+#include <string>
+#include <vector>
+
+namespace n2t {
+
+/**
+ * @brief Execution counts of one CFG block.
+ */
+struct ProfileBlock {
+    Address start = 0;
+    Address end = 0;              // Inclusive
+    uint64_t executions = 0;      // Times the block ran
+    uint64_t instructions = 0;    // Instructions executed inside it
+};
+
+/**
+ * @brief Execution counts of one CFG loop.
+ */
+struct ProfileLoop {
+    Address head = 0;             // First address of the header block
+    Address back_edge = 0;        // Last instruction of the last latch block
+    uint64_t iterations = 0;      // Times a back edge was taken
+    uint64_t instructions = 0;    // Instructions executed in the loop's blocks
+};
+
+/**
+ * @brief Execution and taken-jump counts for every ROM address.
+ */
+class CPUProfile {
+public:
+    CPUProfile();
+
+    void clear();
+
+    // Written directly by the execution cores (ROM_SIZE entries each)
+    uint64_t* executed_data() { return executed_.data(); }
+    uint64_t* jumps_data() { return jumps_.data(); }
+
+    uint64_t executed(Address address) const { return executed_.at(address); }
+    uint64_t jumps_taken(Address address) const { return jumps_.at(address); }
+
+    /**
+     * @brief Sum of all execution counts.
+     */
+    uint64_t total() const;
+
+    // =========================================================================
+    // Analysis
+    // =========================================================================
+
+    /**
+     * @brief Executed addresses, most executed first (at most limit).
+     */
+    std::vector<Address> hottest(size_t limit) const;
+
+    /**
+     * @brief The CFG's blocks, in address order.
+     */
+    std::vector<ProfileBlock> blocks(const ControlFlowGraph& cfg) const;
+
+    /**
+     * @brief The CFG's loops that ran at least once, most expensive first.
+     */
+    std::vector<ProfileLoop> loops(const ControlFlowGraph& cfg) const;
+
+    // =========================================================================
+    // Reports
+    // =========================================================================
+
+    /**
+     * @brief Hot instructions, hot blocks and loops as a text table.
+     */
+    std::string report(const CPUProgram& program, const ControlFlowGraph& cfg,
+                       size_t limit = 20) const;
+
+    /**
+     * @brief Disassembly of the executed blocks, each instruction prefixed
+     *        with its execution count, share of the total and taken jumps.
+     *
+     * Blocks that never ran are collapsed to one line.
+     */
+    std::string annotate(const CPUProgram& program, const ControlFlowGraph& cfg) const;
+
+private:
+    std::vector<uint64_t> executed_;
+    std::vector<uint64_t> jumps_;
+};
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CPU_PROFILE_HPP
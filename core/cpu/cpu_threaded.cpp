@@ -0,0 +1,367 @@
+// ==============================================================================
+// Hack CPU Threaded Execution Core
+// ==============================================================================
+// An alternative to the execute_instruction() loop for long runs.
+//
+// The switch core funnels every instruction through one dispatch point, so
+// the host branch predictor sees a single indirect branch whose target
+// changes almost every cycle. Here each instruction shape (A-instruction,
+// or one ALU handler with A or M as its operand) gets its own handler, and
+// every handler ends with its own copy of the dispatch jump. The predictor
+// can then learn per-shape successor patterns ("@X is usually followed by
+// D=M"), which is where compiler-generated Hack spends its time.
+//
+// With GCC/Clang the handlers are reached through a table of label
+// addresses (labels-as-values); other compilers get a switch of gotos with
+// the same handler bodies.
+//
+// Results are bit-identical to the switch core: same register updates in the
+// same order, same stats, same error messages and error locations. Like the
+// switch core it is instantiated once per CPUCheckMode and CPUInstrumentation
+// (and once more with the breakpoint test compiled out); errors are recorded
+// as a CPUErrorCode and reported on exit, never thrown.
+//
+// Under BARE instrumentation even instructions_executed is not counted per
+// instruction: it is folded in from the slice countdown (remaining) at the
+// end of every slice and on exit.
+// ==============================================================================
+
+#include "cpu.hpp"
+#include "cpu_profile.hpp"
+#include <algorithm>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define N2T_CPU_COMPUTED_GOTO 1
+#else
+#define N2T_CPU_COMPUTED_GOTO 0
+#endif
+
+namespace n2t {
+
+// ==============================================================================
+// Handler Table Layout
+// ==============================================================================
+// Handler index = AluOp value, plus M_OFFSET when the operand is M.
+// Slots that no valid instruction can reach fall through to INVALID.
+
+namespace {
+
+constexpr size_t M_OFFSET = static_cast<size_t>(AluOp::INVALID) + 1;
+constexpr size_t HANDLER_COUNT = 2 * M_OFFSET;
+
+inline size_t handler_index(const MicroOp& op) {
+    return static_cast<size_t>(op.op) + (op.reads_m ? M_OFFSET : 0);
+}
+
+}  // namespace
+
+// ==============================================================================
+// Threaded Core
+// ==============================================================================
+
+#if N2T_CPU_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+template <CPUCheckMode Mode, CPUInstrumentation Inst>
+void CPUEngine::run_threaded_with(uint64_t max_instructions) {
+    if (breakpoints_.empty()) {
+        run_threaded_as<Mode, Inst, false>(max_instructions);
+    } else {
+        run_threaded_as<Mode, Inst, true>(max_instructions);
+    }
+}
+
+void CPUEngine::run_threaded(uint64_t max_instructions) {
+    constexpr auto CHECKED = CPUCheckMode::CHECKED;
+    constexpr auto UNCHECKED = CPUCheckMode::UNCHECKED;
+    const bool checked = check_mode_ == CHECKED;
+
+    switch (active_instrumentation()) {
+        case CPUInstrumentation::FULL:
+            checked ? run_threaded_with<CHECKED, CPUInstrumentation::FULL>(max_instructions)
+                    : run_threaded_with<UNCHECKED, CPUInstrumentation::FULL>(max_instructions);
+            break;
+        case CPUInstrumentation::BARE:
+            checked ? run_threaded_with<CHECKED, CPUInstrumentation::BARE>(max_instructions)
+                    : run_threaded_with<UNCHECKED, CPUInstrumentation::BARE>(max_instructions);
+            break;
+        case CPUInstrumentation::TRACE:
+            checked ? run_threaded_with<CHECKED, CPUInstrumentation::TRACE>(max_instructions)
+                    : run_threaded_with<UNCHECKED, CPUInstrumentation::TRACE>(max_instructions);
+            break;
+        case CPUInstrumentation::PROFILE:
+            checked ? run_threaded_with<CHECKED, CPUInstrumentation::PROFILE>(max_instructions)
+                    : run_threaded_with<UNCHECKED, CPUInstrumentation::PROFILE>(max_instructions);
+            break;
+    }
+}
+
+template <CPUCheckMode Mode, CPUInstrumentation Inst, bool Breakpoints>
+void CPUEngine::run_threaded_as(uint64_t max_instructions) {
+    constexpr bool checked = Mode == CPUCheckMode::CHECKED;
+    constexpr bool counted = Inst != CPUInstrumentation::BARE;
+    constexpr bool traced = Inst == CPUInstrumentation::TRACE;
+    constexpr bool profiled = Inst == CPUInstrumentation::PROFILE;
+    const MicroOp* ops = memory_.decoded_ptr();
+    const size_t program_size = memory_.rom_size();
+    uint64_t* executed_at = profiled ? profile_->executed_data() : nullptr;
+    uint64_t* jumps_at = profiled ? profile_->jumps_data() : nullptr;
+
+    // Working copies of the machine state, written back on every exit
+    Word a = a_register_;
+    Word d = d_register_;
+    Address pc = pc_;
+    CPUStats stats = stats_;
+    uint64_t budget_left = max_instructions;  // Not yet handed to a slice
+    uint64_t remaining = 0;                   // Left in the current slice
+    uint64_t slice_length = 0;                // Not yet folded into stats (BARE)
+    const MicroOp* op = nullptr;
+    CPUErrorCode fault = CPUErrorCode::NONE;
+    Address fault_address = 0;
+
+// Checks performed before every instruction, in the same order as
+// execute_instruction(), followed by the jump to the next handler. The
+// pause flag is only polled between slices (see next_slice).
+#if N2T_CPU_COMPUTED_GOTO
+#define N2T_CPU_JUMP() goto *handlers[handler_index(*op)]
+#else
+#define N2T_CPU_JUMP() goto dispatch_switch
+#endif
+
+// Instructions executed so far, including the unfolded part of the slice
+#define N2T_CPU_EXECUTED()                                                  \
+    (stats.instructions_executed + (counted ? 0 : slice_length - remaining))
+
+// Fold the current slice into stats.instructions_executed (BARE only)
+#define N2T_CPU_FOLD()                                                      \
+    do {                                                                    \
+        if (!counted) {                                                     \
+            stats.instructions_executed += slice_length - remaining;        \
+            slice_length = remaining;                                       \
+        }                                                                   \
+    } while (0)
+
+#define N2T_CPU_DISPATCH()                                                  \
+    do {                                                                    \
+        if (remaining == 0) goto next_slice;                                \
+        if (pc >= program_size) goto halted;                                \
+        if (Breakpoints && N2T_CPU_EXECUTED() > 0 &&                        \
+            breakpoints_.test(pc)) goto breakpoint_hit;                     \
+        op = &ops[pc];                                                      \
+        if (traced) trace_hook_(pc, a, d);                                  \
+        N2T_CPU_JUMP();                                                     \
+    } while (0)
+
+// Bookkeeping after an instruction completes
+#define N2T_CPU_RETIRE()                                                    \
+    do {                                                                    \
+        if (counted) stats.instructions_executed++;                         \
+        if (profiled) executed_at[op - ops]++;                              \
+        remaining--;                                                        \
+        if (pc >= program_size) goto halted;                                \
+        N2T_CPU_DISPATCH();                                                 \
+    } while (0)
+
+// Store the ALU output, evaluate the jump, retire. Same order as the
+// switch core so a failing M write leaves A/D exactly as it would there.
+#define N2T_CPU_COMPLETE(EXPR)                                              \
+    do {                                                                    \
+        Word out = static_cast<Word>(EXPR);                                 \
+        Word original_a = a;                                                \
+        if (op->dest & 0x4) a = out;                                        \
+        if (op->dest & 0x2) d = out;                                        \
+        if (op->dest & 0x1) {                                               \
+            if (checked && original_a >= CPUAddress::RAM_SIZE) {            \
+                fault = CPUErrorCode::RAM_WRITE_OUT_OF_RANGE;               \
+                fault_address = original_a;                                 \
+                goto error;                                                 \
+            }                                                               \
+            Address target = ram_address<Mode>(original_a);                 \
+            memory_.write_ram_unchecked(target, out);                       \
+            if (counted) stats.memory_writes++;                             \
+        }                                                                   \
+        if (op->jump && jump_taken(op->jump, out)) {                        \
+            pc = a;                                                         \
+            if (counted) stats.jump_count++;                                \
+            if (profiled) jumps_at[op - ops]++;                             \
+        } else {                                                            \
+            pc++;                                                           \
+        }                                                                   \
+        if (counted) stats.c_instruction_count++;                           \
+        N2T_CPU_RETIRE();                                                   \
+    } while (0)
+
+// One handler for the A-operand form and one for the M-operand form
+#define N2T_CPU_X_HANDLERS(NAME, EXPR)                                      \
+    op_##NAME##_A: {                                                        \
+        Word x = a;                                                         \
+        N2T_CPU_COMPLETE(EXPR);                                             \
+    }                                                                       \
+    op_##NAME##_M: {                                                        \
+        if (checked && a >= CPUAddress::RAM_SIZE) {                         \
+            fault = CPUErrorCode::RAM_READ_OUT_OF_RANGE;                    \
+            fault_address = a;                                              \
+            goto error;                                                     \
+        }                                                                   \
+        Word x = memory_.read_ram_unchecked(ram_address<Mode>(a));          \
+        if (counted) stats.memory_reads++;                                  \
+        N2T_CPU_COMPLETE(EXPR);                                             \
+    }
+
+    {
+#if N2T_CPU_COMPUTED_GOTO
+        static const void* const handlers[HANDLER_COUNT] = {
+            // Operand A (a-bit = 0)
+            &&op_LOAD_A,
+            &&op_ZERO, &&op_ONE, &&op_NEG_ONE, &&op_D, &&op_X_A,
+            &&op_NOT_D, &&op_NOT_X_A, &&op_NEG_D, &&op_NEG_X_A,
+            &&op_D_PLUS_1, &&op_X_PLUS_1_A, &&op_D_MINUS_1, &&op_X_MINUS_1_A,
+            &&op_D_PLUS_X_A, &&op_D_MINUS_X_A, &&op_X_MINUS_D_A,
+            &&op_D_AND_X_A, &&op_D_OR_X_A,
+            &&op_INVALID,
+            // Operand M (a-bit = 1); D-only and constant ops never read M
+            &&op_INVALID,
+            &&op_INVALID, &&op_INVALID, &&op_INVALID, &&op_INVALID, &&op_X_M,
+            &&op_INVALID, &&op_NOT_X_M, &&op_INVALID, &&op_NEG_X_M,
+            &&op_INVALID, &&op_X_PLUS_1_M, &&op_INVALID, &&op_X_MINUS_1_M,
+            &&op_D_PLUS_X_M, &&op_D_MINUS_X_M, &&op_X_MINUS_D_M,
+            &&op_D_AND_X_M, &&op_D_OR_X_M,
+            &&op_INVALID,
+        };
+#endif
+
+        // Run in slices of at most PAUSE_POLL_INTERVAL instructions, polling
+        // the pause flag (which only another thread can set) between them
+    next_slice:
+        N2T_CPU_FOLD();
+        if (budget_left == 0) goto budget_exhausted;
+        if (pc >= program_size) goto halted;
+        if (pause_requested_.load(std::memory_order_relaxed)) goto user_pause;
+        if (idle_detection_ && is_idle_loop(a, d, pc)) goto idle_loop;
+        remaining = std::min(budget_left, PAUSE_POLL_INTERVAL);
+        budget_left -= remaining;
+        slice_length = remaining;
+        N2T_CPU_DISPATCH();
+
+#if !N2T_CPU_COMPUTED_GOTO
+    dispatch_switch:
+        switch (handler_index(*op)) {
+            case static_cast<size_t>(AluOp::LOAD_A):    goto op_LOAD_A;
+            case static_cast<size_t>(AluOp::ZERO):      goto op_ZERO;
+            case static_cast<size_t>(AluOp::ONE):       goto op_ONE;
+            case static_cast<size_t>(AluOp::NEG_ONE):   goto op_NEG_ONE;
+            case static_cast<size_t>(AluOp::D):         goto op_D;
+            case static_cast<size_t>(AluOp::X):         goto op_X_A;
+            case static_cast<size_t>(AluOp::NOT_D):     goto op_NOT_D;
+            case static_cast<size_t>(AluOp::NOT_X):     goto op_NOT_X_A;
+            case static_cast<size_t>(AluOp::NEG_D):     goto op_NEG_D;
+            case static_cast<size_t>(AluOp::NEG_X):     goto op_NEG_X_A;
+            case static_cast<size_t>(AluOp::D_PLUS_1):  goto op_D_PLUS_1;
+            case static_cast<size_t>(AluOp::X_PLUS_1):  goto op_X_PLUS_1_A;
+            case static_cast<size_t>(AluOp::D_MINUS_1): goto op_D_MINUS_1;
+            case static_cast<size_t>(AluOp::X_MINUS_1): goto op_X_MINUS_1_A;
+            case static_cast<size_t>(AluOp::D_PLUS_X):  goto op_D_PLUS_X_A;
+            case static_cast<size_t>(AluOp::D_MINUS_X): goto op_D_MINUS_X_A;
+            case static_cast<size_t>(AluOp::X_MINUS_D): goto op_X_MINUS_D_A;
+            case static_cast<size_t>(AluOp::D_AND_X):   goto op_D_AND_X_A;
+            case static_cast<size_t>(AluOp::D_OR_X):    goto op_D_OR_X_A;
+            case M_OFFSET + static_cast<size_t>(AluOp::X):         goto op_X_M;
+            case M_OFFSET + static_cast<size_t>(AluOp::NOT_X):     goto op_NOT_X_M;
+            case M_OFFSET + static_cast<size_t>(AluOp::NEG_X):     goto op_NEG_X_M;
+            case M_OFFSET + static_cast<size_t>(AluOp::X_PLUS_1):  goto op_X_PLUS_1_M;
+            case M_OFFSET + static_cast<size_t>(AluOp::X_MINUS_1): goto op_X_MINUS_1_M;
+            case M_OFFSET + static_cast<size_t>(AluOp::D_PLUS_X):  goto op_D_PLUS_X_M;
+            case M_OFFSET + static_cast<size_t>(AluOp::D_MINUS_X): goto op_D_MINUS_X_M;
+            case M_OFFSET + static_cast<size_t>(AluOp::X_MINUS_D): goto op_X_MINUS_D_M;
+            case M_OFFSET + static_cast<size_t>(AluOp::D_AND_X):   goto op_D_AND_X_M;
+            case M_OFFSET + static_cast<size_t>(AluOp::D_OR_X):    goto op_D_OR_X_M;
+            default:                                               goto op_INVALID;
+        }
+#endif
+
+        // ---- A-instruction ----
+    op_LOAD_A:
+        a = op->value;
+        pc++;
+        if (counted) stats.a_instruction_count++;
+        N2T_CPU_RETIRE();
+
+        // ---- C-instructions that only use D or constants ----
+    op_ZERO:      N2T_CPU_COMPLETE(0);
+    op_ONE:       N2T_CPU_COMPLETE(1);
+    op_NEG_ONE:   N2T_CPU_COMPLETE(0xFFFF);
+    op_D:         N2T_CPU_COMPLETE(d);
+    op_NOT_D:     N2T_CPU_COMPLETE(~d);
+    op_NEG_D:     N2T_CPU_COMPLETE(-static_cast<int16_t>(d));
+    op_D_PLUS_1:  N2T_CPU_COMPLETE(static_cast<int16_t>(d) + 1);
+    op_D_MINUS_1: N2T_CPU_COMPLETE(static_cast<int16_t>(d) - 1);
+
+        // ---- C-instructions with an A or M operand ----
+        N2T_CPU_X_HANDLERS(X,         x)
+        N2T_CPU_X_HANDLERS(NOT_X,     ~x)
+        N2T_CPU_X_HANDLERS(NEG_X,     -static_cast<int16_t>(x))
+        N2T_CPU_X_HANDLERS(X_PLUS_1,  static_cast<int16_t>(x) + 1)
+        N2T_CPU_X_HANDLERS(X_MINUS_1, static_cast<int16_t>(x) - 1)
+        N2T_CPU_X_HANDLERS(D_PLUS_X,  static_cast<int16_t>(d) + static_cast<int16_t>(x))
+        N2T_CPU_X_HANDLERS(D_MINUS_X, static_cast<int16_t>(d) - static_cast<int16_t>(x))
+        N2T_CPU_X_HANDLERS(X_MINUS_D, static_cast<int16_t>(x) - static_cast<int16_t>(d))
+        N2T_CPU_X_HANDLERS(D_AND_X,   d & x)
+        N2T_CPU_X_HANDLERS(D_OR_X,    d | x)
+
+    op_INVALID:
+        fault = CPUErrorCode::INVALID_INSTRUCTION;
+        fault_address = pc;
+        goto error;
+
+        // ---- Exits ----
+    halted:
+        state_ = CPUState::HALTED;
+        goto done;
+
+    user_pause:
+        pause_requested_ = false;
+        state_ = CPUState::PAUSED;
+        pause_reason_ = CPUPauseReason::USER_REQUEST;
+        goto done;
+
+    breakpoint_hit:
+        state_ = CPUState::PAUSED;
+        pause_reason_ = CPUPauseReason::BREAKPOINT;
+        goto done;
+
+    idle_loop:
+        state_ = CPUState::PAUSED;
+        pause_reason_ = CPUPauseReason::IDLE_LOOP;
+        goto done;
+
+    error:
+    budget_exhausted:
+    done:
+        N2T_CPU_FOLD();
+    }
+
+#undef N2T_CPU_X_HANDLERS
+#undef N2T_CPU_COMPLETE
+#undef N2T_CPU_RETIRE
+#undef N2T_CPU_DISPATCH
+#undef N2T_CPU_FOLD
+#undef N2T_CPU_EXECUTED
+#undef N2T_CPU_JUMP
+
+    a_register_ = a;
+    d_register_ = d;
+    pc_ = pc;
+    stats_ = stats;
+
+    if (fault != CPUErrorCode::NONE) {
+        raise_error(fault, fault_address);
+    }
+}
+
+#if N2T_CPU_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+}  // namespace n2t
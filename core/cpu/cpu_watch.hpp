@@ -0,0 +1,136 @@
+// ==============================================================================
+// Hack CPU RAM Watchpoints
+// ==============================================================================
+// Read and write watchpoints on RAM addresses and ranges.
+//
+// Lookups are two bitmap tests: a page bitmap (one bit per 256-word page)
+// rejects accesses to unwatched pages, then a per-address bitmap decides.
+// Only M accesses are looked up, and only by the watched instantiation of
+// the execution core, which run() selects while any watchpoint is set; with
+// none set the cores are exactly the unwatched ones.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CPU_WATCH_HPP
+#define NAND2TETRIS_CPU_WATCH_HPP
+
+#include "memory.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace n2t {
+
+/**
+ * @brief Which accesses a watchpoint reports.
+ */
+enum class WatchKind : uint8_t {
+    READ   = 1,
+    WRITE  = 2,
+    ACCESS = 3,     // READ | WRITE
+};
+
+/**
+ * @brief A watched RAM range [first, last].
+ */
+struct Watchpoint {
+    Address first = 0;
+    Address last = 0;
+    WatchKind kind = WatchKind::WRITE;
+};
+
+/**
+ * @brief The access that paused a run with CPUPauseReason::WATCHPOINT.
+ *
+ * A write is reported even if it stores the value already there. An
+ * instruction that both reads and writes a watched word (M=M+1) reports
+ * the write.
+ */
+struct WatchHit {
+    Address address = 0;        // RAM address accessed
+    Address pc = 0;             // ROM address of the accessing instruction
+    WatchKind kind = WatchKind::WRITE;  // READ or WRITE
+    Word old_value = 0;         // Before the instruction
+    Word new_value = 0;         // After it (equal to old_value for a read)
+};
+
+/**
+ * @brief The set of watchpoints of one engine.
+ */
+class RamWatchpoints {
+public:
+    static constexpr size_t PAGE_SHIFT = 8;
+    static constexpr size_t PAGE_COUNT = CPUAddress::RAM_SIZE >> PAGE_SHIFT;
+
+    /**
+     * @brief Watch [first, last]; the part past the end of RAM is ignored.
+     */
+    void add(Address first, Address last, WatchKind kind) {
+        if (first > last || first >= CPUAddress::RAM_SIZE) return;
+        last = static_cast<Address>(std::min<size_t>(last, CPUAddress::RAM_SIZE - 1));
+        watchpoints_.push_back({first, last, kind});
+        rebuild();
+    }
+
+    /**
+     * @brief Remove every watchpoint on exactly [first, last].
+     *        Returns false if there was none.
+     */
+    bool remove(Address first, Address last) {
+        size_t before = watchpoints_.size();
+        watchpoints_.erase(std::remove_if(watchpoints_.begin(), watchpoints_.end(),
+                                          [&](const Watchpoint& w) {
+                                              return w.first == first && w.last == last;
+                                          }),
+                           watchpoints_.end());
+        if (watchpoints_.size() == before) return false;
+        rebuild();
+        return true;
+    }
+
+    void clear() {
+        watchpoints_.clear();
+        rebuild();
+    }
+
+    bool empty() const { return watchpoints_.empty(); }
+    const std::vector<Watchpoint>& list() const { return watchpoints_; }
+
+    bool watches_read(Address address) const {
+        return read_pages_.test(address >> PAGE_SHIFT) && reads_.test(address);
+    }
+
+    bool watches_write(Address address) const {
+        return write_pages_.test(address >> PAGE_SHIFT) && writes_.test(address);
+    }
+
+private:
+    void rebuild() {
+        read_pages_.clear();
+        write_pages_.clear();
+        reads_.clear();
+        writes_.clear();
+        for (const Watchpoint& w : watchpoints_) {
+            const bool read = static_cast<uint8_t>(w.kind) & static_cast<uint8_t>(WatchKind::READ);
+            const bool write = static_cast<uint8_t>(w.kind) & static_cast<uint8_t>(WatchKind::WRITE);
+            for (size_t a = w.first; a <= w.last; a++) {
+                if (read) {
+                    reads_.insert(a);
+                    read_pages_.insert(a >> PAGE_SHIFT);
+                }
+                if (write) {
+                    writes_.insert(a);
+                    write_pages_.insert(a >> PAGE_SHIFT);
+                }
+            }
+        }
+    }
+
+    std::vector<Watchpoint> watchpoints_;
+    AddressBitmap<PAGE_COUNT> read_pages_;
+    AddressBitmap<PAGE_COUNT> write_pages_;
+    AddressBitmap<CPUAddress::RAM_SIZE> reads_;
+    AddressBitmap<CPUAddress::RAM_SIZE> writes_;
+};
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CPU_WATCH_HPP
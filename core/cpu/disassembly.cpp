@@ -0,0 +1,36 @@
+// ==============================================================================
+// Hack CPU Disassembly Table Implementation
+// ==============================================================================
+
+#include "disassembly.hpp"
+#include "assembler.hpp"
+#include <algorithm>
+
+namespace n2t {
+
+DisassemblyTable::DisassemblyTable(const CPUProgram& program, const AsmSourceMap* source_map) {
+    const size_t size = program.size;
+    const bool from_source = source_map && source_map->text.size() == size;
+
+    offsets_.reserve(size + 1);
+    pool_.reserve(size * 8);
+    for (size_t a = 0; a < size; a++) {
+        offsets_.push_back(static_cast<uint32_t>(pool_.size()));
+        if (from_source) {
+            pool_ += source_map->text[a];
+        } else {
+            pool_ += instruction_to_string(program.rom[a]);
+        }
+        pool_ += '\n';
+    }
+    offsets_.push_back(static_cast<uint32_t>(pool_.size()));
+    pool_.shrink_to_fit();
+}
+
+std::string_view DisassemblyTable::window(Address start, Address end) const {
+    size_t last = std::min<size_t>(end, size());
+    if (start >= last) return {};
+    return std::string_view(pool_).substr(offsets_[start], offsets_[last] - offsets_[start] - 1);
+}
+
+}  // namespace n2t
@@ -0,0 +1,64 @@
+// ==============================================================================
+// Hack CPU Disassembly Table
+// ==============================================================================
+// The disassembly of a whole loaded program, formatted once and kept in one
+// contiguous string pool: every line followed by '\n', with an offset per
+// ROM address. Lines are served as string_views into the pool, and any
+// window of consecutive lines is itself a single view (lines joined by
+// '\n'), so a UI can fetch what it displays without building a string or
+// an array element per instruction.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_CPU_DISASSEMBLY_HPP
+#define NAND2TETRIS_CPU_DISASSEMBLY_HPP
+
+#include "memory.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace n2t {
+
+struct AsmSourceMap;
+
+class DisassemblyTable {
+public:
+    /**
+     * @brief Disassemble the program's first size instructions.
+     *
+     * @param source_map If given, each line is the instruction's .asm
+     *                   source text instead of its decoded form
+     */
+    explicit DisassemblyTable(const CPUProgram& program, const AsmSourceMap* source_map = nullptr);
+
+    size_t size() const { return offsets_.size() - 1; }
+
+    /**
+     * @brief One line (empty past the end of the program).
+     */
+    std::string_view line(Address address) const {
+        if (address >= size()) return {};
+        return std::string_view(pool_).substr(offsets_[address],
+                                              offsets_[address + 1] - offsets_[address] - 1);
+    }
+
+    /**
+     * @brief Lines [start, end), clipped to the program, joined by '\n'
+     *        (no trailing newline).
+     */
+    std::string_view window(Address start, Address end) const;
+
+    /**
+     * @brief Bytes held by the pool.
+     */
+    size_t pool_size() const { return pool_.size(); }
+
+private:
+    std::string pool_;
+    std::vector<uint32_t> offsets_;     // size() + 1 entries
+};
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_CPU_DISASSEMBLY_HPP
@@ -50,6 +50,47 @@ static constexpr std::array<bool, 128> make_valid_comp_table() {
 
 static constexpr auto VALID_COMP = make_valid_comp_table();
 
+// Static lookup table: ALU_HANDLER[i] is the handler for 7-bit comp code i.
+// Both a=0 and a=1 variants map to the same handler; invalid codes map
+// to AluOp::INVALID.
+static constexpr std::array<AluOp, 128> make_alu_handler_table() {
+    std::array<AluOp, 128> table{};
+    for (auto& entry : table) entry = AluOp::INVALID;
+    // a=0 computations
+    table[0b0101010] = AluOp::ZERO;
+    table[0b0111111] = AluOp::ONE;
+    table[0b0111010] = AluOp::NEG_ONE;
+    table[0b0001100] = AluOp::D;
+    table[0b0110000] = AluOp::X;          // A
+    table[0b0001101] = AluOp::NOT_D;
+    table[0b0110001] = AluOp::NOT_X;      // !A
+    table[0b0001111] = AluOp::NEG_D;
+    table[0b0110011] = AluOp::NEG_X;      // -A
+    table[0b0011111] = AluOp::D_PLUS_1;
+    table[0b0110111] = AluOp::X_PLUS_1;   // A+1
+    table[0b0001110] = AluOp::D_MINUS_1;
+    table[0b0110010] = AluOp::X_MINUS_1;  // A-1
+    table[0b0000010] = AluOp::D_PLUS_X;   // D+A
+    table[0b0010011] = AluOp::D_MINUS_X;  // D-A
+    table[0b0000111] = AluOp::X_MINUS_D;  // A-D
+    table[0b0000000] = AluOp::D_AND_X;    // D&A
+    table[0b0010101] = AluOp::D_OR_X;     // D|A
+    // a=1 computations
+    table[0b1110000] = AluOp::X;          // M
+    table[0b1110001] = AluOp::NOT_X;      // !M
+    table[0b1110011] = AluOp::NEG_X;      // -M
+    table[0b1110111] = AluOp::X_PLUS_1;   // M+1
+    table[0b1110010] = AluOp::X_MINUS_1;  // M-1
+    table[0b1000010] = AluOp::D_PLUS_X;   // D+M
+    table[0b1010011] = AluOp::D_MINUS_X;  // D-M
+    table[0b1000111] = AluOp::X_MINUS_D;  // M-D
+    table[0b1000000] = AluOp::D_AND_X;    // D&M
+    table[0b1010101] = AluOp::D_OR_X;     // D|M
+    return table;
+}
+
+static constexpr auto ALU_HANDLER = make_alu_handler_table();
+
 // ==============================================================================
 // Computation to String Table
 // ==============================================================================
@@ -162,6 +203,27 @@ bool is_valid_computation(uint8_t comp_bits) {
     return VALID_COMP[comp_bits];
 }
 
+// ==============================================================================
+// Predecoding
+// ==============================================================================
+
+MicroOp predecode_instruction(Word instruction) {
+    MicroOp op;
+
+    if (!(instruction & 0x8000)) {
+        op.op = AluOp::LOAD_A;
+        op.value = instruction & 0x7FFF;
+        return op;
+    }
+
+    uint8_t comp_bits = static_cast<uint8_t>((instruction >> 6) & 0x7F);
+    op.op = ALU_HANDLER[comp_bits];
+    op.dest = static_cast<uint8_t>((instruction >> 3) & 0x7);
+    op.jump = static_cast<uint8_t>(instruction & 0x7);
+    op.reads_m = (comp_bits & 0x40) != 0;
+    return op;
+}
+
 // ==============================================================================
 // Disassembly
 // ==============================================================================
@@ -11,8 +11,9 @@
 //   1. Load-time validation (decode_instruction_checked)
 //   2. Debug/disassembly (instruction_to_string)
 //
-// The hot execution loop in CPUEngine does inline bit extraction for
-// performance rather than going through the DecodedInstruction struct.
+// The hot execution loop in CPUEngine does not decode at all: each ROM
+// word is predecoded once at load time into a compact MicroOp record
+// (predecode_instruction), and the loop dispatches on that table.
 // ==============================================================================
 
 #ifndef NAND2TETRIS_CPU_INSTRUCTION_HPP
@@ -119,7 +120,7 @@ enum class JumpCondition : uint8_t {
  * @brief A decoded Hack instruction.
  *
  * Used for debugging, disassembly, and load-time validation.
- * The hot execution loop does inline bit extraction instead.
+ * The hot execution loop uses the predecoded MicroOp table instead.
  */
 struct DecodedInstruction {
     InstructionType type;
@@ -170,6 +171,107 @@ std::string instruction_to_string(const DecodedInstruction& instr);
  */
 std::string instruction_to_string(Word raw_instruction);
 
+// ==============================================================================
+// Predecoded Micro-Ops
+// ==============================================================================
+
+/**
+ * @brief ALU handler selected at load time.
+ *
+ * The 28 Hack computations collapse to 18 handlers because the a-bit only
+ * chooses the second ALU operand (A or M); that choice is carried separately
+ * in MicroOp::reads_m. "X" below stands for "A or M".
+ */
+enum class AluOp : uint8_t {
+    LOAD_A,     // A-instruction: A = value (no ALU involvement)
+    ZERO,       // 0
+    ONE,        // 1
+    NEG_ONE,    // -1
+    D,          // D
+    X,          // A / M
+    NOT_D,      // !D
+    NOT_X,      // !A / !M
+    NEG_D,      // -D
+    NEG_X,      // -A / -M
+    D_PLUS_1,   // D+1
+    X_PLUS_1,   // A+1 / M+1
+    D_MINUS_1,  // D-1
+    X_MINUS_1,  // A-1 / M-1
+    D_PLUS_X,   // D+A / D+M
+    D_MINUS_X,  // D-A / D-M
+    X_MINUS_D,  // A-D / M-D
+    D_AND_X,    // D&A / D&M
+    D_OR_X,     // D|A / D|M
+    INVALID     // Unrecognized comp bits — a runtime error when executed
+};
+
+/**
+ * @brief One ROM word, decoded once at load time for the execution loop.
+ *
+ * The masks keep the bit layout of the instruction:
+ *   dest: 0x4 = A, 0x2 = D, 0x1 = M
+ *   jump: 0x4 = jump if out < 0, 0x2 = if out == 0, 0x1 = if out > 0
+ */
+struct MicroOp {
+    Word value = 0;              // A-instruction immediate
+    AluOp op = AluOp::LOAD_A;    // ALU handler (LOAD_A for A-instructions)
+    uint8_t dest = 0;            // Destination mask
+    uint8_t jump = 0;            // Jump condition mask
+    bool reads_m = false;        // true if the ALU's X operand is M = RAM[A]
+};
+
+/**
+ * @brief Predecode a raw instruction word into a MicroOp.
+ *
+ * Never throws: invalid computation codes become AluOp::INVALID so that
+ * the error is reported only if the instruction is actually executed.
+ */
+MicroOp predecode_instruction(Word instruction);
+
+/**
+ * @brief Evaluate an ALU handler on D and X (A or M).
+ *
+ * LOAD_A and INVALID are not ALU operations and return 0; callers
+ * dispatch on those before reaching the ALU.
+ */
+inline Word evaluate_alu(AluOp op, Word d_val, Word x_val) {
+    int16_t d = static_cast<int16_t>(d_val);
+    int16_t x = static_cast<int16_t>(x_val);
+    switch (op) {
+        case AluOp::ZERO:      return 0;
+        case AluOp::ONE:       return 1;
+        case AluOp::NEG_ONE:   return 0xFFFF;
+        case AluOp::D:         return d_val;
+        case AluOp::X:         return x_val;
+        case AluOp::NOT_D:     return static_cast<Word>(~d_val);
+        case AluOp::NOT_X:     return static_cast<Word>(~x_val);
+        case AluOp::NEG_D:     return static_cast<Word>(-d);
+        case AluOp::NEG_X:     return static_cast<Word>(-x);
+        case AluOp::D_PLUS_1:  return static_cast<Word>(d + 1);
+        case AluOp::X_PLUS_1:  return static_cast<Word>(x + 1);
+        case AluOp::D_MINUS_1: return static_cast<Word>(d - 1);
+        case AluOp::X_MINUS_1: return static_cast<Word>(x - 1);
+        case AluOp::D_PLUS_X:  return static_cast<Word>(d + x);
+        case AluOp::D_MINUS_X: return static_cast<Word>(d - x);
+        case AluOp::X_MINUS_D: return static_cast<Word>(x - d);
+        case AluOp::D_AND_X:   return static_cast<Word>(d_val & x_val);
+        case AluOp::D_OR_X:    return static_cast<Word>(d_val | x_val);
+        default:               return 0;
+    }
+}
+
+/**
+ * @brief Evaluate a jjj mask against an ALU output (signed 16-bit).
+ *
+ * Selects the lt/eq/gt bit that matches the output's sign and tests it
+ * against the mask, so all eight conditions share one code path.
+ */
+inline bool jump_taken(uint8_t jump, Word alu_output) {
+    int16_t val = static_cast<int16_t>(alu_output);
+    uint8_t sign_bit = (val < 0) ? 0x4 : (val == 0) ? 0x2 : 0x1;
+    return (jump & sign_bit) != 0;
+}
+
 }  // namespace n2t
 
 #endif  // NAND2TETRIS_CPU_INSTRUCTION_HPP
@@ -3,6 +3,8 @@
 // ==============================================================================
 
 #include "memory.hpp"
+#include "rom_image.hpp"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
@@ -18,10 +20,9 @@ CPUMemory::CPUMemory() {
 }
 
 void CPUMemory::reset() {
-    rom_.fill(0);
+    load_program(empty_program());
     ram_.fill(0);
-    program_size_ = 0;
-    screen_dirty_ = false;
+    mark_screen_dirty();
 }
 
 // ==============================================================================
@@ -29,49 +30,58 @@ void CPUMemory::reset() {
 // ==============================================================================
 
 void CPUMemory::load_rom_file(const std::string& file_path) {
-    std::ifstream file(file_path);
+    load_program(empty_program());
+    load_program(read_program_file(file_path));
+}
+
+void CPUMemory::save_rom_binary(const std::string& file_path) const {
+    std::ofstream file(file_path, std::ios::binary);
     if (!file.is_open()) {
-        throw FileError(file_path, "Could not open .hack file for reading");
+        throw FileError(file_path, "Could not open .hackb file for writing");
+    }
+    std::string image = encode_hack_binary(program_->rom.data(), program_size_);
+    file.write(image.data(), static_cast<std::streamsize>(image.size()));
+    if (!file) {
+        throw FileError(file_path, "Could not write .hackb file");
     }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    load_rom_string(buffer.str());
 }
 
 void CPUMemory::load_rom_string(const std::string& hack_text) {
-    rom_.fill(0);
-    program_size_ = 0;
-
-    std::istringstream stream(hack_text);
-    std::string line;
-    size_t line_number = 0;
-
-    while (std::getline(stream, line)) {
-        line_number++;
+    // A failed load leaves an empty ROM, never a partial one
+    load_program(empty_program());
+    load_program(parse_program(hack_text));
+}
 
-        // Trim trailing whitespace/CR
-        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
-            line.pop_back();
-        }
+void CPUMemory::load_rom(const std::vector<Word>& instructions) {
+    load_program(empty_program());
+    load_program(make_program(instructions));
+}
 
-        // Skip empty lines
-        if (line.empty()) continue;
+void CPUMemory::load_program(std::shared_ptr<const CPUProgram> program) {
+    program_ = std::move(program);
+    decoded_ = program_->decoded.data();
+    program_size_ = program_->size;
+    rom_generation_++;
+}
 
-        if (program_size_ >= CPUAddress::ROM_SIZE) {
-            throw ParseError("<rom>", line_number,
-                "Program too large! ROM can hold at most " +
-                std::to_string(CPUAddress::ROM_SIZE) + " instructions.");
-        }
+std::shared_ptr<const CPUProgram> CPUMemory::empty_program() {
+    static const std::shared_ptr<const CPUProgram> empty = make_program({});
+    return empty;
+}
 
-        rom_[program_size_] = parse_binary_line(line, line_number);
-        program_size_++;
-    }
+std::shared_ptr<const CPUProgram> CPUMemory::parse_program(const std::string& hack_text) {
+    auto program = std::make_shared<CPUProgram>();
+    size_t size = parse_hack_text(hack_text.data(), hack_text.size(), program->rom.data());
+    return finish_program(std::move(program), size);
 }
 
-void CPUMemory::load_rom(const std::vector<Word>& instructions) {
-    rom_.fill(0);
+std::shared_ptr<const CPUProgram> CPUMemory::read_program_file(const std::string& file_path) {
+    auto program = std::make_shared<CPUProgram>();
+    size_t size = read_rom_file(file_path, program->rom.data());
+    return finish_program(std::move(program), size);
+}
 
+std::shared_ptr<const CPUProgram> CPUMemory::make_program(const std::vector<Word>& instructions) {
     if (instructions.size() > CPUAddress::ROM_SIZE) {
         throw RuntimeError(
             "Program too large! ROM can hold at most " +
@@ -79,33 +89,20 @@ void CPUMemory::load_rom(const std::vector<Word>& instructions) {
             std::to_string(instructions.size()) + ".");
     }
 
-    for (size_t i = 0; i < instructions.size(); i++) {
-        rom_[i] = instructions[i];
-    }
-    program_size_ = instructions.size();
+    auto program = std::make_shared<CPUProgram>();
+    std::copy(instructions.begin(), instructions.end(), program->rom.begin());
+    return finish_program(std::move(program), instructions.size());
 }
 
-Word CPUMemory::parse_binary_line(const std::string& line, size_t line_number) {
-    if (line.length() != 16) {
-        throw ParseError("<rom>", line_number,
-            "Expected 16-bit binary instruction (16 characters of '0' and '1'), "
-            "got " + std::to_string(line.length()) + " characters: \"" + line + "\"");
-    }
-
-    Word result = 0;
-    for (size_t i = 0; i < 16; i++) {
-        char c = line[i];
-        if (c == '1') {
-            result |= static_cast<Word>(1 << (15 - i));
-        } else if (c != '0') {
-            throw ParseError("<rom>", line_number,
-                "Invalid character '" + std::string(1, c) +
-                "' at position " + std::to_string(i + 1) +
-                ". Only '0' and '1' are allowed in .hack files.");
-        }
+std::shared_ptr<const CPUProgram> CPUMemory::finish_program(
+        std::shared_ptr<CPUProgram> program, size_t size) {
+    // ROM and its micro-op table are built together, so they always match
+    program->decoded.fill(predecode_instruction(0));
+    for (size_t i = 0; i < size; i++) {
+        program->decoded[i] = predecode_instruction(program->rom[i]);
     }
-
-    return result;
+    program->size = size;
+    return program;
 }
 
 // ==============================================================================
@@ -118,7 +115,7 @@ Word CPUMemory::read_rom(Address address) const {
             "ROM access out of bounds: address " + std::to_string(address) +
             ". Valid range is 0-" + std::to_string(CPUAddress::ROM_SIZE - 1) + ".");
     }
-    return rom_[address];
+    return program_->rom[address];
 }
 
 // ==============================================================================
@@ -127,29 +124,35 @@ Word CPUMemory::read_rom(Address address) const {
 
 Word CPUMemory::read_ram(Address address) const {
     if (address >= CPUAddress::RAM_SIZE) {
-        throw RuntimeError(
-            "Cannot read RAM at address " + std::to_string(address) +
-            ". Valid range is 0-32767 (32K). "
-            "The A register may contain an out-of-bounds value.");
+        throw RuntimeError(read_error_message(address));
     }
     return ram_[address];
 }
 
 void CPUMemory::write_ram(Address address, Word value) {
     if (address >= CPUAddress::RAM_SIZE) {
-        throw RuntimeError(
-            "Cannot write to RAM at address " + std::to_string(address) +
-            ". Valid range is 0-32767 (32K). "
-            "The A register may contain an out-of-bounds value.");
+        throw RuntimeError(write_error_message(address));
     }
 
-    ram_[address] = value;
+    // Also tracks screen modifications
+    write_ram_unchecked(address, value);
+}
 
-    // Track screen modifications
-    if (address >= CPUAddress::SCREEN_BASE &&
-        address < CPUAddress::SCREEN_BASE + CPUAddress::SCREEN_SIZE) {
-        screen_dirty_ = true;
-    }
+void CPUMemory::load_ram(const Word* values) {
+    std::copy(values, values + CPUAddress::RAM_SIZE, ram_.begin());
+    mark_screen_dirty();
+}
+
+std::string CPUMemory::read_error_message(Address address) {
+    return "Cannot read RAM at address " + std::to_string(address) +
+           ". Valid range is 0-32767 (32K). "
+           "The A register may contain an out-of-bounds value.";
+}
+
+std::string CPUMemory::write_error_message(Address address) {
+    return "Cannot write to RAM at address " + std::to_string(address) +
+           ". Valid range is 0-32767 (32K). "
+           "The A register may contain an out-of-bounds value.";
 }
 
 // ==============================================================================
@@ -182,7 +185,30 @@ void CPUMemory::set_pixel(int x, int y, bool on) {
     } else {
         ram_[addr] &= static_cast<Word>(~(1 << bit_offset));
     }
-    screen_dirty_ = true;
+    mark_screen_row(static_cast<size_t>(y));
+}
+
+std::vector<uint8_t> CPUMemory::take_dirty_rows() {
+    std::vector<uint8_t> rows;
+    for (size_t w = 0; w < dirty_rows_.size(); w++) {
+        uint64_t bits = dirty_rows_[w];
+        dirty_rows_[w] = 0;
+        for (size_t offset = 0; bits != 0; offset++, bits >>= 1) {
+            if (bits & 1) rows.push_back(static_cast<uint8_t>(w * 64 + offset));
+        }
+    }
+    return rows;
+}
+
+ScreenDelta CPUMemory::take_screen_delta() {
+    ScreenDelta delta;
+    delta.rows = take_dirty_rows();
+    delta.words.reserve(delta.rows.size() * CPUAddress::SCREEN_ROW_WORDS);
+    for (uint8_t row : delta.rows) {
+        const Word* start = screen_buffer() + row * CPUAddress::SCREEN_ROW_WORDS;
+        delta.words.insert(delta.words.end(), start, start + CPUAddress::SCREEN_ROW_WORDS);
+    }
+    return delta;
 }
 
 // ==============================================================================
@@ -218,7 +244,7 @@ std::string CPUMemory::dump_state() const {
         }
     }
 
-    oss << "\nScreen dirty: " << (screen_dirty_ ? "yes" : "no") << "\n";
+    oss << "\nScreen dirty: " << (screen_dirty() ? "yes" : "no") << "\n";
     oss << "Keyboard: " << ram_[CPUAddress::KEYBOARD] << "\n";
 
     return oss.str();
@@ -2,7 +2,9 @@
 // CPU Memory System
 // ==============================================================================
 // Manages the Hack computer's memory subsystems:
-//   - ROM (32K): Read-only instruction memory, loaded from .hack files
+//   - ROM (32K): Read-only instruction memory, loaded from .hack files.
+//     A loaded ROM is an immutable CPUProgram that several CPUMemory
+//     instances can share (see CPUFarm).
 //   - RAM (32K): Read/write data memory
 //   - Screen (memory-mapped): 256x512 pixels at addresses 16384-24575
 //   - Keyboard (memory-mapped): Currently pressed key at address 24576
@@ -17,7 +19,10 @@
 
 #include "types.hpp"
 #include "error.hpp"
+#include "instruction.hpp"
+#include "address_bitmap.hpp"
 #include <array>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -44,6 +49,8 @@ namespace CPUAddress {
     // Screen memory-mapped I/O
     constexpr Address SCREEN_BASE = 16384;
     constexpr size_t  SCREEN_SIZE = 8192;  // 256 rows * 32 words/row
+    constexpr size_t  SCREEN_ROWS = 256;
+    constexpr size_t  SCREEN_ROW_WORDS = 32;
 
     // Keyboard memory-mapped I/O
     constexpr Address KEYBOARD = 24576;
@@ -53,6 +60,42 @@ namespace CPUAddress {
     constexpr size_t ROM_SIZE = 32768;  // 32K instructions
 }
 
+/**
+ * @brief One bit per ROM address (breakpoints, block boundaries).
+ */
+using RomBitmap = AddressBitmap<CPUAddress::ROM_SIZE>;
+
+// ==============================================================================
+// Loaded Program
+// ==============================================================================
+
+/**
+ * @brief A loaded ROM image and its predecoded micro-ops.
+ *
+ * Immutable once built, so one program can back any number of CPUMemory
+ * instances at once. Addresses past `size` hold zeros (@0).
+ */
+struct CPUProgram {
+    std::array<Word, CPUAddress::ROM_SIZE> rom{};
+    std::array<MicroOp, CPUAddress::ROM_SIZE> decoded{};
+    size_t size = 0;
+};
+
+// ==============================================================================
+// Screen Delta
+// ==============================================================================
+
+/**
+ * @brief The screen rows written since the last take_screen_delta().
+ *
+ * rows lists the row numbers (0-255) in ascending order; words holds
+ * SCREEN_ROW_WORDS words per listed row, in the same order.
+ */
+struct ScreenDelta {
+    std::vector<uint8_t> rows;
+    std::vector<Word> words;
+};
+
 // ==============================================================================
 // CPU Memory Class
 // ==============================================================================
@@ -81,17 +124,26 @@ public:
     // =========================================================================
 
     /**
-     * @brief Load a program from a .hack file.
+     * @brief Load a program from a .hack or .hackb file.
      *
      * A .hack file contains one instruction per line, each as a
-     * 16-character string of '0' and '1' characters.
+     * 16-character string of '0' and '1' characters. A .hackb file is
+     * the binary image written by save_rom_binary() (see rom_image.hpp);
+     * the format is detected from the file's first bytes.
      *
-     * @param file_path Path to the .hack file
+     * @param file_path Path to the .hack/.hackb file
      * @throws FileError if file cannot be read
      * @throws ParseError if file contains invalid instructions
      */
     void load_rom_file(const std::string& file_path);
 
+    /**
+     * @brief Write the loaded program as a .hackb binary image.
+     *
+     * @throws FileError if the file cannot be written
+     */
+    void save_rom_binary(const std::string& file_path) const;
+
     /**
      * @brief Load a program from a string of binary lines.
      *
@@ -105,6 +157,38 @@ public:
      */
     void load_rom(const std::vector<Word>& instructions);
 
+    /**
+     * @brief Use an already built program (shared, never copied).
+     */
+    void load_program(std::shared_ptr<const CPUProgram> program);
+
+    /**
+     * @brief The program currently in ROM.
+     */
+    const std::shared_ptr<const CPUProgram>& program() const { return program_; }
+
+    /**
+     * @brief Build a program from .hack text without loading it.
+     *
+     * @throws ParseError if text contains invalid instructions
+     */
+    static std::shared_ptr<const CPUProgram> parse_program(const std::string& hack_text);
+
+    /**
+     * @brief Build a program from a .hack or .hackb file without loading it.
+     *
+     * @throws FileError if file cannot be read
+     * @throws ParseError if file contains invalid instructions
+     */
+    static std::shared_ptr<const CPUProgram> read_program_file(const std::string& file_path);
+
+    /**
+     * @brief Build a program from instruction words without loading it.
+     *
+     * @throws RuntimeError if there are more than ROM_SIZE instructions
+     */
+    static std::shared_ptr<const CPUProgram> make_program(const std::vector<Word>& instructions);
+
     /**
      * @brief Read an instruction from ROM.
      */
@@ -118,7 +202,23 @@ public:
     /**
      * @brief Get raw ROM pointer for disassembly views.
      */
-    const Word* rom_ptr() const { return rom_.data(); }
+    const Word* rom_ptr() const { return program_->rom.data(); }
+
+    /**
+     * @brief Get the predecoded micro-op table (one entry per ROM word).
+     *
+     * Rebuilt by every load_rom* call, so it always matches the ROM.
+     * This is what the CPUEngine execution loop dispatches on.
+     */
+    const MicroOp* decoded_ptr() const { return decoded_; }
+
+    /**
+     * @brief Counter bumped every time the ROM is cleared or reloaded.
+     *
+     * Caches derived from the ROM (such as translated code) compare this
+     * against the generation they were built for.
+     */
+    uint64_t rom_generation() const { return rom_generation_; }
 
     // =========================================================================
     // RAM (Data Memory)
@@ -142,11 +242,51 @@ public:
      */
     void write_ram(Address address, Word value);
 
+    /**
+     * @brief Read RAM without a bounds check; requires address < RAM_SIZE.
+     */
+    Word read_ram_unchecked(Address address) const { return ram_[address]; }
+
+    /**
+     * @brief Write RAM without a bounds check; requires address < RAM_SIZE.
+     *
+     * Screen dirty tracking still applies.
+     */
+    void write_ram_unchecked(Address address, Word value) {
+        ram_[address] = value;
+        size_t offset = static_cast<size_t>(address) - CPUAddress::SCREEN_BASE;
+        if (offset < CPUAddress::SCREEN_SIZE) {
+            mark_screen_row(offset / CPUAddress::SCREEN_ROW_WORDS);
+        }
+    }
+
+    /**
+     * @brief Error messages used by read_ram()/write_ram() (and by
+     *        execution cores that report errors without throwing).
+     */
+    static std::string read_error_message(Address address);
+    static std::string write_error_message(Address address);
+
+    /**
+     * @brief Replace all of RAM (RAM_SIZE words), e.g. from a snapshot.
+     *
+     * Marks the screen dirty, since any of it may have changed.
+     */
+    void load_ram(const Word* values);
+
     /**
      * @brief Get raw RAM pointer for bulk access.
      */
     const Word* ram_ptr() const { return ram_.data(); }
 
+    /**
+     * @brief Get writable RAM pointer for execution backends.
+     *
+     * Writes through this pointer bypass bounds checks and screen dirty
+     * tracking, so callers must only use it for addresses below SCREEN_BASE.
+     */
+    Word* ram_ptr() { return ram_.data(); }
+
     // =========================================================================
     // I/O (Screen + Keyboard)
     // =========================================================================
@@ -181,12 +321,37 @@ public:
     /**
      * @brief Check if screen memory was modified since last check.
      */
-    bool screen_dirty() const { return screen_dirty_; }
+    bool screen_dirty() const {
+        return (dirty_rows_[0] | dirty_rows_[1] | dirty_rows_[2] | dirty_rows_[3]) != 0;
+    }
+
+    /**
+     * @brief Check if one screen row (0-255) was modified since last check.
+     */
+    bool screen_row_dirty(size_t row) const {
+        return row < CPUAddress::SCREEN_ROWS &&
+               (dirty_rows_[row >> 6] & (uint64_t{1} << (row & 63))) != 0;
+    }
+
+    /**
+     * @brief Clear the dirty flag of every screen row.
+     */
+    void clear_screen_dirty() { dirty_rows_.fill(0); }
 
     /**
-     * @brief Clear the screen dirty flag.
+     * @brief Rows modified since the last call, in ascending order; clears
+     *        their dirty flags in the same call.
      */
-    void clear_screen_dirty() { screen_dirty_ = false; }
+    std::vector<uint8_t> take_dirty_rows();
+
+    /**
+     * @brief Like take_dirty_rows(), together with the current contents of
+     *        those rows, so a renderer can update only what changed.
+     *
+     * reset() and load_ram() mark the whole screen dirty, so the first
+     * delta after either is a full frame.
+     */
+    ScreenDelta take_screen_delta();
 
     // =========================================================================
     // Debugging
@@ -198,15 +363,34 @@ public:
     std::string dump_state() const;
 
 private:
-    std::array<Word, CPUAddress::ROM_SIZE> rom_;
+    std::shared_ptr<const CPUProgram> program_;
     std::array<Word, CPUAddress::RAM_SIZE> ram_;
+
+    // Cached from program_ for the execution loop
+    const MicroOp* decoded_ = nullptr;
     size_t program_size_ = 0;
-    bool screen_dirty_ = false;
+
+    uint64_t rom_generation_ = 0;
+
+    // One bit per screen row, set by every write into the screen
+    std::array<uint64_t, CPUAddress::SCREEN_ROWS / 64> dirty_rows_{};
+
+    void mark_screen_row(size_t row) {
+        dirty_rows_[row >> 6] |= uint64_t{1} << (row & 63);
+    }
+
+    void mark_screen_dirty() { dirty_rows_.fill(~uint64_t{0}); }
+
+    /**
+     * @brief Shared all-zero program used after reset().
+     */
+    static std::shared_ptr<const CPUProgram> empty_program();
 
     /**
-     * @brief Parse a single line of binary text into a Word.
+     * @brief Predecode the first size ROM words and seal the program.
      */
-    Word parse_binary_line(const std::string& line, size_t line_number);
+    static std::shared_ptr<const CPUProgram> finish_program(
+        std::shared_ptr<CPUProgram> program, size_t size);
 };
 
 }  // namespace n2t
@@ -0,0 +1,269 @@
+// ==============================================================================
+// Hack ROM Images Implementation
+// ==============================================================================
+
+#include "rom_image.hpp"
+#include "memory.hpp"
+#include "error.hpp"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define N2T_ROM_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define N2T_ROM_MMAP 0
+#endif
+
+namespace n2t {
+
+namespace {
+
+// ==============================================================================
+// .hack Line Kernel
+// ==============================================================================
+
+constexpr uint64_t ONES = 0x0101010101010101ULL;
+constexpr uint64_t ASCII_ZEROS = 0x3030303030303030ULL;   // "00000000"
+
+inline uint64_t load_le64(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+/**
+ * @brief Convert 8 characters (first = most significant) to 8 bits.
+ *
+ * Every byte must be '0' (0x30) or '1' (0x31), i.e. equal 0x30 once bit 0
+ * is masked off. Bit 0 of byte i is then multiplied up to bit 63 - i; no
+ * two partial products overlap, so nothing carries into the top byte.
+ */
+inline bool pack8(const char* p, uint32_t& bits) {
+    uint64_t v = load_le64(p);
+    bits = static_cast<uint32_t>(((v & ONES) * 0x8040201008040201ULL) >> 56);
+    return (v & ~ONES) == ASCII_ZEROS;
+}
+
+/**
+ * @brief Slow path for a line the kernel rejected; always throws the
+ *        same message the line-by-line parser used to.
+ */
+[[noreturn]] void reject_line(const char* line, size_t length, size_t line_number) {
+    if (length != 16) {
+        throw ParseError("<rom>", line_number,
+            "Expected 16-bit binary instruction (16 characters of '0' and '1'), "
+            "got " + std::to_string(length) + " characters: \"" +
+            std::string(line, length) + "\"");
+    }
+    size_t i = 0;
+    while (i < 16 && (line[i] == '0' || line[i] == '1')) i++;
+    throw ParseError("<rom>", line_number,
+        "Invalid character '" + std::string(1, line[i]) +
+        "' at position " + std::to_string(i + 1) +
+        ". Only '0' and '1' are allowed in .hack files.");
+}
+
+// ==============================================================================
+// File Mapping
+// ==============================================================================
+
+/**
+ * @brief Read-only view of a whole file: mapped where mmap exists,
+ *        read into a buffer elsewhere.
+ */
+class FileView {
+public:
+    explicit FileView(const std::string& file_path) {
+#if N2T_ROM_MMAP
+        int fd = ::open(file_path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw FileError(file_path, "Could not open .hack file for reading");
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw FileError(file_path, "Could not open .hack file for reading");
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data_ = static_cast<const char*>(mapped);
+                mapped_ = true;
+            }
+        }
+        ::close(fd);
+        if (mapped_ || size_ == 0) return;
+#endif
+        // No mmap (or it failed, e.g. on a pipe): read the whole file
+        std::ifstream file(file_path, std::ios::binary);
+        if (!file.is_open()) {
+            throw FileError(file_path, "Could not open .hack file for reading");
+        }
+        buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+
+    ~FileView() {
+#if N2T_ROM_MMAP
+        if (mapped_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<char> buffer_;
+};
+
+}  // namespace
+
+// ==============================================================================
+// .hack Text
+// ==============================================================================
+
+size_t parse_hack_text(const char* text, size_t length, Word* rom) {
+    const char* p = text;
+    const char* end = text + length;
+    size_t count = 0;
+    size_t line_number = 0;
+
+    while (p < end) {
+        line_number++;
+
+        // Almost every line is exactly 16 characters and a newline. Only
+        // form p + 16 once it is known to be inside the text.
+        const size_t remaining = static_cast<size_t>(end - p);
+        const char* eol = nullptr;
+        if (remaining > 16 && p[16] == '\n') {
+            eol = p + 16;
+        } else {
+            eol = static_cast<const char*>(std::memchr(p, '\n', remaining));
+            if (!eol) eol = end;
+        }
+
+        // Trim trailing whitespace/CR
+        const char* last = eol;
+        while (last > p && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t')) {
+            last--;
+        }
+        size_t line_length = static_cast<size_t>(last - p);
+
+        if (line_length > 0) {
+            if (count >= CPUAddress::ROM_SIZE) {
+                throw ParseError("<rom>", line_number,
+                    "Program too large! ROM can hold at most " +
+                    std::to_string(CPUAddress::ROM_SIZE) + " instructions.");
+            }
+
+            uint32_t high = 0;
+            uint32_t low = 0;
+            bool valid = line_length == 16;
+            if (valid) {
+                valid = pack8(p, high) & pack8(p + 8, low);
+            }
+            if (!valid) reject_line(p, line_length, line_number);
+
+            rom[count++] = static_cast<Word>((high << 8) | low);
+        }
+
+        p = (eol == end) ? end : eol + 1;
+    }
+
+    return count;
+}
+
+// ==============================================================================
+// .hackb Binary
+// ==============================================================================
+
+bool is_hack_binary(const char* data, size_t length) {
+    return length >= sizeof(HackBinary::MAGIC) &&
+           std::memcmp(data, HackBinary::MAGIC, sizeof(HackBinary::MAGIC)) == 0;
+}
+
+size_t parse_hack_binary(const char* data, size_t length, Word* rom) {
+    auto u16 = [data](size_t offset) {
+        return static_cast<uint16_t>(static_cast<uint8_t>(data[offset]) |
+                                     static_cast<uint8_t>(data[offset + 1]) << 8);
+    };
+
+    if (length < HackBinary::HEADER_SIZE || !is_hack_binary(data, length)) {
+        throw ParseError("Not a .hackb ROM image (missing \"HACK\" header).");
+    }
+    if (u16(4) != HackBinary::VERSION) {
+        throw ParseError("Unsupported .hackb version " + std::to_string(u16(4)) +
+                         " (expected " + std::to_string(HackBinary::VERSION) + ").");
+    }
+
+    size_t count = u16(6);
+    if (count > CPUAddress::ROM_SIZE) {
+        throw ParseError("Program too large! ROM can hold at most " +
+                         std::to_string(CPUAddress::ROM_SIZE) + " instructions, got " +
+                         std::to_string(count) + ".");
+    }
+    if (length != HackBinary::HEADER_SIZE + count * sizeof(Word)) {
+        throw ParseError(".hackb image is " + std::to_string(length) +
+                         " bytes, but its header declares " + std::to_string(count) +
+                         " instructions (" +
+                         std::to_string(HackBinary::HEADER_SIZE + count * sizeof(Word)) +
+                         " bytes).");
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < count; i++) {
+        rom[i] = u16(HackBinary::HEADER_SIZE + 2 * i);
+    }
+#else
+    // The image is already in host order
+    std::memcpy(rom, data + HackBinary::HEADER_SIZE, count * sizeof(Word));
+#endif
+    return count;
+}
+
+std::string encode_hack_binary(const Word* rom, size_t count) {
+    std::string image;
+    image.reserve(HackBinary::HEADER_SIZE + count * sizeof(Word));
+    auto put16 = [&image](uint16_t value) {
+        image.push_back(static_cast<char>(value & 0xFF));
+        image.push_back(static_cast<char>(value >> 8));
+    };
+
+    image.append(HackBinary::MAGIC, sizeof(HackBinary::MAGIC));
+    put16(HackBinary::VERSION);
+    put16(static_cast<uint16_t>(count));
+    for (size_t i = 0; i < count; i++) {
+        put16(rom[i]);
+    }
+    return image;
+}
+
+// ==============================================================================
+// Files
+// ==============================================================================
+
+size_t read_rom_file(const std::string& file_path, Word* rom) {
+    FileView file(file_path);
+    if (is_hack_binary(file.data(), file.size())) {
+        return parse_hack_binary(file.data(), file.size(), rom);
+    }
+    return parse_hack_text(file.data(), file.size(), rom);
+}
+
+}  // namespace n2t
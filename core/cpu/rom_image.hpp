@@ -0,0 +1,79 @@
+// ==============================================================================
+// Hack ROM Images
+// ==============================================================================
+// Parsers for the two on-disk ROM formats, writing straight into a ROM
+// array (no intermediate strings or vectors):
+//
+//   .hack   Text, one 16-character line of '0'/'1' per instruction. Each
+//           line is converted with a branch-free SWAR kernel: the 16 bytes
+//           are loaded as two 64-bit words, validated with one mask compare
+//           each, and packed to 8 bits each with one multiply.
+//
+//   .hackb  Little-endian binary image, for loading many programs fast:
+//             offset 0  "HACK"           magic
+//             offset 4  uint16 version   (1)
+//             offset 6  uint16 count     number of instructions (<= 32768)
+//             offset 8  uint16 rom[count]
+//           The file is exactly 8 + 2 * count bytes.
+//
+// read_rom_file() maps the file into memory (mmap where available) and
+// picks the format from its first bytes, so either can be passed anywhere
+// a .hack path is accepted.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_ROM_IMAGE_HPP
+#define NAND2TETRIS_ROM_IMAGE_HPP
+
+#include "types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace n2t {
+
+namespace HackBinary {
+    constexpr char MAGIC[4] = {'H', 'A', 'C', 'K'};
+    constexpr uint16_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 8;
+}
+
+/**
+ * @brief Parse .hack text into rom (room for ROM_SIZE words).
+ *
+ * Blank lines are skipped and trailing spaces, tabs and CRs ignored.
+ *
+ * @return Number of instructions
+ * @throws ParseError on a malformed line or more than ROM_SIZE instructions
+ */
+size_t parse_hack_text(const char* text, size_t length, Word* rom);
+
+/**
+ * @brief Whether data starts with the .hackb magic.
+ */
+bool is_hack_binary(const char* data, size_t length);
+
+/**
+ * @brief Decode a .hackb image into rom (room for ROM_SIZE words).
+ *
+ * @return Number of instructions
+ * @throws ParseError if the header or size is wrong
+ */
+size_t parse_hack_binary(const char* data, size_t length, Word* rom);
+
+/**
+ * @brief Encode count instructions as a .hackb image.
+ */
+std::string encode_hack_binary(const Word* rom, size_t count);
+
+/**
+ * @brief Read a .hack or .hackb file into rom (room for ROM_SIZE words).
+ *
+ * @return Number of instructions
+ * @throws FileError if the file cannot be read
+ * @throws ParseError if its contents are invalid
+ */
+size_t read_rom_file(const std::string& file_path, Word* rom);
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_ROM_IMAGE_HPP
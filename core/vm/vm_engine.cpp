@@ -23,7 +23,7 @@ VMEngine::VMEngine() = default;
 void VMEngine::load_file(const std::string& file_path) {
     VMParser parser;
     parser.parse_file(file_path);
-    program_ = parser.get_program();
+    linked_ = link_program(parser.get_program(), natives_enabled_ ? &natives_ : nullptr);
     state_ = VMState::READY;
     pc_ = 0;
     stats_.reset();
@@ -33,7 +33,7 @@ void VMEngine::load_string(const std::string& source,
                            const std::string& file_name) {
     VMParser parser;
     parser.parse_string(source, file_name);
-    program_ = parser.get_program();
+    linked_ = link_program(parser.get_program(), natives_enabled_ ? &natives_ : nullptr);
     state_ = VMState::READY;
     pc_ = 0;
     stats_.reset();
@@ -42,7 +42,7 @@ void VMEngine::load_string(const std::string& source,
 void VMEngine::load_directory(const std::string& directory_path) {
     VMParser parser;
     parser.parse_directory(directory_path);
-    program_ = parser.get_program();
+    linked_ = link_program(parser.get_program(), natives_enabled_ ? &natives_ : nullptr);
     state_ = VMState::READY;
     pc_ = 0;
     stats_.reset();
@@ -52,6 +52,14 @@ void VMEngine::set_entry_point(const std::string& function_name) {
     entry_point_ = function_name;
 }
 
+void VMEngine::set_natives_enabled(bool enabled) {
+    if (enabled == natives_enabled_) {
+        return;
+    }
+    natives_enabled_ = enabled;
+    bind_natives(linked_, natives_enabled_ ? &natives_ : nullptr);
+}
+
 void VMEngine::reset() {
     memory_.reset();
     pc_ = 0;
@@ -80,10 +88,10 @@ VMState VMEngine::run() {
     pause_reason_ = PauseReason::NONE;
     pause_requested_ = false;
 
-    while (state_ == VMState::RUNNING) {
-        if (!execute_command()) {
-            break;
-        }
+    if (dispatch_ == VMDispatch::THREADED) {
+        run_threaded(UINT64_MAX);
+    } else {
+        run_switch(UINT64_MAX);
     }
 
     return state_;
@@ -102,12 +110,10 @@ VMState VMEngine::run_for(uint64_t max_instructions) {
     pause_reason_ = PauseReason::NONE;
     pause_requested_ = false;
 
-    uint64_t count = 0;
-    while (state_ == VMState::RUNNING && count < max_instructions) {
-        if (!execute_command()) {
-            break;
-        }
-        count++;
+    if (dispatch_ == VMDispatch::THREADED) {
+        run_threaded(max_instructions);
+    } else {
+        run_switch(max_instructions);
     }
 
     // If we hit the limit without halting or error, pause
@@ -119,6 +125,16 @@ VMState VMEngine::run_for(uint64_t max_instructions) {
     return state_;
 }
 
+void VMEngine::run_switch(uint64_t max_instructions) {
+    uint64_t count = 0;
+    while (state_ == VMState::RUNNING && count < max_instructions) {
+        if (!execute_command()) {
+            break;
+        }
+        count++;
+    }
+}
+
 VMState VMEngine::step() {
     if (state_ == VMState::READY) {
         initialize_execution();
@@ -217,11 +233,11 @@ void VMEngine::pause() {
 // State Inspection
 // ==============================================================================
 
-const VMCommand* VMEngine::get_command(size_t index) const {
-    if (index >= program_.commands.size()) {
-        return nullptr;
+std::optional<VMCommand> VMEngine::get_command(size_t index) const {
+    if (index >= linked_.code.size()) {
+        return std::nullopt;
     }
-    return &program_.commands[index];
+    return linked_.command(index);
 }
 
 // ==============================================================================
@@ -233,8 +249,8 @@ void VMEngine::add_breakpoint(size_t command_index) {
 }
 
 void VMEngine::add_function_breakpoint(const std::string& function_name, size_t offset) {
-    auto it = program_.function_entry_points.find(function_name);
-    if (it != program_.function_entry_points.end()) {
+    auto it = linked_.function_entry_points.find(function_name);
+    if (it != linked_.function_entry_points.end()) {
         breakpoints_.insert(it->second + offset);
     }
 }
@@ -261,31 +277,26 @@ std::vector<size_t> VMEngine::get_breakpoints() const {
 
 void VMEngine::initialize_execution() {
     memory_.reset();
+    natives_.reset(memory_, linked_.native_classes);
 
     // Determine entry point
     std::string entry = entry_point_;
     if (entry.empty()) {
         // Try Sys.init first (standard bootstrap), then Main.main
-        if (program_.function_entry_points.count("Sys.init")) {
+        if (linked_.function_entry_points.count("Sys.init")) {
             entry = "Sys.init";
-        } else if (program_.function_entry_points.count("Main.main")) {
+        } else if (linked_.function_entry_points.count("Main.main")) {
             entry = "Main.main";
         }
     }
 
     if (!entry.empty()) {
-        auto it = program_.function_entry_points.find(entry);
-        if (it != program_.function_entry_points.end()) {
+        auto it = linked_.function_entry_points.find(entry);
+        if (it != linked_.function_entry_points.end()) {
             pc_ = it->second;
 
-            // Look up num_locals from the function definition command
-            uint16_t num_locals = 0;
-            if (pc_ < program_.commands.size()) {
-                const VMCommand& cmd = program_.commands[pc_];
-                if (std::holds_alternative<FunctionCommand>(cmd)) {
-                    num_locals = std::get<FunctionCommand>(cmd).num_locals;
-                }
-            }
+            // The function definition's operand is its local count
+            uint16_t num_locals = linked_.code[pc_].operand;
 
             // Bootstrap: set up a proper call frame on the RAM stack
             // Return address 0 signals halt when the entry function returns
@@ -299,9 +310,9 @@ void VMEngine::initialize_execution() {
         pc_ = 0;
     }
 
-    // Pre-allocate static segments for all source files
-    for (const auto& file : program_.source_files) {
-        memory_.get_static_base(get_file_basename(file));
+    // Pre-allocate static segments in the order the linker laid them out
+    for (const auto& file : linked_.static_files) {
+        memory_.get_static_base(file);
     }
 
     state_ = VMState::PAUSED;
@@ -310,7 +321,7 @@ void VMEngine::initialize_execution() {
 
 bool VMEngine::execute_command() {
     // Check for halt: PC past end of program
-    if (pc_ >= program_.commands.size()) {
+    if (pc_ >= linked_.code.size()) {
         state_ = VMState::HALTED;
         return false;
     }
@@ -330,34 +341,31 @@ bool VMEngine::execute_command() {
         return false;
     }
 
-    const VMCommand& cmd = program_.commands[pc_];
+    const VMInstruction& cmd = linked_.code[pc_];
 
     try {
-        std::visit([this](const auto& command) {
-            using T = std::decay_t<decltype(command)>;
-
-            if constexpr (std::is_same_v<T, ArithmeticCommand>) {
-                execute_arithmetic(command);
-            } else if constexpr (std::is_same_v<T, PushCommand>) {
-                execute_push(command);
-            } else if constexpr (std::is_same_v<T, PopCommand>) {
-                execute_pop(command);
-            } else if constexpr (std::is_same_v<T, LabelCommand>) {
-                execute_label(command);
-            } else if constexpr (std::is_same_v<T, GotoCommand>) {
-                execute_goto(command);
-            } else if constexpr (std::is_same_v<T, IfGotoCommand>) {
-                execute_if_goto(command);
-            } else if constexpr (std::is_same_v<T, FunctionCommand>) {
-                execute_function(command);
-            } else if constexpr (std::is_same_v<T, CallCommand>) {
-                execute_call(command);
-            } else if constexpr (std::is_same_v<T, ReturnCommand>) {
-                execute_return(command);
-            }
-        }, cmd);
+        switch (cmd.op) {
+            case LinkedOp::PUSH:     execute_push(cmd); break;
+            case LinkedOp::POP:      execute_pop(cmd); break;
+            case LinkedOp::GOTO:     execute_goto(cmd); break;
+            case LinkedOp::IF_GOTO:  execute_if_goto(cmd); break;
+            case LinkedOp::CALL:     execute_call(cmd); break;
+            case LinkedOp::CALL_NATIVE: execute_native(cmd); break;
+            case LinkedOp::RETURN:   execute_return(); break;
+            case LinkedOp::LABEL:
+            case LinkedOp::FUNCTION:
+                // Labels and function definitions are no-ops at runtime:
+                // push_frame (called by execute_call or bootstrap) sets up
+                // the frame and initializes local variables to 0
+                pc_++;
+                break;
+            default:
+                execute_arithmetic(cmd.op);
+                break;
+        }
 
         stats_.instructions_executed++;
+        stats_.dispatch_count++;
 
     } catch (const N2TError& e) {
         error_message_ = e.what();
@@ -378,140 +386,154 @@ bool VMEngine::execute_command() {
 // Command Execution
 // ==============================================================================
 
-void VMEngine::execute_arithmetic(const ArithmeticCommand& cmd) {
+void VMEngine::execute_arithmetic(LinkedOp op) {
     stats_.arithmetic_count++;
 
-    switch (cmd.operation) {
-        case ArithmeticOp::ADD: {
+    switch (op) {
+        case LinkedOp::ADD: {
             int16_t y = static_cast<int16_t>(memory_.pop());
             int16_t x = static_cast<int16_t>(memory_.pop());
             memory_.push(static_cast<Word>(x + y));
             break;
         }
-        case ArithmeticOp::SUB: {
+        case LinkedOp::SUB: {
             int16_t y = static_cast<int16_t>(memory_.pop());
             int16_t x = static_cast<int16_t>(memory_.pop());
             memory_.push(static_cast<Word>(x - y));
             break;
         }
-        case ArithmeticOp::NEG: {
+        case LinkedOp::NEG: {
             int16_t y = static_cast<int16_t>(memory_.pop());
             memory_.push(static_cast<Word>(-y));
             break;
         }
-        case ArithmeticOp::EQ: {
+        case LinkedOp::EQ: {
             Word y = memory_.pop();
             Word x = memory_.pop();
             // True = -1 (0xFFFF), False = 0
             memory_.push(x == y ? 0xFFFF : 0);
             break;
         }
-        case ArithmeticOp::GT: {
+        case LinkedOp::GT: {
             int16_t y = static_cast<int16_t>(memory_.pop());
             int16_t x = static_cast<int16_t>(memory_.pop());
             memory_.push(x > y ? 0xFFFF : 0);
             break;
         }
-        case ArithmeticOp::LT: {
+        case LinkedOp::LT: {
             int16_t y = static_cast<int16_t>(memory_.pop());
             int16_t x = static_cast<int16_t>(memory_.pop());
             memory_.push(x < y ? 0xFFFF : 0);
             break;
         }
-        case ArithmeticOp::AND: {
+        case LinkedOp::AND: {
             Word y = memory_.pop();
             Word x = memory_.pop();
             memory_.push(x & y);
             break;
         }
-        case ArithmeticOp::OR: {
+        case LinkedOp::OR: {
             Word y = memory_.pop();
             Word x = memory_.pop();
             memory_.push(x | y);
             break;
         }
-        case ArithmeticOp::NOT: {
+        case LinkedOp::NOT: {
             Word y = memory_.pop();
             memory_.push(~y);
             break;
         }
+        default:
+            throw InternalError("Not an arithmetic opcode");
     }
 
     pc_++;
 }
 
-void VMEngine::execute_push(const PushCommand& cmd) {
+void VMEngine::execute_push(const VMInstruction& cmd) {
     stats_.push_count++;
 
-    Word value = memory_.read_segment(cmd.segment, cmd.index, cmd.file_name);
+    // Static operands were linked to their absolute address
+    Word value = cmd.segment == SegmentType::STATIC
+        ? memory_.read_ram(cmd.operand)
+        : memory_.read_segment(cmd.segment, cmd.operand);
     memory_.push(value);
 
     pc_++;
 }
 
-void VMEngine::execute_pop(const PopCommand& cmd) {
+void VMEngine::execute_pop(const VMInstruction& cmd) {
     stats_.pop_count++;
 
     Word value = memory_.pop();
-    memory_.write_segment(cmd.segment, cmd.index, value, cmd.file_name);
-
-    pc_++;
-}
+    if (cmd.segment == SegmentType::STATIC) {
+        memory_.write_ram(cmd.operand, value);
+    } else {
+        memory_.write_segment(cmd.segment, cmd.operand, value);
+    }
 
-void VMEngine::execute_label(const LabelCommand& /*cmd*/) {
-    // Labels are no-ops at runtime; just advance PC
     pc_++;
 }
 
-void VMEngine::execute_goto(const GotoCommand& cmd) {
-    pc_ = lookup_label(cmd.label_name);
+void VMEngine::execute_goto(const VMInstruction& cmd) {
+    if (cmd.target == LinkedProgram::UNRESOLVED) throw_unresolved();
+    pc_ = cmd.target;
 }
 
-void VMEngine::execute_if_goto(const IfGotoCommand& cmd) {
+void VMEngine::execute_if_goto(const VMInstruction& cmd) {
     Word condition = memory_.pop();
     if (condition != 0) {
-        pc_ = lookup_label(cmd.label_name);
+        if (cmd.target == LinkedProgram::UNRESOLVED) throw_unresolved();
+        pc_ = cmd.target;
     } else {
         pc_++;
     }
 }
 
-void VMEngine::execute_function(const FunctionCommand& /*cmd*/) {
-    // Function definitions are handled at call time:
-    // - push_frame (called by execute_call or bootstrap) sets up the frame
-    //   and initializes local variables to 0
-    // - At runtime, the function command is a no-op; just advance PC
-    pc_++;
-}
-
-void VMEngine::execute_call(const CallCommand& cmd) {
+void VMEngine::execute_call(const VMInstruction& cmd) {
     stats_.call_count++;
 
-    // Look up the function entry point
-    size_t function_pc = lookup_function(cmd.function_name);
+    if (cmd.target == LinkedProgram::UNRESOLVED) throw_unresolved();
 
     // The return address is the command after this call
-    size_t return_address = pc_ + 1;
-
-    // Push frame saves state and sets up for the called function
-    // We pass 0 for num_locals here; the function command will set local count
-    // Actually, push_frame needs num_locals to initialize them.
-    // We need to look at the function command to get num_locals.
-    uint16_t num_locals = 0;
-    if (function_pc < program_.commands.size()) {
-        const VMCommand& func_cmd = program_.commands[function_pc];
-        if (std::holds_alternative<FunctionCommand>(func_cmd)) {
-            num_locals = std::get<FunctionCommand>(func_cmd).num_locals;
-        }
+    // The callee's local count is the operand of its FUNCTION instruction
+    memory_.push_frame(pc_ + 1, linked_.name_of(pc_), cmd.operand,
+                       linked_.code[cmd.target].operand);
+
+    // Jump to function
+    pc_ = cmd.target;
+}
+
+void VMEngine::execute_native(const VMInstruction& cmd) {
+    stats_.call_count++;
+    stats_.native_call_count++;
+
+    const VMNative& native = natives_.get(cmd.target);
+    if (cmd.operand != native.num_args) {
+        throw RuntimeError("Native function '" + native.name + "' takes " +
+                           std::to_string(native.num_args) + " argument(s), called with " +
+                           std::to_string(cmd.operand));
+    }
+    Word sp = memory_.get_sp();
+    if (sp < VMAddress::STACK_BASE + cmd.operand) {
+        throw RuntimeError("Stack underflow! Not enough arguments on the stack for '" +
+                           native.name + "'");
     }
 
-    memory_.push_frame(return_address, cmd.function_name, cmd.num_args, num_locals);
+    // The arguments sit where the callee's ARG would point; like a return,
+    // the return value replaces them
+    VMNativeCall call{memory_, static_cast<Address>(sp - cmd.operand), cmd.operand};
+    Word return_value = native.function(call);
+    memory_.write_ram(VMAddress::SP, call.arg_base);
+    memory_.push(return_value);
 
-    // Jump to function
-    pc_ = function_pc;
+    pc_++;
+    if (call.halt) {
+        state_ = VMState::HALTED;
+    }
 }
 
-void VMEngine::execute_return(const ReturnCommand& /*cmd*/) {
+void VMEngine::execute_return() {
     stats_.return_count++;
 
     // Pop return value from stack
@@ -530,44 +552,24 @@ void VMEngine::execute_return(const ReturnCommand& /*cmd*/) {
 }
 
 // ==============================================================================
-// Lookup Helpers
+// Error Helpers
 // ==============================================================================
 
-size_t VMEngine::lookup_label(const std::string& label_name) const {
-    // Labels are stored with scoped names: "functionName$labelName"
-    // Try scoped lookup first (using current function context)
-    std::string current_func = memory_.current_function();
-    if (!current_func.empty()) {
-        std::string scoped = current_func + "$" + label_name;
-        auto it = program_.label_positions.find(scoped);
-        if (it != program_.label_positions.end()) {
-            return it->second;
-        }
-    }
+void VMEngine::throw_unresolved() const {
+    const std::string& name = linked_.name_of(pc_);
 
-    // Fall back to raw label name (for programs without function scoping)
-    auto it = program_.label_positions.find(label_name);
-    if (it != program_.label_positions.end()) {
-        return it->second;
+    if (linked_.code[pc_].op == LinkedOp::CALL) {
+        throw RuntimeError(
+            "Undefined function: '" + name + "'. "
+            "Make sure the function is defined with 'function " + name +
+            " <nLocals>' and the .vm file containing it has been loaded."
+        );
     }
 
     throw RuntimeError(
-        "Undefined label: '" + label_name + "'. "
+        "Undefined label: '" + name + "'. "
         "Make sure the label is defined in the current function with 'label " +
-        label_name + "'."
-    );
-}
-
-size_t VMEngine::lookup_function(const std::string& function_name) const {
-    auto it = program_.function_entry_points.find(function_name);
-    if (it != program_.function_entry_points.end()) {
-        return it->second;
-    }
-
-    throw RuntimeError(
-        "Undefined function: '" + function_name + "'. "
-        "Make sure the function is defined with 'function " + function_name +
-        " <nLocals>' and the .vm file containing it has been loaded."
+        name + "'."
     );
 }
 
@@ -16,8 +16,11 @@
 
 #include "vm_command.hpp"
 #include "vm_parser.hpp"
+#include "vm_linker.hpp"
 #include "vm_memory.hpp"
+#include "vm_natives.hpp"
 #include <functional>
+#include <optional>
 #include <unordered_set>
 
 namespace n2t {
@@ -49,6 +52,30 @@ enum class PauseReason {
     USER_REQUEST    // User requested pause
 };
 
+/**
+ * @brief Which execution core run() and run_for() use
+ *
+ * Both cores give identical results (RAM, call stack, stats, errors and
+ * error locations).
+ *   SWITCH:   one execute_command() per VM command, through VMMemory.
+ *   THREADED: one handler per opcode and segment, each ending in its own
+ *             indirect jump to the next handler (GCC/Clang labels-as-values,
+ *             with a portable switch fallback on other compilers). SP and
+ *             the top of the stack live in locals; RAM[0] is written back
+ *             at calls, returns, pauses, breakpoints and errors.
+ * step(), step_over() and step_out() always use the SWITCH core.
+ *
+ * With superinstructions enabled (the default) the THREADED core runs
+ * LinkedProgram::fused, executing each fused idiom with one dispatch. It
+ * falls back to the plain commands for a sequence that a breakpoint, the
+ * run_for() budget or an error would stop part way through, so results
+ * stay identical. Single-stepping never sees superinstructions.
+ */
+enum class VMDispatch {
+    SWITCH,
+    THREADED
+};
+
 // ==============================================================================
 // Execution Statistics
 // ==============================================================================
@@ -63,6 +90,9 @@ struct VMStats {
     uint64_t arithmetic_count = 0;       // Number of arithmetic commands
     uint64_t call_count = 0;             // Number of function calls
     uint64_t return_count = 0;           // Number of returns
+    uint64_t native_call_count = 0;      // Calls run natively (included in call_count)
+    uint64_t dispatch_count = 0;         // Handler dispatches (< instructions_executed
+                                         // when superinstructions run)
 
     void reset() {
         instructions_executed = 0;
@@ -71,6 +101,8 @@ struct VMStats {
         arithmetic_count = 0;
         call_count = 0;
         return_count = 0;
+        native_call_count = 0;
+        dispatch_count = 0;
     }
 };
 
@@ -138,6 +170,27 @@ public:
      */
     void set_entry_point(const std::string& function_name);
 
+    /**
+     * @brief Native functions available to programs (the Jack OS by default)
+     *
+     * Natives are bound when a program is loaded and again whenever
+     * set_natives_enabled() changes the setting, so register them before
+     * calling load_*().
+     */
+    VMNatives& natives() { return natives_; }
+    const VMNatives& natives() const { return natives_; }
+
+    /**
+     * @brief Use natives for functions the program does not define
+     *
+     * Turn this off to run a student's own OS classes with nothing
+     * filling in for missing functions. A loaded program is relinked at
+     * once; the native heap is only set up when execution starts, so change
+     * this before running or follow it with reset().
+     */
+    void set_natives_enabled(bool enabled);
+    bool get_natives_enabled() const { return natives_enabled_; }
+
     /**
      * @brief Reset the engine to initial state
      *
@@ -196,6 +249,18 @@ public:
      */
     void pause();
 
+    /**
+     * @brief Select the execution core for run() and run_for()
+     */
+    void set_dispatch(VMDispatch mode) { dispatch_ = mode; }
+    VMDispatch get_dispatch() const { return dispatch_; }
+
+    /**
+     * @brief Let the threaded core run fused superinstructions
+     */
+    void set_superinstructions(bool enabled) { superinstructions_ = enabled; }
+    bool get_superinstructions() const { return superinstructions_; }
+
     /**
      * @brief Check if the engine is currently running
      */
@@ -224,18 +289,21 @@ public:
 
     /**
      * @brief Get the command at a specific index
+     *
+     * The command is rebuilt from the linked program, which is all the
+     * engine keeps of the source; nullopt past the end of the program.
      */
-    const VMCommand* get_command(size_t index) const;
+    std::optional<VMCommand> get_command(size_t index) const;
 
     /**
      * @brief Get the current command (at PC)
      */
-    const VMCommand* get_current_command() const { return get_command(pc_); }
+    std::optional<VMCommand> get_current_command() const { return get_command(pc_); }
 
     /**
      * @brief Get total number of commands in the program
      */
-    size_t get_command_count() const { return program_.commands.size(); }
+    size_t get_command_count() const { return linked_.code.size(); }
 
     /**
      * @brief Get current function name
@@ -369,7 +437,7 @@ private:
     // Internal State
     // =========================================================================
 
-    VMProgram program_;          // The loaded program
+    LinkedProgram linked_;       // The loaded program, names resolved
     VMMemory memory_;            // Memory system
     size_t pc_ = 0;              // Program counter
     VMState state_ = VMState::READY;
@@ -377,7 +445,15 @@ private:
     VMStats stats_;
 
     std::string entry_point_;    // Entry function name
+    VMNatives natives_ = jack_os_natives();
+    bool natives_enabled_ = true;
     bool pause_requested_ = false;
+    VMDispatch dispatch_ = VMDispatch::SWITCH;
+    bool superinstructions_ = true;
+
+    // The threaded core polls pause_requested_ once per slice of this many
+    // commands instead of before every command
+    static constexpr uint64_t PAUSE_POLL_INTERVAL = 4096;
 
     // Breakpoints
     std::unordered_set<size_t> breakpoints_;
@@ -390,6 +466,17 @@ private:
     // Execution Helpers
     // =========================================================================
 
+    /**
+     * @brief Run up to max_instructions commands with execute_command()
+     */
+    void run_switch(uint64_t max_instructions);
+
+    /**
+     * @brief Run up to max_instructions commands on the threaded core
+     *        (vm_threaded.cpp)
+     */
+    void run_threaded(uint64_t max_instructions);
+
     /**
      * @brief Execute a single command (internal)
      *
@@ -400,57 +487,47 @@ private:
     /**
      * @brief Execute an arithmetic command
      */
-    void execute_arithmetic(const ArithmeticCommand& cmd);
+    void execute_arithmetic(LinkedOp op);
 
     /**
      * @brief Execute a push command
      */
-    void execute_push(const PushCommand& cmd);
+    void execute_push(const VMInstruction& cmd);
 
     /**
      * @brief Execute a pop command
      */
-    void execute_pop(const PopCommand& cmd);
-
-    /**
-     * @brief Execute a label command (no-op, just moves PC)
-     */
-    void execute_label(const LabelCommand& cmd);
+    void execute_pop(const VMInstruction& cmd);
 
     /**
      * @brief Execute a goto command
      */
-    void execute_goto(const GotoCommand& cmd);
+    void execute_goto(const VMInstruction& cmd);
 
     /**
      * @brief Execute an if-goto command
      */
-    void execute_if_goto(const IfGotoCommand& cmd);
-
-    /**
-     * @brief Execute a function definition
-     */
-    void execute_function(const FunctionCommand& cmd);
+    void execute_if_goto(const VMInstruction& cmd);
 
     /**
      * @brief Execute a function call
      */
-    void execute_call(const CallCommand& cmd);
+    void execute_call(const VMInstruction& cmd);
 
     /**
-     * @brief Execute a return
+     * @brief Execute a call bound to a native function
      */
-    void execute_return(const ReturnCommand& cmd);
+    void execute_native(const VMInstruction& cmd);
 
     /**
-     * @brief Look up a label and return its command index
+     * @brief Execute a return
      */
-    size_t lookup_label(const std::string& label_name) const;
+    void execute_return();
 
     /**
-     * @brief Look up a function and return its entry point
+     * @brief Report the jump or call at PC whose target did not link
      */
-    size_t lookup_function(const std::string& function_name) const;
+    [[noreturn]] void throw_unresolved() const;
 
     /**
      * @brief Set error state with message
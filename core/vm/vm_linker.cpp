@@ -0,0 +1,356 @@
+// ==============================================================================
+// VM Linker Implementation
+// ==============================================================================
+
+#include "vm_linker.hpp"
+#include "vm_memory.hpp"
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace n2t {
+
+namespace {
+
+LinkedOp arithmetic_opcode(ArithmeticOp op) {
+    switch (op) {
+        case ArithmeticOp::ADD: return LinkedOp::ADD;
+        case ArithmeticOp::SUB: return LinkedOp::SUB;
+        case ArithmeticOp::NEG: return LinkedOp::NEG;
+        case ArithmeticOp::EQ:  return LinkedOp::EQ;
+        case ArithmeticOp::GT:  return LinkedOp::GT;
+        case ArithmeticOp::LT:  return LinkedOp::LT;
+        case ArithmeticOp::AND: return LinkedOp::AND;
+        case ArithmeticOp::OR:  return LinkedOp::OR;
+        case ArithmeticOp::NOT: return LinkedOp::NOT;
+    }
+    throw InternalError("Unknown arithmetic operation");
+}
+
+/**
+ * @brief Assigns static segments to files in first-use order
+ */
+class StaticAllocator {
+public:
+    explicit StaticAllocator(std::vector<std::string>& files) : files_(files) {}
+
+    Address base(const std::string& file_name) {
+        auto it = bases_.find(file_name);
+        if (it != bases_.end()) {
+            return it->second;
+        }
+        Address base = static_cast<Address>(
+            VMAddress::STATIC_BASE + files_.size() * VMAddress::STATIC_FILE_SIZE);
+        files_.push_back(file_name);
+        bases_.emplace(file_name, base);
+        return base;
+    }
+
+private:
+    std::vector<std::string>& files_;
+    std::unordered_map<std::string, Address> bases_;
+};
+
+/**
+ * @brief Interns names into LinkedProgram::names
+ */
+class NameTable {
+public:
+    explicit NameTable(std::vector<std::string>& names) : names_(names) {}
+
+    uint32_t id(const std::string& name) {
+        auto [it, inserted] = ids_.try_emplace(name, static_cast<uint32_t>(names_.size()));
+        if (inserted) {
+            names_.push_back(name);
+        }
+        return it->second;
+    }
+
+private:
+    std::vector<std::string>& names_;
+    std::unordered_map<std::string, uint32_t> ids_;
+};
+
+// The two-local compare-and-branch superinstruction for a compare opcode
+LinkedOp locals_goto_opcode(LinkedOp compare, bool negated) {
+    switch (compare) {
+        case LinkedOp::LT: return negated ? LinkedOp::LOCALS_GE_GOTO : LinkedOp::LOCALS_LT_GOTO;
+        case LinkedOp::GT: return negated ? LinkedOp::LOCALS_LE_GOTO : LinkedOp::LOCALS_GT_GOTO;
+        case LinkedOp::EQ: return negated ? LinkedOp::LOCALS_NE_GOTO : LinkedOp::LOCALS_EQ_GOTO;
+        default: throw InternalError("Not a compare opcode");
+    }
+}
+
+bool is_compare(LinkedOp op) {
+    return op == LinkedOp::LT || op == LinkedOp::GT || op == LinkedOp::EQ;
+}
+
+bool is_push(const VMInstruction& ins, SegmentType segment) {
+    return ins.op == LinkedOp::PUSH && ins.segment == segment;
+}
+
+ArithmeticOp arithmetic_operation(LinkedOp op) {
+    switch (op) {
+        case LinkedOp::ADD: return ArithmeticOp::ADD;
+        case LinkedOp::SUB: return ArithmeticOp::SUB;
+        case LinkedOp::NEG: return ArithmeticOp::NEG;
+        case LinkedOp::EQ:  return ArithmeticOp::EQ;
+        case LinkedOp::GT:  return ArithmeticOp::GT;
+        case LinkedOp::LT:  return ArithmeticOp::LT;
+        case LinkedOp::AND: return ArithmeticOp::AND;
+        case LinkedOp::OR:  return ArithmeticOp::OR;
+        case LinkedOp::NOT: return ArithmeticOp::NOT;
+        default: throw InternalError("Not an arithmetic opcode");
+    }
+}
+
+}  // namespace
+
+size_t command_count(LinkedOp op) {
+    switch (op) {
+        case LinkedOp::ADD_CONSTANT:
+        case LinkedOp::SUB_CONSTANT:
+        case LinkedOp::MOVE_TO_POINTER:
+            return 2;
+        case LinkedOp::LOCALS_LT_GOTO:
+        case LinkedOp::LOCALS_GT_GOTO:
+        case LinkedOp::LOCALS_EQ_GOTO:
+            return 4;
+        case LinkedOp::LOCALS_GE_GOTO:
+        case LinkedOp::LOCALS_LE_GOTO:
+        case LinkedOp::LOCALS_NE_GOTO:
+            return 5;
+        default:
+            return 1;
+    }
+}
+
+const std::string& LinkedProgram::name_of(size_t pc) const {
+    static const std::string none;
+    if (pc >= source.size() || source[pc].name == NO_NAME) {
+        return none;
+    }
+    return names[source[pc].name];
+}
+
+VMCommand LinkedProgram::command(size_t pc) const {
+    const VMInstruction& ins = code[pc];
+    const std::string& name = name_of(pc);
+    const LineNumber line = static_cast<LineNumber>(source[pc].line);
+
+    // Undo link_segment(): a static operand is the file's base plus the index
+    auto segment_index = [&]() {
+        if (ins.segment != SegmentType::STATIC) {
+            return ins.operand;
+        }
+        auto file = std::find(static_files.begin(), static_files.end(), name);
+        size_t base = VMAddress::STATIC_BASE +
+            static_cast<size_t>(file - static_files.begin()) * VMAddress::STATIC_FILE_SIZE;
+        return static_cast<uint16_t>(ins.operand - base);
+    };
+
+    switch (ins.op) {
+        case LinkedOp::PUSH:     return PushCommand{ins.segment, segment_index(), name, line};
+        case LinkedOp::POP:      return PopCommand{ins.segment, segment_index(), name, line};
+        case LinkedOp::LABEL:    return LabelCommand{name, line};
+        case LinkedOp::GOTO:     return GotoCommand{name, line};
+        case LinkedOp::IF_GOTO:  return IfGotoCommand{name, line};
+        case LinkedOp::FUNCTION: return FunctionCommand{name, ins.operand, line};
+        case LinkedOp::CALL:
+        case LinkedOp::CALL_NATIVE:
+            return CallCommand{name, ins.operand, line};
+        case LinkedOp::RETURN:   return ReturnCommand{line};
+        default:                 return ArithmeticCommand{arithmetic_operation(ins.op), line};
+    }
+}
+
+LinkedProgram link_program(const VMProgram& program, const VMNatives* natives) {
+    if (program.commands.size() >= LinkedProgram::UNRESOLVED) {
+        throw RuntimeError("Program too large: " + std::to_string(program.commands.size()) +
+                           " commands");
+    }
+
+    LinkedProgram linked;
+    linked.function_entry_points = program.function_entry_points;
+    linked.code.resize(program.commands.size());
+    linked.source.resize(program.commands.size(), {LinkedProgram::NO_NAME, 0});
+
+    StaticAllocator statics(linked.static_files);
+    for (const auto& file : program.source_files) {
+        statics.base(get_file_basename(file));
+    }
+    NameTable names(linked.names);
+
+    auto find_label = [&](const std::string& function, const std::string& label) {
+        if (!function.empty()) {
+            auto it = program.label_positions.find(function + "$" + label);
+            if (it != program.label_positions.end()) return static_cast<uint32_t>(it->second);
+        }
+        auto it = program.label_positions.find(label);
+        return it != program.label_positions.end()
+            ? static_cast<uint32_t>(it->second)
+            : LinkedProgram::UNRESOLVED;
+    };
+
+    auto find_function = [&](const std::string& function_name) {
+        auto it = program.function_entry_points.find(function_name);
+        return it != program.function_entry_points.end()
+            ? static_cast<uint32_t>(it->second)
+            : LinkedProgram::UNRESOLVED;
+    };
+
+    // Resolve static addresses for the segment index, leave others alone
+    auto link_segment = [&](SegmentType segment, uint16_t index,
+                            const std::string& file_name, VMInstruction& out) {
+        out.segment = segment;
+        out.operand = segment == SegmentType::STATIC
+            ? static_cast<uint16_t>(statics.base(file_name) + index)
+            : index;
+    };
+
+    std::string function;   // Enclosing function of the current command
+    for (size_t i = 0; i < program.commands.size(); i++) {
+        VMInstruction& out = linked.code[i];
+        VMSourceInfo& info = linked.source[i];
+
+        std::visit([&](const auto& cmd) {
+            using T = std::decay_t<decltype(cmd)>;
+
+            info.line = static_cast<uint32_t>(cmd.source_line);
+
+            if constexpr (std::is_same_v<T, ArithmeticCommand>) {
+                out.op = arithmetic_opcode(cmd.operation);
+            } else if constexpr (std::is_same_v<T, PushCommand>) {
+                out.op = LinkedOp::PUSH;
+                link_segment(cmd.segment, cmd.index, cmd.file_name, out);
+                info.name = names.id(cmd.file_name);
+            } else if constexpr (std::is_same_v<T, PopCommand>) {
+                out.op = LinkedOp::POP;
+                link_segment(cmd.segment, cmd.index, cmd.file_name, out);
+                info.name = names.id(cmd.file_name);
+            } else if constexpr (std::is_same_v<T, LabelCommand>) {
+                out.op = LinkedOp::LABEL;
+                info.name = names.id(cmd.label_name);
+            } else if constexpr (std::is_same_v<T, GotoCommand>) {
+                out.op = LinkedOp::GOTO;
+                out.target = find_label(function, cmd.label_name);
+                info.name = names.id(cmd.label_name);
+            } else if constexpr (std::is_same_v<T, IfGotoCommand>) {
+                out.op = LinkedOp::IF_GOTO;
+                out.target = find_label(function, cmd.label_name);
+                info.name = names.id(cmd.label_name);
+            } else if constexpr (std::is_same_v<T, FunctionCommand>) {
+                out.op = LinkedOp::FUNCTION;
+                out.operand = cmd.num_locals;
+                function = cmd.function_name;
+                info.name = names.id(cmd.function_name);
+            } else if constexpr (std::is_same_v<T, CallCommand>) {
+                out.op = LinkedOp::CALL;
+                out.operand = cmd.num_args;
+                out.target = find_function(cmd.function_name);
+                info.name = names.id(cmd.function_name);
+            } else if constexpr (std::is_same_v<T, ReturnCommand>) {
+                out.op = LinkedOp::RETURN;
+            }
+        }, program.commands[i]);
+    }
+
+    bind_natives(linked, natives);
+    fuse_superinstructions(linked);
+    return linked;
+}
+
+void bind_natives(LinkedProgram& linked, const VMNatives* natives) {
+    auto class_of = [](const std::string& function_name) {
+        return function_name.substr(0, function_name.find('.'));
+    };
+
+    // A class the program defines any function of gets no natives
+    std::unordered_set<std::string> defined_classes;
+    for (const auto& entry : linked.function_entry_points) {
+        defined_classes.insert(class_of(entry.first));
+    }
+
+    linked.native_classes.clear();
+    std::unordered_set<std::string> native_classes;
+    const bool has_fused = linked.fused.size() == linked.code.size();
+
+    for (size_t i = 0; i < linked.code.size(); i++) {
+        VMInstruction& ins = linked.code[i];
+        if (ins.op == LinkedOp::CALL_NATIVE) {
+            ins.op = LinkedOp::CALL;
+            ins.target = LinkedProgram::UNRESOLVED;
+        }
+        if (ins.op != LinkedOp::CALL || ins.target != LinkedProgram::UNRESOLVED) {
+            continue;
+        }
+
+        if (natives) {
+            const std::string& function_name = linked.name_of(i);
+            std::string class_name = class_of(function_name);
+            uint32_t native = natives->usable(class_name, defined_classes)
+                ? natives->find(function_name)
+                : VMNatives::NOT_FOUND;
+            if (native != VMNatives::NOT_FOUND) {
+                ins.op = LinkedOp::CALL_NATIVE;
+                ins.target = native;
+                if (native_classes.insert(class_name).second) {
+                    linked.native_classes.push_back(class_name);
+                }
+            }
+        }
+
+        // Calls are never the head of a superinstruction
+        if (has_fused) {
+            linked.fused[i] = ins;
+        }
+    }
+}
+
+void fuse_superinstructions(LinkedProgram& linked) {
+    const std::vector<VMInstruction>& code = linked.code;
+    linked.fused = code;
+
+    for (size_t i = 0; i < code.size(); i++) {
+        const VMInstruction& first = code[i];
+        const size_t left = code.size() - i;
+        VMInstruction& out = linked.fused[i];
+
+        // push local i; push local j; lt|gt|eq; [not]; if-goto L
+        if (left >= 4 && is_push(first, SegmentType::LOCAL) &&
+            is_push(code[i + 1], SegmentType::LOCAL) && is_compare(code[i + 2].op) &&
+            first.operand <= UINT8_MAX && code[i + 1].operand <= UINT8_MAX) {
+            bool negated = code[i + 3].op == LinkedOp::NOT;
+            size_t branch = i + (negated ? 4 : 3);
+            if (branch < code.size() && code[branch].op == LinkedOp::IF_GOTO) {
+                out.op = locals_goto_opcode(code[i + 2].op, negated);
+                out.operand = static_cast<uint16_t>(first.operand << 8 | code[i + 1].operand);
+                out.target = code[branch].target;
+                continue;
+            }
+        }
+
+        if (left < 2 || first.op != LinkedOp::PUSH) {
+            continue;
+        }
+        const VMInstruction& second = code[i + 1];
+
+        // push constant N; add|sub
+        if (first.segment == SegmentType::CONSTANT &&
+            (second.op == LinkedOp::ADD || second.op == LinkedOp::SUB)) {
+            out.op = second.op == LinkedOp::ADD ? LinkedOp::ADD_CONSTANT : LinkedOp::SUB_CONSTANT;
+            continue;
+        }
+
+        // push <segment> i; pop pointer k
+        if (second.op == LinkedOp::POP && second.segment == SegmentType::POINTER &&
+            second.operand <= 1) {
+            out.op = LinkedOp::MOVE_TO_POINTER;
+            out.target = second.operand;
+        }
+    }
+}
+
+}  // namespace n2t
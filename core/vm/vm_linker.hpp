@@ -0,0 +1,185 @@
+// ==============================================================================
+// VM Linker
+// ==============================================================================
+// Lowers a parsed VMProgram into the flat form the engine executes. Every
+// name in the program is resolved once, at load time:
+//
+// - goto/if-goto: the label's command index. Labels are looked up in the
+//   function that contains the jump (the scope the parser registered them
+//   in), then as a bare name, exactly like the parser's scoping.
+// - call: the callee's entry index, or, for a function the program does
+//   not define, a native from the VMNatives passed in (see vm_natives.hpp).
+// - push/pop static: the absolute RAM address of the variable. Each file
+//   gets VMAddress::STATIC_FILE_SIZE words, allocated in the order listed
+//   in LinkedProgram::static_files, which is the order the engine hands
+//   them to VMMemory::get_static_base.
+//
+// A call's local count is not copied into the call: it is the operand of
+// the FUNCTION instruction the call targets.
+//
+// A jump or call whose target does not exist is not a load error; it is
+// linked to UNRESOLVED and reported when (and only if) it executes.
+//
+// Superinstructions: fuse_superinstructions() builds LinkedProgram::fused,
+// a copy of code in which the first command of each common Jack compiler
+// idiom is replaced by one instruction doing the whole sequence:
+//
+//   push constant N; add|sub                         ADD_CONSTANT/SUB_CONSTANT
+//   push <segment> i; pop pointer k                  MOVE_TO_POINTER
+//   push local i; push local j; lt|gt|eq; [not];     LOCALS_<test>_GOTO
+//   if-goto L
+//
+// The commands inside a fused sequence are left as they were, so an index
+// into fused is still an index into program.commands: a jump into the
+// middle of a sequence, a breakpoint on one of its commands or a pc
+// reported to the debugger all mean the same command as before.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_VM_LINKER_HPP
+#define NAND2TETRIS_VM_LINKER_HPP
+
+#include "vm_parser.hpp"
+#include "vm_natives.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace n2t {
+
+/**
+ * @brief Operation of a linked command
+ *
+ * Arithmetic commands get one opcode per operation, so the engine
+ * dispatches once per command. The opcodes after RETURN are
+ * superinstructions and only appear in LinkedProgram::fused.
+ */
+enum class LinkedOp : uint8_t {
+    ADD, SUB, NEG, EQ, GT, LT, AND, OR, NOT,
+    PUSH,
+    POP,
+    LABEL,
+    GOTO,
+    IF_GOTO,
+    FUNCTION,
+    CALL,
+    CALL_NATIVE,
+    RETURN,
+
+    // Superinstructions
+    ADD_CONSTANT,       // push constant operand; add
+    SUB_CONSTANT,       // push constant operand; sub
+    MOVE_TO_POINTER,    // push segment operand; pop pointer target
+    LOCALS_LT_GOTO,     // push local i; push local j; lt; if-goto target
+    LOCALS_GT_GOTO,     //   (i and j are the high and low byte of operand)
+    LOCALS_EQ_GOTO,
+    LOCALS_GE_GOTO,     // ... lt; not; if-goto target
+    LOCALS_LE_GOTO,     // ... gt; not; if-goto target
+    LOCALS_NE_GOTO      // ... eq; not; if-goto target
+};
+
+/**
+ * @brief Number of commands an instruction stands for
+ *
+ * 1 for ordinary opcodes, the length of the fused sequence for
+ * superinstructions.
+ */
+size_t command_count(LinkedOp op);
+
+/**
+ * @brief One command with every name resolved to an integer
+ *
+ * linked.code[i] is the lowering of program.commands[i]. Instructions are
+ * plain 8-byte values with no names in them, so the code array of even a
+ * large multi-file program stays small and contiguous; names and source
+ * lines live in LinkedProgram's side table.
+ */
+struct VMInstruction {
+    LinkedOp op;
+    SegmentType segment;    // PUSH/POP
+    uint16_t operand;       // PUSH/POP: segment index, or the RAM address for static
+                            // CALL/CALL_NATIVE: number of arguments
+                            // FUNCTION: number of locals
+    uint32_t target;        // GOTO/IF_GOTO: label index; CALL: callee entry index
+                            // CALL_NATIVE: index into the VMNatives
+};
+
+static_assert(sizeof(VMInstruction) == 8, "VMInstruction must stay 8 bytes");
+
+/**
+ * @brief Cold per-instruction data: what the instruction was called in
+ *        the source and where it came from
+ */
+struct VMSourceInfo {
+    uint32_t name;          // Index into LinkedProgram::names, or NO_NAME
+    uint32_t line;          // Source line of the command
+};
+
+/**
+ * @brief The result of linking a VMProgram
+ */
+struct LinkedProgram {
+    static constexpr uint32_t UNRESOLVED = UINT32_MAX;
+    static constexpr uint32_t NO_NAME = UINT32_MAX;
+
+    std::vector<VMInstruction> code;
+
+    // code with superinstructions at the head of every fused sequence
+    std::vector<VMInstruction> fused;
+
+    // Side table, parallel to code. The name is the label for LABEL/GOTO/
+    // IF_GOTO, the function for FUNCTION/CALL and the file for PUSH/POP.
+    std::vector<VMSourceInfo> source;
+    std::vector<std::string> names;     // Each distinct name once
+
+    // Files with a static segment, in allocation order
+    std::vector<std::string> static_files;
+
+    // Classes with at least one call linked to a native
+    std::vector<std::string> native_classes;
+
+    // Function name -> index of its FUNCTION instruction
+    std::unordered_map<std::string, size_t> function_entry_points;
+
+    /**
+     * @brief Name attached to instruction pc ("" if it has none)
+     */
+    const std::string& name_of(size_t pc) const;
+
+    /**
+     * @brief The parsed command instruction pc was linked from
+     *
+     * Rebuilt from code and the side table, so the linked program is all
+     * an engine needs to keep of a VMProgram.
+     */
+    VMCommand command(size_t pc) const;
+};
+
+/**
+ * @brief Resolve labels, calls and static addresses of a parsed program
+ *
+ * With natives, calls to undefined functions of classes the program does
+ * not define become CALL_NATIVE.
+ */
+LinkedProgram link_program(const VMProgram& program, const VMNatives* natives = nullptr);
+
+/**
+ * @brief Relink the program's calls against natives
+ *
+ * Every CALL_NATIVE goes back to an unresolved CALL, then unresolved calls
+ * are bound to natives as link_program() does (none when natives is
+ * null), in both code and fused. Lets the engine switch natives on or off
+ * for a loaded program.
+ */
+void bind_natives(LinkedProgram& linked, const VMNatives* natives);
+
+/**
+ * @brief Build linked.fused from linked.code
+ *
+ * link_program() calls this; it is exposed so tools can inspect the result.
+ */
+void fuse_superinstructions(LinkedProgram& linked);
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_VM_LINKER_HPP
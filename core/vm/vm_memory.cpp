@@ -237,7 +237,7 @@ Address VMMemory::get_static_base(const std::string& file_name) {
 
     // Reserve some space for this file's statics (we don't know how many it needs)
     // We'll allocate 16 per file by default
-    next_static_address_ += 16;
+    next_static_address_ += VMAddress::STATIC_FILE_SIZE;
 
     return base;
 }
@@ -56,6 +56,7 @@ namespace VMAddress {
     // Static segment starts at address 16
     constexpr Address STATIC_BASE = 16;
     constexpr Address STATIC_SIZE = 240;  // 16-255
+    constexpr Address STATIC_FILE_SIZE = 16;  // Words reserved per .vm file
 
     // Stack starts at address 256
     constexpr Address STACK_BASE = 256;
@@ -263,6 +264,12 @@ public:
      */
     const Word* ram_ptr() const { return ram_.data(); }
 
+    /**
+     * @brief Writable RAM for the threaded execution core, which keeps SP
+     *        in a register and does its own bounds checks
+     */
+    Word* ram_ptr() { return ram_.data(); }
+
     // =========================================================================
     // Function Call Support
     // =========================================================================
@@ -0,0 +1,384 @@
+// ==============================================================================
+// VM Native Functions Implementation
+// ==============================================================================
+
+#include "vm_natives.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace n2t {
+
+// ==============================================================================
+// Registry
+// ==============================================================================
+
+void VMNatives::add(const std::string& name, uint16_t num_args, VMNativeFunction function) {
+    auto [it, inserted] = index_.try_emplace(name, static_cast<uint32_t>(natives_.size()));
+    if (inserted) {
+        natives_.push_back({name, num_args, std::move(function)});
+    } else {
+        natives_[it->second] = {name, num_args, std::move(function)};
+    }
+}
+
+void VMNatives::require(const std::string& class_name, const std::string& required_class) {
+    requires_[class_name].push_back(required_class);
+}
+
+bool VMNatives::usable(const std::string& class_name,
+                       const std::unordered_set<std::string>& defined_classes) const {
+    // Every class reachable through require() must be left to the natives
+    std::vector<std::string> pending{class_name};
+    std::unordered_set<std::string> seen{class_name};
+    while (!pending.empty()) {
+        std::string current = std::move(pending.back());
+        pending.pop_back();
+        if (defined_classes.count(current)) {
+            return false;
+        }
+        auto it = requires_.find(current);
+        if (it == requires_.end()) {
+            continue;
+        }
+        for (const auto& required : it->second) {
+            if (seen.insert(required).second) {
+                pending.push_back(required);
+            }
+        }
+    }
+    return true;
+}
+
+void VMNatives::on_reset(std::vector<std::string> classes, std::function<void(VMMemory&)> hook) {
+    reset_hooks_.push_back({std::move(classes), std::move(hook)});
+}
+
+uint32_t VMNatives::find(const std::string& name) const {
+    auto it = index_.find(name);
+    return it != index_.end() ? it->second : NOT_FOUND;
+}
+
+void VMNatives::reset(VMMemory& memory, const std::vector<std::string>& native_classes) const {
+    for (const auto& reset : reset_hooks_) {
+        for (const auto& class_name : reset.classes) {
+            if (std::find(native_classes.begin(), native_classes.end(), class_name) !=
+                native_classes.end()) {
+                reset.hook(memory);
+                break;
+            }
+        }
+    }
+}
+
+// ==============================================================================
+// Jack OS
+// ==============================================================================
+
+namespace {
+
+constexpr Word JACK_TRUE = 0xFFFF;
+
+// The error the Jack OS would report through Sys.error(code)
+[[noreturn]] void os_error(int code, const std::string& message) {
+    throw RuntimeError(message + " (Sys.error " + std::to_string(code) + ")");
+}
+
+/**
+ * @brief The native heap: a first-fit free list in RAM, see jack_os_natives()
+ */
+class NativeHeap {
+public:
+    static constexpr int HEAP_WORDS = VMAddress::HEAP_MAX - VMAddress::HEAP_BASE + 1;
+
+    void init(VMMemory& memory) {
+        free_list_ = VMAddress::HEAP_BASE;
+        memory.write_ram(VMAddress::HEAP_BASE, static_cast<Word>(HEAP_WORDS));
+        memory.write_ram(VMAddress::HEAP_BASE + 1, 0);
+    }
+
+    Word alloc(VMMemory& memory, int size) {
+        if (size <= 0) {
+            os_error(5, "Memory.alloc: allocated memory size must be positive");
+        }
+        const int needed = size + 1;    // The block's length word comes first
+
+        Address previous = 0;
+        Address segment = free_list_;
+        for (int visited = 0; segment != 0 && visited < HEAP_WORDS; visited++) {
+            int length = memory.read_ram(segment);
+            Word next = memory.read_ram(static_cast<Address>(segment + 1));
+
+            // Take an exact fit whole; split a larger segment from its end,
+            // leaving it at least its two header words
+            if (length == needed) {
+                if (previous == 0) {
+                    free_list_ = next;
+                } else {
+                    memory.write_ram(static_cast<Address>(previous + 1), next);
+                }
+                return static_cast<Word>(segment + 1);
+            }
+            if (length >= needed + 2) {
+                memory.write_ram(segment, static_cast<Word>(length - needed));
+                Address block = static_cast<Address>(segment + length - needed);
+                memory.write_ram(block, static_cast<Word>(needed));
+                return static_cast<Word>(block + 1);
+            }
+
+            previous = segment;
+            segment = next;
+        }
+        os_error(6, "Memory.alloc: heap overflow");
+    }
+
+    void dealloc(VMMemory& memory, Word address) {
+        if (address <= VMAddress::HEAP_BASE || address > VMAddress::HEAP_MAX) {
+            throw RuntimeError("Memory.deAlloc: " + std::to_string(address) +
+                               " is not a heap block");
+        }
+        Address segment = static_cast<Address>(address - 1);
+        memory.write_ram(static_cast<Address>(segment + 1), free_list_);
+        free_list_ = segment;
+    }
+
+private:
+    Address free_list_ = 0;
+};
+
+// String object fields
+constexpr Address STRING_LENGTH = 0;
+constexpr Address STRING_MAX_LENGTH = 1;
+constexpr Address STRING_CHARS = 2;
+
+Word field(const VMNativeCall& call, Address object, Address index) {
+    return call.memory.read_ram(static_cast<Address>(object + index));
+}
+
+void set_field(VMNativeCall& call, Address object, Address index, Word value) {
+    call.memory.write_ram(static_cast<Address>(object + index), value);
+}
+
+void add_math(VMNatives& natives) {
+    natives.add("Math.init", 0, [](VMNativeCall&) -> Word { return 0; });
+
+    natives.add("Math.abs", 1, [](VMNativeCall& call) {
+        int x = call.int_arg(0);
+        return static_cast<Word>(x < 0 ? -x : x);
+    });
+
+    natives.add("Math.multiply", 2, [](VMNativeCall& call) {
+        return static_cast<Word>(call.int_arg(0) * call.int_arg(1));
+    });
+
+    natives.add("Math.divide", 2, [](VMNativeCall& call) {
+        int x = call.int_arg(0);
+        int y = call.int_arg(1);
+        if (y == 0) {
+            os_error(3, "Math.divide: division by zero");
+        }
+        return static_cast<Word>(x / y);
+    });
+
+    natives.add("Math.min", 2, [](VMNativeCall& call) {
+        return static_cast<Word>(std::min(call.int_arg(0), call.int_arg(1)));
+    });
+
+    natives.add("Math.max", 2, [](VMNativeCall& call) {
+        return static_cast<Word>(std::max(call.int_arg(0), call.int_arg(1)));
+    });
+
+    natives.add("Math.sqrt", 1, [](VMNativeCall& call) {
+        int x = call.int_arg(0);
+        if (x < 0) {
+            os_error(4, "Math.sqrt: cannot compute square root of a negative number");
+        }
+        int root = static_cast<int>(std::sqrt(static_cast<double>(x)));
+        while (root * root > x) root--;
+        while ((root + 1) * (root + 1) <= x) root++;
+        return static_cast<Word>(root);
+    });
+}
+
+void add_memory(VMNatives& natives, const std::shared_ptr<NativeHeap>& heap) {
+    natives.on_reset({"Memory", "Array", "String"},
+                     [heap](VMMemory& memory) { heap->init(memory); });
+
+    natives.add("Memory.init", 0, [heap](VMNativeCall& call) -> Word {
+        heap->init(call.memory);
+        return 0;
+    });
+
+    natives.add("Memory.peek", 1, [](VMNativeCall& call) {
+        return call.memory.read_ram(call.arg(0));
+    });
+
+    natives.add("Memory.poke", 2, [](VMNativeCall& call) -> Word {
+        call.memory.write_ram(call.arg(0), call.arg(1));
+        return 0;
+    });
+
+    natives.add("Memory.alloc", 1, [heap](VMNativeCall& call) {
+        return heap->alloc(call.memory, call.int_arg(0));
+    });
+
+    natives.add("Memory.deAlloc", 1, [heap](VMNativeCall& call) -> Word {
+        heap->dealloc(call.memory, call.arg(0));
+        return 0;
+    });
+}
+
+void add_array(VMNatives& natives, const std::shared_ptr<NativeHeap>& heap) {
+    natives.add("Array.new", 1, [heap](VMNativeCall& call) {
+        int size = call.int_arg(0);
+        if (size <= 0) {
+            os_error(2, "Array.new: array size must be positive");
+        }
+        return heap->alloc(call.memory, size);
+    });
+
+    natives.add("Array.dispose", 1, [heap](VMNativeCall& call) -> Word {
+        heap->dealloc(call.memory, call.arg(0));
+        return 0;
+    });
+}
+
+void add_string(VMNatives& natives, const std::shared_ptr<NativeHeap>& heap) {
+    natives.add("String.new", 1, [heap](VMNativeCall& call) {
+        int max_length = call.int_arg(0);
+        if (max_length < 0) {
+            os_error(14, "String.new: maximum length must be non-negative");
+        }
+        Address object = heap->alloc(call.memory, 3);
+        Word chars = max_length > 0 ? heap->alloc(call.memory, max_length) : 0;
+        set_field(call, object, STRING_LENGTH, 0);
+        set_field(call, object, STRING_MAX_LENGTH, static_cast<Word>(max_length));
+        set_field(call, object, STRING_CHARS, chars);
+        return static_cast<Word>(object);
+    });
+
+    natives.add("String.dispose", 1, [heap](VMNativeCall& call) -> Word {
+        Address object = call.arg(0);
+        Word chars = field(call, object, STRING_CHARS);
+        if (chars != 0) {
+            heap->dealloc(call.memory, chars);
+        }
+        heap->dealloc(call.memory, object);
+        return 0;
+    });
+
+    natives.add("String.length", 1, [](VMNativeCall& call) {
+        return field(call, call.arg(0), STRING_LENGTH);
+    });
+
+    natives.add("String.charAt", 2, [](VMNativeCall& call) {
+        Address object = call.arg(0);
+        int j = call.int_arg(1);
+        if (j < 0 || j >= static_cast<int16_t>(field(call, object, STRING_LENGTH))) {
+            os_error(15, "String.charAt: index out of bounds");
+        }
+        return field(call, field(call, object, STRING_CHARS), static_cast<Address>(j));
+    });
+
+    natives.add("String.setCharAt", 3, [](VMNativeCall& call) -> Word {
+        Address object = call.arg(0);
+        int j = call.int_arg(1);
+        if (j < 0 || j >= static_cast<int16_t>(field(call, object, STRING_LENGTH))) {
+            os_error(16, "String.setCharAt: index out of bounds");
+        }
+        set_field(call, field(call, object, STRING_CHARS), static_cast<Address>(j), call.arg(2));
+        return 0;
+    });
+
+    natives.add("String.appendChar", 2, [](VMNativeCall& call) {
+        Address object = call.arg(0);
+        Word length = field(call, object, STRING_LENGTH);
+        if (length >= field(call, object, STRING_MAX_LENGTH)) {
+            os_error(17, "String.appendChar: string is full");
+        }
+        set_field(call, field(call, object, STRING_CHARS), length, call.arg(1));
+        set_field(call, object, STRING_LENGTH, static_cast<Word>(length + 1));
+        return static_cast<Word>(object);
+    });
+
+    natives.add("String.eraseLastChar", 1, [](VMNativeCall& call) -> Word {
+        Address object = call.arg(0);
+        Word length = field(call, object, STRING_LENGTH);
+        if (length == 0) {
+            os_error(18, "String.eraseLastChar: string is empty");
+        }
+        set_field(call, object, STRING_LENGTH, static_cast<Word>(length - 1));
+        return 0;
+    });
+
+    // Leading '-' and digits up to the first non-digit, wrapping mod 2^16
+    // like the Jack OS's 16-bit arithmetic
+    natives.add("String.intValue", 1, [](VMNativeCall& call) {
+        Address object = call.arg(0);
+        Address chars = field(call, object, STRING_CHARS);
+        Word length = field(call, object, STRING_LENGTH);
+        bool negative = length > 0 && field(call, chars, 0) == '-';
+        Word value = 0;
+        for (Word i = negative ? 1 : 0; i < length; i++) {
+            Word c = field(call, chars, i);
+            if (c < '0' || c > '9') break;
+            value = static_cast<Word>(value * 10 + (c - '0'));
+        }
+        return static_cast<Word>(negative ? -value : value);
+    });
+
+    natives.add("String.setInt", 2, [](VMNativeCall& call) -> Word {
+        Address object = call.arg(0);
+        int value = call.int_arg(1);
+        std::string digits = std::to_string(value);
+        if (static_cast<int>(digits.size()) > static_cast<int16_t>(field(call, object, STRING_MAX_LENGTH))) {
+            os_error(19, "String.setInt: insufficient string capacity");
+        }
+        Address chars = field(call, object, STRING_CHARS);
+        for (size_t i = 0; i < digits.size(); i++) {
+            set_field(call, chars, static_cast<Address>(i), static_cast<Word>(digits[i]));
+        }
+        set_field(call, object, STRING_LENGTH, static_cast<Word>(digits.size()));
+        return 0;
+    });
+
+    natives.add("String.newLine", 0, [](VMNativeCall&) -> Word { return 128; });
+    natives.add("String.backSpace", 0, [](VMNativeCall&) -> Word { return 129; });
+    natives.add("String.doubleQuote", 0, [](VMNativeCall&) -> Word { return '"'; });
+}
+
+void add_sys(VMNatives& natives) {
+    natives.add("Sys.halt", 0, [](VMNativeCall& call) -> Word {
+        call.halt = true;
+        return 0;
+    });
+
+    natives.add("Sys.error", 1, [](VMNativeCall& call) -> Word {
+        throw RuntimeError("Sys.error: error code " + std::to_string(call.int_arg(0)));
+    });
+
+    // The emulator does not model time, so waiting is immediate
+    natives.add("Sys.wait", 1, [](VMNativeCall& call) -> Word {
+        if (call.int_arg(0) < 0) {
+            os_error(1, "Sys.wait: duration must be positive");
+        }
+        return 0;
+    });
+}
+
+}  // namespace
+
+VMNatives jack_os_natives() {
+    VMNatives natives;
+    auto heap = std::make_shared<NativeHeap>();
+    add_math(natives);
+    add_memory(natives, heap);
+    add_array(natives, heap);
+    add_string(natives, heap);
+    add_sys(natives);
+    natives.require("Array", "Memory");
+    natives.require("String", "Memory");
+    return natives;
+}
+
+}  // namespace n2t
@@ -0,0 +1,142 @@
+// ==============================================================================
+// VM Native Functions
+// ==============================================================================
+// C++ implementations of VM functions, called in place of VM code.
+//
+// A call to a function the program does not define is linked to a native
+// of the same name, if there is one and the program defines no function of
+// that class at all: supplying Memory.vm replaces every Memory native.
+// A class can also require another (require()): the Array and String
+// natives allocate from the native heap, so a program that supplies its
+// own Memory gets none of them either, and user code never shares the heap
+// with a native alloc.
+//
+// A native honors the VM calling convention. Its arguments are the top
+// num_args stack words (argument i at arg_base + i, where a VM callee's ARG
+// would point); they are replaced by its return value, exactly as a VM
+// return leaves the stack. No frame is pushed, so LCL, ARG, THIS and THAT
+// are untouched and the call stack does not change.
+//
+// jack_os_natives() is the shipped set: the Math, Memory, Array, String
+// and Sys classes of the Jack OS, with the OS's error codes.
+// ==============================================================================
+
+#ifndef NAND2TETRIS_VM_NATIVES_HPP
+#define NAND2TETRIS_VM_NATIVES_HPP
+
+#include "vm_memory.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace n2t {
+
+/**
+ * @brief What a native sees of the call
+ */
+struct VMNativeCall {
+    VMMemory& memory;
+    Address arg_base;       // Address of argument 0
+    uint16_t num_args;
+    bool halt = false;      // Set to stop the program after the call
+
+    Word arg(size_t i) const { return memory.read_ram(static_cast<Address>(arg_base + i)); }
+    int16_t int_arg(size_t i) const { return static_cast<int16_t>(arg(i)); }
+};
+
+/**
+ * @brief A native implementation; returns the function's return value
+ *
+ * Errors are reported by throwing N2TError (usually RuntimeError); the
+ * engine stops at the call with the error's message.
+ */
+using VMNativeFunction = std::function<Word(VMNativeCall&)>;
+
+struct VMNative {
+    std::string name;           // Full VM name, e.g. "Math.multiply"
+    uint16_t num_args;
+    VMNativeFunction function;
+};
+
+/**
+ * @brief Registry of native functions, by VM function name
+ */
+class VMNatives {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    /**
+     * @brief Register a native, replacing any previous one of that name
+     */
+    void add(const std::string& name, uint16_t num_args, VMNativeFunction function);
+
+    /**
+     * @brief Use natives of class_name only when required_class is native too
+     */
+    void require(const std::string& class_name, const std::string& required_class);
+
+    /**
+     * @brief Whether natives of class_name may be linked into a program
+     *        defining functions of defined_classes
+     */
+    bool usable(const std::string& class_name,
+                const std::unordered_set<std::string>& defined_classes) const;
+
+    /**
+     * @brief Register a hook run at the start of an execution that calls
+     *        a native of one of classes
+     *
+     * Natives that keep state (the native heap) set it up here, after RAM
+     * has been cleared. A program that links none of them keeps its RAM
+     * as cleared.
+     */
+    void on_reset(std::vector<std::string> classes, std::function<void(VMMemory&)> hook);
+
+    /**
+     * @brief Index of the native called name, or NOT_FOUND
+     */
+    uint32_t find(const std::string& name) const;
+
+    const VMNative& get(uint32_t index) const { return natives_[index]; }
+    size_t size() const { return natives_.size(); }
+
+    /**
+     * @brief Run the reset hooks of the classes a program has natives of
+     */
+    void reset(VMMemory& memory, const std::vector<std::string>& native_classes) const;
+
+private:
+    struct ResetHook {
+        std::vector<std::string> classes;
+        std::function<void(VMMemory&)> hook;
+    };
+
+    std::vector<VMNative> natives_;
+    std::unordered_map<std::string, uint32_t> index_;
+    std::unordered_map<std::string, std::vector<std::string>> requires_;
+    std::vector<ResetHook> reset_hooks_;
+};
+
+/**
+ * @brief Native Jack OS: Math, Memory, Array, String and Sys
+ *
+ * Heap layout (HEAP_BASE-HEAP_MAX): a first-fit free list of segments
+ * [length, next, ...]. alloc(n) hands out n + 1 words whose first word
+ * keeps the length, and returns the address after it; deAlloc puts the
+ * block back at the head of the list.
+ *
+ * String objects have three fields: [0] length, [1] maxLength, [2] the
+ * character array (0 when maxLength is 0). Array and String require
+ * Memory, and the heap is initialized only for programs linking one of
+ * the three.
+ *
+ * Each call of this function returns a set with its own heap state.
+ */
+VMNatives jack_os_natives();
+
+}  // namespace n2t
+
+#endif  // NAND2TETRIS_VM_NATIVES_HPP
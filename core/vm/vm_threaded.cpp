@@ -0,0 +1,564 @@
+// ==============================================================================
+// VM Threaded Execution Core
+// ==============================================================================
+// An alternative to the execute_command() loop for run() and run_for().
+//
+// The switch core pays, per command, for a dispatch switch, for handlers
+// that go through VMMemory::push()/pop() (each reloading SP from RAM[0]
+// and bounds-checking it) and for segment access through
+// calculate_address(). Here every opcode/segment pair of the linked code
+// gets its own handler, every handler ends with its own copy of the
+// dispatch jump, and SP and the top-of-stack value live in locals.
+//
+// Stack values are still stored to RAM as they are pushed, so RAM always
+// matches the switch core word for word except RAM[0]. The cached top is
+// only there to save the reload on every pop. RAM[0] is written back at
+// observation points: calls, returns, pauses, breakpoints, errors and the
+// end of the run.
+//
+// Anything unusual leaves the fast path before it changes any state:
+// - stack underflow or overflow
+// - a bad temp or pointer index
+// - a segment address of 0 (SP itself) or outside RAM
+// - an unresolved jump
+// - calls (native or not) and returns
+// The engine then syncs and runs that one command through execute_command(),
+// so errors, messages and error locations are the switch core's by
+// construction. If SP ever leaves the stack area (only possible by writing
+// RAM[0] through a segment), the rest of the run falls back to the switch
+// core.
+//
+// Superinstructions (LinkedProgram::fused) are handled here only. A fused
+// handler runs its whole sequence at once when nothing could stop it part
+// way through; otherwise it continues with the plain instruction at the same
+// pc, which leaves the decision to the handlers above, one command at a time.
+//
+// With GCC/Clang the handlers are reached through a table of label
+// addresses (labels-as-values); other compilers get a switch of gotos with
+// the same handler bodies.
+// ==============================================================================
+
+#include "vm_engine.hpp"
+#include <algorithm>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define N2T_VM_COMPUTED_GOTO 1
+#else
+#define N2T_VM_COMPUTED_GOTO 0
+#endif
+
+namespace n2t {
+
+// ==============================================================================
+// Handler Table Layout
+// ==============================================================================
+// Handler index = opcode * SEGMENT_COUNT + segment. Only PUSH and POP look
+// at the segment; every other opcode fills all of its slots with one handler.
+
+namespace {
+
+constexpr size_t SEGMENT_COUNT = 8;
+constexpr size_t OPCODE_COUNT = static_cast<size_t>(LinkedOp::LOCALS_NE_GOTO) + 1;
+
+inline size_t handler_index(const VMInstruction& ins) {
+    return static_cast<size_t>(ins.op) * SEGMENT_COUNT + static_cast<size_t>(ins.segment);
+}
+
+// An address the fast path may touch directly: inside RAM and not SP
+inline bool fast_address(Address address) {
+    return static_cast<Address>(address - 1) < VMAddress::RAM_SIZE - 1;
+}
+
+// SP values the fast path can work with
+inline bool fast_sp(Word sp) {
+    return sp >= VMAddress::STACK_BASE && sp <= VMAddress::STACK_MAX + 1;
+}
+
+// Whether a breakpoint sits on one of the commands a sequence of length
+// count starting at pc runs after its first
+inline bool breakpoint_inside(const uint8_t* breakpoint_at, size_t pc, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        if (breakpoint_at[pc + i]) return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+// ==============================================================================
+// Threaded Core
+// ==============================================================================
+
+#if N2T_VM_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+void VMEngine::run_threaded(uint64_t max_instructions) {
+    const VMInstruction* plain = linked_.code.data();
+    const VMInstruction* code = superinstructions_ ? linked_.fused.data() : plain;
+    const size_t program_size = linked_.code.size();
+    Word* ram = memory_.ram_ptr();
+
+    // Breakpoints as a per-command flag array for the duration of the run
+    std::vector<uint8_t> breakpoint_flags;
+    if (!breakpoints_.empty()) {
+        breakpoint_flags.assign(program_size, 0);
+        for (size_t index : breakpoints_) {
+            if (index < program_size) breakpoint_flags[index] = 1;
+        }
+    }
+    const uint8_t* breakpoint_at = breakpoint_flags.empty() ? nullptr : breakpoint_flags.data();
+
+    // Working copies of the machine state
+    size_t pc = pc_;
+    VMStats stats = stats_;
+    Word sp = ram[VMAddress::SP];
+    if (!fast_sp(sp)) {
+        run_switch(max_instructions);
+        return;
+    }
+    Word tos = ram[sp - 1];
+    uint64_t budget_left = max_instructions;  // Not yet handed to a slice
+    uint64_t remaining = 0;                   // Left in the current slice
+    const VMInstruction* ins = nullptr;
+
+#if N2T_VM_COMPUTED_GOTO
+#define N2T_VM_JUMP() goto *handlers[handler_index(*ins)]
+#else
+#define N2T_VM_JUMP() goto dispatch_switch
+#endif
+
+// Checks performed before every command, in the same order as
+// execute_command(). The pause flag is only polled between slices.
+#define N2T_VM_DISPATCH()                                                   \
+    do {                                                                    \
+        if (remaining == 0) goto next_slice;                                \
+        if (pc >= program_size) goto halted;                                \
+        if (breakpoint_at && stats.instructions_executed > 0 &&             \
+            breakpoint_at[pc]) goto breakpoint_hit;                         \
+        ins = &code[pc];                                                    \
+        N2T_VM_JUMP();                                                      \
+    } while (0)
+
+#define N2T_VM_RETIRE()                                                     \
+    do {                                                                    \
+        stats.instructions_executed++;                                      \
+        stats.dispatch_count++;                                             \
+        remaining--;                                                        \
+        N2T_VM_DISPATCH();                                                  \
+    } while (0)
+
+// A superinstruction only runs when the whole sequence fits in the slice
+// and no breakpoint would stop it part way
+#define N2T_VM_FUSED_BEGIN(COUNT)                                           \
+    do {                                                                    \
+        if (remaining < (COUNT)) goto plain_instruction;                    \
+        if (breakpoint_at && breakpoint_inside(breakpoint_at, pc, COUNT))   \
+            goto plain_instruction;                                         \
+    } while (0)
+
+#define N2T_VM_FUSED_RETIRE(COUNT)                                          \
+    do {                                                                    \
+        stats.instructions_executed += (COUNT);                             \
+        stats.dispatch_count++;                                             \
+        remaining -= (COUNT);                                               \
+        N2T_VM_DISPATCH();                                                  \
+    } while (0)
+
+// Write the working copies back so VMMemory and the members are current
+#define N2T_VM_SYNC()                                                       \
+    do {                                                                    \
+        ram[VMAddress::SP] = sp;                                            \
+        pc_ = pc;                                                           \
+        stats_ = stats;                                                     \
+    } while (0)
+
+// y = top, x = the word below it; the result replaces x
+#define N2T_VM_BINARY(NAME, EXPR)                                           \
+    op_##NAME: {                                                            \
+        if (sp < VMAddress::STACK_BASE + 2) goto slow;                      \
+        Word y = tos;                                                       \
+        Word x = ram[sp - 2];                                               \
+        tos = static_cast<Word>(EXPR);                                      \
+        ram[sp - 2] = tos;                                                  \
+        sp--;                                                               \
+        stats.arithmetic_count++;                                           \
+        pc++;                                                               \
+        N2T_VM_RETIRE();                                                    \
+    }
+
+#define N2T_VM_UNARY(NAME, EXPR)                                            \
+    op_##NAME: {                                                            \
+        if (sp <= VMAddress::STACK_BASE) goto slow;                         \
+        Word y = tos;                                                       \
+        tos = static_cast<Word>(EXPR);                                      \
+        ram[sp - 1] = tos;                                                  \
+        stats.arithmetic_count++;                                           \
+        pc++;                                                               \
+        N2T_VM_RETIRE();                                                    \
+    }
+
+#define N2T_VM_PUSH_VALUE(VALUE)                                            \
+    do {                                                                    \
+        if (sp > VMAddress::STACK_MAX) goto slow;                           \
+        tos = (VALUE);                                                      \
+        ram[sp++] = tos;                                                    \
+        stats.push_count++;                                                 \
+        pc++;                                                               \
+        N2T_VM_RETIRE();                                                    \
+    } while (0)
+
+#define N2T_VM_PUSH_FROM(ADDRESS)                                           \
+    do {                                                                    \
+        Address address = static_cast<Address>(ADDRESS);                    \
+        if (!fast_address(address)) goto slow;                              \
+        N2T_VM_PUSH_VALUE(ram[address]);                                    \
+    } while (0)
+
+// Writing the word under SP must also update the cached top
+#define N2T_VM_POP_TO(ADDRESS)                                              \
+    do {                                                                    \
+        Address address = static_cast<Address>(ADDRESS);                    \
+        if (!fast_address(address)) goto slow;                              \
+        if (sp <= VMAddress::STACK_BASE) goto slow;                         \
+        Word value = tos;                                                   \
+        sp--;                                                               \
+        tos = ram[sp - 1];                                                  \
+        ram[address] = value;                                               \
+        if (address == sp - 1) tos = value;                                 \
+        stats.pop_count++;                                                  \
+        pc++;                                                               \
+        N2T_VM_RETIRE();                                                    \
+    } while (0)
+
+// push <segment> i; pop pointer k. The pushed word stays in RAM above SP.
+#define N2T_VM_MOVE_VALUE(VALUE)                                            \
+    do {                                                                    \
+        N2T_VM_FUSED_BEGIN(2);                                              \
+        if (sp > VMAddress::STACK_MAX) goto plain_instruction;              \
+        Word value = (VALUE);                                               \
+        ram[sp] = value;                                                    \
+        ram[VMAddress::THIS + ins->target] = value;                         \
+        stats.push_count++;                                                 \
+        stats.pop_count++;                                                  \
+        pc += 2;                                                            \
+        N2T_VM_FUSED_RETIRE(2);                                             \
+    } while (0)
+
+#define N2T_VM_MOVE_FROM(ADDRESS)                                           \
+    do {                                                                    \
+        Address address = static_cast<Address>(ADDRESS);                    \
+        if (!fast_address(address)) goto plain_instruction;                 \
+        N2T_VM_MOVE_VALUE(ram[address]);                                    \
+    } while (0)
+
+// push local i; push local j; <compare>; [not]; if-goto L. Leaves the
+// same words above SP as the plain sequence: the tested flag, then local j.
+#define N2T_VM_LOCALS_GOTO(NAME, COUNT, TEST)                               \
+    op_##NAME: {                                                            \
+        N2T_VM_FUSED_BEGIN(COUNT);                                          \
+        if (sp >= VMAddress::STACK_MAX) goto plain_instruction;             \
+        Address lcl = ram[VMAddress::LCL];                                  \
+        Address first = static_cast<Address>(lcl + (ins->operand >> 8));    \
+        Address second = static_cast<Address>(lcl + (ins->operand & 0xFF)); \
+        if (!fast_address(first) || !fast_address(second))                 \
+            goto plain_instruction;                                         \
+        if (second == sp) goto plain_instruction;  /* Reads the 1st push */ \
+        int16_t x = static_cast<int16_t>(ram[first]);                       \
+        int16_t y = static_cast<int16_t>(ram[second]);                      \
+        bool jump = (TEST);                                                 \
+        if (jump && ins->target == LinkedProgram::UNRESOLVED)               \
+            goto plain_instruction;                                         \
+        ram[sp] = jump ? 0xFFFF : 0;                                        \
+        ram[sp + 1] = static_cast<Word>(y);                                 \
+        stats.push_count += 2;                                              \
+        stats.arithmetic_count += (COUNT) - 3;                              \
+        pc = jump ? ins->target : pc + (COUNT);                             \
+        N2T_VM_FUSED_RETIRE(COUNT);                                         \
+    }
+
+#define N2T_VM_EVERY_SEGMENT(LABEL) \
+    &&LABEL, &&LABEL, &&LABEL, &&LABEL, &&LABEL, &&LABEL, &&LABEL, &&LABEL
+
+    {
+#if N2T_VM_COMPUTED_GOTO
+        static const void* const handlers[OPCODE_COUNT * SEGMENT_COUNT] = {
+            N2T_VM_EVERY_SEGMENT(op_ADD),
+            N2T_VM_EVERY_SEGMENT(op_SUB),
+            N2T_VM_EVERY_SEGMENT(op_NEG),
+            N2T_VM_EVERY_SEGMENT(op_EQ),
+            N2T_VM_EVERY_SEGMENT(op_GT),
+            N2T_VM_EVERY_SEGMENT(op_LT),
+            N2T_VM_EVERY_SEGMENT(op_AND),
+            N2T_VM_EVERY_SEGMENT(op_OR),
+            N2T_VM_EVERY_SEGMENT(op_NOT),
+            // PUSH, in SegmentType order
+            &&push_LOCAL, &&push_ARGUMENT, &&push_THIS, &&push_THAT,
+            &&push_CONSTANT, &&push_STATIC, &&push_TEMP, &&push_POINTER,
+            // POP; popping to constant is an error, reported by the slow path
+            &&pop_LOCAL, &&pop_ARGUMENT, &&pop_THIS, &&pop_THAT,
+            &&slow, &&pop_STATIC, &&pop_TEMP, &&pop_POINTER,
+            N2T_VM_EVERY_SEGMENT(op_NEXT),      // LABEL
+            N2T_VM_EVERY_SEGMENT(op_GOTO),
+            N2T_VM_EVERY_SEGMENT(op_IF_GOTO),
+            N2T_VM_EVERY_SEGMENT(op_NEXT),      // FUNCTION
+            N2T_VM_EVERY_SEGMENT(slow),         // CALL
+            N2T_VM_EVERY_SEGMENT(slow),         // CALL_NATIVE
+            N2T_VM_EVERY_SEGMENT(slow),         // RETURN
+            // Superinstructions
+            N2T_VM_EVERY_SEGMENT(op_ADD_CONSTANT),
+            N2T_VM_EVERY_SEGMENT(op_SUB_CONSTANT),
+            // MOVE_TO_POINTER, by the segment of the push
+            &&move_LOCAL, &&move_ARGUMENT, &&move_THIS, &&move_THAT,
+            &&move_CONSTANT, &&move_STATIC, &&move_TEMP, &&move_POINTER,
+            N2T_VM_EVERY_SEGMENT(op_LOCALS_LT_GOTO),
+            N2T_VM_EVERY_SEGMENT(op_LOCALS_GT_GOTO),
+            N2T_VM_EVERY_SEGMENT(op_LOCALS_EQ_GOTO),
+            N2T_VM_EVERY_SEGMENT(op_LOCALS_GE_GOTO),
+            N2T_VM_EVERY_SEGMENT(op_LOCALS_LE_GOTO),
+            N2T_VM_EVERY_SEGMENT(op_LOCALS_NE_GOTO),
+        };
+#endif
+
+        // Run in slices of at most PAUSE_POLL_INTERVAL commands, polling
+        // the pause flag (which only another thread can set) between them
+    next_slice:
+        if (budget_left == 0) goto budget_exhausted;
+        if (pc >= program_size) goto halted;
+        if (pause_requested_) goto user_pause;
+        remaining = std::min(budget_left, PAUSE_POLL_INTERVAL);
+        budget_left -= remaining;
+        N2T_VM_DISPATCH();
+
+#if !N2T_VM_COMPUTED_GOTO
+    dispatch_switch:
+        switch (ins->op) {
+            case LinkedOp::ADD:      goto op_ADD;
+            case LinkedOp::SUB:      goto op_SUB;
+            case LinkedOp::NEG:      goto op_NEG;
+            case LinkedOp::EQ:       goto op_EQ;
+            case LinkedOp::GT:       goto op_GT;
+            case LinkedOp::LT:       goto op_LT;
+            case LinkedOp::AND:      goto op_AND;
+            case LinkedOp::OR:       goto op_OR;
+            case LinkedOp::NOT:      goto op_NOT;
+            case LinkedOp::LABEL:    goto op_NEXT;
+            case LinkedOp::GOTO:     goto op_GOTO;
+            case LinkedOp::IF_GOTO:  goto op_IF_GOTO;
+            case LinkedOp::FUNCTION: goto op_NEXT;
+            case LinkedOp::CALL:     goto slow;
+            case LinkedOp::CALL_NATIVE: goto slow;
+            case LinkedOp::RETURN:   goto slow;
+            case LinkedOp::PUSH:
+                switch (ins->segment) {
+                    case SegmentType::LOCAL:    goto push_LOCAL;
+                    case SegmentType::ARGUMENT: goto push_ARGUMENT;
+                    case SegmentType::THIS:     goto push_THIS;
+                    case SegmentType::THAT:     goto push_THAT;
+                    case SegmentType::CONSTANT: goto push_CONSTANT;
+                    case SegmentType::STATIC:   goto push_STATIC;
+                    case SegmentType::TEMP:     goto push_TEMP;
+                    case SegmentType::POINTER:  goto push_POINTER;
+                }
+                goto slow;
+            case LinkedOp::POP:
+                switch (ins->segment) {
+                    case SegmentType::LOCAL:    goto pop_LOCAL;
+                    case SegmentType::ARGUMENT: goto pop_ARGUMENT;
+                    case SegmentType::THIS:     goto pop_THIS;
+                    case SegmentType::THAT:     goto pop_THAT;
+                    case SegmentType::STATIC:   goto pop_STATIC;
+                    case SegmentType::TEMP:     goto pop_TEMP;
+                    case SegmentType::POINTER:  goto pop_POINTER;
+                    default:                    goto slow;
+                }
+            case LinkedOp::ADD_CONSTANT:    goto op_ADD_CONSTANT;
+            case LinkedOp::SUB_CONSTANT:    goto op_SUB_CONSTANT;
+            case LinkedOp::LOCALS_LT_GOTO:  goto op_LOCALS_LT_GOTO;
+            case LinkedOp::LOCALS_GT_GOTO:  goto op_LOCALS_GT_GOTO;
+            case LinkedOp::LOCALS_EQ_GOTO:  goto op_LOCALS_EQ_GOTO;
+            case LinkedOp::LOCALS_GE_GOTO:  goto op_LOCALS_GE_GOTO;
+            case LinkedOp::LOCALS_LE_GOTO:  goto op_LOCALS_LE_GOTO;
+            case LinkedOp::LOCALS_NE_GOTO:  goto op_LOCALS_NE_GOTO;
+            case LinkedOp::MOVE_TO_POINTER:
+                switch (ins->segment) {
+                    case SegmentType::LOCAL:    goto move_LOCAL;
+                    case SegmentType::ARGUMENT: goto move_ARGUMENT;
+                    case SegmentType::THIS:     goto move_THIS;
+                    case SegmentType::THAT:     goto move_THAT;
+                    case SegmentType::CONSTANT: goto move_CONSTANT;
+                    case SegmentType::STATIC:   goto move_STATIC;
+                    case SegmentType::TEMP:     goto move_TEMP;
+                    case SegmentType::POINTER:  goto move_POINTER;
+                }
+                goto plain_instruction;
+        }
+        goto slow;
+#endif
+
+        // ---- Arithmetic ----
+        N2T_VM_BINARY(ADD, static_cast<int16_t>(x) + static_cast<int16_t>(y))
+        N2T_VM_BINARY(SUB, static_cast<int16_t>(x) - static_cast<int16_t>(y))
+        N2T_VM_UNARY(NEG,  -static_cast<int16_t>(y))
+        N2T_VM_BINARY(EQ,  x == y ? 0xFFFF : 0)
+        N2T_VM_BINARY(GT,  static_cast<int16_t>(x) > static_cast<int16_t>(y) ? 0xFFFF : 0)
+        N2T_VM_BINARY(LT,  static_cast<int16_t>(x) < static_cast<int16_t>(y) ? 0xFFFF : 0)
+        N2T_VM_BINARY(AND, x & y)
+        N2T_VM_BINARY(OR,  x | y)
+        N2T_VM_UNARY(NOT,  ~y)
+
+        // ---- Push ----
+    push_LOCAL:    N2T_VM_PUSH_FROM(ram[VMAddress::LCL] + ins->operand);
+    push_ARGUMENT: N2T_VM_PUSH_FROM(ram[VMAddress::ARG] + ins->operand);
+    push_THIS:     N2T_VM_PUSH_FROM(ram[VMAddress::THIS] + ins->operand);
+    push_THAT:     N2T_VM_PUSH_FROM(ram[VMAddress::THAT] + ins->operand);
+    push_CONSTANT: N2T_VM_PUSH_VALUE(ins->operand);
+    push_STATIC:   N2T_VM_PUSH_FROM(ins->operand);
+    push_TEMP:
+        if (ins->operand >= VMAddress::TEMP_SIZE) goto slow;
+        N2T_VM_PUSH_FROM(VMAddress::TEMP_BASE + ins->operand);
+    push_POINTER:
+        if (ins->operand > 1) goto slow;
+        N2T_VM_PUSH_FROM(VMAddress::THIS + ins->operand);
+
+        // ---- Pop ----
+    pop_LOCAL:     N2T_VM_POP_TO(ram[VMAddress::LCL] + ins->operand);
+    pop_ARGUMENT:  N2T_VM_POP_TO(ram[VMAddress::ARG] + ins->operand);
+    pop_THIS:      N2T_VM_POP_TO(ram[VMAddress::THIS] + ins->operand);
+    pop_THAT:      N2T_VM_POP_TO(ram[VMAddress::THAT] + ins->operand);
+    pop_STATIC:    N2T_VM_POP_TO(ins->operand);
+    pop_TEMP:
+        if (ins->operand >= VMAddress::TEMP_SIZE) goto slow;
+        N2T_VM_POP_TO(VMAddress::TEMP_BASE + ins->operand);
+    pop_POINTER:
+        if (ins->operand > 1) goto slow;
+        N2T_VM_POP_TO(VMAddress::THIS + ins->operand);
+
+        // ---- Program flow ----
+    op_NEXT:
+        pc++;
+        N2T_VM_RETIRE();
+
+    op_GOTO:
+        if (ins->target == LinkedProgram::UNRESOLVED) goto slow;
+        pc = ins->target;
+        N2T_VM_RETIRE();
+
+    op_IF_GOTO: {
+        if (sp <= VMAddress::STACK_BASE) goto slow;
+        Word condition = tos;
+        if (condition != 0 && ins->target == LinkedProgram::UNRESOLVED) goto slow;
+        sp--;
+        tos = ram[sp - 1];
+        pc = condition != 0 ? ins->target : pc + 1;
+        N2T_VM_RETIRE();
+    }
+
+        // ---- Superinstructions ----
+        // push constant N; add|sub. The constant stays in RAM above SP.
+    op_ADD_CONSTANT:
+    op_SUB_CONSTANT: {
+        N2T_VM_FUSED_BEGIN(2);
+        if (sp <= VMAddress::STACK_BASE || sp > VMAddress::STACK_MAX) goto plain_instruction;
+        int16_t x = static_cast<int16_t>(tos);
+        int16_t y = static_cast<int16_t>(ins->operand);
+        ram[sp] = ins->operand;
+        tos = static_cast<Word>(ins->op == LinkedOp::ADD_CONSTANT ? x + y : x - y);
+        ram[sp - 1] = tos;
+        stats.push_count++;
+        stats.arithmetic_count++;
+        pc += 2;
+        N2T_VM_FUSED_RETIRE(2);
+    }
+
+    move_LOCAL:    N2T_VM_MOVE_FROM(ram[VMAddress::LCL] + ins->operand);
+    move_ARGUMENT: N2T_VM_MOVE_FROM(ram[VMAddress::ARG] + ins->operand);
+    move_THIS:     N2T_VM_MOVE_FROM(ram[VMAddress::THIS] + ins->operand);
+    move_THAT:     N2T_VM_MOVE_FROM(ram[VMAddress::THAT] + ins->operand);
+    move_CONSTANT: N2T_VM_MOVE_VALUE(ins->operand);
+    move_STATIC:   N2T_VM_MOVE_FROM(ins->operand);
+    move_TEMP:
+        if (ins->operand >= VMAddress::TEMP_SIZE) goto plain_instruction;
+        N2T_VM_MOVE_FROM(VMAddress::TEMP_BASE + ins->operand);
+    move_POINTER:
+        if (ins->operand > 1) goto plain_instruction;
+        N2T_VM_MOVE_FROM(VMAddress::THIS + ins->operand);
+
+        N2T_VM_LOCALS_GOTO(LOCALS_LT_GOTO, 4, x < y)
+        N2T_VM_LOCALS_GOTO(LOCALS_GT_GOTO, 4, x > y)
+        N2T_VM_LOCALS_GOTO(LOCALS_EQ_GOTO, 4, x == y)
+        N2T_VM_LOCALS_GOTO(LOCALS_GE_GOTO, 5, !(x < y))
+        N2T_VM_LOCALS_GOTO(LOCALS_LE_GOTO, 5, !(x > y))
+        N2T_VM_LOCALS_GOTO(LOCALS_NE_GOTO, 5, !(x == y))
+
+        // The first command of the sequence, on its own
+    plain_instruction:
+        ins = &plain[pc];
+        N2T_VM_JUMP();
+
+        // ---- Slow path: one command through execute_command() ----
+    slow:
+        N2T_VM_SYNC();
+        if (execute_command()) {
+            remaining--;
+        }
+        if (state_ != VMState::RUNNING) {
+            return;
+        }
+        pc = pc_;
+        stats = stats_;
+        sp = ram[VMAddress::SP];
+        if (!fast_sp(sp)) {
+            run_switch(remaining + budget_left);
+            return;
+        }
+        tos = ram[sp - 1];
+        N2T_VM_DISPATCH();
+
+        // ---- Exits ----
+    halted:
+        N2T_VM_SYNC();
+        state_ = VMState::HALTED;
+        return;
+
+    user_pause:
+        N2T_VM_SYNC();
+        pause_requested_ = false;
+        state_ = VMState::PAUSED;
+        pause_reason_ = PauseReason::USER_REQUEST;
+        return;
+
+    breakpoint_hit:
+        N2T_VM_SYNC();
+        state_ = VMState::PAUSED;
+        pause_reason_ = PauseReason::BREAKPOINT;
+        return;
+
+    budget_exhausted:
+        N2T_VM_SYNC();
+        return;
+    }
+
+#undef N2T_VM_EVERY_SEGMENT
+#undef N2T_VM_LOCALS_GOTO
+#undef N2T_VM_MOVE_FROM
+#undef N2T_VM_MOVE_VALUE
+#undef N2T_VM_FUSED_RETIRE
+#undef N2T_VM_FUSED_BEGIN
+#undef N2T_VM_POP_TO
+#undef N2T_VM_PUSH_FROM
+#undef N2T_VM_PUSH_VALUE
+#undef N2T_VM_UNARY
+#undef N2T_VM_BINARY
+#undef N2T_VM_SYNC
+#undef N2T_VM_RETIRE
+#undef N2T_VM_DISPATCH
+#undef N2T_VM_JUMP
+}
+
+#if N2T_VM_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+}  // namespace n2t
@@ -2,11 +2,25 @@
 // CPU Engine Tests
 // ==============================================================================
 
+#include "assembler.hpp"
 #include "cpu.hpp"
+#include "cpu_cfg.hpp"
+#include "cpu_farm.hpp"
+#include "cpu_lockstep.hpp"
+#include "cpu_profile.hpp"
+#include "disassembly.hpp"
 #include "instruction.hpp"
 #include "memory.hpp"
+#include "rom_image.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <cassert>
+#include <thread>
 
 using namespace n2t;
 
@@ -108,6 +122,34 @@ void test_disassembly() {
           "disassemble ADM=D+1");
 }
 
+void test_predecode() {
+    // @5 => LOAD_A with immediate
+    MicroOp op = predecode_instruction(0b0000000000000101);
+    check(op.op == AluOp::LOAD_A && op.value == 5, "predecode @5");
+
+    // M=D+M => D_PLUS_X, dest M, reads M
+    op = predecode_instruction(0b1111000010001000);
+    check(op.op == AluOp::D_PLUS_X, "predecode M=D+M handler");
+    check(op.dest == 0x1 && op.reads_m, "predecode M=D+M dest/reads_m");
+
+    // D=D+A shares the handler but not the M read
+    op = predecode_instruction(0b1110000010010000);
+    check(op.op == AluOp::D_PLUS_X && !op.reads_m, "predecode D=D+A handler");
+
+    // D;JLE keeps the jjj mask
+    op = predecode_instruction(0b1110001100000110);
+    check(op.op == AluOp::D && op.jump == 0x6, "predecode D;JLE jump mask");
+
+    // Invalid comp bits decode to INVALID instead of throwing
+    op = predecode_instruction(0b1110100100010000);
+    check(op.op == AluOp::INVALID, "predecode invalid comp");
+
+    // Jump masks against signed outputs
+    check(jump_taken(0x4, 0xFFFF) && !jump_taken(0x4, 0), "jump_taken JLT");
+    check(jump_taken(0x3, 0) && jump_taken(0x3, 7), "jump_taken JGE");
+    check(!jump_taken(0x5, 0), "jump_taken JNE on zero");
+}
+
 // ==============================================================================
 // Memory Tests
 // ==============================================================================
@@ -144,6 +186,21 @@ void test_memory() {
     mem.write_ram(16384, 0xFFFF);  // Write to screen memory
     check(mem.screen_dirty(), "screen dirty after write to screen address");
 
+    // Per-row tracking and deltas
+    mem.clear_screen_dirty();
+    mem.write_ram(CPUAddress::SCREEN_BASE + 5 * 32 + 31, 0x8001);  // Row 5
+    mem.write_ram(CPUAddress::SCREEN_BASE + 200 * 32, 0x00FF);     // Row 200
+    mem.write_ram(CPUAddress::KEYBOARD, 65);                       // Not screen
+    check(mem.screen_row_dirty(5) && mem.screen_row_dirty(200) && !mem.screen_row_dirty(6),
+          "screen rows marked individually");
+    ScreenDelta delta = mem.take_screen_delta();
+    check(delta.rows == std::vector<uint8_t>{5, 200} && delta.words.size() == 64 &&
+          delta.words[31] == 0x8001 && delta.words[32] == 0x00FF,
+          "screen delta holds the written rows");
+    check(!mem.screen_dirty() && mem.take_dirty_rows().empty(), "taking a delta clears it");
+    mem.load_ram(mem.ram_ptr());
+    check(mem.take_dirty_rows().size() == CPUAddress::SCREEN_ROWS, "load_ram marks every row");
+
     // Pixel access
     mem.reset();
     mem.set_pixel(0, 0, true);
@@ -444,6 +501,66 @@ void test_cpu_dest_am_overlap() {
     check(cpu.read_ram(50) == 101, "AM=D+1: RAM[50]=101 (original A used for M write)");
 }
 
+void test_cpu_invalid_instruction() {
+    // A corrupted comp code loads fine but is a runtime error when reached
+    CPUEngine cpu;
+    cpu.load(std::vector<Word>{5, 0b1110100100010000});
+    CPUState state = cpu.run();
+    check(state == CPUState::ERROR, "invalid comp is a runtime error");
+    check(cpu.get_error_location() == 1, "invalid comp error location");
+    check(cpu.get_a() == 5, "state before the invalid instruction kept");
+    check(cpu.get_error_code() == CPUErrorCode::INVALID_INSTRUCTION,
+          "invalid comp error code");
+}
+
+void test_cpu_check_modes() {
+    std::cout << "\n--- Check Modes ---\n";
+
+    // A=-1, AM=1: checked stops with the memory accessor's own message
+    const std::vector<Word> wild_write = {
+        0b1110111010100000,   // A=-1
+        0b1110111111101000};  // AM=1
+    std::string expected;
+    try {
+        CPUMemory().write_ram(0xFFFF, 1);
+    } catch (const RuntimeError& e) {
+        expected = e.what();
+    }
+
+    for (CPUDispatch mode : {CPUDispatch::SWITCH, CPUDispatch::THREADED}) {
+        CPUEngine cpu;
+        cpu.set_dispatch(mode);
+        cpu.load(wild_write);
+        cpu.run();
+        check(cpu.get_error_code() == CPUErrorCode::RAM_WRITE_OUT_OF_RANGE &&
+              cpu.get_error_message() == expected && cpu.get_error_location() == 1,
+              "checked write error code and message");
+    }
+
+    CPUEngine reader;
+    reader.load(std::vector<Word>{0b1110111010100000, 0b1111110000010000});  // A=-1, D=M
+    reader.run();
+    check(reader.get_error_code() == CPUErrorCode::RAM_READ_OUT_OF_RANGE,
+          "checked read error code");
+    reader.reset();
+    check(reader.get_error_code() == CPUErrorCode::NONE, "reset clears error code");
+
+    // Unchecked: addresses wrap to 15 bits, no error
+    for (CPUDispatch mode : {CPUDispatch::SWITCH, CPUDispatch::THREADED}) {
+        CPUEngine cpu;
+        cpu.set_dispatch(mode);
+        cpu.set_check_mode(CPUCheckMode::UNCHECKED);
+        check(cpu.get_check_mode() == CPUCheckMode::UNCHECKED, "check mode selectable");
+        cpu.load(std::vector<Word>{
+            0b1110111010100000,   // A=-1
+            0b1110111111001000,   // M=1        (RAM[32767])
+            0b1111110000010000}); // D=M
+        cpu.run();
+        check(cpu.get_state() == CPUState::HALTED && cpu.read_ram(32767) == 1 &&
+              cpu.get_d() == 1, "unchecked access wraps to 15 bits");
+    }
+}
+
 void test_cpu_negative_arithmetic() {
     // Test signed comparison: -1 < 0
     // @1 / D=A / D=-D / @10 / D;JLT
@@ -459,6 +576,1124 @@ void test_cpu_negative_arithmetic() {
     check(cpu.get_pc() == 10, "negative jump: D=-1, JLT taken");
 }
 
+void test_cpu_breakpoint_set() {
+    std::cout << "\n--- Breakpoint Set and Pause ---\n";
+
+    CPUEngine cpu;
+    cpu.add_breakpoint(300);
+    cpu.add_breakpoint(7);
+    cpu.add_breakpoint(300);
+    cpu.add_breakpoint(40000);  // Past the end of ROM: ignored
+    check(cpu.get_breakpoints() == std::vector<Address>({7, 300}),
+          "breakpoints listed once, in address order");
+    check(cpu.has_breakpoint(7) && !cpu.has_breakpoint(8) && !cpu.has_breakpoint(40000),
+          "has_breakpoint");
+    cpu.remove_breakpoint(7);
+    check(cpu.get_breakpoints() == std::vector<Address>({300}), "remove_breakpoint");
+
+    // A pause from another thread stops an endless loop in every core
+    for (CPUDispatch mode : {CPUDispatch::SWITCH, CPUDispatch::THREADED,
+                             CPUDispatch::BLOCK, CPUDispatch::JIT}) {
+        CPUEngine looping;
+        looping.set_dispatch(mode);
+        looping.load(std::vector<Word>{0, 0b1110101010000111});  // @0 0;JMP
+        std::atomic<bool> finished{false};
+        std::thread runner([&looping, &finished]() {
+            looping.run();
+            finished = true;
+        });
+        // run() clears stale requests on entry, so keep asking until it stops
+        while (!finished) {
+            looping.pause();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        runner.join();
+        check(looping.get_state() == CPUState::PAUSED &&
+              looping.get_pause_reason() == CPUPauseReason::USER_REQUEST,
+              "pause() from another thread stops run()");
+    }
+}
+
+// ==============================================================================
+// Dispatch Core Equivalence
+// ==============================================================================
+
+// Mult: RAM[2] = RAM[0] * RAM[1] by repeated addition, then (END) loop.
+static const std::vector<Word> MULT_PROGRAM = {
+    2,      0b1110101010001000,  // @2   M=0
+    0,      0b1111110000010000,  // @0   D=M
+    18,     0b1110001100000010,  // @END D;JEQ       (LOOP at 4)
+    1,      0b1111110000010000,  // @1   D=M
+    2,      0b1111000010001000,  // @2   M=D+M
+    0,      0b1111110010001000,  // @0   M=M-1
+    0,      0b1111110000010000,  // @0   D=M
+    4,      0b1110001100000101,  // @LOOP D;JNE
+    18,     0b1110101010000111,  // @END 0;JMP       (END at 18)
+};
+
+static bool same_machine(const CPUEngine& x, const CPUEngine& y) {
+    const auto& sx = x.get_stats();
+    const auto& sy = y.get_stats();
+    for (Address addr = 0; addr < 32; addr++) {
+        if (x.read_ram(addr) != y.read_ram(addr)) return false;
+    }
+    return x.get_state() == y.get_state() &&
+           x.get_pause_reason() == y.get_pause_reason() &&
+           x.get_a() == y.get_a() && x.get_d() == y.get_d() &&
+           x.get_pc() == y.get_pc() &&
+           x.get_error_message() == y.get_error_message() &&
+           x.get_error_location() == y.get_error_location() &&
+           sx.instructions_executed == sy.instructions_executed &&
+           sx.a_instruction_count == sy.a_instruction_count &&
+           sx.c_instruction_count == sy.c_instruction_count &&
+           sx.jump_count == sy.jump_count &&
+           sx.memory_reads == sy.memory_reads &&
+           sx.memory_writes == sy.memory_writes;
+}
+
+void test_cpu_threaded_dispatch() {
+    std::cout << "\n--- Threaded Dispatch ---\n";
+
+    CPUEngine sw, th;
+    th.set_dispatch(CPUDispatch::THREADED);
+    check(th.get_dispatch() == CPUDispatch::THREADED, "dispatch mode selectable");
+
+    // Budgeted run through a multiply loop, then resume to the END loop
+    for (CPUEngine* cpu : {&sw, &th}) {
+        cpu->load(MULT_PROGRAM);
+        cpu->write_ram(0, 7);
+        cpu->write_ram(1, 9);
+        cpu->run_for(50);
+    }
+    check(same_machine(sw, th), "threaded matches switch mid-run");
+    for (CPUEngine* cpu : {&sw, &th}) cpu->run_for(1000);
+    check(sw.read_ram(2) == 63 && same_machine(sw, th), "threaded Mult 7*9 = 63");
+
+    // Breakpoint inside the loop, then continue
+    for (CPUEngine* cpu : {&sw, &th}) {
+        cpu->reset();
+        cpu->load(MULT_PROGRAM);
+        cpu->write_ram(0, 3);
+        cpu->write_ram(1, 4);
+        cpu->add_breakpoint(10);
+        cpu->run();
+    }
+    check(th.get_pause_reason() == CPUPauseReason::BREAKPOINT && same_machine(sw, th),
+          "threaded breakpoint matches switch");
+
+    // Halt past the end of ROM
+    for (CPUEngine* cpu : {&sw, &th}) {
+        cpu->reset();
+        cpu->clear_breakpoints();
+        cpu->load_string("0000000000000101\n1110110000010000\n");
+        cpu->run();
+    }
+    check(th.get_state() == CPUState::HALTED && same_machine(sw, th),
+          "threaded halt matches switch");
+
+    // Out-of-bounds M write: A=-1, AM=1 updates A before failing
+    for (CPUEngine* cpu : {&sw, &th}) {
+        cpu->reset();
+        cpu->load(std::vector<Word>{
+            0b1110111010100000,   // A=-1
+            0b1110111111101000}); // AM=1
+        cpu->run();
+    }
+    check(th.get_state() == CPUState::ERROR && same_machine(sw, th),
+          "threaded runtime error matches switch");
+
+    // Pause request is honored before the first instruction
+    for (CPUEngine* cpu : {&sw, &th}) {
+        cpu->reset();
+        cpu->load(MULT_PROGRAM);
+        cpu->pause();
+        cpu->run_for(10);
+        cpu->pause();
+        cpu->run_for(0);
+    }
+    check(same_machine(sw, th), "threaded pause/zero budget matches switch");
+}
+
+// Shared checks for the cores that translate basic blocks
+static void check_translated_dispatch(CPUDispatch mode, const std::string& name) {
+    std::cout << "\n--- " << name << " Dispatch ---\n";
+
+    CPUEngine sw, fast;
+    fast.set_dispatch(mode);
+    check(fast.get_dispatch() == mode, name + " dispatch selectable");
+
+    // Every budget must stop on exactly the same instruction
+    bool budgets_match = true;
+    for (uint64_t budget = 1; budget <= 80; budget++) {
+        for (CPUEngine* cpu : {&sw, &fast}) {
+            cpu->reset();
+            cpu->load(MULT_PROGRAM);
+            cpu->write_ram(0, 5);
+            cpu->write_ram(1, 6);
+            cpu->run_for(budget);
+        }
+        budgets_match = budgets_match && same_machine(sw, fast);
+    }
+    check(budgets_match, name + " matches switch for every run_for budget");
+    for (CPUEngine* cpu : {&sw, &fast}) cpu->run_for(1000);
+    check(fast.read_ram(2) == 30 && same_machine(sw, fast), name + " Mult 5*6 = 30");
+
+    // Breakpoints split blocks and are honored on resume
+    for (CPUEngine* cpu : {&sw, &fast}) {
+        cpu->reset();
+        cpu->load(MULT_PROGRAM);
+        cpu->write_ram(0, 3);
+        cpu->write_ram(1, 4);
+        cpu->add_breakpoint(11);
+        cpu->run();
+        cpu->run();
+    }
+    check(fast.get_pause_reason() == CPUPauseReason::BREAKPOINT && same_machine(sw, fast),
+          name + " breakpoint matches switch");
+    for (CPUEngine* cpu : {&sw, &fast}) {
+        cpu->clear_breakpoints();
+        cpu->run_for(1000);
+    }
+    check(same_machine(sw, fast), name + " resumes after breakpoints are cleared");
+
+    // Screen writes leave native code so dirty tracking still works
+    fast.reset();
+    fast.load(std::vector<Word>{
+        CPUAddress::SCREEN_BASE,
+        0b1110111010001000});  // M=-1
+    fast.run();
+    check(fast.read_ram(CPUAddress::SCREEN_BASE) == 0xFFFF && fast.memory().screen_dirty(),
+          name + " screen write tracked");
+
+    // Out-of-bounds M write reports the interpreter's error
+    for (CPUEngine* cpu : {&sw, &fast}) {
+        cpu->reset();
+        cpu->load(std::vector<Word>{
+            0b1110111010100000,   // A=-1
+            0b1110111111101000}); // AM=1
+        cpu->run();
+    }
+    check(fast.get_state() == CPUState::ERROR && same_machine(sw, fast),
+          name + " runtime error matches switch");
+
+    // Reloading the ROM drops stale translations
+    for (CPUEngine* cpu : {&sw, &fast}) {
+        cpu->reset();
+        cpu->load_string("0000000000000101\n1110110000010000\n");
+        cpu->run();
+        cpu->load_string("0000000000001001\n1110110000010000\n");
+        cpu->run();
+    }
+    check(fast.get_d() == 9 && same_machine(sw, fast), name + " retranslates after reload");
+
+    // Random programs over every comp/dest/jump encoding
+    static const Word COMPS[] = {
+        0b0101010, 0b0111111, 0b0111010, 0b0001100, 0b0110000, 0b0001101,
+        0b0110001, 0b0001111, 0b0110011, 0b0011111, 0b0110111, 0b0001110,
+        0b0110010, 0b0000010, 0b0010011, 0b0000111, 0b0000000, 0b0010101,
+        0b1110000, 0b1110001, 0b1110011, 0b1110111, 0b1110010, 0b1000010,
+        0b1010011, 0b1000111, 0b1000000, 0b1010101};
+    uint32_t seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) & 0x7FFF;
+    };
+    bool random_match = true;
+    for (int trial = 0; trial < 50 && random_match; trial++) {
+        std::vector<Word> program;
+        for (int i = 0; i < 200; i++) {
+            if (next() % 2 == 0) {
+                // Mostly plain RAM, sometimes a program address or the screen
+                uint32_t kind = next() % 8;
+                Word value = kind < 5 ? static_cast<Word>(next() % 64)
+                           : kind < 7 ? static_cast<Word>(next() % 200)
+                           : static_cast<Word>(CPUAddress::SCREEN_BASE + next() % 16);
+                program.push_back(value);
+            } else {
+                Word comp = COMPS[next() % 28];
+                Word dest = static_cast<Word>(next() % 8);
+                Word jump = next() % 4 == 0 ? static_cast<Word>(next() % 8) : 0;
+                program.push_back(static_cast<Word>(0xE000 | (comp << 6) | (dest << 3) | jump));
+            }
+        }
+        for (CPUEngine* cpu : {&sw, &fast}) {
+            cpu->reset();
+            cpu->load(program);
+            cpu->run_for(5000);
+        }
+        random_match = same_machine(sw, fast);
+        for (Address addr = 0; addr < CPUAddress::RAM_SIZE && random_match; addr++) {
+            random_match = sw.read_ram(addr) == fast.read_ram(addr);
+        }
+    }
+    check(random_match, name + " matches switch on random programs");
+}
+
+void test_cpu_block_dispatch() {
+    check_translated_dispatch(CPUDispatch::BLOCK, "Block");
+}
+
+void test_cpu_jit_dispatch() {
+    check_translated_dispatch(CPUDispatch::JIT, "JIT");
+}
+
+void test_cpu_idle_detection() {
+    std::cout << "\n--- Idle Loop Detection ---\n";
+
+    for (CPUDispatch mode : {CPUDispatch::SWITCH, CPUDispatch::THREADED,
+                             CPUDispatch::BLOCK, CPUDispatch::JIT}) {
+        // RAM[0] = 7, then (END) @END; 0;JMP
+        CPUEngine cpu;
+        cpu.set_dispatch(mode);
+        cpu.set_idle_detection(true);
+        cpu.load(std::vector<Word>{
+            7, 0b1110110000010000,   // @7   D=A
+            0, 0b1110001100001000,   // @0   M=D
+            4, 0b1110101010000111}); // @END 0;JMP
+        CPUState state = cpu.run_for(1000000);
+        check(state == CPUState::PAUSED &&
+              cpu.get_pause_reason() == CPUPauseReason::IDLE_LOOP &&
+              cpu.read_ram(0) == 7 && cpu.get_stats().instructions_executed <= 10000,
+              "END loop stops the run early");
+
+        // Keyboard busy-wait: (LOOP) @KBD; D=M; @LOOP; D;JEQ
+        CPUEngine waiter;
+        waiter.set_dispatch(mode);
+        waiter.set_idle_detection(true);
+        waiter.load(std::vector<Word>{
+            CPUAddress::KEYBOARD, 0b1111110000010000,   // @KBD  D=M
+            0,                    0b1110001100000010}); // @LOOP D;JEQ
+        waiter.run();
+        check(waiter.get_pause_reason() == CPUPauseReason::IDLE_LOOP,
+              "keyboard busy-wait detected");
+        waiter.set_keyboard(65);
+        check(waiter.run() == CPUState::HALTED && waiter.get_d() == 65,
+              "busy-wait resumes after a key press");
+    }
+
+    // A loop that writes RAM is not idle
+    CPUEngine counter;
+    counter.set_idle_detection(true);
+    counter.load(std::vector<Word>{
+        0, 0b1111110111001000,   // @0 M=M+1
+        0, 0b1110101010000111}); // @0 0;JMP
+    counter.run_for(20000);
+    check(counter.get_pause_reason() == CPUPauseReason::USER_REQUEST &&
+          counter.get_stats().instructions_executed == 20000,
+          "loop with RAM writes runs its full budget");
+
+    // Off by default
+    CPUEngine plain;
+    check(!plain.get_idle_detection(), "idle detection off by default");
+}
+
+void test_cpu_farm() {
+    std::cout << "\n--- CPU Farm ---\n";
+
+    auto program = CPUMemory::make_program(MULT_PROGRAM);
+
+    std::vector<CPUScenario> scenarios;
+    for (Word x = 0; x < 24; x++) {
+        CPUScenario scenario;
+        scenario.ram = {{0, x}, {1, static_cast<Word>(x + 3)}};
+        scenarios.push_back(scenario);
+    }
+    scenarios[5].max_instructions = 10;  // Runs out of budget mid-loop
+
+    CPUFarm::Options options;
+    options.threads = 4;
+    CPUFarm farm(program, options);
+    auto results = farm.run(scenarios, {{0, 3}});
+
+    bool all_match = results.size() == scenarios.size();
+    for (size_t i = 0; i < results.size() && all_match; i++) {
+        CPUEngine reference;
+        reference.load(MULT_PROGRAM);
+        for (const auto& [address, value] : scenarios[i].ram) reference.write_ram(address, value);
+        reference.run_for(scenarios[i].max_instructions);
+
+        const CPURunResult& r = results[i];
+        all_match = r.state == reference.get_state() &&
+                    r.stats.instructions_executed == reference.get_stats().instructions_executed &&
+                    r.regions.size() == 1 && r.regions[0].size() == 3 &&
+                    r.regions[0][2] == reference.read_ram(2);
+    }
+    check(all_match, "farm results match sequential runs");
+    check(results[7].regions[0][2] == 70, "farm Mult 7*10 = 70");
+    check(results[5].state == CPUState::PAUSED, "farm honors per-scenario budget");
+    check(program.use_count() == 2, "farm shares one program and releases it");
+
+    // Keyboard script: wait for a key, store it in RAM[100], then END
+    std::vector<Word> wait_key = {
+        CPUAddress::KEYBOARD, 0b1111110000010000,   // @KBD D=M
+        0,                    0b1110001100000010,   // @0   D;JEQ
+        100,                  0b1110001100001000,   // @100 M=D
+        6,                    0b1110101010000111};  // @6   0;JMP
+    CPUScenario typing;
+    typing.keyboard = {{50000, 65}};
+    typing.max_instructions = 100000;
+    CPUFarm key_farm(CPUMemory::make_program(wait_key));
+    auto typed = key_farm.run({typing}, {{100, 1}});
+    check(typed[0].regions[0][0] == 65 &&
+          typed[0].pause_reason == CPUPauseReason::IDLE_LOOP &&
+          typed[0].stats.instructions_executed < 50000,
+          "idle wait fast-forwards to the next key event");
+
+    CPUScenario bad;
+    bad.ram = {{40000, 1}};
+    bool threw = false;
+    try {
+        farm.run({bad}, {});
+    } catch (const RuntimeError&) {
+        threw = true;
+    }
+    check(threw, "farm rejects out-of-range RAM patches");
+
+    // start + length would wrap around to a small number
+    threw = false;
+    try {
+        farm.run({scenarios[0]}, {{16, SIZE_MAX - 8}});
+    } catch (const RuntimeError&) {
+        threw = true;
+    }
+    check(threw, "farm rejects RAM regions whose end overflows");
+}
+
+void test_cpu_lockstep() {
+    std::cout << "\n--- CPU Lockstep ---\n";
+
+    constexpr size_t LANES = CPULockstep::LANES;
+    CPULockstep lockstep(CPUMemory::make_program(MULT_PROGRAM));
+
+    // Different loop counts per lane: the lanes diverge and reconverge
+    auto setup = [&]() {
+        lockstep.reset();
+        for (size_t l = 0; l < LANES; l++) {
+            lockstep.write_ram(l, 0, static_cast<Word>(l % 5));
+            lockstep.write_ram(l, 1, static_cast<Word>(l + 3));
+        }
+    };
+    auto matches_engine = [&](uint64_t budget) {
+        for (size_t l = 0; l < LANES; l++) {
+            CPUEngine reference;
+            reference.load(MULT_PROGRAM);
+            reference.write_ram(0, static_cast<Word>(l % 5));
+            reference.write_ram(1, static_cast<Word>(l + 3));
+            reference.run_for(budget);
+            if (lockstep.state(l) != reference.get_state() ||
+                lockstep.a(l) != reference.get_a() || lockstep.d(l) != reference.get_d() ||
+                lockstep.pc(l) != reference.get_pc() ||
+                lockstep.instructions_executed(l) != reference.get_stats().instructions_executed) {
+                return false;
+            }
+            for (Address addr = 0; addr < 3; addr++) {
+                if (lockstep.read_ram(l, addr) != reference.read_ram(addr)) return false;
+            }
+        }
+        return true;
+    };
+
+    setup();
+    lockstep.run_for(1000);
+    check(matches_engine(1000), "lockstep lanes match CPUEngine");
+    check(lockstep.read_ram(9, 2) == 48, "lockstep lane 9: Mult 4*12 = 48");
+    check(lockstep.full_steps() > 0 && lockstep.masked_steps() > 0,
+          "lockstep runs both full and masked steps");
+
+    bool budgets_match = true;
+    for (uint64_t budget : {1, 7, 23, 40}) {
+        setup();
+        lockstep.run_for(budget);
+        budgets_match = budgets_match && matches_engine(budget);
+    }
+    check(budgets_match, "lockstep honors per-lane budgets");
+
+    // Lanes with an out-of-range pointer fail alone, with CPUEngine's message
+    std::vector<Word> deref = {
+        0, 0b1111110000100000,   // @0 A=M
+        0b1111110000010000,      // D=M
+        1, 0b1110001100001000};  // @1 M=D
+    CPULockstep pointers(CPUMemory::make_program(deref));
+    pointers.reset();
+    for (size_t l = 0; l < LANES; l++) {
+        pointers.write_ram(l, 0, static_cast<Word>(l % 2 ? 40000 : 100 + l));
+        pointers.write_ram(l, static_cast<Address>(100 + l), static_cast<Word>(l * 3));
+    }
+    pointers.run_for(100);
+    CPUEngine faulty;
+    faulty.load(deref);
+    faulty.write_ram(0, 40000);
+    faulty.run_for(100);
+    check(pointers.state(1) == CPUState::ERROR &&
+          pointers.error_message(1) == faulty.get_error_message(),
+          "lockstep lane error matches CPUEngine");
+    check(pointers.state(4) == CPUState::HALTED && pointers.read_ram(4, 1) == 12,
+          "lockstep healthy lanes finish after a lane error");
+
+    // Every lane writing past RAM at once: the failed lanes must not be
+    // written as one row
+    std::vector<Word> overflow = {
+        32767,                   // @32767
+        0b1110110111100000,      // A=A+1
+        0b1110101010001000};     // M=0
+    CPULockstep writers(CPUMemory::make_program(overflow));
+    writers.reset();
+    writers.run_for(10);
+    CPUEngine single;
+    single.load(overflow);
+    single.run_for(10);
+    bool all_failed = single.get_state() == CPUState::ERROR;
+    for (size_t l = 0; l < LANES; l++) {
+        all_failed = all_failed && writers.state(l) == CPUState::ERROR &&
+                     writers.error_message(l) == single.get_error_message();
+    }
+    check(all_failed, "lockstep out-of-range write fails every lane");
+}
+
+void test_cpu_reverse_execution() {
+    std::cout << "\n--- CPU Reverse Execution ---\n";
+
+    auto matches = [](const CPUEngine& x, const CPUEngine& y) {
+        return x.get_a() == y.get_a() && x.get_d() == y.get_d() &&
+               x.get_pc() == y.get_pc() &&
+               x.get_stats().instructions_executed == y.get_stats().instructions_executed &&
+               x.get_stats().memory_writes == y.get_stats().memory_writes &&
+               x.read_ram(0) == y.read_ram(0) && x.read_ram(1) == y.read_ram(1) &&
+               x.read_ram(2) == y.read_ram(2);
+    };
+
+    CPUEngine cpu;
+    cpu.set_history_enabled(true);
+    cpu.set_checkpoint_interval(10);
+    cpu.load(MULT_PROGRAM);
+    cpu.write_ram(0, 7);
+    cpu.write_ram(1, 9);
+    check(cpu.run() == CPUState::HALTED && cpu.read_ram(2) == 63, "recorded run gives the same result");
+    uint64_t total = cpu.get_stats().instructions_executed;
+    check(cpu.history_depth() == total, "history covers the whole run");
+
+    // Step back one instruction at a time, comparing with a fresh replay
+    bool all_match = true;
+    for (uint64_t at = total; at-- > 0;) {
+        cpu.step_back();
+        CPUEngine expected;
+        expected.load(MULT_PROGRAM);
+        expected.write_ram(0, 7);
+        expected.write_ram(1, 9);
+        if (at > 0) expected.run_for(at);
+        all_match = all_match && matches(cpu, expected) &&
+                    cpu.get_state() == CPUState::PAUSED;
+    }
+    check(all_match, "step_back visits every earlier state");
+    check(cpu.step_back() == CPUState::PAUSED &&
+          cpu.get_pause_reason() == CPUPauseReason::HISTORY_START &&
+          cpu.get_stats().instructions_executed == 0,
+          "step_back stops at the start of history");
+
+    // Forward again after going back records a new future
+    cpu.run_for(40);
+    cpu.step_back(25);
+    CPUEngine at15;
+    at15.load(MULT_PROGRAM);
+    at15.write_ram(0, 7);
+    at15.write_ram(1, 9);
+    at15.run_for(15);
+    check(matches(cpu, at15), "step_back(N) after re-recording");
+
+    // Run back to the previous time PC was at the loop's M=D+M
+    cpu.run();
+    cpu.add_breakpoint(8);
+    uint64_t before = cpu.get_stats().instructions_executed;
+    check(cpu.run_back() == CPUState::PAUSED &&
+          cpu.get_pause_reason() == CPUPauseReason::BREAKPOINT &&
+          cpu.get_pc() == 8 && cpu.read_ram(0) == 1 && cpu.read_ram(2) == 54,
+          "run_back stops at the last breakpoint hit");
+    cpu.run_back();
+    check(cpu.get_pc() == 8 && cpu.read_ram(0) == 2 && cpu.read_ram(2) == 45 &&
+          cpu.get_stats().instructions_executed < before,
+          "run_back again finds the hit before that");
+    cpu.clear_breakpoints();
+    check(cpu.run_back() == CPUState::PAUSED &&
+          cpu.get_pause_reason() == CPUPauseReason::HISTORY_START &&
+          cpu.get_stats().instructions_executed == 0,
+          "run_back without breakpoints goes to the start");
+
+    // External RAM changes between runs are undone too
+    cpu.run_for(20);
+    cpu.write_ram(1, 100);
+    cpu.run_for(5);
+    cpu.step_back(5);
+    check(cpu.read_ram(1) == 100, "step_back keeps external writes before the target");
+    cpu.step_back(1);
+    check(cpu.read_ram(1) == 9 && cpu.get_stats().instructions_executed == 19,
+          "step_back undoes external writes after the target");
+
+    // A failing instruction: the first step back leaves the error state
+    std::vector<Word> faulty = {
+        32767, 0b1110110111100000,   // @32767 A=A+1
+        0b1111110000010000};         // D=M  (RAM[32768])
+    CPUEngine failing;
+    failing.set_history_enabled(true);
+    failing.load(faulty);
+    check(failing.run() == CPUState::ERROR, "recorded run reports errors");
+    check(failing.step_back() == CPUState::PAUSED && failing.get_a() == 32768 &&
+          failing.get_pc() == 2 && failing.get_error_message().empty(),
+          "step_back from ERROR returns to before the failing instruction");
+    check(failing.step_back() == CPUState::PAUSED && failing.get_a() == 32767 &&
+          failing.get_pc() == 1, "then steps back normally");
+
+    // Memory cap: old segments are dropped, limiting the depth
+    CPUEngine capped;
+    capped.set_history_enabled(true);
+    capped.set_checkpoint_interval(10);
+    capped.set_history_limit(3 * 70 * 1024);
+    capped.load(MULT_PROGRAM);
+    capped.write_ram(0, 7);
+    capped.write_ram(1, 9);
+    capped.run();
+    uint64_t depth = capped.history_depth();
+    check(depth >= 20 && depth <= 30, "history limit drops the oldest checkpoints");
+    capped.step_back(1000);
+    check(capped.get_pause_reason() == CPUPauseReason::HISTORY_START &&
+          capped.get_stats().instructions_executed == total - depth,
+          "capped step_back ends at the oldest kept state");
+
+    // Replaying history does not count instructions into the profile or
+    // the trace a second time
+    std::vector<Word> loop = {
+        0, 0b1111110111001000,       // @0 M=M+1
+        0, 0b1110101010000111};      // @0 0;JMP
+    CPUEngine profiled;
+    profiled.set_history_enabled(true);
+    profiled.set_checkpoint_interval(4096);
+    profiled.set_instrumentation(CPUInstrumentation::PROFILE);
+    profiled.load(loop);
+    profiled.run_for(10000);
+    profiled.step_back(5000);
+    check(profiled.get_stats().instructions_executed == 5000 &&
+          profiled.get_profile()->total() == 10000,
+          "step_back leaves the profile alone");
+
+    CPUEngine traced;
+    uint64_t traced_count = 0;
+    traced.set_history_enabled(true);
+    traced.set_checkpoint_interval(4096);
+    traced.set_instrumentation(CPUInstrumentation::TRACE);
+    traced.set_trace_hook([&traced_count](Address, Word, Word) { traced_count++; });
+    traced.load(loop);
+    traced.run_for(10000);
+    traced.step_back(1);
+    traced.run_back();
+    check(traced_count == 10000 && traced.read_ram(0) == 0,
+          "step_back and run_back do not fire the trace hook");
+}
+
+void test_cpu_instrumentation() {
+    std::cout << "\n--- CPU Instrumentation ---\n";
+
+    auto run_mult = [](CPUEngine& cpu) {
+        cpu.load(MULT_PROGRAM);
+        cpu.write_ram(0, 123);
+        cpu.write_ram(1, 45);
+        return cpu.run();
+    };
+
+    CPUEngine reference;
+    run_mult(reference);
+    const CPUStats& full = reference.get_stats();
+
+    for (CPUDispatch mode : {CPUDispatch::SWITCH, CPUDispatch::THREADED,
+                             CPUDispatch::BLOCK, CPUDispatch::JIT}) {
+        CPUEngine bare;
+        bare.set_dispatch(mode);
+        bare.set_instrumentation(CPUInstrumentation::BARE);
+        check(run_mult(bare) == CPUState::HALTED && bare.read_ram(2) == reference.read_ram(2) &&
+              bare.get_a() == reference.get_a() && bare.get_d() == reference.get_d() &&
+              bare.get_stats().instructions_executed == full.instructions_executed,
+              "BARE gives the same result and instruction count");
+        check(bare.get_stats().c_instruction_count == 0 && bare.get_stats().memory_reads == 0 &&
+              bare.get_stats().jump_count == 0, "BARE keeps no other counters");
+
+        // Breakpoints and budgets still see exact instruction counts
+        CPUEngine stepped;
+        stepped.set_dispatch(mode);
+        stepped.set_instrumentation(CPUInstrumentation::BARE);
+        stepped.load(MULT_PROGRAM);
+        stepped.write_ram(0, 123);
+        stepped.write_ram(1, 45);
+        stepped.add_breakpoint(8);
+        stepped.run();
+        stepped.remove_breakpoint(8);
+        uint64_t at_breakpoint = stepped.get_stats().instructions_executed;
+        stepped.run_for(100);
+        check(at_breakpoint == 8 && stepped.get_stats().instructions_executed == 108,
+              "BARE counts exactly across breakpoints and budgets");
+    }
+
+    for (CPUDispatch mode : {CPUDispatch::SWITCH, CPUDispatch::THREADED,
+                             CPUDispatch::BLOCK, CPUDispatch::JIT}) {
+        CPUEngine traced;
+        traced.set_dispatch(mode);
+        traced.set_instrumentation(CPUInstrumentation::TRACE);
+        uint64_t calls = 0;
+        uint64_t loop_entries = 0;
+        traced.set_trace_hook([&](Address pc, Word, Word) {
+            calls++;
+            if (pc == 4) loop_entries++;
+        });
+        run_mult(traced);
+        check(calls == full.instructions_executed && loop_entries == 123 &&
+              traced.get_stats().memory_reads == full.memory_reads &&
+              traced.read_ram(2) == reference.read_ram(2),
+              "TRACE calls the hook once per instruction with full stats");
+    }
+
+    // TRACE without a hook is FULL
+    CPUEngine unhooked;
+    unhooked.set_dispatch(CPUDispatch::JIT);
+    unhooked.set_instrumentation(CPUInstrumentation::TRACE);
+    run_mult(unhooked);
+    check(unhooked.get_stats().jump_count == full.jump_count &&
+          unhooked.get_stats().instructions_executed == full.instructions_executed,
+          "TRACE without a hook counts like FULL");
+}
+
+void test_cpu_profile() {
+    std::cout << "\n--- CPU Profile ---\n";
+
+    for (CPUDispatch mode : {CPUDispatch::SWITCH, CPUDispatch::THREADED,
+                             CPUDispatch::BLOCK, CPUDispatch::JIT}) {
+        CPUEngine cpu;
+        cpu.set_dispatch(mode);
+        cpu.set_instrumentation(CPUInstrumentation::PROFILE);
+        cpu.load(MULT_PROGRAM);
+        cpu.write_ram(0, 123);
+        cpu.write_ram(1, 45);
+        cpu.run();
+        const CPUProfile& profile = *cpu.get_profile();
+        check(profile.total() == cpu.get_stats().instructions_executed &&
+              profile.executed(4) == 123 && profile.executed(0) == 1 &&
+              profile.jumps_taken(15) == 122 && profile.jumps_taken(17) == 1,
+              "per-address execution and jump counts");
+    }
+
+    // Stepping counts too, and the counts survive until cleared
+    CPUEngine cpu;
+    cpu.set_instrumentation(CPUInstrumentation::PROFILE);
+    cpu.load(MULT_PROGRAM);
+    cpu.write_ram(0, 3);
+    cpu.write_ram(1, 5);
+    while (cpu.step() == CPUState::PAUSED) {}
+    const CPUProfile& profile = *cpu.get_profile();
+    const CPUProgram& program = *cpu.memory().program();
+    check(profile.total() == cpu.get_stats().instructions_executed && profile.executed(6) == 3,
+          "step() is profiled");
+
+    auto cfg = cpu.get_cfg();
+    auto loops = profile.loops(*cfg);
+    check(loops.size() == 1 && loops[0].head == 4 && loops[0].back_edge == 15 &&
+          loops[0].iterations == 2, "Mult loop found from its back edge");
+
+    auto blocks = profile.blocks(*cfg);
+    uint64_t covered = 0;
+    bool uniform = true;
+    for (const auto& b : blocks) {
+        covered += b.instructions;
+        for (Address a = b.start; a <= b.end; a++) {
+            uniform = uniform && profile.executed(a) == b.executions;
+        }
+    }
+    check(covered == profile.total() && uniform && blocks.front().start == 0,
+          "blocks cover the program with one count each");
+
+    std::string annotated = profile.annotate(program, *cfg);
+    check(profile.report(program, *cfg).find("4-15") != std::string::npos &&
+          annotated.find("D;JNE") != std::string::npos &&
+          annotated.find("block 4-5, ran 3 times") != std::string::npos,
+          "report and annotated disassembly");
+
+    cpu.clear_profile();
+    check(profile.total() == 0, "clear_profile resets the counters");
+
+    // A back edge whose @X is not right before the jump: the profile sees
+    // the loop and the blocks the CFG sees
+    CPUEngine tracked;
+    tracked.set_instrumentation(CPUInstrumentation::PROFILE);
+    tracked.load({5,  0b1110110000010000,    // @5  D=A
+                  0b1110001110010000,        // D=D-1      (loop header)
+                  2,  0b1110001100001000,    // @2  M=D
+                  0b1110001100000001});      // D;JGT
+    tracked.run();
+    auto tracked_cfg = tracked.get_cfg();
+    auto tracked_loops = tracked.get_profile()->loops(*tracked_cfg);
+    auto tracked_blocks = tracked.get_profile()->blocks(*tracked_cfg);
+    bool same_blocks = tracked_blocks.size() == tracked_cfg->blocks().size();
+    for (size_t i = 0; same_blocks && i < tracked_blocks.size(); i++) {
+        same_blocks = tracked_blocks[i].start == tracked_cfg->blocks()[i].start &&
+                      tracked_blocks[i].end == tracked_cfg->blocks()[i].end;
+    }
+    check(same_blocks && tracked_loops.size() == 1 && tracked_loops[0].head == 2 &&
+          tracked_loops[0].back_edge == 5 && tracked_loops[0].iterations == 4 &&
+          tracked_loops[0].instructions == 20,
+          "profile blocks and loops come from the CFG");
+}
+
+void test_cpu_watchpoints() {
+    std::cout << "\n--- CPU Watchpoints ---\n";
+
+    // Every core pauses right after the watched write, whatever the dispatch
+    for (CPUDispatch mode : {CPUDispatch::SWITCH, CPUDispatch::THREADED,
+                             CPUDispatch::BLOCK, CPUDispatch::JIT}) {
+        CPUEngine cpu;
+        cpu.set_dispatch(mode);
+        cpu.load(MULT_PROGRAM);
+        cpu.write_ram(0, 3);
+        cpu.write_ram(1, 5);
+        cpu.write_ram(2, 99);
+        cpu.add_watchpoint(2, 2);
+
+        CPUState state = cpu.run();
+        const WatchHit& hit = cpu.get_watch_hit();
+        check(state == CPUState::PAUSED && cpu.get_pause_reason() == CPUPauseReason::WATCHPOINT &&
+              hit.address == 2 && hit.pc == 1 && hit.kind == WatchKind::WRITE &&
+              hit.old_value == 99 && hit.new_value == 0 && cpu.get_pc() == 2 &&
+              cpu.get_stats().instructions_executed == 2, "write watch reports old and new value");
+
+        cpu.run();
+        check(cpu.get_watch_hit().pc == 9 && cpu.get_watch_hit().old_value == 0 &&
+              cpu.get_watch_hit().new_value == 5 && cpu.read_ram(2) == 5,
+              "resuming stops at the next write");
+
+        cpu.clear_watchpoints();
+        check(cpu.run() == CPUState::HALTED && cpu.read_ram(2) == 15,
+              "run completes once the watchpoint is cleared");
+    }
+
+    // Read watches over a range; M=M-1 both reads and writes R0
+    CPUEngine cpu;
+    cpu.load(MULT_PROGRAM);
+    cpu.write_ram(0, 3);
+    cpu.write_ram(1, 5);
+    cpu.add_watchpoint(0, 1, WatchKind::READ);
+    cpu.run();
+    check(cpu.get_pause_reason() == CPUPauseReason::WATCHPOINT &&
+          cpu.get_watch_hit().kind == WatchKind::READ && cpu.get_watch_hit().address == 0 &&
+          cpu.get_watch_hit().pc == 3 && cpu.get_watch_hit().new_value == 3,
+          "read watch over a range");
+    check(cpu.remove_watchpoint(0, 1) && !cpu.remove_watchpoint(0, 1) &&
+          cpu.get_watchpoints().empty(), "watchpoints removed by range");
+
+    cpu.add_watchpoint(0, 0, WatchKind::ACCESS);
+    cpu.run();
+    check(cpu.get_watch_hit().pc == 11 && cpu.get_watch_hit().kind == WatchKind::WRITE &&
+          cpu.get_watch_hit().old_value == 3 && cpu.get_watch_hit().new_value == 2,
+          "read-modify-write reported as a write");
+
+    // step() stops with WATCHPOINT too; stepping back replays silently
+    cpu.clear_watchpoints();
+    cpu.load(MULT_PROGRAM);
+    cpu.set_history_enabled(true);
+    cpu.add_watchpoint(2, 2);
+    cpu.step();
+    cpu.step();
+    check(cpu.get_pause_reason() == CPUPauseReason::WATCHPOINT, "step() reports the watchpoint");
+    cpu.write_ram(0, 2);
+    cpu.write_ram(1, 4);
+    cpu.run();
+    cpu.step_back(3);
+    check(cpu.get_pause_reason() == CPUPauseReason::STEP_COMPLETE && cpu.get_pc() == 7,
+          "step_back replays without triggering watchpoints");
+
+    // Watching words the program never touches changes nothing else
+    CPUEngine watched;
+    CPUEngine reference;
+    for (CPUEngine* engine : {&watched, &reference}) {
+        engine->load(MULT_PROGRAM);
+        engine->write_ram(0, 200);
+        engine->write_ram(1, 7);
+    }
+    watched.add_watchpoint(300, 400, WatchKind::ACCESS);
+    watched.add_watchpoint(CPUAddress::RAM_SIZE - 1, CPUAddress::RAM_SIZE + 10);
+    check(watched.run() == reference.run() && same_machine(watched, reference),
+          "unrelated watchpoints do not change execution");
+}
+
+void test_rom_images() {
+    std::cout << "\n--- ROM Images ---\n";
+
+    // Every 16-bit value through the .hack kernel, with CRLF and blank lines
+    std::vector<Word> words;
+    std::string text;
+    for (uint32_t v = 0; v < 65536; v += 3) {
+        if (words.size() == CPUAddress::ROM_SIZE) break;
+        words.push_back(static_cast<Word>(v));
+        for (int bit = 15; bit >= 0; bit--) text += ((v >> bit) & 1) ? '1' : '0';
+        text += (v % 2) ? "\r\n" : " \n\n";
+    }
+    std::vector<Word> parsed(CPUAddress::ROM_SIZE);
+    size_t count = parse_hack_text(text.data(), text.size(), parsed.data());
+    parsed.resize(count);
+    check(parsed == words, ".hack kernel decodes every instruction");
+
+    // The last line may end the text without a newline
+    const std::string unterminated = "0000000000000111\n1111110000010000";
+    std::vector<char> exact(unterminated.begin(), unterminated.end());
+    std::vector<Word> tail(CPUAddress::ROM_SIZE);
+    size_t tail_count = parse_hack_text(exact.data(), exact.size(), tail.data());
+    check(tail_count == 2 && tail[0] == 7 && tail[1] == 0b1111110000010000,
+          ".hack last line without a newline");
+
+    std::string message;
+    try {
+        CPUMemory::parse_program("0000000000000000\n000000000000002\n");
+    } catch (const ParseError& e) { message = e.what(); }
+    check(message.find("got 15 characters") != std::string::npos,
+          "short line reported with its length");
+    message.clear();
+    try {
+        CPUMemory::parse_program("0000000010000000\n00000000100x0000\n");
+    } catch (const ParseError& e) { message = e.what(); }
+    check(message.find("Invalid character 'x' at position 12") != std::string::npos,
+          "bad character reported with its position");
+
+    // .hackb round trip, and rejection of damaged images
+    std::string image = encode_hack_binary(MULT_PROGRAM.data(), MULT_PROGRAM.size());
+    check(image.size() == HackBinary::HEADER_SIZE + 2 * MULT_PROGRAM.size() &&
+          is_hack_binary(image.data(), image.size()), ".hackb image has header and words");
+    std::vector<Word> decoded(CPUAddress::ROM_SIZE);
+    decoded.resize(parse_hack_binary(image.data(), image.size(), decoded.data()));
+    check(decoded == MULT_PROGRAM, ".hackb round trip");
+    bool threw = false;
+    try {
+        parse_hack_binary(image.data(), image.size() - 1, decoded.data());
+    } catch (const ParseError&) { threw = true; }
+    check(threw, "truncated .hackb rejected");
+
+    // Files: both formats load through load_rom_file
+    namespace fs = std::filesystem;
+    fs::path hack_path = fs::temp_directory_path() / "n2t_rom_image_test.hack";
+    fs::path hackb_path = fs::temp_directory_path() / "n2t_rom_image_test.hackb";
+    {
+        std::ofstream out(hack_path);
+        for (Word w : MULT_PROGRAM) {
+            for (int bit = 15; bit >= 0; bit--) out << (((w >> bit) & 1) ? '1' : '0');
+            out << "\n";
+        }
+    }
+    CPUMemory from_text;
+    from_text.load_rom_file(hack_path.string());
+    from_text.save_rom_binary(hackb_path.string());
+    CPUMemory from_binary;
+    from_binary.load_rom_file(hackb_path.string());
+    bool same = from_binary.rom_size() == MULT_PROGRAM.size();
+    for (size_t i = 0; same && i < MULT_PROGRAM.size(); i++) {
+        same = from_text.read_rom(static_cast<Address>(i)) == MULT_PROGRAM[i] &&
+               from_binary.read_rom(static_cast<Address>(i)) == MULT_PROGRAM[i];
+    }
+    check(same, ".hack and .hackb files load the same ROM");
+    fs::remove(hack_path);
+    fs::remove(hackb_path);
+
+    threw = false;
+    try { from_text.load_rom_file(hack_path.string()); } catch (const FileError&) { threw = true; }
+    check(threw && from_text.rom_size() == 0, "missing file throws and leaves an empty ROM");
+}
+
+// ==============================================================================
+// Assembler
+// ==============================================================================
+
+// MULT_PROGRAM's source: forward and backward labels, comments, blank lines
+static const char* MULT_ASM =
+    "// Mult: RAM[2] = RAM[0] * RAM[1]\n"   // 1
+    "\n"                                     // 2
+    "    @R2\n"                              // 3
+    "    M=0\n"                              // 4
+    "    @R0\n"                              // 5
+    "    D=M\n"                              // 6
+    "(LOOP)\n"                               // 7
+    "    @END\n"                             // 8
+    "    D;JEQ      // nothing left to add\n" // 9
+    "    @R1\n"                              // 10
+    "    D=M\n"                              // 11
+    "    @R2\n"                              // 12
+    "    M = D + M\n"                        // 13
+    "    @R0\n"                              // 14
+    "    M=M-1\n"                            // 15
+    "    @R0\n"                              // 16
+    "    D=M\n"                              // 17
+    "    @LOOP\n"                            // 18
+    "    D;JNE\n"                            // 19
+    "    @END\r\n"                           // 20
+    "    0;JMP\r\n"                          // 21
+    "(END)\r\n";                             // 22
+
+void test_assembler() {
+    std::cout << "\n--- Assembler ---\n";
+
+    AssembledProgram mult = assemble_hack(MULT_ASM, "Mult.asm");
+    check(mult.rom == MULT_PROGRAM, "Mult.asm assembles to MULT_PROGRAM");
+
+    const AsmSourceMap& map = mult.source_map;
+    check(map.line_for(0) == LineNumber(3) && map.line_for(4) == LineNumber(8) &&
+          map.line_for(17) == LineNumber(21) && !map.line_for(18),
+          "ROM addresses map to their source lines");
+    check(map.address_for_line(7) == Address(4) && map.address_for_line(1) == Address(0) &&
+          !map.address_for_line(22), "label and comment lines map to the next instruction");
+    check(map.text[9] == "M = D + M" && map.text[5] == "D;JEQ", "source text kept without comments");
+    check(map.labels_at(4) == std::vector<std::string>{"LOOP"} && map.labels_at(5).empty() &&
+          map.labels_at(18) == std::vector<std::string>{"END"} && map.symbols.at("END") == 18,
+          "labels recorded by address");
+
+    // Variables from RAM[16] in order of first use; labels used before
+    // their declaration are never variables
+    AssembledProgram vars = assemble_hack(
+        "@i\nM=1\n@sum\nM=0\n@NEXT\n0;JMP\n(NEXT)\n@i\nD=M\n@SCREEN\n@KBD\n@THAT\n@x.y$z\n");
+    check(vars.rom[0] == 16 && vars.rom[2] == 17 && vars.rom[4] == 6 && vars.rom[6] == 16 &&
+          vars.rom[8] == CPUAddress::SCREEN_BASE && vars.rom[9] == CPUAddress::KEYBOARD &&
+          vars.rom[10] == 4 && vars.rom[11] == 18, "variables, labels and predefined symbols");
+    check(assemble_hack("AMD=D|A;JMP\nMD=A+1\nDM=1+D\n").rom ==
+              std::vector<Word>{0b1110010101111111, 0b1110110111011000, 0b1110011111011000},
+          "dest permutations, jumps and commutative comps");
+
+    auto error_of = [](const std::string& source) {
+        try {
+            assemble_hack(source, "Bad.asm");
+        } catch (const ParseError& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+    check(error_of("@1\n(A)\n(A)\n").find("already defined on line 2") != std::string::npos,
+          "duplicate label reported");
+    check(error_of("@32768\n").find("does not fit in 15 bits") != std::string::npos,
+          "constant above 32767 reported");
+    LineNumber bad_line = 0;
+    try {
+        assemble_hack("D=M\nD=X+1\n");
+    } catch (const ParseError& e) { bad_line = e.line(); }
+    check(bad_line == 2, "bad comp reported with its line");
+    check(!error_of("AA=D\n").empty() && !error_of("D;JXX\n").empty() &&
+          !error_of("(LOOP\n").empty() && !error_of("(R1)\n").empty() && !error_of("@1x\n").empty(),
+          "bad dest, jump, label and constant rejected");
+
+    // The engine runs .asm directly, disassembles to source and breaks on lines
+    CPUEngine cpu;
+    cpu.load_asm(MULT_ASM);
+    cpu.write_ram(0, 6);
+    cpu.write_ram(1, 7);
+    check(cpu.disassemble(9) == "M = D + M", "disassemble shows the .asm source");
+    check(cpu.add_breakpoint_at_line(13) == Address(9), "breakpoint on a source line");
+    CPUState state = cpu.run();
+    check(state == CPUState::PAUSED && cpu.get_pc() == 9, "run stops at the line's instruction");
+    cpu.clear_breakpoints();
+    cpu.run_for(1000);
+    check(cpu.read_ram(2) == 42, "assembled Mult computes 6 * 7");
+    cpu.load(MULT_PROGRAM);
+    check(!cpu.get_source_map() && !cpu.add_breakpoint_at_line(13),
+          "loading a ROM drops the source map");
+
+    namespace fs = std::filesystem;
+    fs::path asm_path = fs::temp_directory_path() / "n2t_assembler_test.asm";
+    {
+        std::ofstream out(asm_path);
+        out << MULT_ASM;
+    }
+    cpu.load_file(asm_path.string());
+    check(cpu.rom_size() == MULT_PROGRAM.size() && cpu.get_source_map() &&
+          cpu.get_source_map()->file == asm_path.string(), "load_file assembles .asm files");
+    fs::remove(asm_path);
+}
+
+// ==============================================================================
+// Control-Flow Graph
+// ==============================================================================
+
+void test_cpu_cfg() {
+    std::cout << "\n--- Control-Flow Graph ---\n";
+
+    CPUEngine cpu;
+    cpu.load(MULT_PROGRAM);
+    auto cfg = cpu.get_cfg();
+    const auto& blocks = cfg->blocks();
+    check(blocks.size() == 4 && blocks[0].end == 3 && blocks[1].start == 4 &&
+          blocks[2].start == 6 && blocks[3].start == 16, "Mult split at jumps and targets");
+    check(blocks[1].successors == std::vector<uint32_t>{2} && blocks[1].halts &&
+          blocks[2].successors == (std::vector<uint32_t>{1, 3}) && cfg->jump_target(2) == Address(4) &&
+          blocks[3].successors.empty() && blocks[3].halts, "static targets and exits resolved");
+    check(cfg->loops().size() == 1 && cfg->loops()[0].header == 1 &&
+          cfg->loops()[0].latches == std::vector<uint32_t>{2} &&
+          cfg->loops()[0].blocks == (std::vector<uint32_t>{1, 2}), "Mult loop found");
+    check(cfg->unreachable().empty() && cfg->computed_jumps().empty() &&
+          cfg->block_at(10) == uint32_t(2) && !cfg->block_at(18), "Mult fully reachable");
+    check(cpu.get_cfg() == cfg, "graph built once per load");
+    cpu.load(MULT_PROGRAM);
+    check(cpu.get_cfg() != cfg, "loading rebuilds the graph");
+
+    // A call through R13: the return is a computed jump, and code that
+    // only falls into the function is dead
+    cpu.load_asm(
+        "@RET\nD=A\n@R13\nM=D\n@FUNC\n0;JMP\n"       // 0-5
+        "(RET)\n@END\n0;JMP\n"                         // 6-7
+        "@42\nD=A\n"                                    // 8-9: dead
+        "(FUNC)\n@R13\nA=M\n0;JMP\n"                  // 10-12
+        "(END)\n@END\n0;JMP\n");                       // 13-14
+    cfg = cpu.get_cfg();
+    check(cfg->computed_jumps() == std::vector<Address>{12} &&
+          cfg->blocks()[*cfg->block_at(12)].computed_jump &&
+          cfg->blocks()[*cfg->block_at(12)].successors.empty(), "computed jump flagged");
+    check(cfg->blocks()[*cfg->block_at(6)].address_taken &&
+          cfg->blocks()[*cfg->block_at(6)].reachable, "return address reachable through the computed jump");
+    check(cfg->unreachable() == (std::vector<std::pair<Address, Address>>{{8, 9}}),
+          "dead code found");
+    check(cfg->loops().size() == 1 && cfg->blocks()[cfg->loops()[0].header].start == 13,
+          "END self-loop");
+
+    // Constant ALU results decide the jump; A=D with a known D is static
+    cpu.load_asm("@4\n0;JEQ\n@0\nD=A\n@9\nD=A\n@0\nA=D\n0;JMP\n@9\n0;JMP\n");
+    cfg = cpu.get_cfg();
+    check(cfg->blocks()[0].successors == std::vector<uint32_t>{*cfg->block_at(4)} &&
+          !cfg->blocks()[*cfg->block_at(2)].reachable, "always-taken jump has no fall-through");
+    check(cfg->jump_target(*cfg->block_at(8)) == Address(9) && cfg->computed_jumps().empty(),
+          "target tracked through D");
+
+    std::string dot = cfg->to_dot(*cpu.memory().program());
+    std::string json = cfg->to_json();
+    check(dot.find("digraph cfg") != std::string::npos && dot.find("lightgrey") != std::string::npos &&
+          json.find("\"unreachable\": [[2, 3]]") != std::string::npos, "dot and JSON output");
+}
+
+void test_cpu_disassembly_table() {
+    std::cout << "\n--- Disassembly Table ---\n";
+
+    CPUEngine cpu;
+    cpu.load(MULT_PROGRAM);
+    bool lines_match = true;
+    for (Address a = 0; a < MULT_PROGRAM.size(); a++) {
+        lines_match = lines_match && cpu.disassemble_view(a) == instruction_to_string(MULT_PROGRAM[a]) &&
+                      cpu.disassemble(a) == instruction_to_string(MULT_PROGRAM[a]);
+    }
+    check(lines_match, "table lines match instruction_to_string");
+    check(cpu.disassemble_view(18).empty() && cpu.disassemble(18) == "@0", "past the program");
+    check(cpu.disassemble_window(0, 3) == "@2\nM=0\n@0", "window joined by newlines");
+    check(cpu.disassemble_window(16, 100) == cpu.disassemble(16) + "\n" + cpu.disassemble(17) &&
+          cpu.disassemble_window(5, 5).empty() && cpu.disassemble_window(30, 40).empty(),
+          "window clipped to the program");
+    std::vector<std::string> range = cpu.disassemble_range(0, 100);
+    check(range.size() == MULT_PROGRAM.size() && range[9] == cpu.disassemble(9),
+          "disassemble_range served from the table");
+
+    std::string_view before = cpu.disassemble_view(9);
+    check(before.data() == cpu.disassemble_view(9).data(), "table built once per load");
+    cpu.load_asm(MULT_ASM);
+    check(cpu.disassemble_view(9) == "M = D + M" && cpu.disassemble_view(5) == "D;JEQ",
+          "assembly source text after load_asm");
+
+    DisassemblyTable table(*cpu.memory().program());
+    check(table.size() == MULT_PROGRAM.size() && table.line(9) == "M=D+M" &&
+          table.window(0, 18).size() + 1 == table.pool_size(), "one pooled buffer");
+}
+
 // ==============================================================================
 // Main
 // ==============================================================================
@@ -470,7 +1705,10 @@ int main() {
     test_decode_c_instruction();
     test_decode_checked();
     test_disassembly();
+    test_predecode();
     test_memory();
+    test_rom_images();
+    test_assembler();
     test_cpu_set_d();
     test_cpu_add();
     test_cpu_write_ram();
@@ -479,11 +1717,26 @@ int main() {
     test_cpu_decrement_loop();
     test_cpu_max_program();
     test_cpu_breakpoint();
+    test_cpu_breakpoint_set();
     test_cpu_run_for();
     test_cpu_statistics();
     test_cpu_step();
     test_cpu_dest_am_overlap();
     test_cpu_negative_arithmetic();
+    test_cpu_invalid_instruction();
+    test_cpu_check_modes();
+    test_cpu_threaded_dispatch();
+    test_cpu_block_dispatch();
+    test_cpu_jit_dispatch();
+    test_cpu_idle_detection();
+    test_cpu_farm();
+    test_cpu_lockstep();
+    test_cpu_reverse_execution();
+    test_cpu_instrumentation();
+    test_cpu_profile();
+    test_cpu_watchpoints();
+    test_cpu_cfg();
+    test_cpu_disassembly_table();
 
     std::cout << "\n=== " << pass_count << "/" << test_count << " tests passed! ===\n";
     return 0;
@@ -6,6 +6,7 @@
 // ==============================================================================
 
 #include "vm_engine.hpp"
+#include "vm_linker.hpp"
 #include <iostream>
 #include <cassert>
 
@@ -235,6 +236,31 @@ int main() {
         "return\n",
         30);
 
+    // ---- Static variables ----
+    std::cout << "\n--- Static Variables ---\n";
+
+    // A program loaded from a string gets the static segment of the name
+    // it was loaded under
+    test_function_program("static variables after load_string",
+        "function Sys.init 0\n"
+        "push constant 12\n"
+        "pop static 0\n"
+        "push constant 30\n"
+        "pop static 1\n"
+        "push static 0\n"
+        "push static 1\n"
+        "add\n"
+        "return\n",
+        42);
+    {
+        VMEngine vm;
+        vm.load_string("function Main.main 0\npush constant 9\npop static 2\n"
+                       "push constant 0\nreturn\n", "Main");
+        bool pass = vm.run() == VMState::HALTED && vm.read_ram(VMAddress::STATIC_BASE + 2) == 9;
+        std::cout << (pass ? "PASS" : "FAIL") << ": statics of a string program live in RAM\n";
+        assert(pass);
+    }
+
     // ---- Statistics ----
     std::cout << "\n--- Statistics ---\n";
     {
@@ -317,6 +343,501 @@ int main() {
         assert(pass2);
     }
 
+    // ---- Linking ----
+    std::cout << "\n--- Linking ---\n";
+    {
+        VMParser parser;
+        parser.parse_string(
+            "function A.f 3\n"        // cmd 0
+            "label LOOP\n"            // cmd 1
+            "push static 2\n"         // cmd 2
+            "goto LOOP\n",            // cmd 3
+            "A");
+        parser.parse_string(
+            "function B.g 0\n"        // cmd 4
+            "label LOOP\n"            // cmd 5
+            "call A.f 1\n"            // cmd 6
+            "pop static 0\n"          // cmd 7
+            "if-goto LOOP\n"          // cmd 8
+            "call Missing.h 0\n",     // cmd 9
+            "B");
+        LinkedProgram linked = link_program(parser.get_program());
+
+        bool pass = linked.code.size() == 10
+                 && linked.code[3].op == LinkedOp::GOTO && linked.code[3].target == 1
+                 && linked.code[8].op == LinkedOp::IF_GOTO && linked.code[8].target == 5
+                 && linked.code[6].target == 0 && linked.code[6].operand == 1
+                 && linked.code[0].op == LinkedOp::FUNCTION && linked.code[0].operand == 3
+                 && linked.code[9].target == LinkedProgram::UNRESOLVED;
+        std::cout << (pass ? "PASS" : "FAIL") << ": labels resolve in their own function, calls to entries\n";
+        assert(pass);
+
+        bool pass2 = linked.static_files == std::vector<std::string>{"A", "B"}
+                  && linked.code[2].operand == VMAddress::STATIC_BASE + 2
+                  && linked.code[7].operand == VMAddress::STATIC_BASE + VMAddress::STATIC_FILE_SIZE;
+        std::cout << (pass2 ? "PASS" : "FAIL") << ": statics linked to absolute addresses\n";
+        assert(pass2);
+
+        bool pass3 = linked.source.size() == linked.code.size()
+                  && linked.name_of(9) == "Missing.h" && linked.name_of(3) == "LOOP"
+                  && linked.name_of(7) == "B" && linked.name_of(1) == "LOOP"
+                  && linked.source[1].name == linked.source[5].name
+                  && linked.name_of(4) == "B.g" && linked.source[4].line == 1
+                  && linked.name_of(11).empty();
+        std::cout << (pass3 ? "PASS" : "FAIL") << ": names and lines in the side table\n";
+        assert(pass3);
+
+        // Commands rebuilt from the linked program match the parsed ones
+        parser.parse_string("function C.h 1\npush constant 3\nadd\nnot\ncall Math.abs 1\n"
+                            "pop static 15\nreturn\n", "C");
+        VMProgram program = parser.get_program();
+        VMNatives natives = jack_os_natives();
+        LinkedProgram relinked = link_program(program, &natives);
+        auto line_of = [](const VMCommand& cmd) {
+            return std::visit([](const auto& c) { return c.source_line; }, cmd);
+        };
+        bool pass4 = relinked.code[14].op == LinkedOp::CALL_NATIVE;
+        for (size_t i = 0; i < program.commands.size(); i++) {
+            VMCommand rebuilt = relinked.command(i);
+            pass4 = pass4 && command_to_string(rebuilt) == command_to_string(program.commands[i])
+                          && line_of(rebuilt) == line_of(program.commands[i]);
+        }
+        std::cout << (pass4 ? "PASS" : "FAIL") << ": commands rebuilt from the linked program\n";
+        assert(pass4);
+    }
+    {
+        // A missing label is only an error if the jump is taken
+        VMEngine vm;
+        vm.load_string(
+            "function Sys.init 0\n"
+            "push constant 0\n"
+            "if-goto NOWHERE\n"
+            "push constant 7\n"
+            "pop static 3\n"
+            "push static 3\n"
+            "return\n",
+            "test");
+        VMState state = vm.run();
+        bool pass = state == VMState::HALTED
+                 && vm.get_segment(SegmentType::STATIC, 3, "test") == 7;
+        std::cout << (pass ? "PASS" : "FAIL") << ": untaken jump to missing label\n";
+        assert(pass);
+
+        vm.load_string(
+            "function Sys.init 0\n"
+            "goto NOWHERE\n",
+            "test");
+        state = vm.run();
+        bool pass2 = state == VMState::ERROR
+                  && vm.get_error_location() == 1
+                  && vm.get_error_message().find("Undefined label: 'NOWHERE'") != std::string::npos;
+        std::cout << (pass2 ? "PASS" : "FAIL") << ": taken jump to missing label\n";
+        assert(pass2);
+    }
+
+    // ---- Threaded dispatch ----
+    std::cout << "\n--- Threaded Dispatch ---\n";
+    {
+        const std::string fib =
+            "function Sys.init 0\n"
+            "push constant 12\n"
+            "call Main.fib 1\n"
+            "pop static 0\n"
+            "push constant 3000\n"
+            "pop pointer 1\n"
+            "push static 0\n"
+            "pop that 5\n"
+            "push constant 0\n"
+            "pop temp 7\n"
+            "label LOOP\n"
+            "push temp 7\n"
+            "push constant 40\n"
+            "lt\n"
+            "not\n"
+            "if-goto DONE\n"
+            "push temp 7\n"
+            "push constant 1\n"
+            "add\n"
+            "neg\n"
+            "neg\n"
+            "pop temp 7\n"
+            "goto LOOP\n"
+            "label DONE\n"
+            "push static 0\n"
+            "return\n"
+            "function Main.fib 0\n"
+            "push argument 0\n"
+            "push constant 2\n"
+            "lt\n"
+            "if-goto BASE\n"
+            "push argument 0\n"
+            "push constant 1\n"
+            "sub\n"
+            "call Main.fib 1\n"
+            "push argument 0\n"
+            "push constant 2\n"
+            "sub\n"
+            "call Main.fib 1\n"
+            "add\n"
+            "return\n"
+            "label BASE\n"
+            "push argument 0\n"
+            "return\n";
+
+        // Same state, stats, errors and every RAM word
+        auto same_vm = [](const VMEngine& a, const VMEngine& b) {
+            const VMStats& sa = a.get_stats();
+            const VMStats& sb = b.get_stats();
+            bool same = a.get_state() == b.get_state()
+                     && a.get_pause_reason() == b.get_pause_reason()
+                     && a.get_pc() == b.get_pc()
+                     && sa.instructions_executed == sb.instructions_executed
+                     && sa.push_count == sb.push_count && sa.pop_count == sb.pop_count
+                     && sa.arithmetic_count == sb.arithmetic_count
+                     && sa.call_count == sb.call_count && sa.return_count == sb.return_count
+                     && a.get_error_message() == b.get_error_message()
+                     && a.get_error_location() == b.get_error_location()
+                     && a.get_call_stack().size() == b.get_call_stack().size();
+            for (Address i = 0; same && i < VMAddress::RAM_SIZE; i++) {
+                same = a.read_ram(i) == b.read_ram(i);
+            }
+            return same;
+        };
+
+        auto run_both = [&](const std::string& source, uint64_t chunk,
+                            const std::vector<size_t>& breakpoints) {
+            VMEngine sw, th;
+            sw.load_string(source, "test");
+            th.load_string(source, "test");
+            th.set_dispatch(VMDispatch::THREADED);
+            for (size_t bp : breakpoints) {
+                sw.add_breakpoint(bp);
+                th.add_breakpoint(bp);
+            }
+            bool same = true;
+            for (int i = 0; same && i < 100000; i++) {
+                VMState state = chunk ? sw.run_for(chunk) : sw.run();
+                chunk ? th.run_for(chunk) : th.run();
+                same = same_vm(sw, th);
+                if (state == VMState::HALTED || state == VMState::ERROR) break;
+                if (sw.get_pause_reason() == PauseReason::BREAKPOINT) {
+                    size_t hit = sw.get_pc();  // Stays hit until removed
+                    sw.remove_breakpoint(hit);
+                    th.remove_breakpoint(hit);
+                }
+            }
+            return same && sw.get_state() != VMState::PAUSED;
+        };
+
+        VMEngine th;
+        th.set_dispatch(VMDispatch::THREADED);
+        th.load_string(fib, "test");
+        bool pass = th.get_dispatch() == VMDispatch::THREADED
+                 && th.run() == VMState::HALTED && th.get_stack().back() == 144;
+        std::cout << (pass ? "PASS" : "FAIL") << ": threaded fib(12) = 144\n";
+        assert(pass);
+
+        bool pass2 = run_both(fib, 0, {}) && run_both(fib, 1, {}) && run_both(fib, 37, {});
+        std::cout << (pass2 ? "PASS" : "FAIL") << ": threaded matches switch (run, run_for)\n";
+        assert(pass2);
+
+        bool pass3 = run_both(fib, 0, {27, 21}) && run_both(fib, 5, {14});
+        std::cout << (pass3 ? "PASS" : "FAIL") << ": threaded breakpoints match switch\n";
+        assert(pass3);
+
+        // Each program stops with an error; the error and state must match
+        const std::vector<std::string> failing = {
+            "function Sys.init 0\npush constant 1\nadd\nreturn\n",      // underflow
+            "function Sys.init 0\npush constant 1\nif-goto NOWHERE\n",  // unresolved
+            "function Sys.init 0\ncall Nowhere.f 0\n",                  // unresolved call
+            "function Sys.init 0\nlabel L\npush constant 1\ngoto L\n",  // overflow
+        };
+        bool pass4 = true;
+        for (const auto& source : failing) {
+            pass4 = pass4 && run_both(source, 0, {}) && run_both(source, 3, {});
+        }
+        std::cout << (pass4 ? "PASS" : "FAIL") << ": threaded errors match switch\n";
+        assert(pass4);
+
+        // Stack words aliased through segments, and SP moved through "that"
+        bool pass5 = run_both(
+            "function Sys.init 0\n"
+            "push constant 5\n"
+            "push constant 6\n"
+            "push constant 0\n"
+            "pop pointer 1\n"
+            "push that 0\n"          // Reads SP
+            "pop temp 0\n"
+            "push constant 9\n"
+            "push constant 262\n"
+            "pop pointer 1\n"
+            "pop that 0\n"           // Writes the word under SP
+            "push constant 300\n"
+            "push constant 0\n"
+            "pop pointer 1\n"
+            "pop that 0\n"           // Moves SP
+            "push constant 1\n"
+            "push constant 2\n"
+            "add\n"
+            "return\n", 0, {});
+        std::cout << (pass5 ? "PASS" : "FAIL") << ": threaded aliasing matches switch\n";
+        assert(pass5);
+
+        // ---- Superinstructions ----
+        std::cout << "\n--- Superinstructions ---\n";
+        {
+            const std::string idioms =
+                "function Sys.init 2\n"     // 0
+                "push constant 0\n"
+                "pop local 0\n"
+                "push constant 10\n"
+                "pop local 1\n"
+                "label LOOP\n"              // 5
+                "push local 0\n"            // 6: LOCALS_GE_GOTO
+                "push local 1\n"
+                "lt\n"
+                "not\n"
+                "if-goto END\n"             // 10
+                "push local 0\n"
+                "push constant 1\n"         // 12: ADD_CONSTANT
+                "add\n"
+                "pop local 0\n"
+                "push constant 3000\n"      // 15: MOVE_TO_POINTER
+                "pop pointer 0\n"
+                "push pointer 0\n"          // 17: MOVE_TO_POINTER
+                "pop pointer 1\n"
+                "push local 0\n"
+                "pop that 0\n"              // 20
+                "push local 0\n"            // 21: LOCALS_EQ_GOTO
+                "push local 1\n"
+                "eq\n"
+                "if-goto END\n"
+                "goto LOOP\n"               // 25
+                "label END\n"
+                "push local 0\n"            // 27: LOCALS_LE_GOTO
+                "push local 1\n"
+                "gt\n"
+                "not\n"                     // 30
+                "if-goto DONE\n"
+                "label DONE\n"
+                "push local 0\n"
+                "push constant 7\n"         // 34: SUB_CONSTANT
+                "sub\n"
+                "return\n";
+
+            VMParser parser;
+            parser.parse_string(idioms, "Sys");
+            LinkedProgram linked = link_program(parser.get_program());
+            const auto& fused = linked.fused;
+            bool pass6 = fused.size() == linked.code.size()
+                     && fused[6].op == LinkedOp::LOCALS_GE_GOTO && fused[6].operand == 1
+                     && fused[6].target == 26 && command_count(fused[6].op) == 5
+                     && fused[12].op == LinkedOp::ADD_CONSTANT && fused[12].operand == 1
+                     && fused[15].op == LinkedOp::MOVE_TO_POINTER && fused[15].target == 0
+                     && fused[17].op == LinkedOp::MOVE_TO_POINTER && fused[17].target == 1
+                     && fused[17].segment == SegmentType::POINTER && fused[17].operand == 0
+                     && fused[21].op == LinkedOp::LOCALS_EQ_GOTO && command_count(fused[21].op) == 4
+                     && fused[27].op == LinkedOp::LOCALS_LE_GOTO
+                     && fused[34].op == LinkedOp::SUB_CONSTANT && fused[34].operand == 7;
+            // Everything else, including the rest of each sequence, is unchanged
+            for (size_t i = 0; pass6 && i < fused.size(); i++) {
+                if (i == 6 || i == 12 || i == 15 || i == 17 || i == 21 || i == 27 || i == 34) continue;
+                pass6 = fused[i].op == linked.code[i].op;
+            }
+            std::cout << (pass6 ? "PASS" : "FAIL") << ": idioms fused at their first command only\n";
+            assert(pass6);
+
+            VMEngine fast, plain;
+            fast.set_dispatch(VMDispatch::THREADED);
+            plain.set_dispatch(VMDispatch::THREADED);
+            plain.set_superinstructions(false);
+            fast.load_string(idioms, "Sys");
+            plain.load_string(idioms, "Sys");
+            fast.run();
+            plain.run();
+            const VMStats& fs = fast.get_stats();
+            const VMStats& ps = plain.get_stats();
+            bool pass7 = fast.get_superinstructions() && fast.get_state() == VMState::HALTED
+                      && same_vm(fast, plain) && fast.read_ram(3000) == 10
+                      && fs.dispatch_count < fs.instructions_executed
+                      && ps.dispatch_count == ps.instructions_executed;
+            std::cout << (pass7 ? "PASS" : "FAIL") << ": superinstructions cut dispatches ("
+                      << fs.dispatch_count << " for " << fs.instructions_executed << " commands)\n";
+            assert(pass7);
+
+            bool pass8 = run_both(idioms, 0, {}) && run_both(idioms, 1, {})
+                      && run_both(idioms, 2, {}) && run_both(idioms, 3, {})
+                      && run_both(idioms, 7, {});
+            std::cout << (pass8 ? "PASS" : "FAIL") << ": fused run_for budgets match switch\n";
+            assert(pass8);
+
+            bool pass9 = run_both(idioms, 0, {9, 13, 30}) && run_both(idioms, 4, {18, 23});
+            std::cout << (pass9 ? "PASS" : "FAIL") << ": breakpoints inside fused sequences\n";
+            assert(pass9);
+
+            // A taken branch to a missing label reports the if-goto, as before
+            bool pass10 = run_both("function Sys.init 1\npush local 0\npush local 0\n"
+                                  "eq\nif-goto NOWHERE\n", 0, {})
+                      && run_both("function Sys.init 1\npush local 0\npush local 0\n"
+                                  "lt\nif-goto NOWHERE\n", 0, {});
+            std::cout << (pass10 ? "PASS" : "FAIL") << ": fused branches to missing labels\n";
+            assert(pass10);
+        }
+    }
+
+    // ---- Native Functions ----
+    std::cout << "\n--- Native Functions ---\n";
+    {
+        const std::string math =
+            "function Main.main 0\n"
+            "push constant 7\nneg\npush constant 300\ncall Math.multiply 2\npop static 0\n"
+            "push constant 100\nneg\npush constant 7\ncall Math.divide 2\npop static 1\n"
+            "push constant 1000\ncall Math.sqrt 1\npop static 2\n"
+            "push constant 5\nneg\ncall Math.abs 1\npop static 3\n"
+            "push constant 3\npush constant 9\ncall Math.max 2\npop static 4\n"
+            "push constant 0\n"
+            "return\n";
+        for (VMDispatch dispatch : {VMDispatch::SWITCH, VMDispatch::THREADED}) {
+            VMEngine vm;
+            vm.set_dispatch(dispatch);
+            vm.load_string(math, "Main");
+            VMState state = vm.run();
+            bool pass = state == VMState::HALTED
+                     && static_cast<int16_t>(vm.read_ram(16)) == -2100
+                     && static_cast<int16_t>(vm.read_ram(17)) == -14
+                     && vm.read_ram(18) == 31 && vm.read_ram(19) == 5 && vm.read_ram(20) == 9
+                     && vm.get_stats().native_call_count == 5
+                     && vm.get_stats().call_count == 5;
+            std::cout << (pass ? "PASS" : "FAIL") << ": native Math ("
+                      << (dispatch == VMDispatch::THREADED ? "threaded" : "switch") << ")\n";
+            assert(pass);
+        }
+
+        // Heap layout: blocks come off the end of the free segment, their
+        // length word first, and a freed block is reused by an exact fit
+        VMEngine vm;
+        vm.load_string(
+            "function Main.main 1\n"
+            "push constant 3\ncall Array.new 1\npop static 0\n"
+            "push constant 5\ncall String.new 1\npop local 0\n"
+            "push local 0\npush constant 104\ncall String.appendChar 2\n"
+            "push constant 105\ncall String.appendChar 2\n"
+            "call String.length 1\npop static 1\n"
+            "push local 0\npush constant 1\ncall String.charAt 2\npop static 2\n"
+            "push local 0\npush constant 123\nneg\ncall String.setInt 2\npop temp 0\n"
+            "push local 0\ncall String.intValue 1\npop static 3\n"
+            "push static 0\ncall Array.dispose 1\npop temp 0\n"
+            "push constant 3\ncall Memory.alloc 1\npop static 4\n"
+            "push constant 0\n"
+            "return\n", "Main");
+        VMState state = vm.run();
+        bool pass = state == VMState::HALTED
+                 && vm.read_ram(16) == 16381 && vm.read_ram(16380) == 4
+                 && vm.read_ram(VMAddress::HEAP_BASE) == 14336 - 4 - 4 - 6
+                 && vm.read_ram(17) == 2 && vm.read_ram(18) == 'i'
+                 && static_cast<int16_t>(vm.read_ram(19)) == -123
+                 && vm.read_ram(20) == 16381
+                 && vm.get_sp() == VMAddress::STACK_BASE + 1;   // Only the return value
+        std::cout << (pass ? "PASS" : "FAIL") << ": native Memory, Array and String\n";
+        assert(pass);
+
+        // intValue of more digits than fit in 16 bits wraps like Jack arithmetic
+        std::string digits_source = "function Main.main 0\npush constant 20\ncall String.new 1\n";
+        for (char c : std::string("-1234567890123456")) {
+            digits_source += "push constant " + std::to_string(c) + "\ncall String.appendChar 2\n";
+        }
+        digits_source += "call String.intValue 1\npop static 0\npush constant 0\nreturn\n";
+        VMEngine digits;
+        digits.load_string(digits_source, "Main");
+        bool pass_digits = digits.run() == VMState::HALTED && digits.read_ram(16) == 17728;
+        std::cout << (pass_digits ? "PASS" : "FAIL") << ": String.intValue wraps long numbers\n";
+        assert(pass_digits);
+
+        // Defining any function of a class replaces all of its natives
+        VMEngine user;
+        user.load_string(
+            "function Main.main 0\n"
+            "push constant 6\npush constant 7\ncall Math.multiply 2\npop static 0\n"
+            "push constant 1\ncall Math.abs 1\n"
+            "return\n"
+            "function Math.multiply 0\npush constant 42\nreturn\n", "Main");
+        bool pass2 = user.run() == VMState::ERROR && user.read_ram(16) == 42
+                  && user.get_error_message().find("Math.abs") != std::string::npos
+                  && user.get_stats().native_call_count == 0;
+        std::cout << (pass2 ? "PASS" : "FAIL") << ": a user class overrides its natives\n";
+        assert(pass2);
+
+        VMEngine off;
+        off.set_natives_enabled(false);
+        off.load_string(math, "Main");
+        bool pass3 = !off.get_natives_enabled() && off.run() == VMState::ERROR
+                  && off.get_error_message().find("Undefined function") != std::string::npos;
+        std::cout << (pass3 ? "PASS" : "FAIL") << ": natives can be turned off\n";
+        assert(pass3);
+
+        // OS errors stop at the call; Sys.halt stops after it
+        VMEngine err;
+        err.load_string("function Main.main 0\npush constant 1\npush constant 0\n"
+                        "call Math.divide 2\nreturn\n", "Main");
+        VMEngine halt;
+        halt.load_string("function Main.main 0\ncall Sys.halt 0\npush constant 1\nreturn\n",
+                         "Main");
+        bool pass4 = err.run() == VMState::ERROR && err.get_error_location() == 3
+                  && err.get_error_message().find("Sys.error 3") != std::string::npos
+                  && halt.run() == VMState::HALTED && halt.get_pc() == 2;
+        std::cout << (pass4 ? "PASS" : "FAIL") << ": native errors and Sys.halt\n";
+        assert(pass4);
+
+        VMEngine custom;
+        custom.natives().add("Util.twice", 1, [](VMNativeCall& call) {
+            return static_cast<Word>(call.arg(0) * 2);
+        });
+        custom.load_string("function Main.main 0\npush constant 21\ncall Util.twice 1\n"
+                           "pop static 0\npush constant 0\nreturn\n", "Main");
+        bool pass5 = custom.run() == VMState::HALTED && custom.read_ram(16) == 42;
+        std::cout << (pass5 ? "PASS" : "FAIL") << ": registered natives\n";
+        assert(pass5);
+
+        // A user Memory takes Array and String with it: they allocate from
+        // the native heap, which the user's allocator knows nothing about
+        VMEngine own_memory;
+        own_memory.load_string(
+            "function Main.main 0\n"
+            "push constant 3\ncall Memory.alloc 1\npop static 0\n"
+            "push constant 2\ncall String.new 1\n"
+            "return\n"
+            "function Memory.alloc 0\n"
+            "push constant 3000\nreturn\n", "Main");
+        bool pass6 = own_memory.run() == VMState::ERROR && own_memory.read_ram(16) == 3000
+                  && own_memory.get_error_message().find("String.new") != std::string::npos
+                  && own_memory.read_ram(VMAddress::HEAP_BASE) == 0
+                  && own_memory.get_stats().native_call_count == 0;
+        std::cout << (pass6 ? "PASS" : "FAIL") << ": a user Memory replaces Array and String\n";
+        assert(pass6);
+
+        // The heap is only set up for programs that use it
+        VMEngine no_heap;
+        no_heap.load_string(math, "Main");
+        bool pass7 = no_heap.run() == VMState::HALTED
+                  && no_heap.read_ram(VMAddress::HEAP_BASE) == 0
+                  && no_heap.read_ram(VMAddress::HEAP_BASE + 1) == 0;
+        std::cout << (pass7 ? "PASS" : "FAIL") << ": no heap without Memory, Array or String\n";
+        assert(pass7);
+
+        // Toggling natives relinks the loaded program
+        VMEngine toggled;
+        toggled.load_string(math, "Main");
+        toggled.set_natives_enabled(false);
+        bool off_fails = toggled.run() == VMState::ERROR
+                      && toggled.get_error_message().find("Undefined function") != std::string::npos;
+        toggled.set_natives_enabled(true);
+        toggled.reset();
+        bool pass8 = off_fails && toggled.run() == VMState::HALTED
+                  && toggled.get_stats().native_call_count > 0;
+        std::cout << (pass8 ? "PASS" : "FAIL") << ": natives toggle on a loaded program\n";
+        assert(pass8);
+    }
+
     std::cout << "\n=== All tests passed! ===\n";
     return 0;
 }
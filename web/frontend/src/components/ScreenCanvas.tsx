@@ -1,4 +1,5 @@
 import { useRef, useEffect, useCallback } from "react";
+import type { ScreenDelta } from "../wasm/types";
 
 /** Hack screen: 256 rows x 512 cols. Each word = 16 pixels, MSB-first. */
 const SCREEN_WIDTH = 512;
@@ -9,12 +10,36 @@ const WORDS_PER_ROW = 32; // 512 / 16
 interface ScreenCanvasProps {
   /** Read a RAM word at the given address. */
   readRam: (addr: number) => number;
+  /**
+   * Optional: rows changed since the last call. When given, only those
+   * rows are redrawn; the engine marks the whole screen dirty on reset.
+   */
+  takeDelta?: () => ScreenDelta;
   /** CSS width override (canvas is always 512x256 logical pixels). */
   width?: number;
 }
 
-export function ScreenCanvas({ readRam, width }: ScreenCanvasProps) {
+/** Paint one 32-word row into RGBA pixel data. */
+function paintRow(data: Uint8ClampedArray, row: number, wordAt: (word: number) => number) {
+  for (let word = 0; word < WORDS_PER_ROW; word++) {
+    const val = wordAt(word) & 0xffff;
+    for (let bit = 0; bit < 16; bit++) {
+      const col = word * 16 + bit;
+      const pixelIndex = (row * SCREEN_WIDTH + col) * 4;
+      // Hack screen: bit 0 = leftmost pixel (LSB-first per nand2tetris spec)
+      const on = (val >> bit) & 1;
+      const color = on ? 0 : 255; // 1 = black, 0 = white
+      data[pixelIndex] = color;
+      data[pixelIndex + 1] = color;
+      data[pixelIndex + 2] = color;
+      data[pixelIndex + 3] = 255;
+    }
+  }
+}
+
+export function ScreenCanvas({ readRam, takeDelta, width }: ScreenCanvasProps) {
   const canvasRef = useRef<HTMLCanvasElement>(null);
+  const imageRef = useRef<ImageData | null>(null);
 
   const draw = useCallback(() => {
     const canvas = canvasRef.current;
@@ -22,29 +47,29 @@ export function ScreenCanvas({ readRam, width }: ScreenCanvasProps) {
     const ctx = canvas.getContext("2d");
     if (!ctx) return;
 
+    if (takeDelta && imageRef.current) {
+      // Incremental: repaint only the rows written since the last frame
+      const { rows, words } = takeDelta();
+      if (rows.length === 0) return;
+      const data = imageRef.current.data;
+      rows.forEach((row, i) => {
+        paintRow(data, row, (word) => words[i * WORDS_PER_ROW + word]);
+      });
+      ctx.putImageData(imageRef.current, 0, 0);
+      return;
+    }
+
     const imageData = ctx.createImageData(SCREEN_WIDTH, SCREEN_HEIGHT);
     const data = imageData.data;
+    if (takeDelta) takeDelta(); // Full frame below; drop pending rows
 
     for (let row = 0; row < SCREEN_HEIGHT; row++) {
-      for (let word = 0; word < WORDS_PER_ROW; word++) {
-        const addr = SCREEN_BASE + row * WORDS_PER_ROW + word;
-        const val = readRam(addr) & 0xffff;
-        for (let bit = 0; bit < 16; bit++) {
-          const col = word * 16 + bit;
-          const pixelIndex = (row * SCREEN_WIDTH + col) * 4;
-          // Hack screen: bit 0 = leftmost pixel (LSB-first per nand2tetris spec)
-          const on = (val >> bit) & 1;
-          const color = on ? 0 : 255; // 1 = black, 0 = white
-          data[pixelIndex] = color;
-          data[pixelIndex + 1] = color;
-          data[pixelIndex + 2] = color;
-          data[pixelIndex + 3] = 255;
-        }
-      }
+      paintRow(data, row, (word) => readRam(SCREEN_BASE + row * WORDS_PER_ROW + word));
     }
 
+    imageRef.current = imageData;
     ctx.putImageData(imageData, 0, 0);
-  }, [readRam]);
+  }, [readRam, takeDelta]);
 
   // Redraw periodically when mounted
   useEffect(() => {
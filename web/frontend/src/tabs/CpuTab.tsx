@@ -52,6 +52,11 @@ export function CpuTab() {
     return engineRef.current?.readRam(addr) ?? 0;
   }, []);
 
+  const takeScreenDelta = useCallback(() => {
+    const eng = engineRef.current;
+    return eng ? eng.takeScreenDelta() : { rows: new Uint8Array(0), words: new Uint16Array(0) };
+  }, []);
+
   const syncState = useCallback(() => {
     const eng = engineRef.current;
     if (!eng) return;
@@ -91,7 +96,7 @@ export function CpuTab() {
       const size = eng.romSize();
       const end = Math.min(size, 200);
       if (end > 0) {
-        setDisasm(eng.disassembleRange(0, end));
+        setDisasm(eng.disassembleWindow(0, end).split("\n"));
       }
       syncState();
       return true;
@@ -246,7 +251,7 @@ export function CpuTab() {
               )}
             </div>
             <div className="panel-body" style={{ display: "flex", justifyContent: "center", padding: 4 }}>
-              <ScreenCanvas readRam={readRam} width={256} />
+              <ScreenCanvas readRam={readRam} takeDelta={takeScreenDelta} width={256} />
             </div>
           </div>
         </div>
@@ -19,6 +19,24 @@ export const enum CPUState {
   ERROR = 4,
 }
 
+/** Why a CPU run stopped in the PAUSED state (mirrors C++ CPUPauseReason) */
+export const enum CPUPauseReason {
+  NONE = 0,
+  STEP_COMPLETE = 1,
+  BREAKPOINT = 2,
+  USER_REQUEST = 3,
+  /** Spinning in a loop that can never change state (see setIdleDetection). */
+  IDLE_LOOP = 4,
+  HISTORY_START = 5,
+  WATCHPOINT = 6,
+}
+
+export const enum WatchKind {
+  READ = 1,
+  WRITE = 2,
+  ACCESS = 3,
+}
+
 export const enum VMState {
   READY = 0,
   RUNNING = 1,
@@ -86,14 +104,48 @@ export interface CPUStats {
   memory_writes: number;
 }
 
+/** Screen rows changed since the last takeScreenDelta() call. */
+export interface ScreenDelta {
+  /** Row numbers (0-255), ascending. */
+  rows: Uint8Array;
+  /** 32 words per listed row, in the same order. */
+  words: Uint16Array;
+}
+
+export interface WatchHit {
+  /** RAM address accessed. */
+  address: number;
+  /** ROM address of the accessing instruction. */
+  pc: number;
+  kind: WatchKind;
+  oldValue: number;
+  /** Equal to oldValue for a read. */
+  newValue: number;
+}
+
 export interface CPUEngine {
   loadString(hack: string): void;
+  /** Assemble Hack assembly and load it; throws on a syntax error. */
+  loadAsm(asm: string): void;
   reset(): void;
   run(): CPUState;
   runFor(n: number): CPUState;
   step(): CPUState;
   pause(): void;
   getState(): CPUState;
+  getPauseReason(): CPUPauseReason;
+  /** Pause with IDLE_LOOP when the program spins in a loop that cannot end. */
+  setIdleDetection(enabled: boolean): void;
+  /** Record execution so it can be stepped backwards; off discards it. */
+  setHistoryEnabled(enabled: boolean): void;
+  /** Memory cap for the recorded history, in bytes. */
+  setHistoryLimit(bytes: number): void;
+  /** How many instructions stepBack() can currently undo. */
+  historyDepth(): number;
+  /** Undo the last count instructions. */
+  stepBack(count: number): CPUState;
+  /** Go back to the previous breakpoint hit, or to the oldest recorded state. */
+  runBack(): CPUState;
   getA(): number;
   getD(): number;
   getPC(): number;
@@ -103,13 +155,28 @@ export interface CPUEngine {
   romSize(): number;
   getKeyboard(): number;
   setKeyboard(key: number): void;
+  takeScreenDelta(): ScreenDelta;
   addBreakpoint(addr: number): void;
   removeBreakpoint(addr: number): void;
   clearBreakpoints(): void;
   hasBreakpoint(addr: number): boolean;
   getBreakpoints(): number[];
+  /** Break on an .asm source line; returns its ROM address, or null. */
+  addBreakpointAtLine(line: number): number | null;
+  /** Pause after an instruction reads/writes RAM[first..last]. */
+  addWatchpoint(first: number, last: number, kind: WatchKind): void;
+  removeWatchpoint(first: number, last: number): boolean;
+  clearWatchpoints(): void;
+  /** The access behind the last WATCHPOINT pause. */
+  getWatchHit(): WatchHit;
   disassemble(addr: number): string;
   disassembleRange(start: number, end: number): string[];
+  /** Disassembly of [start, end) as one string, lines joined by "\n". */
+  disassembleWindow(start: number, end: number): string;
+  /** .asm source line of a ROM address, or null if not loaded from .asm. */
+  sourceLine(addr: number): number | null;
+  /** Control-flow graph of the loaded ROM (blocks, loops, dead code) as JSON. */
+  getCfgJson(): string;
   getCurrentInstruction(): DecodedInstruction;
   getStats(): CPUStats;
   getErrorMessage(): string;
@@ -253,6 +320,8 @@ export interface N2TModule {
   // Enum objects
   HDLState: Record<string, number>;
   CPUState: Record<string, number>;
+  CPUPauseReason: Record<string, number>;
+  WatchKind: Record<string, number>;
   VMState: Record<string, number>;
   SegmentType: Record<string, number>;
 }
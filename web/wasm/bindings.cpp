@@ -12,6 +12,8 @@
 // Engine headers
 #include "hdl_engine.hpp"
 #include "cpu.hpp"
+#include "assembler.hpp"
+#include "cpu_cfg.hpp"
 #include "vm_engine.hpp"
 #include "jack_debugger.hpp"
 
@@ -23,6 +25,8 @@
 #include "source_map.hpp"
 #include "object_inspector.hpp"
 
+#include <algorithm>
+
 using namespace emscripten;
 using namespace n2t;
 
@@ -55,25 +59,18 @@ static val vec_word_to_array(const std::vector<Word>& v) {
     return arr;
 }
 
-static val vec_string_to_array(const std::vector<std::string>& v) {
-    val arr = val::array();
-    for (size_t i = 0; i < v.size(); ++i)
-        arr.call<void>("push", v[i]);
-    return arr;
-}
-
 // =============================================================================
 // VMCommand → string helper (variant can't be bound directly)
 // =============================================================================
 
 static std::string vm_command_to_string_at(const VMEngine& eng, size_t idx) {
-    const VMCommand* cmd = eng.get_command(idx);
+    std::optional<VMCommand> cmd = eng.get_command(idx);
     if (!cmd) return "";
     return command_to_string(*cmd);
 }
 
 static std::string vm_current_command_string(const VMEngine& eng) {
-    const VMCommand* cmd = eng.get_current_command();
+    std::optional<VMCommand> cmd = eng.get_current_command();
     if (!cmd) return "";
     return command_to_string(*cmd);
 }
@@ -231,6 +228,10 @@ static val cpu_stats(const CPUEngine& eng) {
     return obj;
 }
 
+static double cpu_history_depth(const CPUEngine& eng) {
+    return static_cast<double>(eng.history_depth());
+}
+
 static val cpu_breakpoints(const CPUEngine& eng) {
     val arr = val::array();
     for (auto bp : eng.get_breakpoints())
@@ -238,9 +239,59 @@ static val cpu_breakpoints(const CPUEngine& eng) {
     return arr;
 }
 
+// The window is one pre-joined string in the engine's disassembly table;
+// it crosses into JS as a single string and is split there.
+static std::string cpu_disassemble_window(const CPUEngine& eng, unsigned start, unsigned end) {
+    start = std::min<unsigned>(start, CPUAddress::ROM_SIZE);
+    end = std::min<unsigned>(end, CPUAddress::ROM_SIZE);
+    return std::string(eng.disassemble_window(static_cast<Address>(start), static_cast<Address>(end)));
+}
+
 static val cpu_disassemble_range(const CPUEngine& eng, unsigned start, unsigned end) {
-    return vec_string_to_array(eng.disassemble_range(
-        static_cast<Address>(start), static_cast<Address>(end)));
+    std::string window = cpu_disassemble_window(eng, start, end);
+    if (window.empty()) return val::array();
+    return val(window).call<val>("split", std::string("\n"));
+}
+
+// .asm source line of a ROM address, or null without an .asm program
+static val cpu_source_line(const CPUEngine& eng, unsigned addr) {
+    const AsmSourceMap* map = eng.get_source_map();
+    if (!map) return val::null();
+    auto line = map->line_for(static_cast<Address>(addr));
+    if (!line) return val::null();
+    return val(static_cast<unsigned>(*line));
+}
+
+static val cpu_add_breakpoint_at_line(CPUEngine& eng, unsigned line) {
+    auto addr = eng.add_breakpoint_at_line(line);
+    if (!addr) return val::null();
+    return val(static_cast<unsigned>(*addr));
+}
+
+static std::string cpu_cfg_json(const CPUEngine& eng) {
+    return eng.get_cfg()->to_json();
+}
+
+// { address, pc, kind, oldValue, newValue } of the last WATCHPOINT pause
+static val cpu_watch_hit(const CPUEngine& eng) {
+    const WatchHit& hit = eng.get_watch_hit();
+    val obj = val::object();
+    obj.set("address",  static_cast<unsigned>(hit.address));
+    obj.set("pc",       static_cast<unsigned>(hit.pc));
+    obj.set("kind",     hit.kind);
+    obj.set("oldValue", static_cast<unsigned>(hit.old_value));
+    obj.set("newValue", static_cast<unsigned>(hit.new_value));
+    return obj;
+}
+
+// { rows: Uint8Array, words: Uint16Array } (32 words per row), copied out
+// of the WASM heap so it stays valid after the next call
+static val cpu_take_screen_delta(CPUEngine& eng) {
+    ScreenDelta delta = eng.take_screen_delta();
+    val obj = val::object();
+    obj.set("rows", val(typed_memory_view(delta.rows.size(), delta.rows.data())).call<val>("slice"));
+    obj.set("words", val(typed_memory_view(delta.words.size(), delta.words.data())).call<val>("slice"));
+    return obj;
 }
 
 static val cpu_current_instruction(const CPUEngine& eng) {
@@ -291,6 +342,20 @@ EMSCRIPTEN_BINDINGS(n2t_enums) {
         .value("HALTED",  CPUState::HALTED)
         .value("ERROR",   CPUState::ERROR);
 
+    enum_<CPUPauseReason>("CPUPauseReason")
+        .value("NONE",          CPUPauseReason::NONE)
+        .value("STEP_COMPLETE", CPUPauseReason::STEP_COMPLETE)
+        .value("BREAKPOINT",    CPUPauseReason::BREAKPOINT)
+        .value("USER_REQUEST",  CPUPauseReason::USER_REQUEST)
+        .value("IDLE_LOOP",     CPUPauseReason::IDLE_LOOP)
+        .value("HISTORY_START", CPUPauseReason::HISTORY_START)
+        .value("WATCHPOINT",    CPUPauseReason::WATCHPOINT);
+
+    enum_<WatchKind>("WatchKind")
+        .value("READ",   WatchKind::READ)
+        .value("WRITE",  WatchKind::WRITE)
+        .value("ACCESS", WatchKind::ACCESS);
+
     enum_<VMState>("VMState")
         .value("READY",   VMState::READY)
         .value("RUNNING", VMState::RUNNING)
@@ -341,6 +406,7 @@ EMSCRIPTEN_BINDINGS(n2t_cpu) {
         .constructor<>()
         // Loading
         .function("loadString", &CPUEngine::load_string)
+        .function("loadAsm",    &CPUEngine::load_asm)
         .function("reset",      &CPUEngine::reset)
         // Execution
         .function("run",        &CPUEngine::run)
@@ -348,6 +414,14 @@ EMSCRIPTEN_BINDINGS(n2t_cpu) {
         .function("step",       &CPUEngine::step)
         .function("pause",      &CPUEngine::pause)
         .function("getState",   &CPUEngine::get_state)
+        .function("getPauseReason",   &CPUEngine::get_pause_reason)
+        .function("setIdleDetection", &CPUEngine::set_idle_detection)
+        // Reverse execution
+        .function("setHistoryEnabled", &CPUEngine::set_history_enabled)
+        .function("setHistoryLimit",   &CPUEngine::set_history_limit)
+        .function("historyDepth",      &cpu_history_depth)
+        .function("stepBack",          &CPUEngine::step_back)
+        .function("runBack",           &CPUEngine::run_back)
         // Registers
         .function("getA",       &CPUEngine::get_a)
         .function("getD",       &CPUEngine::get_d)
@@ -360,15 +434,26 @@ EMSCRIPTEN_BINDINGS(n2t_cpu) {
         // I/O
         .function("getKeyboard",  &CPUEngine::get_keyboard)
         .function("setKeyboard",  &CPUEngine::set_keyboard)
+        .function("takeScreenDelta", &cpu_take_screen_delta)
         // Breakpoints
         .function("addBreakpoint",    &CPUEngine::add_breakpoint)
         .function("removeBreakpoint", &CPUEngine::remove_breakpoint)
         .function("clearBreakpoints", &CPUEngine::clear_breakpoints)
         .function("hasBreakpoint",    &CPUEngine::has_breakpoint)
         .function("getBreakpoints",   &cpu_breakpoints)
+        .function("addBreakpointAtLine", &cpu_add_breakpoint_at_line)
+        // Watchpoints
+        .function("addWatchpoint",    &CPUEngine::add_watchpoint)
+        .function("removeWatchpoint", &CPUEngine::remove_watchpoint)
+        .function("clearWatchpoints", &CPUEngine::clear_watchpoints)
+        .function("getWatchHit",      &cpu_watch_hit)
         // Disassembly
         .function("disassemble",         &CPUEngine::disassemble)
         .function("disassembleRange",    &cpu_disassemble_range)
+        .function("disassembleWindow",   &cpu_disassemble_window)
+        .function("sourceLine",          &cpu_source_line)
+        // Static analysis
+        .function("getCfgJson",          &cpu_cfg_json)
         .function("getCurrentInstruction", &cpu_current_instruction)
         // Stats & errors
         .function("getStats",         &cpu_stats)